@@ -0,0 +1,55 @@
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	thread_local unsigned long long allocations = 0;
+
+	void* counted_allocation(std::size_t size)
+	{
+		++allocations;
+		void* memory = std::malloc(size != 0 ? size : 1);
+		if (memory == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return memory;
+	}
+}
+
+unsigned long long heap_allocations()
+{
+	return allocations;
+}
+
+// the nothrow forms call these, the aligned forms keep their own allocator
+void* operator new(std::size_t size)
+{
+	return counted_allocation(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return counted_allocation(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
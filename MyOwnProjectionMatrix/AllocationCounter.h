@@ -0,0 +1,9 @@
+#pragma once
+
+// operator new is replaced for the whole program to count the heap allocations of every
+// thread, so a benchmark can show its loop allocates nothing:
+//		const unsigned long long before = heap_allocations();
+//		... timed loop ...
+//		const unsigned long long allocated = heap_allocations() - before;
+// The count is per thread, the other threads allocating meanwhile don't show up.
+unsigned long long heap_allocations();
@@ -0,0 +1,208 @@
+#include "CameraUniformBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// every region has to start at a multiple of the uniform buffer offset alignment
+	GLsizeiptr uniform_buffer_alignment()
+	{
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		return alignment;
+	}
+
+	// the same work for both ways of getting the camera, VARIANT makes every program a distinct one
+	constexpr char const* benchmarkCameraBlock =
+		"layout (std140) uniform Camera { mat4 uView; mat4 uProj; mat4 uViewProj; vec4 uCameraPosition; };\n";
+	constexpr char const* benchmarkCameraUniforms =
+		"uniform mat4 uView;\nuniform mat4 uProj;\nuniform mat4 uViewProj;\n";
+	constexpr char const* benchmarkVertexMain =
+		"layout (location = 0) in vec3 aPos;\n"
+		"uniform mat4 uModel;\n"
+		"void main() { gl_Position = uViewProj * uModel * vec4(aPos, 1.0) + (uView[3] + uProj[3]) * (1e-6 * float(VARIANT)); }\n";
+	constexpr char const* benchmarkFragment =
+		"#version 330 core\nout vec4 FragColor;\nvoid main() { FragColor = vec4(1.0); }\n";
+
+	GLuint build_benchmark_program(const bool cameraBlock, const std::size_t variant)
+	{
+		const std::string vertexSource = std::string("#version 330 core\n#define VARIANT ") + std::to_string(variant) + "\n"
+			+ (cameraBlock ? benchmarkCameraBlock : benchmarkCameraUniforms) + benchmarkVertexMain;
+		char const* vertexText = vertexSource.c_str();
+
+		const GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertex, 1, &vertexText, nullptr);
+		glCompileShader(vertex);
+		const GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragment, 1, &benchmarkFragment, nullptr);
+		glCompileShader(fragment);
+
+		const GLuint program = glCreateProgram();
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		glLinkProgram(program);
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked != GL_TRUE)
+		{
+			std::cout << "ERROR::CAMERA BENCHMARK PROGRAM NOT LINKED\n";
+			glDeleteProgram(program);
+			return 0;
+		}
+		if (cameraBlock)
+		{
+			glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Camera"), CAMERA_BLOCK_BINDING);
+		}
+		return program;
+	}
+
+	double median(std::vector<double>& times)
+	{
+		if (times.empty())
+		{
+			return 0.0;
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+}
+
+CameraUniformBuffer::CameraUniformBuffer() : stream(GL_UNIFORM_BUFFER, sizeof(CameraBlock), uniform_buffer_alignment())
+{
+}
+
+void CameraUniformBuffer::update(const CameraBlock& camera)
+{
+	void* region = stream.beginWrite();
+	if (region != nullptr)
+	{
+		std::memcpy(region, &camera, sizeof(CameraBlock));
+	}
+	stream.endWrite(sizeof(CameraBlock));
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, stream.getBuffer(), stream.getRegionOffset(), sizeof(CameraBlock));
+}
+
+void CameraUniformBuffer::endFrame()
+{
+	stream.endFrame();
+}
+
+bool CameraUniformBuffer::isPersistentlyMapped() const
+{
+	return stream.isPersistentlyMapped();
+}
+
+unsigned long long CameraUniformBuffer::getFenceWaits() const
+{
+	return stream.getFenceWaits();
+}
+
+CameraUpdateTiming measure_camera_updates(const std::size_t programs, const std::size_t draws, const int frames)
+{
+	GLint previousProgram = 0;
+	GLint previousVAO = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVAO);
+
+	// one triangle, nothing reaches the rasterizer: the frame costs the state changes and the draws
+	const float triangle[] = { -0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f, 0.0f, 0.5f, 0.0f };
+	GLuint vao, vbo;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+	glEnableVertexAttribArray(0);
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	CameraBlock camera;
+	camera.view = General4::identity();
+	camera.proj = General4::identity();
+	camera.viewProj = General4::identity();
+	camera.position[0] = 0.0f;
+	camera.position[1] = 0.0f;
+	camera.position[2] = 3.0f;
+	camera.position[3] = 1.0f;
+	const General4 model = General4::identity();
+
+	CameraUpdateTiming timing = {};
+	for (const bool cameraBlock : { true, false })
+	{
+		std::vector<GLuint> ids;
+		std::vector<GLint> modelLocations, viewLocations, projLocations, viewProjLocations;
+		for (std::size_t i = 0; i < programs; ++i)
+		{
+			const GLuint id = build_benchmark_program(cameraBlock, i);
+			if (id == 0)
+			{
+				continue;
+			}
+			ids.push_back(id);
+			modelLocations.push_back(glGetUniformLocation(id, "uModel"));
+			viewLocations.push_back(glGetUniformLocation(id, "uView"));
+			projLocations.push_back(glGetUniformLocation(id, "uProj"));
+			viewProjLocations.push_back(glGetUniformLocation(id, "uViewProj"));
+		}
+
+		CameraUniformBuffer cameraBuffer;
+		std::vector<double> times;
+		for (int frame = 0; frame < frames + 1 && !ids.empty(); ++frame)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			if (cameraBlock)
+			{
+				cameraBuffer.update(camera);
+			}
+			else
+			{
+				for (std::size_t i = 0; i < ids.size(); ++i)
+				{
+					glUseProgram(ids[i]);
+					glUniformMatrix4fv(viewLocations[i], 1, GL_FALSE, camera.view.data());
+					glUniformMatrix4fv(projLocations[i], 1, GL_FALSE, camera.proj.data());
+					glUniformMatrix4fv(viewProjLocations[i], 1, GL_FALSE, camera.viewProj.data());
+				}
+			}
+			for (std::size_t draw = 0; draw < draws; ++draw)
+			{
+				const std::size_t i = draw % ids.size();
+				glUseProgram(ids[i]);
+				glUniformMatrix4fv(modelLocations[i], 1, GL_FALSE, model.data());
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+			}
+			if (cameraBlock)
+			{
+				cameraBuffer.endFrame();
+			}
+			glFinish();
+
+			// the first frame pays for the first use of every program
+			if (frame > 0)
+			{
+				times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+		}
+		(cameraBlock ? timing.uniformBlock : timing.perProgramUniforms) = median(times);
+
+		for (const GLuint id : ids)
+		{
+			glDeleteProgram(id);
+		}
+	}
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	glUseProgram(static_cast<GLuint>(previousProgram));
+	glBindVertexArray(static_cast<GLuint>(previousVAO));
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+	return timing;
+}
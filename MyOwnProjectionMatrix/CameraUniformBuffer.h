@@ -0,0 +1,64 @@
+#pragma once
+#include <glad/glad.h>
+#include "MatrixTypes.h"
+#include "StreamingBuffer.h"
+#include <cstddef>
+
+// Uniform block binding points shared by every shader program
+// (Shader binds the blocks it finds by name right after linking)
+enum UniformBlockBinding : GLuint
+{
+	CAMERA_BLOCK_BINDING = 0,
+	MATERIAL_BLOCK_BINDING = 1	// the material table of the texture atlas (see TextureAtlas.h)
+};
+
+// std140 layout of the Camera uniform block declared in the vertex shaders:
+//		layout (std140) uniform Camera { mat4 uView; mat4 uProj; mat4 uViewProj; vec4 uCameraPosition; };
+struct CameraBlock
+{
+	General4 view;
+	General4 proj;
+	General4 viewProj;
+	float position[4];
+};
+
+static_assert(sizeof(CameraBlock) == 3 * 64 + 16, "CameraBlock must match the std140 layout of the Camera block");
+
+// Camera data for every shader program, updated with a single memcpy per frame into a
+// StreamingBuffer: FRAMES fenced regions used round-robin (triple buffering), persistently
+// mapped with GL 4.4 / ARB_buffer_storage.
+class CameraUniformBuffer
+{
+public:
+	static constexpr int FRAMES = StreamingBuffer::FRAMES;
+
+	CameraUniformBuffer();
+
+	CameraUniformBuffer(const CameraUniformBuffer&) = delete;
+	CameraUniformBuffer& operator=(const CameraUniformBuffer&) = delete;
+
+	// write this frame's camera data and bind its region to CAMERA_BLOCK_BINDING
+	void update(const CameraBlock& camera);
+
+	// fence the region used this frame and move to the next one, call after the frame draws
+	void endFrame();
+
+	bool isPersistentlyMapped() const;
+
+	// how many times the CPU had to wait for the GPU to release a region
+	unsigned long long getFenceWaits() const;
+
+private:
+	StreamingBuffer stream;
+};
+
+// Median ms per frame (submission and glFinish) for `draws` tiny draws spread round-robin over
+// `programs` distinct programs, nothing rasterized. The camera is written once per frame to the
+// Camera block, or set on every program as plain view/proj/viewProj uniforms as before the block
+struct CameraUpdateTiming
+{
+	double uniformBlock;
+	double perProgramUniforms;
+};
+
+CameraUpdateTiming measure_camera_updates(std::size_t programs, std::size_t draws, int frames);
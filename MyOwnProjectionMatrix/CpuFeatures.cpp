@@ -0,0 +1,74 @@
+#include "CpuFeatures.h"
+
+#if CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if CPU_X86
+	void cpuid(int leaf, int subleaf, unsigned int regs[4])
+	{
+#if defined(_MSC_VER)
+		int r[4];
+		__cpuidex(r, leaf, subleaf);
+		for (int i = 0; i < 4; ++i)
+		{
+			regs[i] = static_cast<unsigned int>(r[i]);
+		}
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	// XCR0 tells whether the OS saves the AVX registers on context switches
+	unsigned long long xgetbv0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+#endif
+
+	CpuFeatures detect()
+	{
+		CpuFeatures features = {};
+#if CPU_X86
+		unsigned int regs[4];
+		cpuid(0, 0, regs);
+		const unsigned int maxLeaf = regs[0];
+
+		cpuid(1, 0, regs);
+		features.sse2 = (regs[3] & (1u << 26)) != 0;
+		features.sse41 = (regs[2] & (1u << 19)) != 0;
+		const bool osxsave = (regs[2] & (1u << 27)) != 0;
+		const bool cpuAvx = (regs[2] & (1u << 28)) != 0;
+		const bool cpuFma = (regs[2] & (1u << 12)) != 0;
+
+		const bool osAvx = osxsave && (xgetbv0() & 0x6) == 0x6; // XMM and YMM state enabled
+		features.avx = cpuAvx && osAvx;
+		features.fma = cpuFma && osAvx;
+
+		if (maxLeaf >= 7)
+		{
+			cpuid(7, 0, regs);
+			features.avx2 = features.avx && (regs[1] & (1u << 5)) != 0;
+		}
+#endif
+		return features;
+	}
+}
+
+const CpuFeatures& cpu_features()
+{
+	static const CpuFeatures features = detect();
+	return features;
+}
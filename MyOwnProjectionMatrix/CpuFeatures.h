@@ -0,0 +1,31 @@
+#pragma once
+
+// Runtime detection of the x86 SIMD extensions used by the CPU-side kernels
+// (vertex transform, culling, ...). The kernels are compiled for every
+// instruction set and the best one is picked at runtime with these flags.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#else
+#define CPU_X86 0
+#endif
+
+// lets GCC/Clang compile a single function for a newer instruction set than
+// the rest of the translation unit (MSVC accepts the intrinsics without it)
+#if CPU_X86 && (defined(__GNUC__) || defined(__clang__))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define CPU_TARGET_AVX2
+#endif
+
+struct CpuFeatures
+{
+	bool sse2;
+	bool sse41;
+	bool avx;
+	bool avx2;
+	bool fma;
+};
+
+// detected once and cached
+const CpuFeatures& cpu_features();
@@ -0,0 +1,95 @@
+#include "DepthMode.h"
+#include "GLExtensions.h"
+#include <cmath>
+#include <iostream>
+
+const char* depth_mode_name(const DepthMode mode)
+{
+	switch (mode)
+	{
+	case DepthMode::ReversedZ: return "reversed-Z, 32F";
+	case DepthMode::ReversedZInfinite: return "reversed-Z infinite, 32F";
+	default: return "standard, 24 bit";
+	}
+}
+
+DepthMode supported_depth_mode(const DepthMode requested)
+{
+	if (is_reversed_z(requested) && !gl_extensions().clipControl)
+	{
+		std::cout << "Reversed-Z needs glClipControl, using the standard depth range\n";
+		return DepthMode::Standard;
+	}
+	return requested;
+}
+
+bool is_reversed_z(const DepthMode mode)
+{
+	return mode != DepthMode::Standard;
+}
+
+GLenum depth_mode_format(const DepthMode mode)
+{
+	return is_reversed_z(mode) ? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT24;
+}
+
+void apply_depth_mode(const DepthMode mode)
+{
+	if (is_reversed_z(mode))
+	{
+		// the far plane clears to 0 and nearer fragments have greater depth
+		glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+		glDepthFunc(GL_GREATER);
+		glClearDepth(0.0);
+	}
+	else
+	{
+		if (gl_extensions().clipControl)
+		{
+			glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+		}
+		glDepthFunc(GL_LESS);
+		glClearDepth(1.0);
+	}
+}
+
+double depth_resolution(const DepthMode mode, const float zNear, const float zFar, const double distance)
+{
+	const double n = zNear;
+	const double f = zFar;
+	if (distance < n || (mode != DepthMode::ReversedZInfinite && distance > f))
+	{
+		return 0.0;
+	}
+
+	// window depth d(z) and its slope, z being the view distance
+	double depth, slope;
+	switch (mode)
+	{
+	case DepthMode::ReversedZ:
+		depth = f * n / ((f - n) * distance) - n / (f - n);
+		slope = f * n / ((f - n) * distance * distance);
+		break;
+	case DepthMode::ReversedZInfinite:
+		depth = n / distance;
+		slope = n / (distance * distance);
+		break;
+	default:
+		depth = 0.5 * ((f + n) / (f - n) - 2.0 * f * n / ((f - n) * distance)) + 0.5;
+		slope = f * n / ((f - n) * distance * distance);
+		break;
+	}
+
+	// spacing of the stored values around depth
+	double step;
+	if (is_reversed_z(mode))
+	{
+		const float stored = static_cast<float>(depth);
+		step = static_cast<double>(std::nextafter(stored, 2.0f)) - static_cast<double>(stored);
+	}
+	else
+	{
+		step = 1.0 / 16777215.0;
+	}
+	return step / slope;
+}
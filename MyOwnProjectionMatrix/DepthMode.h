@@ -0,0 +1,35 @@
+#pragma once
+#include <glad/glad.h>
+
+// How depth is stored and compared by the depth-test path:
+//		Standard			[-1, 1] clip depth (my_perspective), near at window depth 0, GL_LESS,
+//							whatever depth buffer the target has (24 bit fixed point)
+//		ReversedZ			[0, 1] clip depth (glClipControl), near at 1 and far at 0 (my_perspective_reversed_z),
+//							GL_GREATER, 32 bit float depth. The float exponent spends its precision near 0,
+//							where the 1/z depth of a perspective is the flattest, so the resolvable depth step
+//							grows linearly with the distance instead of quadratically
+//		ReversedZInfinite	same with the far plane at infinity (my_perspective_infinite_reversed_z), the
+//							scene can grow by orders of magnitude without a far plane to tune
+enum class DepthMode
+{
+	Standard,
+	ReversedZ,
+	ReversedZInfinite
+};
+
+const char* depth_mode_name(DepthMode mode);
+
+// the mode the context can run: the reversed ones need glClipControl (GL 4.5 or ARB_clip_control)
+DepthMode supported_depth_mode(DepthMode requested);
+
+bool is_reversed_z(DepthMode mode);
+
+// format of the depth attachment the mode renders with
+GLenum depth_mode_format(DepthMode mode);
+
+// clip control, depth function and depth clear value of the mode, for the current context
+void apply_depth_mode(DepthMode mode);
+
+// smallest change of view distance the depth buffer still tells apart at distance
+// (from the slope of the stored depth and the spacing of its format), 0 beyond the far plane
+double depth_resolution(DepthMode mode, float zNear, float zFar, double distance);
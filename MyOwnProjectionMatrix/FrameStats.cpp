@@ -0,0 +1,105 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// nearest-rank percentile of sorted values, p in (0, 100]
+	double percentile(const std::vector<double>& sorted, const double p)
+	{
+		const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+		return sorted[std::max<std::size_t>(rank, 1) - 1];
+	}
+
+	// JSON string with quotes and control characters escaped
+	void write_json_string(std::ostream& out, const std::string& value)
+	{
+		out << '"';
+		for (const char c : value)
+		{
+			switch (c)
+			{
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) >= 0x20)
+				{
+					out << c;
+				}
+				break;
+			}
+		}
+		out << '"';
+	}
+}
+
+FrameStats::FrameStats(const std::size_t expectedFrames)
+{
+	frameTimes.reserve(expectedFrames);
+}
+
+void FrameStats::addFrame(const double milliseconds)
+{
+	frameTimes.push_back(milliseconds);
+}
+
+std::size_t FrameStats::getFrameCount() const
+{
+	return frameTimes.size();
+}
+
+FrameTimeSummary FrameStats::summarize() const
+{
+	FrameTimeSummary summary;
+	if (frameTimes.empty())
+	{
+		return summary;
+	}
+
+	std::vector<double> sorted(frameTimes);
+	std::sort(sorted.begin(), sorted.end());
+
+	summary.frames = sorted.size();
+	for (const double ms : sorted)
+	{
+		summary.totalMs += ms;
+	}
+	summary.minMs = sorted.front();
+	summary.maxMs = sorted.back();
+	summary.meanMs = summary.totalMs / static_cast<double>(sorted.size());
+	summary.medianMs = percentile(sorted, 50.0);
+	summary.p95Ms = percentile(sorted, 95.0);
+	summary.p99Ms = percentile(sorted, 99.0);
+	return summary;
+}
+
+void write_benchmark_json(std::ostream& out, const BenchmarkReport& report)
+{
+	const FrameTimeSummary& ft = report.frameTimes;
+	const double seconds = ft.totalMs / 1000.0;
+	const double draws = static_cast<double>(ft.frames * report.drawsPerFrame);
+	const double cubes = static_cast<double>(ft.frames) * static_cast<double>(report.instances > 0 ? report.instances : 1);
+
+	out << "{\n";
+	out << "  \"backend\": "; write_json_string(out, report.backend); out << ",\n";
+	out << "  \"renderer\": "; write_json_string(out, report.renderer); out << ",\n";
+	out << "  \"width\": " << report.width << ",\n";
+	out << "  \"height\": " << report.height << ",\n";
+	out << "  \"instances\": " << report.instances << ",\n";
+	out << "  \"visible_instances_per_frame\": " << report.visiblePerFrame << ",\n";
+	out << "  \"frames\": " << ft.frames << ",\n";
+	out << "  \"total_ms\": " << ft.totalMs << ",\n";
+	out << "  \"frame_ms\": {\n";
+	out << "    \"min\": " << ft.minMs << ",\n";
+	out << "    \"mean\": " << ft.meanMs << ",\n";
+	out << "    \"median\": " << ft.medianMs << ",\n";
+	out << "    \"p95\": " << ft.p95Ms << ",\n";
+	out << "    \"p99\": " << ft.p99Ms << ",\n";
+	out << "    \"max\": " << ft.maxMs << "\n";
+	out << "  },\n";
+	out << "  \"draws_per_second\": " << (seconds > 0.0 ? draws / seconds : 0.0) << ",\n";
+	out << "  \"cubes_per_second\": " << (seconds > 0.0 ? cubes / seconds : 0.0) << "\n";
+	out << "}\n";
+}
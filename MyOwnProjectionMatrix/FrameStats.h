@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Summary of a run of frame times, all in milliseconds.
+// Percentiles use the nearest-rank method over the recorded frames.
+struct FrameTimeSummary
+{
+	std::size_t frames = 0;
+	double totalMs = 0.0;
+	double minMs = 0.0;
+	double meanMs = 0.0;
+	double medianMs = 0.0;
+	double p95Ms = 0.0;
+	double p99Ms = 0.0;
+	double maxMs = 0.0;
+};
+
+// Collects the duration of every frame, storage is reserved up front so
+// recording a frame never allocates inside the measured loop
+class FrameStats
+{
+public:
+	explicit FrameStats(std::size_t expectedFrames = 0);
+
+	void addFrame(double milliseconds);
+	std::size_t getFrameCount() const;
+	FrameTimeSummary summarize() const;
+
+private:
+	std::vector<double> frameTimes;
+};
+
+// Everything the benchmark reports besides the frame times
+struct BenchmarkReport
+{
+	std::string backend;
+	std::string renderer;
+	int width = 0;
+	int height = 0;
+	std::size_t instances = 0;
+	double visiblePerFrame = 0.0; // instances left after frustum culling, on average
+	std::size_t drawsPerFrame = 0;
+	FrameTimeSummary frameTimes;
+};
+
+// write the report as a single JSON object, e.g:
+//		{ "backend": "egl-surfaceless", ..., "frame_ms": { "min": 0.41, "median": 0.52, "p95": 0.7, "p99": 0.9 }, "draws_per_second": 1923.1 }
+void write_benchmark_json(std::ostream& out, const BenchmarkReport& report);
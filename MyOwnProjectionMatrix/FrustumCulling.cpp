@@ -0,0 +1,552 @@
+#include "FrustumCulling.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	FrustumPlane normalize_plane(const float a, const float b, const float c, const float d)
+	{
+		const float length = std::sqrt(a * a + b * b + c * c);
+		if (length == 0.0f)
+		{
+			// the far plane of an infinite projection: everything is in front of it
+			return FrustumPlane{ 0.0f, 0.0f, 0.0f, 1.0f };
+		}
+		return FrustumPlane{ a / length, b / length, c / length, d / length };
+	}
+
+	// the objects a kernel reads, sorted ranges of the BVH use the same kernels
+	struct SphereArrays
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		const float* radius;
+	};
+
+	struct BoxArrays
+	{
+		const float* centerX;
+		const float* centerY;
+		const float* centerZ;
+		const float* extentX;
+		const float* extentY;
+		const float* extentZ;
+	};
+
+	SphereArrays arrays_of(const SphereBounds& bounds)
+	{
+		return SphereArrays{ bounds.x.data(), bounds.y.data(), bounds.z.data(), bounds.radius.data() };
+	}
+
+	BoxArrays arrays_of(const BoxBounds& bounds)
+	{
+		return BoxArrays{ bounds.centerX.data(), bounds.centerY.data(), bounds.centerZ.data(), bounds.extentX.data(), bounds.extentY.data(), bounds.extentZ.data() };
+	}
+
+	// ids maps a position in the arrays to the index written out, nullptr writes the position
+	std::uint32_t id_at(const std::uint32_t* ids, const std::size_t i)
+	{
+		return ids != nullptr ? ids[i] : static_cast<std::uint32_t>(i);
+	}
+
+	// ======================================================================
+	// scalar reference
+
+	bool sphere_visible(const Frustum& frustum, const float x, const float y, const float z, const float radius)
+	{
+		for (const FrustumPlane& plane : frustum.planes)
+		{
+			if (plane.a * x + plane.b * y + plane.c * z + plane.d < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the box reaches |a| ex + |b| ey + |c| ez towards the plane from its center
+	bool box_visible(const Frustum& frustum, const float cx, const float cy, const float cz, const float ex, const float ey, const float ez)
+	{
+		for (const FrustumPlane& plane : frustum.planes)
+		{
+			const float reach = std::fabs(plane.a) * ex + std::fabs(plane.b) * ey + std::fabs(plane.c) * ez;
+			if (plane.a * cx + plane.b * cy + plane.c * cz + plane.d < -reach)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::size_t spheres_scalar(const Frustum& frustum, const SphereArrays s, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		std::size_t written = 0;
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			if (sphere_visible(frustum, s.x[i], s.y[i], s.z[i], s.radius[i]))
+			{
+				visible[written++] = id_at(ids, i);
+			}
+		}
+		return written;
+	}
+
+	std::size_t boxes_scalar(const Frustum& frustum, const BoxArrays b, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		std::size_t written = 0;
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			if (box_visible(frustum, b.centerX[i], b.centerY[i], b.centerZ[i], b.extentX[i], b.extentY[i], b.extentZ[i]))
+			{
+				visible[written++] = id_at(ids, i);
+			}
+		}
+		return written;
+	}
+
+#if CPU_X86
+	// ======================================================================
+	// SSE: 4 objects per iteration, a lane is culled once any plane has it fully behind
+
+	std::size_t spheres_sse(const Frustum& frustum, const SphereArrays s, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		std::size_t written = 0;
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(s.x + i);
+			const __m128 y = _mm_loadu_ps(s.y + i);
+			const __m128 z = _mm_loadu_ps(s.z + i);
+			const __m128 radius = _mm_loadu_ps(s.radius + i);
+
+			__m128 outside = _mm_setzero_ps();
+			for (const FrustumPlane& plane : frustum.planes)
+			{
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.a), x), _mm_mul_ps(_mm_set1_ps(plane.b), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.c), z), _mm_set1_ps(plane.d)));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			}
+
+			const int mask = ~_mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if (mask & (1 << lane))
+				{
+					visible[written++] = id_at(ids, i + lane);
+				}
+			}
+		}
+		return written + spheres_scalar(frustum, s, i, end, ids, visible + written);
+	}
+
+	std::size_t boxes_sse(const Frustum& frustum, const BoxArrays b, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		std::size_t written = 0;
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 cx = _mm_loadu_ps(b.centerX + i);
+			const __m128 cy = _mm_loadu_ps(b.centerY + i);
+			const __m128 cz = _mm_loadu_ps(b.centerZ + i);
+			const __m128 ex = _mm_loadu_ps(b.extentX + i);
+			const __m128 ey = _mm_loadu_ps(b.extentY + i);
+			const __m128 ez = _mm_loadu_ps(b.extentZ + i);
+
+			__m128 outside = _mm_setzero_ps();
+			for (const FrustumPlane& plane : frustum.planes)
+			{
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.a), cx), _mm_mul_ps(_mm_set1_ps(plane.b), cy)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.c), cz), _mm_set1_ps(plane.d)));
+				const __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.a)), ex), _mm_mul_ps(_mm_set1_ps(std::fabs(plane.b)), ey)), _mm_mul_ps(_mm_set1_ps(std::fabs(plane.c)), ez));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+			}
+
+			const int mask = ~_mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if (mask & (1 << lane))
+				{
+					visible[written++] = id_at(ids, i + lane);
+				}
+			}
+		}
+		return written + boxes_scalar(frustum, b, i, end, ids, visible + written);
+	}
+
+	// ======================================================================
+	// AVX2 + FMA: 8 objects per iteration
+
+	CPU_TARGET_AVX2 std::size_t spheres_avx2(const Frustum& frustum, const SphereArrays s, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		std::size_t written = 0;
+		std::size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 x = _mm256_loadu_ps(s.x + i);
+			const __m256 y = _mm256_loadu_ps(s.y + i);
+			const __m256 z = _mm256_loadu_ps(s.z + i);
+			const __m256 radius = _mm256_loadu_ps(s.radius + i);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (const FrustumPlane& plane : frustum.planes)
+			{
+				// distance + radius in one FMA chain
+				const __m256 reach = _mm256_fmadd_ps(_mm256_set1_ps(plane.a), x, _mm256_fmadd_ps(_mm256_set1_ps(plane.b), y, _mm256_fmadd_ps(_mm256_set1_ps(plane.c), z, _mm256_add_ps(_mm256_set1_ps(plane.d), radius))));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(reach, _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+
+			const int mask = ~_mm256_movemask_ps(outside);
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				if (mask & (1 << lane))
+				{
+					visible[written++] = id_at(ids, i + lane);
+				}
+			}
+		}
+		return written + spheres_sse(frustum, s, i, end, ids, visible + written);
+	}
+
+	CPU_TARGET_AVX2 std::size_t boxes_avx2(const Frustum& frustum, const BoxArrays b, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		std::size_t written = 0;
+		std::size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 cx = _mm256_loadu_ps(b.centerX + i);
+			const __m256 cy = _mm256_loadu_ps(b.centerY + i);
+			const __m256 cz = _mm256_loadu_ps(b.centerZ + i);
+			const __m256 ex = _mm256_loadu_ps(b.extentX + i);
+			const __m256 ey = _mm256_loadu_ps(b.extentY + i);
+			const __m256 ez = _mm256_loadu_ps(b.extentZ + i);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (const FrustumPlane& plane : frustum.planes)
+			{
+				const __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.a), cx, _mm256_fmadd_ps(_mm256_set1_ps(plane.b), cy, _mm256_fmadd_ps(_mm256_set1_ps(plane.c), cz, _mm256_set1_ps(plane.d))));
+				const __m256 reach = _mm256_fmadd_ps(_mm256_set1_ps(std::fabs(plane.a)), ex, _mm256_fmadd_ps(_mm256_set1_ps(std::fabs(plane.b)), ey, _mm256_fmadd_ps(_mm256_set1_ps(std::fabs(plane.c)), ez, distance)));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(reach, _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+
+			const int mask = ~_mm256_movemask_ps(outside);
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				if (mask & (1 << lane))
+				{
+					visible[written++] = id_at(ids, i + lane);
+				}
+			}
+		}
+		return written + boxes_sse(frustum, b, i, end, ids, visible + written);
+	}
+#endif
+
+	std::size_t cull_sphere_range(const TransformKernel kernel, const Frustum& frustum, const SphereArrays s, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		switch (kernel)
+		{
+#if CPU_X86
+		case TransformKernel::AVX2: return spheres_avx2(frustum, s, begin, end, ids, visible);
+		case TransformKernel::SSE: return spheres_sse(frustum, s, begin, end, ids, visible);
+#endif
+		default: return spheres_scalar(frustum, s, begin, end, ids, visible);
+		}
+	}
+
+	std::size_t cull_box_range(const TransformKernel kernel, const Frustum& frustum, const BoxArrays b, const std::size_t begin, const std::size_t end, const std::uint32_t* ids, std::uint32_t* visible)
+	{
+		switch (kernel)
+		{
+#if CPU_X86
+		case TransformKernel::AVX2: return boxes_avx2(frustum, b, begin, end, ids, visible);
+		case TransformKernel::SSE: return boxes_sse(frustum, b, begin, end, ids, visible);
+#endif
+		default: return boxes_scalar(frustum, b, begin, end, ids, visible);
+		}
+	}
+}
+
+Frustum frustum_from_perspective(const float fovY, const float aspect, const float zNear, const float zFar, const Affine3& view)
+{
+	// view space, the camera looks down -z: the side planes go through the eye with
+	// slopes tan(fovY / 2) and aspect * tan(fovY / 2)
+	const float tanHalfFovY = std::tan(fovY / 2.0f);
+	const float tanHalfFovX = aspect * tanHalfFovY;
+	const FrustumPlane viewPlanes[6] = {
+		{ 1.0f, 0.0f, -tanHalfFovX, 0.0f },		// left:	x >= z * tanX
+		{ -1.0f, 0.0f, -tanHalfFovX, 0.0f },	// right
+		{ 0.0f, 1.0f, -tanHalfFovY, 0.0f },		// bottom
+		{ 0.0f, -1.0f, -tanHalfFovY, 0.0f },	// top
+		{ 0.0f, 0.0f, -1.0f, -zNear },			// near:	-z >= near
+		{ 0.0f, 0.0f, 1.0f, zFar } };			// far:		-z <= far
+
+	// a point p is inside when plane . (view * p) >= 0, so the world plane is transpose(view) * plane
+	const float* m = view.m;
+	Frustum frustum;
+	for (int i = 0; i < 6; ++i)
+	{
+		const FrustumPlane& p = viewPlanes[i];
+		frustum.planes[i] = normalize_plane(
+			p.a * m[0] + p.b * m[1] + p.c * m[2],
+			p.a * m[3] + p.b * m[4] + p.c * m[5],
+			p.a * m[6] + p.b * m[7] + p.c * m[8],
+			p.a * m[9] + p.b * m[10] + p.c * m[11] + p.d);
+	}
+	return frustum;
+}
+
+Frustum frustum_from_matrix(const General4& viewProj, const bool zeroToOneDepth)
+{
+	// Gribb/Hartmann: -w <= x <= w and friends, each a sum or difference of the matrix rows
+	const auto row = [&](const int r, const int c) { return viewProj.at(r, c); };
+	const auto combine = [&](const int r, const float sign) {
+		return normalize_plane(row(3, 0) + sign * row(r, 0), row(3, 1) + sign * row(r, 1), row(3, 2) + sign * row(r, 2), row(3, 3) + sign * row(r, 3));
+	};
+
+	Frustum frustum;
+	frustum.planes[0] = combine(0, 1.0f);
+	frustum.planes[1] = combine(0, -1.0f);
+	frustum.planes[2] = combine(1, 1.0f);
+	frustum.planes[3] = combine(1, -1.0f);
+	// 0 <= z instead of -w <= z
+	frustum.planes[4] = zeroToOneDepth ? normalize_plane(row(2, 0), row(2, 1), row(2, 2), row(2, 3)) : combine(2, 1.0f);
+	frustum.planes[5] = combine(2, -1.0f);
+	return frustum;
+}
+
+void SphereBounds::add(const float centerX, const float centerY, const float centerZ, const float sphereRadius)
+{
+	x.push_back(centerX);
+	y.push_back(centerY);
+	z.push_back(centerZ);
+	radius.push_back(sphereRadius);
+}
+
+std::size_t SphereBounds::size() const
+{
+	return x.size();
+}
+
+void BoxBounds::add(const float minimum[3], const float maximum[3])
+{
+	centerX.push_back(0.5f * (minimum[0] + maximum[0]));
+	centerY.push_back(0.5f * (minimum[1] + maximum[1]));
+	centerZ.push_back(0.5f * (minimum[2] + maximum[2]));
+	extentX.push_back(0.5f * (maximum[0] - minimum[0]));
+	extentY.push_back(0.5f * (maximum[1] - minimum[1]));
+	extentZ.push_back(0.5f * (maximum[2] - minimum[2]));
+}
+
+std::size_t BoxBounds::size() const
+{
+	return centerX.size();
+}
+
+std::size_t cull_spheres(const Frustum& frustum, const SphereBounds& bounds, std::uint32_t* visible)
+{
+	return cull_spheres(best_transform_kernel(), frustum, bounds, visible);
+}
+
+std::size_t cull_spheres(const TransformKernel kernel, const Frustum& frustum, const SphereBounds& bounds, std::uint32_t* visible)
+{
+	return cull_sphere_range(kernel, frustum, arrays_of(bounds), 0, bounds.size(), nullptr, visible);
+}
+
+std::size_t cull_spheres(const Frustum& frustum, const SphereBounds& bounds, const std::size_t first, const std::size_t count, std::uint32_t* visible)
+{
+	return cull_sphere_range(best_transform_kernel(), frustum, arrays_of(bounds), first, first + count, nullptr, visible);
+}
+
+std::size_t cull_boxes(const Frustum& frustum, const BoxBounds& bounds, std::uint32_t* visible)
+{
+	return cull_boxes(best_transform_kernel(), frustum, bounds, visible);
+}
+
+std::size_t cull_boxes(const TransformKernel kernel, const Frustum& frustum, const BoxBounds& bounds, std::uint32_t* visible)
+{
+	return cull_box_range(kernel, frustum, arrays_of(bounds), 0, bounds.size(), nullptr, visible);
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const BoxBounds& objects, const std::size_t objectsPerLeaf) : leafSize(std::max<std::size_t>(objectsPerLeaf, 1)), depth(0)
+{
+	const std::size_t count = objects.size();
+	ids.resize(count);
+	std::iota(ids.begin(), ids.end(), 0u);
+	if (count > 0)
+	{
+		nodes.reserve(2 * (count / leafSize + 1));
+		build(objects, 0, static_cast<std::uint32_t>(count), 1);
+	}
+
+	// objects in leaf order, a node's range is contiguous for the kernels
+	sorted.centerX.resize(count);
+	sorted.centerY.resize(count);
+	sorted.centerZ.resize(count);
+	sorted.extentX.resize(count);
+	sorted.extentY.resize(count);
+	sorted.extentZ.resize(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const std::uint32_t id = ids[i];
+		sorted.centerX[i] = objects.centerX[id];
+		sorted.centerY[i] = objects.centerY[id];
+		sorted.centerZ[i] = objects.centerZ[id];
+		sorted.extentX[i] = objects.extentX[id];
+		sorted.extentY[i] = objects.extentY[id];
+		sorted.extentZ[i] = objects.extentZ[id];
+	}
+}
+
+std::uint32_t BoundingVolumeHierarchy::build(const BoxBounds& objects, const std::uint32_t first, const std::uint32_t count, const std::size_t level)
+{
+	depth = std::max(depth, level);
+
+	// bounds of the objects and of their centers
+	float minimum[3] = { INFINITY, INFINITY, INFINITY };
+	float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+	float centerMinimum[3] = { INFINITY, INFINITY, INFINITY };
+	float centerMaximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+	const std::vector<float>* centers[3] = { &objects.centerX, &objects.centerY, &objects.centerZ };
+	const std::vector<float>* extents[3] = { &objects.extentX, &objects.extentY, &objects.extentZ };
+	for (std::uint32_t i = first; i < first + count; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			const float center = (*centers[c])[ids[i]];
+			const float extent = (*extents[c])[ids[i]];
+			minimum[c] = std::min(minimum[c], center - extent);
+			maximum[c] = std::max(maximum[c], center + extent);
+			centerMinimum[c] = std::min(centerMinimum[c], center);
+			centerMaximum[c] = std::max(centerMaximum[c], center);
+		}
+	}
+
+	const auto index = static_cast<std::uint32_t>(nodes.size());
+	Node node;
+	for (int c = 0; c < 3; ++c)
+	{
+		node.center[c] = 0.5f * (minimum[c] + maximum[c]);
+		node.extent[c] = 0.5f * (maximum[c] - minimum[c]);
+	}
+	node.first = first;
+	node.count = count;
+	node.rightChild = 0;
+	nodes.push_back(node);
+
+	if (count <= leafSize)
+	{
+		return index;
+	}
+
+	// median split along the widest spread of centers, both halves stay balanced
+	int axis = 0;
+	for (int c = 1; c < 3; ++c)
+	{
+		if (centerMaximum[c] - centerMinimum[c] > centerMaximum[axis] - centerMinimum[axis])
+		{
+			axis = c;
+		}
+	}
+	const std::vector<float>& axisCenters = *centers[axis];
+	const std::uint32_t half = count / 2;
+	std::nth_element(ids.begin() + first, ids.begin() + first + half, ids.begin() + first + count,
+		[&](const std::uint32_t l, const std::uint32_t r) { return axisCenters[l] < axisCenters[r]; });
+
+	build(objects, first, half, level + 1);
+	const std::uint32_t right = build(objects, first + half, count - half, level + 1);
+	nodes[index].rightChild = right;
+	return index;
+}
+
+std::size_t BoundingVolumeHierarchy::cull(const Frustum& frustum, std::uint32_t* visible, BvhCullStats* stats) const
+{
+	BvhCullStats counts = {};
+	std::size_t written = 0;
+	if (!nodes.empty())
+	{
+		const TransformKernel kernel = best_transform_kernel();
+		const BoxArrays objects = arrays_of(sorted);
+
+		// depth first, every entry carries the planes its parent still crossed. Median
+		// splits keep the depth near log2(objects), so the stack never holds more than 64
+		struct Entry
+		{
+			std::uint32_t node;
+			unsigned int planes;
+		};
+		Entry stack[64];
+		std::size_t stackSize = 0;
+		stack[stackSize++] = Entry{ 0, 0x3Fu };
+
+		while (stackSize > 0)
+		{
+			const Entry entry = stack[--stackSize];
+			const Node& node = nodes[entry.node];
+			++counts.nodesVisited;
+
+			unsigned int planes = entry.planes;
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; ++p)
+			{
+				if ((planes & (1u << p)) == 0)
+				{
+					continue;
+				}
+				const FrustumPlane& plane = frustum.planes[p];
+				const float distance = plane.a * node.center[0] + plane.b * node.center[1] + plane.c * node.center[2] + plane.d;
+				const float reach = std::fabs(plane.a) * node.extent[0] + std::fabs(plane.b) * node.extent[1] + std::fabs(plane.c) * node.extent[2];
+				if (distance < -reach)
+				{
+					outside = true;
+				}
+				else if (distance >= reach)
+				{
+					// the whole subtree is in front of this plane
+					planes &= ~(1u << p);
+				}
+			}
+			if (outside)
+			{
+				continue;
+			}
+
+			if (planes == 0)
+			{
+				++counts.nodesFullyInside;
+				std::copy(ids.begin() + node.first, ids.begin() + node.first + node.count, visible + written);
+				written += node.count;
+			}
+			else if (node.rightChild == 0)
+			{
+				counts.objectsTested += node.count;
+				written += cull_box_range(kernel, frustum, objects, node.first, node.first + node.count, ids.data(), visible + written);
+			}
+			else
+			{
+				stack[stackSize++] = Entry{ node.rightChild, planes };
+				stack[stackSize++] = Entry{ entry.node + 1, planes };
+			}
+		}
+	}
+
+	if (stats != nullptr)
+	{
+		*stats = counts;
+	}
+	return written;
+}
+
+std::size_t BoundingVolumeHierarchy::getNodeCount() const
+{
+	return nodes.size();
+}
+
+std::size_t BoundingVolumeHierarchy::getDepth() const
+{
+	return depth;
+}
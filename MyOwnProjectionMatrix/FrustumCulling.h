@@ -0,0 +1,101 @@
+#pragma once
+#include "MatrixTypes.h"
+#include "VertexTransform.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// View frustum culling of bounding spheres and boxes.
+// The six planes come either from the my_perspective parameters and the view matrix, or
+// from any combined view-projection (Gribb/Hartmann). Objects are stored one array per
+// component so the SSE/AVX2 kernels test 4/8 of them against a plane at once, the kernel
+// is picked like the vertex transform ones (see VertexTransform.h).
+// The results are index lists of the visible objects, in increasing order for the flat
+// tests and in hierarchy order for BoundingVolumeHierarchy::cull.
+
+// a * x + b * y + c * z + d >= 0 on the inside, (a, b, c) unit length
+struct FrustumPlane
+{
+	float a, b, c, d;
+};
+
+struct Frustum
+{
+	// left, right, bottom, top, near, far
+	FrustumPlane planes[6];
+};
+
+// view space planes of my_perspective(fovY, aspect, zNear, zFar) moved to world space by the view matrix
+Frustum frustum_from_perspective(float fovY, float aspect, float zNear, float zFar, const Affine3& view);
+
+// planes of any view-projection, zeroToOneDepth for a glClipControl(..., GL_ZERO_TO_ONE) projection
+// (the reversed-Z ones, where depth 0 is far: the near and far entries trade places).
+// An infinite far plane never culls
+Frustum frustum_from_matrix(const General4& viewProj, bool zeroToOneDepth = false);
+
+struct SphereBounds
+{
+	std::vector<float> x, y, z, radius;
+
+	void add(float centerX, float centerY, float centerZ, float sphereRadius);
+	std::size_t size() const;
+};
+
+// axis aligned, as center and half extent: the box test needs nothing else
+struct BoxBounds
+{
+	std::vector<float> centerX, centerY, centerZ, extentX, extentY, extentZ;
+
+	void add(const float minimum[3], const float maximum[3]);
+	std::size_t size() const;
+};
+
+// visible receives the index of every object touching the frustum, room for bounds.size()
+// indices is needed. Returns how many were written
+std::size_t cull_spheres(const Frustum& frustum, const SphereBounds& bounds, std::uint32_t* visible);
+std::size_t cull_spheres(TransformKernel kernel, const Frustum& frustum, const SphereBounds& bounds, std::uint32_t* visible);
+// only the objects [first, first + count), e.g. one job of a parallel cull. The indices written
+// are the ones in bounds, room for count indices is needed
+std::size_t cull_spheres(const Frustum& frustum, const SphereBounds& bounds, std::size_t first, std::size_t count, std::uint32_t* visible);
+std::size_t cull_boxes(const Frustum& frustum, const BoxBounds& bounds, std::uint32_t* visible);
+std::size_t cull_boxes(TransformKernel kernel, const Frustum& frustum, const BoxBounds& bounds, std::uint32_t* visible);
+
+struct BvhCullStats
+{
+	std::size_t nodesVisited;
+	std::size_t nodesFullyInside;	// accepted with every object below them, untested
+	std::size_t objectsTested;		// in leaves that crossed a plane
+};
+
+// Hierarchy of boxes over static objects: the nodes fully outside the frustum skip their
+// objects and the ones fully inside accept them without testing. The objects are
+// reordered so every node covers a contiguous range, leaves go through the box kernel.
+class BoundingVolumeHierarchy
+{
+public:
+	explicit BoundingVolumeHierarchy(const BoxBounds& objects, std::size_t objectsPerLeaf = 16);
+
+	// same contract as cull_boxes, the indices are the ones of the objects given to the constructor
+	std::size_t cull(const Frustum& frustum, std::uint32_t* visible, BvhCullStats* stats = nullptr) const;
+
+	std::size_t getNodeCount() const;
+	std::size_t getDepth() const;
+
+private:
+	struct Node
+	{
+		float center[3];
+		float extent[3];
+		std::uint32_t first;		// objects of the subtree, in sorted
+		std::uint32_t count;
+		std::uint32_t rightChild;	// 0 for leaves, the left child is the next node
+	};
+
+	std::uint32_t build(const BoxBounds& objects, std::uint32_t first, std::uint32_t count, std::size_t level);
+
+	std::vector<Node> nodes;
+	BoxBounds sorted;
+	std::vector<std::uint32_t> ids;	// object index of every sorted entry
+	std::size_t leafSize;
+	std::size_t depth;
+};
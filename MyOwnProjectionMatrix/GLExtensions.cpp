@@ -0,0 +1,109 @@
+#include "GLExtensions.h"
+#include <cstring>
+#include <iostream>
+
+PFN_glBufferStorage ext_glBufferStorage = nullptr;
+PFN_glGetProgramBinary ext_glGetProgramBinary = nullptr;
+PFN_glProgramBinary ext_glProgramBinary = nullptr;
+PFN_glProgramParameteri ext_glProgramParameteri = nullptr;
+PFN_glMaxShaderCompilerThreadsKHR ext_glMaxShaderCompilerThreadsKHR = nullptr;
+PFN_glClipControl ext_glClipControl = nullptr;
+PFN_glMultiDrawElementsIndirect ext_glMultiDrawElementsIndirect = nullptr;
+PFN_glTexStorage2D ext_glTexStorage2D = nullptr;
+
+namespace
+{
+	GLExtensions extensions = {};
+
+	bool version_at_least(int major, int minor)
+	{
+		return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+	}
+
+	template <typename Proc>
+	bool load_proc(GLADloadproc load, Proc& proc, char const* name)
+	{
+		proc = reinterpret_cast<Proc>(load(name));
+		return proc != nullptr;
+	}
+}
+
+void load_gl_extensions(GLADloadproc load)
+{
+	extensions = GLExtensions{};
+
+	if (version_at_least(4, 4) || has_gl_extension("GL_ARB_buffer_storage"))
+	{
+		extensions.bufferStorage = load_proc(load, ext_glBufferStorage, "glBufferStorage");
+	}
+
+	if (version_at_least(4, 1) || has_gl_extension("GL_ARB_get_program_binary"))
+	{
+		// a driver may expose the entry points without supporting any binary format
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		extensions.programBinary = formats > 0
+			&& load_proc(load, ext_glGetProgramBinary, "glGetProgramBinary")
+			&& load_proc(load, ext_glProgramBinary, "glProgramBinary")
+			&& load_proc(load, ext_glProgramParameteri, "glProgramParameteri");
+	}
+
+	if (has_gl_extension("GL_KHR_parallel_shader_compile"))
+	{
+		extensions.parallelShaderCompile = load_proc(load, ext_glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsKHR");
+	}
+	else if (has_gl_extension("GL_ARB_parallel_shader_compile"))
+	{
+		extensions.parallelShaderCompile = load_proc(load, ext_glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsARB");
+	}
+
+	if (version_at_least(4, 5) || has_gl_extension("GL_ARB_clip_control"))
+	{
+		extensions.clipControl = load_proc(load, ext_glClipControl, "glClipControl");
+	}
+
+	if (version_at_least(4, 3) || (has_gl_extension("GL_ARB_multi_draw_indirect") && has_gl_extension("GL_ARB_base_instance")))
+	{
+		extensions.multiDrawIndirect = load_proc(load, ext_glMultiDrawElementsIndirect, "glMultiDrawElementsIndirect");
+	}
+
+	// formats only, no entry points beyond glCompressedTexImage2D
+	extensions.textureCompressionS3tc = has_gl_extension("GL_EXT_texture_compression_s3tc");
+	extensions.textureCompressionBptc = version_at_least(4, 2) || has_gl_extension("GL_ARB_texture_compression_bptc");
+	extensions.textureCompressionEtc2 = version_at_least(4, 3) || has_gl_extension("GL_ARB_ES3_compatibility");
+
+	if (version_at_least(4, 2) || has_gl_extension("GL_ARB_texture_storage"))
+	{
+		extensions.textureStorage = load_proc(load, ext_glTexStorage2D, "glTexStorage2D");
+	}
+
+	std::cout << "\n\nOPENGL EXTENSIONS (" << GLVersion.major << "." << GLVersion.minor << "):\n";
+	std::cout << "Buffer storage: " << (extensions.bufferStorage ? "yes" : "no") << std::endl;
+	std::cout << "Program binary: " << (extensions.programBinary ? "yes" : "no") << std::endl;
+	std::cout << "Parallel shader compile: " << (extensions.parallelShaderCompile ? "yes" : "no") << std::endl;
+	std::cout << "Clip control: " << (extensions.clipControl ? "yes" : "no") << std::endl;
+	std::cout << "Multi-draw indirect: " << (extensions.multiDrawIndirect ? "yes" : "no") << std::endl;
+	std::cout << "Compressed textures (BC1/BC3, BC7, ETC2): " << (extensions.textureCompressionS3tc ? "yes" : "no") << ", "
+		<< (extensions.textureCompressionBptc ? "yes" : "no") << ", " << (extensions.textureCompressionEtc2 ? "yes" : "no") << std::endl;
+	std::cout << "Texture storage: " << (extensions.textureStorage ? "yes" : "no") << std::endl;
+}
+
+const GLExtensions& gl_extensions()
+{
+	return extensions;
+}
+
+bool has_gl_extension(char const* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i)
+	{
+		const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+		if (extension != nullptr && std::strcmp(extension, name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
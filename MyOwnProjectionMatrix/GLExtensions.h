@@ -0,0 +1,150 @@
+#pragma once
+#include <glad/glad.h>
+
+// OpenGL entry points newer than the 3.3 core profile glad was generated for.
+// They are loaded at runtime after glad (load_gl_extensions), every feature that
+// uses them checks gl_extensions() first and falls back to plain 3.3 code paths.
+
+struct GLExtensions
+{
+	// GL 4.4 or ARB_buffer_storage: glBufferStorage, persistent mapping
+	bool bufferStorage;
+
+	// GL 4.1 or ARB_get_program_binary, with at least one binary format: glGetProgramBinary, glProgramBinary
+	bool programBinary;
+
+	// KHR_parallel_shader_compile or ARB_parallel_shader_compile: compiles and links run on
+	// driver threads, GL_COMPLETION_STATUS_KHR tells when they are done without waiting
+	bool parallelShaderCompile;
+
+	// GL 4.5 or ARB_clip_control: glClipControl, [0, 1] clip depth for reversed-Z
+	bool clipControl;
+
+	// GL 4.3 or ARB_multi_draw_indirect with ARB_base_instance: glMultiDrawElementsIndirect,
+	// commands read from GL_DRAW_INDIRECT_BUFFER with their baseInstance honoured
+	bool multiDrawIndirect;
+
+	// block compressed textures glCompressedTexImage2D takes (see Ktx2File.h): EXT_texture_compression_s3tc
+	// for BC1 and BC3, GL 4.2 or ARB_texture_compression_bptc for BC7, GL 4.3 or ARB_ES3_compatibility for ETC2
+	bool textureCompressionS3tc;
+	bool textureCompressionBptc;
+	bool textureCompressionEtc2;
+
+	// GL 4.2 or ARB_texture_storage: glTexStorage2D, immutable storage for every level at once
+	bool textureStorage;
+};
+
+// call once per context, right after gladLoadGLLoader
+void load_gl_extensions(GLADloadproc load);
+const GLExtensions& gl_extensions();
+
+// is the extension listed by glGetStringi(GL_EXTENSIONS, i)?
+bool has_gl_extension(char const* name);
+
+// ======================================================================
+// ARB_buffer_storage
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+typedef void (APIENTRYP PFN_glBufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+extern PFN_glBufferStorage ext_glBufferStorage;
+#define glBufferStorage ext_glBufferStorage
+
+// ======================================================================
+// ARB_get_program_binary
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP PFN_glGetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFN_glProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFN_glProgramParameteri)(GLuint program, GLenum pname, GLint value);
+extern PFN_glGetProgramBinary ext_glGetProgramBinary;
+extern PFN_glProgramBinary ext_glProgramBinary;
+extern PFN_glProgramParameteri ext_glProgramParameteri;
+#define glGetProgramBinary ext_glGetProgramBinary
+#define glProgramBinary ext_glProgramBinary
+#define glProgramParameteri ext_glProgramParameteri
+
+// ======================================================================
+// KHR_parallel_shader_compile (same enums as ARB_parallel_shader_compile)
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP PFN_glMaxShaderCompilerThreadsKHR)(GLuint count);
+extern PFN_glMaxShaderCompilerThreadsKHR ext_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR ext_glMaxShaderCompilerThreadsKHR
+
+// ======================================================================
+// ARB_clip_control
+
+#ifndef GL_LOWER_LEFT
+#define GL_LOWER_LEFT 0x8CA1
+#endif
+#ifndef GL_NEGATIVE_ONE_TO_ONE
+#define GL_NEGATIVE_ONE_TO_ONE 0x935E
+#endif
+#ifndef GL_ZERO_TO_ONE
+#define GL_ZERO_TO_ONE 0x935F
+#endif
+
+typedef void (APIENTRYP PFN_glClipControl)(GLenum origin, GLenum depth);
+extern PFN_glClipControl ext_glClipControl;
+#define glClipControl ext_glClipControl
+
+// ======================================================================
+// ARB_multi_draw_indirect (and ARB_draw_indirect for the buffer target)
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+typedef void (APIENTRYP PFN_glMultiDrawElementsIndirect)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+extern PFN_glMultiDrawElementsIndirect ext_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect ext_glMultiDrawElementsIndirect
+
+// ======================================================================
+// EXT_texture_compression_s3tc, ARB_texture_compression_bptc and ARB_ES3_compatibility
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+// ======================================================================
+// ARB_texture_storage
+
+typedef void (APIENTRYP PFN_glTexStorage2D)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+extern PFN_glTexStorage2D ext_glTexStorage2D;
+#define glTexStorage2D ext_glTexStorage2D
@@ -0,0 +1,358 @@
+#include "GeometryPool.h"
+#include "GLExtensions.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	// the types glDrawElements takes, anything else would be drawn with the wrong stride
+	GLenum checked_index_type(const GLenum indexType)
+	{
+		if (indexType == GL_UNSIGNED_BYTE || indexType == GL_UNSIGNED_SHORT || indexType == GL_UNSIGNED_INT)
+		{
+			return indexType;
+		}
+		std::cout << "ERROR GEOMETRY POOL: index type 0x" << std::hex << indexType << std::dec << " is not an index type, using GL_UNSIGNED_INT\n";
+		return GL_UNSIGNED_INT;
+	}
+
+	template <typename Index>
+	void upload_narrowed(const GLintptr offset, const unsigned int* indices, const std::uint32_t indexCount)
+	{
+		const std::vector<Index> narrowed(indices, indices + indexCount);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, static_cast<GLsizeiptr>(indexCount * sizeof(Index)), narrowed.data());
+	}
+}
+
+RangeAllocator::RangeAllocator(const std::uint32_t capacity) : capacity(capacity), freeUnits(0)
+{
+	reset(0);
+}
+
+bool RangeAllocator::allocate(const std::uint32_t size, std::uint32_t& offset)
+{
+	if (size == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	// best fit: the smallest block that holds size keeps the large ones whole
+	auto best = freeBlocks.end();
+	for (auto block = freeBlocks.begin(); block != freeBlocks.end(); ++block)
+	{
+		if (block->second >= size && (best == freeBlocks.end() || block->second < best->second))
+		{
+			best = block;
+		}
+	}
+	if (best == freeBlocks.end())
+	{
+		return false;
+	}
+
+	offset = best->first;
+	const std::uint32_t left = best->second - size;
+	freeBlocks.erase(best);
+	if (left > 0)
+	{
+		freeBlocks[offset + size] = left;
+	}
+	freeUnits -= size;
+	return true;
+}
+
+void RangeAllocator::free(std::uint32_t offset, std::uint32_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+	freeUnits += size;
+
+	// merge with the block ending at offset and the one starting right after
+	auto next = freeBlocks.lower_bound(offset);
+	if (next != freeBlocks.begin())
+	{
+		const auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			freeBlocks.erase(previous);
+		}
+	}
+	if (next != freeBlocks.end() && offset + size == next->first)
+	{
+		size += next->second;
+		freeBlocks.erase(next);
+	}
+	freeBlocks[offset] = size;
+}
+
+void RangeAllocator::reset(const std::uint32_t used)
+{
+	freeBlocks.clear();
+	if (used < capacity)
+	{
+		freeBlocks[used] = capacity - used;
+	}
+	freeUnits = capacity - std::min(used, capacity);
+}
+
+std::uint32_t RangeAllocator::getCapacity() const
+{
+	return capacity;
+}
+
+std::uint32_t RangeAllocator::getFreeUnits() const
+{
+	return freeUnits;
+}
+
+std::uint32_t RangeAllocator::getLargestFreeBlock() const
+{
+	std::uint32_t largest = 0;
+	for (const auto& block : freeBlocks)
+	{
+		largest = std::max(largest, block.second);
+	}
+	return largest;
+}
+
+std::size_t RangeAllocator::getFreeBlockCount() const
+{
+	return freeBlocks.size();
+}
+
+GeometryPool::GeometryPool(const VertexLayout& layout, const std::uint32_t vertexCapacity, const std::uint32_t indexCapacity, const GLenum indexType)
+	: layout(layout), indexType(checked_index_type(indexType)), indexSize(index_type_size(this->indexType)), vertexArray(0), vertexBuffer(0), indexBuffer(0),
+	vertexAllocator(vertexCapacity), indexAllocator(indexCapacity), liveMeshes(0), defragmentations(0), bytesMoved(0)
+{
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &indexBuffer);
+
+	// filled through GL_COPY_WRITE_BUFFER, which no VAO records
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexCapacity) * static_cast<GLsizeiptr>(layout.getStride()), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indexCapacity) * static_cast<GLsizeiptr>(indexSize), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	attachBuffers();
+}
+
+GeometryPool::~GeometryPool()
+{
+	glDeleteVertexArrays(1, &vertexArray);
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+}
+
+GeometryHandle GeometryPool::add(const unsigned char* vertices, const std::uint32_t vertexCount, const unsigned int* indices, const std::uint32_t indexCount)
+{
+	if (indexSize < 4 && vertexCount > (1u << (8 * indexSize)))
+	{
+		std::cout << "ERROR GEOMETRY POOL: " << vertexCount << " vertices don't fit " << 8 * indexSize << " bit indices\n";
+		return INVALID_GEOMETRY;
+	}
+
+	// compact once when the free space is there but scattered
+	GeometryRange range = { 0, vertexCount, 0, indexCount };
+	bool fits = vertexAllocator.allocate(vertexCount, range.firstVertex);
+	if (fits && !indexAllocator.allocate(indexCount, range.firstIndex))
+	{
+		vertexAllocator.free(range.firstVertex, vertexCount);
+		fits = false;
+	}
+	if (!fits && vertexAllocator.getFreeUnits() >= vertexCount && indexAllocator.getFreeUnits() >= indexCount)
+	{
+		defragment();
+		fits = vertexAllocator.allocate(vertexCount, range.firstVertex) && indexAllocator.allocate(indexCount, range.firstIndex);
+	}
+	if (!fits)
+	{
+		std::cout << "ERROR GEOMETRY POOL FULL: " << vertexCount << " vertices, " << indexCount << " indices requested\n";
+		return INVALID_GEOMETRY;
+	}
+
+	const GLsizeiptr stride = static_cast<GLsizeiptr>(layout.getStride());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstVertex * stride, vertexCount * stride, vertices);
+
+	// local indices in the pool index type
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	const GLintptr indexOffset = static_cast<GLintptr>(range.firstIndex * indexSize);
+	if (indexType == GL_UNSIGNED_BYTE)
+	{
+		upload_narrowed<std::uint8_t>(indexOffset, indices, indexCount);
+	}
+	else if (indexType == GL_UNSIGNED_SHORT)
+	{
+		upload_narrowed<std::uint16_t>(indexOffset, indices, indexCount);
+	}
+	else
+	{
+		glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset, static_cast<GLsizeiptr>(indexCount * indexSize), indices);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	GeometryHandle mesh;
+	if (freeHandles.empty())
+	{
+		mesh = static_cast<GeometryHandle>(entries.size());
+		entries.push_back(Entry{ range, true });
+	}
+	else
+	{
+		mesh = freeHandles.back();
+		freeHandles.pop_back();
+		entries[mesh] = Entry{ range, true };
+	}
+	++liveMeshes;
+	return mesh;
+}
+
+void GeometryPool::remove(const GeometryHandle mesh)
+{
+	if (mesh >= entries.size() || !entries[mesh].live)
+	{
+		return;
+	}
+
+	Entry& entry = entries[mesh];
+	vertexAllocator.free(entry.range.firstVertex, entry.range.vertexCount);
+	indexAllocator.free(entry.range.firstIndex, entry.range.indexCount);
+	entry.live = false;
+	freeHandles.push_back(mesh);
+	--liveMeshes;
+}
+
+void GeometryPool::defragment()
+{
+	// copies inside one buffer can't overlap, the meshes move into new buffers instead
+	const GLsizeiptr stride = static_cast<GLsizeiptr>(layout.getStride());
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexAllocator.getCapacity()) * stride, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indexAllocator.getCapacity()) * static_cast<GLsizeiptr>(indexSize), nullptr, GL_STATIC_DRAW);
+
+	// in buffer order, so the meshes keep their relative placement
+	std::vector<GeometryHandle> live;
+	for (GeometryHandle mesh = 0; mesh < entries.size(); ++mesh)
+	{
+		if (entries[mesh].live)
+		{
+			live.push_back(mesh);
+		}
+	}
+
+	std::sort(live.begin(), live.end(), [this](const GeometryHandle a, const GeometryHandle b) { return entries[a].range.firstVertex < entries[b].range.firstVertex; });
+	glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+	std::uint32_t vertexEnd = 0;
+	for (const GeometryHandle mesh : live)
+	{
+		GeometryRange& range = entries[mesh].range;
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.firstVertex * stride, vertexEnd * stride, range.vertexCount * stride);
+		bytesMoved += static_cast<unsigned long long>(range.vertexCount * stride);
+		range.firstVertex = vertexEnd;
+		vertexEnd += range.vertexCount;
+	}
+
+	std::sort(live.begin(), live.end(), [this](const GeometryHandle a, const GeometryHandle b) { return entries[a].range.firstIndex < entries[b].range.firstIndex; });
+	glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+	std::uint32_t indexEnd = 0;
+	for (const GeometryHandle mesh : live)
+	{
+		GeometryRange& range = entries[mesh].range;
+		const GLsizeiptr bytes = static_cast<GLsizeiptr>(range.indexCount * indexSize);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.firstIndex * indexSize), static_cast<GLintptr>(indexEnd * indexSize), bytes);
+		bytesMoved += static_cast<unsigned long long>(bytes);
+		range.firstIndex = indexEnd;
+		indexEnd += range.indexCount;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	vertexBuffer = buffers[0];
+	indexBuffer = buffers[1];
+	attachBuffers();
+
+	vertexAllocator.reset(vertexEnd);
+	indexAllocator.reset(indexEnd);
+	++defragmentations;
+}
+
+const GeometryRange& GeometryPool::getRange(const GeometryHandle mesh) const
+{
+	return entries[mesh].range;
+}
+
+DrawElementsIndirectCommand GeometryPool::command(const GeometryHandle mesh, const GLuint instanceCount, const GLuint baseInstance) const
+{
+	const GeometryRange& range = entries[mesh].range;
+	return DrawElementsIndirectCommand{ range.indexCount, instanceCount, range.firstIndex, static_cast<GLint>(range.firstVertex), baseInstance };
+}
+
+void GeometryPool::multiDraw(const GLintptr indirectOffset, const GLsizei count) const
+{
+	glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, reinterpret_cast<const void*>(indirectOffset), count, sizeof(DrawElementsIndirectCommand));
+}
+
+void GeometryPool::draw(const DrawElementsIndirectCommand& command) const
+{
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count), indexType,
+		reinterpret_cast<const void*>(static_cast<std::size_t>(command.firstIndex) * indexSize), static_cast<GLsizei>(command.instanceCount), command.baseVertex);
+}
+
+GLuint GeometryPool::getVertexArray() const
+{
+	return vertexArray;
+}
+
+GLenum GeometryPool::getIndexType() const
+{
+	return indexType;
+}
+
+GeometryPoolStats GeometryPool::getStats() const
+{
+	GeometryPoolStats stats;
+	stats.meshes = liveMeshes;
+	stats.vertexCapacity = vertexAllocator.getCapacity();
+	stats.verticesUsed = stats.vertexCapacity - vertexAllocator.getFreeUnits();
+	stats.indexCapacity = indexAllocator.getCapacity();
+	stats.indicesUsed = stats.indexCapacity - indexAllocator.getFreeUnits();
+	stats.freeVertexBlocks = vertexAllocator.getFreeBlockCount();
+	stats.freeIndexBlocks = indexAllocator.getFreeBlockCount();
+	stats.largestFreeVertexBlock = vertexAllocator.getLargestFreeBlock();
+	stats.largestFreeIndexBlock = indexAllocator.getLargestFreeBlock();
+	stats.defragmentations = defragmentations;
+	stats.bytesMoved = bytesMoved;
+	return stats;
+}
+
+void GeometryPool::attachBuffers()
+{
+	GLint previous = 0;
+	GLint previousArrayBuffer = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousArrayBuffer);
+
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	layout.apply();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	// GL_ARRAY_BUFFER isn't VAO state, the attribute pointers already captured the buffer
+	glBindVertexArray(static_cast<GLuint>(previous));
+	glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(previousArrayBuffer));
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <glad/glad.h>
+#include "VertexLayout.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Free list sub-allocator of [0, capacity) units: best fit, freed ranges merge with their
+// free neighbours, so the blocks only stay apart when live ranges sit between them
+class RangeAllocator
+{
+public:
+	explicit RangeAllocator(std::uint32_t capacity);
+
+	// false when no free block is large enough (a defragmentation may make one)
+	bool allocate(std::uint32_t size, std::uint32_t& offset);
+	void free(std::uint32_t offset, std::uint32_t size);
+
+	// after a compaction: [0, used) is taken, the rest is one free block
+	void reset(std::uint32_t used);
+
+	std::uint32_t getCapacity() const;
+	std::uint32_t getFreeUnits() const;
+	std::uint32_t getLargestFreeBlock() const;
+	std::size_t getFreeBlockCount() const;
+
+private:
+	std::map<std::uint32_t, std::uint32_t> freeBlocks; // offset -> size
+	std::uint32_t capacity;
+	std::uint32_t freeUnits;
+};
+
+// layout of the records glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint count;			// indices
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;		// added to every index, so the indices of a mesh stay local to it
+	GLuint baseInstance;	// first instance attribute read (divisor 1)
+};
+
+using GeometryHandle = std::uint32_t;
+constexpr GeometryHandle INVALID_GEOMETRY = 0xFFFFFFFFu;
+
+// where a mesh lives in the pool buffers, in vertices and indices
+struct GeometryRange
+{
+	std::uint32_t firstVertex;
+	std::uint32_t vertexCount;
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+};
+
+struct GeometryPoolStats
+{
+	std::size_t meshes;
+	std::uint32_t verticesUsed, vertexCapacity;
+	std::uint32_t indicesUsed, indexCapacity;
+	std::size_t freeVertexBlocks, freeIndexBlocks;
+	std::uint32_t largestFreeVertexBlock, largestFreeIndexBlock;
+	unsigned long long defragmentations;
+	unsigned long long bytesMoved;	// by glCopyBufferSubData in the defragmentations
+};
+
+// Every mesh in one vertex buffer, one index buffer and one VAO: meshes are added and
+// removed through the two sub-allocators and drawn together with one
+// glMultiDrawElementsIndirect per state bucket, instead of one VAO bind and draw each.
+// The indices stay local to their mesh (baseVertex), so they never need rewriting: not
+// when added, not when defragment() moves the meshes.
+// All meshes share the vertex layout and the index type of the pool.
+class GeometryPool
+{
+public:
+	// indexType GL_UNSIGNED_BYTE or GL_UNSIGNED_SHORT limits the meshes to 256 or 65536
+	// vertices each, any other type than those and GL_UNSIGNED_INT is reported and replaced by it
+	GeometryPool(const VertexLayout& layout, std::uint32_t vertexCapacity, std::uint32_t indexCapacity, GLenum indexType = GL_UNSIGNED_SHORT);
+	~GeometryPool();
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// copy a mesh in, vertices packed with the pool layout. Defragments when the free space
+	// is too scattered, returns INVALID_GEOMETRY when the mesh doesn't fit anyway
+	GeometryHandle add(const unsigned char* vertices, std::uint32_t vertexCount, const unsigned int* indices, std::uint32_t indexCount);
+	void remove(GeometryHandle mesh);
+
+	// move the meshes to the front of the buffers with GPU copies, leaving one free block in
+	// each (the handles stay valid, their ranges change)
+	void defragment();
+
+	const GeometryRange& getRange(GeometryHandle mesh) const;
+
+	// the draw of instanceCount instances of the mesh, attributes from baseInstance on
+	DrawElementsIndirectCommand command(GeometryHandle mesh, GLuint instanceCount, GLuint baseInstance) const;
+
+	// GL thread, with getVertexArray() bound: count commands of the bound GL_DRAW_INDIRECT_BUFFER
+	// from offset with one glMultiDrawElementsIndirect (needs gl_extensions().multiDrawIndirect)
+	void multiDraw(GLintptr indirectOffset, GLsizei count) const;
+
+	// one command with glDrawElementsInstancedBaseVertex, the GL 3.3 path: baseInstance is
+	// ignored, the caller points the instance attributes at it
+	void draw(const DrawElementsIndirectCommand& command) const;
+
+	GLuint getVertexArray() const;
+	GLenum getIndexType() const;
+	GeometryPoolStats getStats() const;
+
+private:
+	struct Entry
+	{
+		GeometryRange range;
+		bool live;
+	};
+
+	// the pool buffers in the VAO, the previous VAO and GL_ARRAY_BUFFER bindings are kept
+	void attachBuffers();
+
+	VertexLayout layout;
+	GLenum indexType;
+	std::size_t indexSize;
+	GLuint vertexArray;
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	RangeAllocator vertexAllocator;
+	RangeAllocator indexAllocator;
+	std::vector<Entry> entries;
+	std::vector<GeometryHandle> freeHandles;
+	std::size_t liveMeshes;
+	unsigned long long defragmentations;
+	unsigned long long bytesMoved;
+};
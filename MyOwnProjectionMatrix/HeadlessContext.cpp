@@ -0,0 +1,250 @@
+#include "HeadlessContext.h"
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+#if defined(__linux__)
+#define HEADLESS_USE_EGL 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#else
+#define HEADLESS_USE_EGL 0
+#endif
+
+#if HEADLESS_USE_EGL
+namespace
+{
+	// whole-word match in the space separated EGL_EXTENSIONS string
+	bool has_egl_extension(EGLDisplay display, char const* name)
+	{
+		char const* extensions = eglQueryString(display, EGL_EXTENSIONS);
+		if (extensions == nullptr)
+		{
+			return false;
+		}
+		const std::size_t length = std::strlen(name);
+		for (char const* found = std::strstr(extensions, name); found != nullptr; found = std::strstr(found + length, name))
+		{
+			const bool startsWord = found == extensions || found[-1] == ' ';
+			const bool endsWord = found[length] == ' ' || found[length] == '\0';
+			if (startsWord && endsWord)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+#endif
+
+HeadlessContext::HeadlessContext() : display(nullptr), context(nullptr), window(nullptr), ownsDisplay(true)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	if (window != nullptr)
+	{
+		glfwDestroyWindow(static_cast<GLFWwindow*>(window));
+		if (ownsDisplay)
+		{
+			glfwTerminate();
+		}
+	}
+#if HEADLESS_USE_EGL
+	if (display != nullptr)
+	{
+		if (ownsDisplay)
+		{
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		}
+		if (context != nullptr)
+		{
+			eglDestroyContext(display, context);
+		}
+		if (ownsDisplay)
+		{
+			eglTerminate(display);
+		}
+	}
+#endif
+}
+
+bool HeadlessContext::create(const int major, const int minor)
+{
+#if HEADLESS_USE_EGL
+	// prefer the surfaceless platform: no X11/Wayland connection nor GPU device needed
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (getPlatformDisplay != nullptr)
+	{
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (eglDisplay == EGL_NO_DISPLAY)
+	{
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint eglMajor, eglMinor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &eglMajor, &eglMinor))
+	{
+		std::cout << "Could not initialize EGL\n";
+		return false;
+	}
+	display = eglDisplay;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "EGL does not support desktop OpenGL\n";
+		return false;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, major,
+		EGL_CONTEXT_MINOR_VERSION, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// no config nor surface needed, shared contexts rely on the same display (see createShared)
+	static constexpr char const* requiredExtensions[] = { "EGL_KHR_no_config_context", "EGL_KHR_surfaceless_context" };
+	for (char const* extension : requiredExtensions)
+	{
+		if (!has_egl_extension(eglDisplay, extension))
+		{
+			std::cout << "EGL display lacks " << extension << ", a context without config nor surface can't be created\n";
+			return false;
+		}
+	}
+
+	const EGLContext eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT)
+	{
+		std::cout << "Could not create EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")\n";
+		return false;
+	}
+	context = eglContext;
+
+	if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		std::cout << "Could not make the EGL context current\n";
+		return false;
+	}
+	return true;
+#else
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* hiddenWindow = glfwCreateWindow(1, 1, "headless", NULL, NULL);
+	if (hiddenWindow == NULL)
+	{
+		std::cout << "Hidden window could not be created\n";
+		return false;
+	}
+	window = hiddenWindow;
+	glfwMakeContextCurrent(hiddenWindow);
+	glfwSwapInterval(0);
+	return true;
+#endif
+}
+
+bool HeadlessContext::createShared(const HeadlessContext& share, const int major, const int minor)
+{
+	if (share.window != nullptr)
+	{
+		return createShared(static_cast<GLFWwindow*>(share.window), major, minor);
+	}
+#if HEADLESS_USE_EGL
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, major,
+		EGL_CONTEXT_MINOR_VERSION, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// create checked the display for no config and surfaceless contexts
+	const EGLContext eglContext = eglCreateContext(share.display, EGL_NO_CONFIG_KHR, share.context, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT)
+	{
+		std::cout << "Could not create shared EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")\n";
+		return false;
+	}
+	display = share.display;
+	context = eglContext;
+	ownsDisplay = false;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool HeadlessContext::createShared(GLFWwindow* share, const int major, const int minor)
+{
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// GLFW keeps the calling thread's current context
+	GLFWwindow* hiddenWindow = glfwCreateWindow(1, 1, "shared", NULL, share);
+	glfwDefaultWindowHints();
+	if (hiddenWindow == NULL)
+	{
+		std::cout << "Shared hidden window could not be created\n";
+		return false;
+	}
+	window = hiddenWindow;
+	ownsDisplay = false;
+	return true;
+}
+
+bool HeadlessContext::makeCurrent()
+{
+	if (window != nullptr)
+	{
+		glfwMakeContextCurrent(static_cast<GLFWwindow*>(window));
+		return true;
+	}
+#if HEADLESS_USE_EGL
+	return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_TRUE;
+#else
+	return false;
+#endif
+}
+
+void HeadlessContext::doneCurrent()
+{
+	if (window != nullptr)
+	{
+		glfwMakeContextCurrent(NULL);
+		return;
+	}
+#if HEADLESS_USE_EGL
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+#endif
+}
+
+GLADloadproc HeadlessContext::getProcAddress()
+{
+#if HEADLESS_USE_EGL
+	return reinterpret_cast<GLADloadproc>(eglGetProcAddress);
+#else
+	return reinterpret_cast<GLADloadproc>(glfwGetProcAddress);
+#endif
+}
+
+const char* HeadlessContext::getBackend() const
+{
+	if (window != nullptr)
+	{
+		return "glfw-hidden-window";
+	}
+#if HEADLESS_USE_EGL
+	return "egl-surfaceless";
+#else
+	return "glfw-hidden-window";
+#endif
+}
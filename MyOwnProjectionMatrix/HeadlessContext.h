@@ -0,0 +1,45 @@
+#pragma once
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+// OpenGL context without a visible window, for benchmarking on machines without a display.
+// On Linux it is a surfaceless EGL context (works with Mesa llvmpipe, no X server needed),
+// elsewhere it falls back to a hidden GLFW window.
+// Rendering has to go to a framebuffer object (see OffscreenFramebuffer), the
+// context has no default framebuffer to draw to.
+// A context can also be created sharing objects with the render context, for worker
+// threads that compile or upload while the render loop keeps drawing.
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// create a core profile context of at least the given version and make it current
+	bool create(int major, int minor);
+
+	// create a context sharing objects (programs, buffers, syncs...) with another one,
+	// made current later on the thread that uses it (see makeCurrent)
+	bool createShared(const HeadlessContext& share, int major, int minor);
+	bool createShared(GLFWwindow* share, int major, int minor);
+
+	// bind to / release from the calling thread
+	bool makeCurrent();
+	void doneCurrent();
+
+	// for gladLoadGLLoader and load_gl_extensions
+	static GLADloadproc getProcAddress();
+
+	// human readable name of the backend that created the context
+	const char* getBackend() const;
+
+private:
+	void* display;
+	void* context;
+	void* window;
+	bool ownsDisplay; // false for shared contexts, the display belongs to the one shared with
+};
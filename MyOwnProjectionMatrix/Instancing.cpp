@@ -0,0 +1,134 @@
+#include "Instancing.h"
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	// cheap deterministic pseudo random numbers in [0, 1), so every run draws the same scene
+	float hash_to_unit(std::uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return static_cast<float>(x >> 8) / 16777216.0f;
+	}
+}
+
+std::vector<InstanceData> make_instance_grid(const std::size_t count, const float extent)
+{
+	std::vector<InstanceData> instances(count);
+
+	// smallest cube of cells that holds every instance
+	std::size_t side = 1;
+	while (side * side * side < count)
+	{
+		++side;
+	}
+
+	const float spacing = 2.0f * extent / static_cast<float>(side);
+	const float scale = 0.6f * spacing; // the cube mesh is 1 unit wide
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const std::size_t x = i % side;
+		const std::size_t y = (i / side) % side;
+		const std::size_t z = i / (side * side);
+
+		// random axis and angle
+		const auto seed = static_cast<std::uint32_t>(i * 3);
+		float axis[3] = {
+			hash_to_unit(seed) - 0.5f,
+			hash_to_unit(seed + 1) - 0.5f,
+			hash_to_unit(seed + 2) - 0.5f };
+		const float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]) + 1e-6f;
+		const float halfAngle = 3.14159265f * hash_to_unit(seed ^ 0x9e3779b9u);
+		const float s = std::sin(halfAngle) / length;
+
+		InstanceData& instance = instances[i];
+		const float rotation[4] = { axis[0] * s, axis[1] * s, axis[2] * s, std::cos(halfAngle) };
+		quaternion_to_snorm16(rotation, instance.rotation);
+		instance.material = 0;
+		instance.reserved = 0;
+
+		instance.offsetScale[0] = -extent + spacing * (static_cast<float>(x) + 0.5f);
+		instance.offsetScale[1] = -extent + spacing * (static_cast<float>(y) + 0.5f);
+		instance.offsetScale[2] = -extent + spacing * (static_cast<float>(z) + 0.5f);
+		instance.offsetScale[3] = scale;
+	}
+
+	return instances;
+}
+
+InstanceData animate_instance(const InstanceData& rest, const std::size_t index, const float time)
+{
+	// spin axis and rate, seeded apart from the rest rotation of make_instance_grid
+	const auto seed = static_cast<std::uint32_t>(index * 3) ^ 0x5bd1e995u;
+	const float axis[3] = {
+		hash_to_unit(seed) - 0.5f,
+		hash_to_unit(seed + 1) - 0.5f,
+		hash_to_unit(seed + 2) - 0.5f };
+	const float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]) + 1e-6f;
+	const float halfAngle = (0.25f + 0.75f * hash_to_unit(seed ^ 0x27d4eb2fu)) * time;
+	const float s = std::sin(halfAngle) / length;
+	const float spin[4] = { axis[0] * s, axis[1] * s, axis[2] * s, std::cos(halfAngle) };
+
+	// spin * rest, so the spin turns the already rotated cube
+	float q[4];
+	snorm16_to_quaternion(rest.rotation, q);
+	const float rotation[4] = {
+		spin[3] * q[0] + spin[0] * q[3] + spin[1] * q[2] - spin[2] * q[1],
+		spin[3] * q[1] - spin[0] * q[2] + spin[1] * q[3] + spin[2] * q[0],
+		spin[3] * q[2] + spin[0] * q[1] - spin[1] * q[0] + spin[2] * q[3],
+		spin[3] * q[3] - spin[0] * q[0] - spin[1] * q[1] - spin[2] * q[2] };
+	InstanceData animated = rest;
+	quaternion_to_snorm16(rotation, animated.rotation);
+	return animated;
+}
+
+void quaternion_to_snorm16(const float quaternion[4], std::int16_t packed[4])
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		const float clamped = std::fmin(std::fmax(quaternion[i], -1.0f), 1.0f);
+		packed[i] = static_cast<std::int16_t>(std::lround(clamped * 32767.0f));
+	}
+}
+
+void snorm16_to_quaternion(const std::int16_t packed[4], float quaternion[4])
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		quaternion[i] = std::fmax(static_cast<float>(packed[i]) / 32767.0f, -1.0f);
+	}
+}
+
+GLuint create_instance_buffer(const std::vector<InstanceData>& instances)
+{
+	GLuint instanceVBO;
+	glGenBuffers(1, &instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instances.size() * sizeof(InstanceData)), instances.data(), GL_STATIC_DRAW);
+	point_instance_attributes(instanceVBO, 0);
+	return instanceVBO;
+}
+
+void point_instance_attributes(const GLuint buffer, const GLintptr offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	// glVertexAttribDivisor(index, 1): advance the attribute once per instance instead of once per vertex
+	glVertexAttribPointer(INSTANCE_OFFSET_SCALE_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, offsetScale)));
+	glVertexAttribDivisor(INSTANCE_OFFSET_SCALE_LOCATION, 1);
+	glEnableVertexAttribArray(INSTANCE_OFFSET_SCALE_LOCATION);
+
+	glVertexAttribPointer(INSTANCE_ROTATION_LOCATION, 4, GL_SHORT, GL_TRUE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, rotation)));
+	glVertexAttribDivisor(INSTANCE_ROTATION_LOCATION, 1);
+	glEnableVertexAttribArray(INSTANCE_ROTATION_LOCATION);
+
+	// an integer attribute (glVertexAttribIPointer), the index isn't converted to float
+	glVertexAttribIPointer(INSTANCE_MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, material)));
+	glVertexAttribDivisor(INSTANCE_MATERIAL_LOCATION, 1);
+	glEnableVertexAttribArray(INSTANCE_MATERIAL_LOCATION);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-instance transform for instanced drawing, packed as a unit quaternion (snorm16) plus
+// translation and uniform scale, and the material the instance is drawn with:
+// 32 bytes per instance instead of a 64 bytes mat4.
+// Read by Shaders/instanced.vert from attribute locations 3, 4 and 5.
+struct InstanceData
+{
+	float offsetScale[4];		// translation (x, y, z) and uniform scale (w)
+	std::int16_t rotation[4];	// quaternion (x, y, z, w), see quaternion_to_snorm16
+	std::uint32_t material;		// row of the material table of the texture atlas (see TextureAtlas.h)
+	std::uint32_t reserved;
+};
+
+static_assert(sizeof(InstanceData) == 32, "InstanceData is read with a 32 bytes stride");
+
+constexpr GLuint INSTANCE_ROTATION_LOCATION = 3;
+constexpr GLuint INSTANCE_OFFSET_SCALE_LOCATION = 4;
+constexpr GLuint INSTANCE_MATERIAL_LOCATION = 5;
+
+// quaternion components in [-1, 1] to GL_SHORT normalized and back
+void quaternion_to_snorm16(const float quaternion[4], std::int16_t packed[4]);
+void snorm16_to_quaternion(const std::int16_t packed[4], float quaternion[4]);
+
+// count instances laid out on a cubic grid filling [-extent, extent]^3, each with its own fixed rotation
+std::vector<InstanceData> make_instance_grid(std::size_t count, float extent);
+
+// the instance at time: the rest one spun about an axis of its own (from index) at its own rate.
+// Only the rotation changes, bounds around the rest position and scale stay valid
+InstanceData animate_instance(const InstanceData& rest, std::size_t index, float time);
+
+// upload the instances to a new vertex buffer and point the per-instance attributes
+// (divisor 1) of the currently bound VAO at it, returns the buffer
+GLuint create_instance_buffer(const std::vector<InstanceData>& instances);
+
+// point the per-instance attributes (divisor 1) of the currently bound VAO at the instances
+// stored from offset in buffer, e.g. this frame's region of a StreamingBuffer
+void point_instance_attributes(GLuint buffer, GLintptr offset);
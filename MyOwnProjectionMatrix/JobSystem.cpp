@@ -0,0 +1,221 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace
+{
+	// the pool and worker the calling thread belongs to, none outside a pool
+	thread_local const JobSystem* current_system = nullptr;
+	thread_local unsigned int current_worker = 0;
+
+	long long elapsed_us(const std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+JobSystem::JobSystem(unsigned int workerCount) : nextWorker(0), queued(0), stopping(false), statsStart(std::chrono::steady_clock::now())
+{
+	if (workerCount == 0)
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	// every deque exists before any worker may steal from it
+	workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		workers.emplace_back(new Worker);
+	}
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (std::unique_ptr<Worker>& worker : workers)
+	{
+		worker->thread.join();
+	}
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter& counter)
+{
+	counter.pending.fetch_add(1);
+
+	// a worker keeps what it spawns, the others take it only when they run dry
+	const unsigned int target = current_system == this ? current_worker : nextWorker.fetch_add(1) % static_cast<unsigned int>(workers.size());
+	{
+		Worker& worker = *workers[target];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.jobs.push_back(Job{ std::move(job), &counter });
+	}
+	queued.fetch_add(1);
+
+	// taking the lock orders the push before the check of a worker about to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	workAvailable.notify_one();
+}
+
+void JobSystem::parallelFor(const std::size_t count, std::size_t grain, const std::function<void(std::size_t begin, std::size_t end)>& body, JobCounter& counter)
+{
+	grain = std::max<std::size_t>(grain, 1);
+	const std::function<void(std::size_t, std::size_t)>* shared = &body;
+	for (std::size_t begin = 0; begin < count; begin += grain)
+	{
+		const std::size_t end = std::min(begin + grain, count);
+		submit([shared, begin, end] { (*shared)(begin, end); }, counter);
+	}
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	if (current_system == this)
+	{
+		// a worker can't block: the jobs it waits for may sit in its own deque
+		while (counter.pending.load() > 0)
+		{
+			Job job;
+			bool stolen;
+			if (findJob(current_worker, job, stolen))
+			{
+				run(current_worker, job, stolen);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	jobDone.wait(lock, [&counter] { return counter.pending.load() == 0; });
+}
+
+unsigned int JobSystem::getWorkerCount() const
+{
+	return static_cast<unsigned int>(workers.size());
+}
+
+std::vector<JobWorkerStats> JobSystem::getWorkerStats() const
+{
+	const double windowMs = static_cast<double>(elapsed_us(statsStart)) / 1000.0;
+	std::vector<JobWorkerStats> stats;
+	stats.reserve(workers.size());
+	for (const std::unique_ptr<Worker>& worker : workers)
+	{
+		JobWorkerStats entry;
+		entry.jobsRun = worker->jobsRun.load();
+		entry.jobsStolen = worker->jobsStolen.load();
+		entry.busyMs = static_cast<double>(worker->busyUs.load()) / 1000.0;
+		entry.utilization = windowMs > 0.0 ? std::min(entry.busyMs / windowMs, 1.0) : 0.0;
+		stats.push_back(entry);
+	}
+	return stats;
+}
+
+void JobSystem::resetStats()
+{
+	for (std::unique_ptr<Worker>& worker : workers)
+	{
+		worker->jobsRun = 0;
+		worker->jobsStolen = 0;
+		worker->busyUs = 0;
+	}
+	statsStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::workerLoop(const unsigned int index)
+{
+	current_system = this;
+	current_worker = index;
+	profiler_set_thread_name("job worker");
+
+	while (true)
+	{
+		Job job;
+		bool stolen;
+		if (findJob(index, job, stolen))
+		{
+			run(index, job, stolen);
+			continue;
+		}
+
+		// stop only once every queued job ran
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		workAvailable.wait(lock, [this] { return stopping || queued.load() > 0; });
+		if (stopping && queued.load() == 0)
+		{
+			return;
+		}
+	}
+}
+
+bool JobSystem::findJob(const unsigned int index, Job& job, bool& stolen)
+{
+	{
+		Worker& own = *workers[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			queued.fetch_sub(1);
+			stolen = false;
+			return true;
+		}
+	}
+
+	// the neighbours first, so the thieves of a loaded worker spread over different victims
+	const std::size_t count = workers.size();
+	for (std::size_t offset = 1; offset < count; ++offset)
+	{
+		Worker& victim = *workers[(index + offset) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queued.fetch_sub(1);
+			stolen = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::run(const unsigned int index, Job& job, const bool stolen)
+{
+	Worker& worker = *workers[index];
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		PROFILE_SCOPE("job");
+		job.function();
+	}
+	worker.busyUs.fetch_add(elapsed_us(start));
+	worker.jobsRun.fetch_add(1);
+	if (stolen)
+	{
+		worker.jobsStolen.fetch_add(1);
+	}
+
+	if (job.counter->pending.fetch_sub(1) == 1)
+	{
+		// taking the lock orders the decrement before the check of a thread about to sleep
+		{
+			std::lock_guard<std::mutex> lock(doneMutex);
+		}
+		jobDone.notify_all();
+	}
+}
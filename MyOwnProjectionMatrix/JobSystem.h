@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job scheduler for the per-frame scene update (animation, culling, draw list).
+// Every worker owns a deque: it pushes and pops its own jobs at the back (last in, first
+// out, the data is still in its cache) and, when it runs dry, steals from the front of the
+// others (the oldest, usually biggest, jobs). Jobs submitted from outside the pool are
+// spread over the workers round robin. The GL thread only submits and waits:
+//
+//		JobCounter cull;
+//		jobs.parallelFor(instanceCount, 4096, [&](std::size_t begin, std::size_t end) { ... }, cull);
+//		... GL commands that don't need the result ...
+//		jobs.wait(cull);
+//
+// A worker waiting on a counter runs other jobs meanwhile, so jobs may submit and wait for jobs.
+
+// how many jobs of a batch are still queued or running
+struct JobCounter
+{
+	std::atomic<std::size_t> pending{ 0 };
+};
+
+struct JobWorkerStats
+{
+	unsigned long long jobsRun;
+	unsigned long long jobsStolen;	// taken from another worker's deque
+	double busyMs;					// running jobs
+	double utilization;				// busyMs over the time since the last resetStats()
+};
+
+class JobSystem
+{
+public:
+	// 0 workers uses every hardware thread but the GL one
+	explicit JobSystem(unsigned int workerCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// queue a job, any thread. The counter is raised now and lowered when the job returned
+	void submit(std::function<void()> job, JobCounter& counter);
+
+	// split [0, count) into ranges of at most grain elements, one job each. The body is
+	// referenced by the jobs, it must outlive the wait on the counter
+	void parallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t begin, std::size_t end)>& body, JobCounter& counter);
+
+	// return once every job of the counter ran
+	void wait(JobCounter& counter);
+
+	unsigned int getWorkerCount() const;
+
+	// one entry per worker
+	std::vector<JobWorkerStats> getWorkerStats() const;
+	void resetStats();
+
+private:
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+		std::thread thread;
+		std::atomic<unsigned long long> jobsRun{ 0 };
+		std::atomic<unsigned long long> jobsStolen{ 0 };
+		std::atomic<long long> busyUs{ 0 };
+	};
+
+	void workerLoop(unsigned int index);
+
+	// pop from the own deque, else steal, false when every deque is empty
+	bool findJob(unsigned int index, Job& job, bool& stolen);
+	void run(unsigned int index, Job& job, bool stolen);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<unsigned int> nextWorker;	// round robin target of outside submissions
+	std::atomic<std::size_t> queued;		// jobs in every deque
+
+	std::mutex sleepMutex;
+	std::condition_variable workAvailable;	// idle workers wait for jobs
+	bool stopping;
+
+	std::mutex doneMutex;
+	std::condition_variable jobDone;		// outside threads wait for their counters
+
+	std::chrono::steady_clock::time_point statsStart;
+};
@@ -0,0 +1,301 @@
+#include "Ktx2File.h"
+#include "GLExtensions.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+	const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// header and index, followed by the level index
+	struct Ktx2Header
+	{
+		unsigned char identifier[12];
+		std::uint32_t vkFormat;
+		std::uint32_t typeSize;
+		std::uint32_t pixelWidth;
+		std::uint32_t pixelHeight;
+		std::uint32_t pixelDepth;
+		std::uint32_t layerCount;
+		std::uint32_t faceCount;
+		std::uint32_t levelCount;
+		std::uint32_t supercompressionScheme;
+		std::uint32_t dfdByteOffset;
+		std::uint32_t dfdByteLength;
+		std::uint32_t kvdByteOffset;
+		std::uint32_t kvdByteLength;
+		std::uint64_t sgdByteOffset;
+		std::uint64_t sgdByteLength;
+	};
+
+	struct Ktx2Level
+	{
+		std::uint64_t byteOffset;
+		std::uint64_t byteLength;
+		std::uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80 && sizeof(Ktx2Level) == 24, "the KTX2 header must not get padded");
+
+	// VkFormat of the blocks, and the color model and channels of their data format descriptor
+	struct FormatDescription
+	{
+		BlockFormat format;
+		std::uint32_t vkFormat;
+		std::uint32_t colorModel;
+		int samples;
+		std::uint32_t channels[2];	// KHR_DF_CHANNEL_*, at bit 0 and 64
+	};
+
+	const FormatDescription formatDescriptions[] = {
+		{ BlockFormat::BC1, 131, 128, 1, { 0 } },		// VK_FORMAT_BC1_RGB_UNORM_BLOCK, KHR_DF_MODEL_BC1A
+		{ BlockFormat::BC3, 137, 130, 2, { 15, 0 } },	// VK_FORMAT_BC3_UNORM_BLOCK, KHR_DF_MODEL_BC3: alpha then color
+		{ BlockFormat::BC7, 145, 134, 1, { 0 } },		// VK_FORMAT_BC7_UNORM_BLOCK, KHR_DF_MODEL_BC7
+		{ BlockFormat::ETC2, 147, 161, 1, { 2 } }		// VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, KHR_DF_MODEL_ETC2
+	};
+
+	const FormatDescription* find_format(const BlockFormat format)
+	{
+		for (const FormatDescription& description : formatDescriptions)
+		{
+			if (description.format == format)
+			{
+				return &description;
+			}
+		}
+		return nullptr;
+	}
+
+	const FormatDescription* find_vk_format(const std::uint32_t vkFormat)
+	{
+		for (const FormatDescription& description : formatDescriptions)
+		{
+			if (description.vkFormat == vkFormat)
+			{
+				return &description;
+			}
+		}
+		return nullptr;
+	}
+
+	void append_u32(std::vector<unsigned char>& bytes, const std::uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			bytes.push_back(static_cast<unsigned char>(value >> (8 * i)));
+		}
+	}
+
+	// basic data format descriptor block: linear BT.709, straight alpha, 4x4 blocks
+	std::vector<unsigned char> make_dfd(const FormatDescription& description)
+	{
+		const std::uint32_t blockSize = 24 + 16 * static_cast<std::uint32_t>(description.samples);
+		const std::uint32_t bytes = static_cast<std::uint32_t>(block_bytes(description.format));
+		std::vector<unsigned char> dfd;
+		append_u32(dfd, 4 + blockSize);				// dfdTotalSize
+		append_u32(dfd, 0);							// vendorId, descriptorType
+		append_u32(dfd, 2 | blockSize << 16);		// versionNumber, descriptorBlockSize
+		append_u32(dfd, description.colorModel | 1 << 8 | 1 << 16);	// colorPrimaries BT709, transferFunction linear, flags
+		append_u32(dfd, 3 | 3 << 8);				// texelBlockDimension minus one
+		append_u32(dfd, bytes);						// bytesPlane0
+		append_u32(dfd, 0);
+		const std::uint32_t sampleBits = 8 * bytes / static_cast<std::uint32_t>(description.samples);
+		for (int sample = 0; sample < description.samples; ++sample)
+		{
+			append_u32(dfd, sampleBits * static_cast<std::uint32_t>(sample) | (sampleBits - 1) << 16 | description.channels[sample] << 24);
+			append_u32(dfd, 0);						// samplePosition
+			append_u32(dfd, 0);						// sampleLower
+			append_u32(dfd, 0xFFFFFFFFu);			// sampleUpper
+		}
+		return dfd;
+	}
+
+	void append_key_value(std::vector<unsigned char>& kvd, char const* key, char const* value)
+	{
+		const std::size_t keyLength = std::strlen(key) + 1, valueLength = std::strlen(value) + 1;
+		append_u32(kvd, static_cast<std::uint32_t>(keyLength + valueLength));
+		kvd.insert(kvd.end(), key, key + keyLength);
+		kvd.insert(kvd.end(), value, value + valueLength);
+		kvd.resize((kvd.size() + 3) & ~static_cast<std::size_t>(3), 0);
+	}
+
+	std::uint64_t align_up(const std::uint64_t offset, const std::uint64_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	int level_size(const int size, const std::size_t level)
+	{
+		return std::max(size >> level, 1);
+	}
+
+	// floor(log2(max(width, height))) + 1, the levels down to 1x1
+	std::uint32_t full_chain_levels(const std::uint32_t width, const std::uint32_t height)
+	{
+		std::uint32_t levels = 1;
+		for (std::uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		{
+			++levels;
+		}
+		return levels;
+	}
+}
+
+bool write_ktx2(const std::string& path, const CompressedTexture& texture)
+{
+	const FormatDescription* description = find_format(texture.format);
+	if (description == nullptr || texture.levels.empty())
+	{
+		std::cout << "ERROR WRITING KTX2 FILE: " << path << " (nothing to write)" << std::endl;
+		return false;
+	}
+
+	Ktx2Header header = {};
+	std::memcpy(header.identifier, ktx2Identifier, sizeof(ktx2Identifier));
+	header.vkFormat = description->vkFormat;
+	header.typeSize = 1;
+	header.pixelWidth = static_cast<std::uint32_t>(texture.width);
+	header.pixelHeight = static_cast<std::uint32_t>(texture.height);
+	header.faceCount = 1;
+	header.levelCount = static_cast<std::uint32_t>(texture.levels.size());
+
+	// keys sorted by their bytes
+	const std::vector<unsigned char> dfd = make_dfd(*description);
+	std::vector<unsigned char> kvd;
+	append_key_value(kvd, "KTXorientation", "ru");
+	append_key_value(kvd, "KTXwriter", "MyOwnProjectionMatrix");
+
+	header.dfdByteOffset = static_cast<std::uint32_t>(sizeof(Ktx2Header) + texture.levels.size() * sizeof(Ktx2Level));
+	header.dfdByteLength = static_cast<std::uint32_t>(dfd.size());
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = static_cast<std::uint32_t>(kvd.size());
+
+	// the smallest level first, every level aligned to the block size
+	std::vector<Ktx2Level> levels(texture.levels.size());
+	std::uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+	for (std::size_t level = texture.levels.size(); level-- > 0;)
+	{
+		offset = align_up(offset, block_bytes(texture.format));
+		levels[level].byteOffset = offset;
+		levels[level].byteLength = texture.levels[level].size();
+		levels[level].uncompressedByteLength = texture.levels[level].size();
+		offset += texture.levels[level].size();
+	}
+
+	// written next to the file then renamed, so a reader never maps a partial file
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(levels.data()), static_cast<std::streamsize>(levels.size() * sizeof(Ktx2Level)));
+		file.write(reinterpret_cast<const char*>(dfd.data()), static_cast<std::streamsize>(dfd.size()));
+		file.write(reinterpret_cast<const char*>(kvd.data()), static_cast<std::streamsize>(kvd.size()));
+		std::uint64_t written = header.kvdByteOffset + header.kvdByteLength;
+		for (std::size_t level = texture.levels.size(); level-- > 0;)
+		{
+			static const char zeros[16] = {};
+			file.write(zeros, static_cast<std::streamsize>(levels[level].byteOffset - written));
+			file.write(reinterpret_cast<const char*>(texture.levels[level].data()), static_cast<std::streamsize>(levels[level].byteLength));
+			written = levels[level].byteOffset + levels[level].byteLength;
+		}
+		if (!file)
+		{
+			std::cout << "ERROR WRITING KTX2 FILE: " << temporaryPath << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cout << "ERROR WRITING KTX2 FILE: " << path << " (" << error.message() << ")" << std::endl;
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool read_ktx2(const std::string& path, CompressedTexture& texture)
+{
+	const MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cout << "ERROR TRYING TO READ KTX2 FILE: " << path << std::endl;
+		return false;
+	}
+
+	// every offset and size is checked against the mapping before anything is read through it
+	const std::uint64_t size = file.size();
+	const auto* header = reinterpret_cast<const Ktx2Header*>(file.data());
+	if (size < sizeof(Ktx2Header) || std::memcmp(header->identifier, ktx2Identifier, sizeof(ktx2Identifier)) != 0
+		|| size < sizeof(Ktx2Header) + static_cast<std::uint64_t>(header->levelCount) * sizeof(Ktx2Level))
+	{
+		std::cout << "KTX2 file is malformed: " << path << std::endl;
+		return false;
+	}
+
+	const FormatDescription* description = find_vk_format(header->vkFormat);
+	if (description == nullptr || header->supercompressionScheme != 0 || header->pixelDepth > 1 || header->layerCount > 1
+		|| header->faceCount != 1 || header->levelCount == 0 || header->pixelWidth == 0 || header->pixelHeight == 0)
+	{
+		std::cout << "KTX2 file is not a plain BC1, BC3, BC7 or ETC2 RGB 2D texture (VkFormat " << header->vkFormat << "): " << path << std::endl;
+		return false;
+	}
+
+	// more levels than the chain down to 1x1 would shift level_size past the width of an int
+	if (header->pixelWidth > static_cast<std::uint32_t>(std::numeric_limits<int>::max()) || header->pixelHeight > static_cast<std::uint32_t>(std::numeric_limits<int>::max())
+		|| header->levelCount > full_chain_levels(header->pixelWidth, header->pixelHeight))
+	{
+		std::cout << "KTX2 file is malformed (" << header->levelCount << " levels for " << header->pixelWidth << "x" << header->pixelHeight << "): " << path << std::endl;
+		return false;
+	}
+
+	texture.format = description->format;
+	texture.width = static_cast<int>(header->pixelWidth);
+	texture.height = static_cast<int>(header->pixelHeight);
+	texture.levels.assign(header->levelCount, std::vector<unsigned char>());
+	const auto* levels = reinterpret_cast<const Ktx2Level*>(file.data() + sizeof(Ktx2Header));
+	for (std::size_t level = 0; level < texture.levels.size(); ++level)
+	{
+		const std::uint64_t expected = compressed_size(texture.format, level_size(texture.width, level), level_size(texture.height, level));
+		if (levels[level].byteLength != expected || levels[level].byteOffset > size || expected > size - levels[level].byteOffset)
+		{
+			std::cout << "KTX2 file is malformed (level " << level << "): " << path << std::endl;
+			return false;
+		}
+		const auto* data = reinterpret_cast<const unsigned char*>(file.data() + levels[level].byteOffset);
+		texture.levels[level].assign(data, data + expected);
+	}
+	return true;
+}
+
+GLenum compressed_texture_format(const BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case BlockFormat::ETC2: return GL_COMPRESSED_RGB8_ETC2;
+	}
+	return GL_NONE;
+}
+
+bool compressed_format_supported(const BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC3: return gl_extensions().textureCompressionS3tc;
+	case BlockFormat::BC7: return gl_extensions().textureCompressionBptc;
+	case BlockFormat::ETC2: return gl_extensions().textureCompressionEtc2;
+	}
+	return false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <glad/glad.h>
+#include "TextureCompression.h"
+#include <string>
+#include <vector>
+
+// KTX 2.0 container of a block compressed 2D texture with its mip chain
+// (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html): header, level index, data format
+// descriptor, key/value data, then the levels from the smallest to level 0.
+// No supercompression, one layer, one face. The rows are stored bottom up like GL reads them,
+// written down as KTXorientation "ru"; files stored top down ("rd") load upside down.
+struct CompressedTexture
+{
+	BlockFormat format;
+	int width;
+	int height;
+	std::vector<std::vector<unsigned char>> levels; // level 0 first, compressed_size bytes each
+};
+
+bool write_ktx2(const std::string& path, const CompressedTexture& texture);
+
+// read through a memory mapping, false (with a message) for a format not in BlockFormat,
+// a supercompressed file or one whose levels don't fit
+bool read_ktx2(const std::string& path, CompressedTexture& texture);
+
+// the internal format glCompressedTexImage2D takes the blocks as
+GLenum compressed_texture_format(BlockFormat format);
+
+// can the context sample the format? (see GLExtensions.h) Else the blocks are decoded on the CPU
+bool compressed_format_supported(BlockFormat format);
@@ -0,0 +1,100 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::string const& path) : bytes(""), length(0), open(false), mapping(nullptr)
+{
+#if defined(_WIN32)
+	const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr)
+		{
+			const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view != nullptr)
+			{
+				bytes = static_cast<char const*>(view);
+				length = static_cast<std::size_t>(fileSize.QuadPart);
+				open = true;
+			}
+		}
+	}
+	else
+	{
+		// an empty file can't be mapped, it is still a valid (empty) file
+		open = true;
+	}
+	CloseHandle(file); // the mapping keeps the file alive
+#else
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) == 0)
+	{
+		if (info.st_size > 0)
+		{
+			void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (view != MAP_FAILED)
+			{
+				bytes = static_cast<char const*>(view);
+				length = static_cast<std::size_t>(info.st_size);
+				open = true;
+			}
+		}
+		else
+		{
+			open = true;
+		}
+	}
+	::close(file); // the mapping keeps the file alive
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	if (length == 0)
+	{
+		return;
+	}
+#if defined(_WIN32)
+	UnmapViewOfFile(bytes);
+	CloseHandle(mapping);
+#else
+	munmap(const_cast<char*>(bytes), length);
+#endif
+}
+
+bool MappedFile::isOpen() const
+{
+	return open;
+}
+
+char const* MappedFile::data() const
+{
+	return bytes;
+}
+
+std::size_t MappedFile::size() const
+{
+	return length;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile), the contents are
+// read straight from the page cache without copying them into the process.
+// The mapping isn't NUL terminated, always pair data() with size().
+// A file truncated by another process while mapped can't be read safely anymore, so
+// mappings are meant to be short lived (see ShaderSourceCache, which unmaps a shader
+// source once it is compiled).
+class MappedFile
+{
+public:
+	explicit MappedFile(std::string const& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// false when the file couldn't be opened or mapped
+	bool isOpen() const;
+
+	char const* data() const;
+	std::size_t size() const;
+
+private:
+	char const* bytes;
+	std::size_t length;
+	bool open;
+	void* mapping; // Windows file mapping handle
+};
@@ -0,0 +1,158 @@
+#include "MatrixCheck.h"
+#include "MatrixTypes.h"
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	template <typename Matrix>
+	float identity_error(const Matrix& matrix)
+	{
+		const General4 product = (inverse(matrix) * matrix).toGeneral4();
+		const General4 identity = General4::identity();
+		float error = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			error = std::max(error, std::abs(product.m[i] - identity.m[i]));
+		}
+		return error;
+	}
+
+	// a model or view transform of every kind the scene builds
+	Affine3 test_affine(const int i)
+	{
+		const float t = static_cast<float>(i);
+		return Affine3::translation(0.5f * t - 3.0f, 1.0f - 0.25f * t, -2.0f - t)
+			* Affine3::rotation(0.37f * t, 1.0f, 0.3f * t, 0.5f)
+			* Affine3::scale(0.5f + 0.1f * t, 1.0f, 2.0f - 0.1f * t);
+	}
+
+	Perspective test_perspective(const int i)
+	{
+		const float fovY = 0.3f + 0.1f * static_cast<float>(i);
+		switch (i % 5)
+		{
+		case 1:
+			return Perspective::fromProjection(my_perspective_infinite(fovY, 1.5f, 0.1f));
+		case 2:
+			return Perspective::fromProjection(my_perspective_reversed_z(fovY, 1.5f, 0.1f, 50.0f));
+		case 3:
+			return Perspective::fromProjection(my_perspective_infinite_reversed_z(fovY, 1.5f, 0.1f));
+		case 4:
+			return Perspective::fromProjection(my_frustum(-0.05f, 0.08f, -0.04f, 0.06f, 0.1f, 50.0f));
+		default:
+			return Perspective::fromProjection(my_perspective(fovY, 1.5f, 0.1f, 50.0f));
+		}
+	}
+
+	glm::mat4 to_glm(const General4& g)
+	{
+		glm::mat4 result;
+		for (int i = 0; i < 16; ++i)
+		{
+			result[i / 4][i % 4] = g.m[i];
+		}
+		return result;
+	}
+}
+
+MatrixInverseErrors check_matrix_inverses()
+{
+	MatrixInverseErrors errors = {};
+	for (int i = 0; i < 20; ++i)
+	{
+		errors.affine = std::max(errors.affine, identity_error(test_affine(i)));
+		errors.perspective = std::max(errors.perspective, identity_error(test_perspective(i)));
+		errors.general = std::max(errors.general, identity_error(test_perspective(i) * test_affine(i)));
+	}
+	return errors;
+}
+
+const char* matrix_operation_name(const MatrixOperation operation)
+{
+	switch (operation)
+	{
+	case MatrixOperation::AffineInverse:
+		return "affine inverse";
+	case MatrixOperation::PerspectiveInverse:
+		return "perspective inverse";
+	default:
+		return "model-view-projection";
+	}
+}
+
+MatrixTiming measure_matrix_operation(const MatrixOperation operation, const std::size_t count)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// the same values on both sides, built from a volatile load so the compiler can't fold them
+	volatile int firstInput = 0;
+	const int first = firstInput;
+	Affine3 affines[16];
+	Perspective perspectives[16];
+	glm::mat4 glmAffines[16];
+	glm::mat4 glmPerspectives[16];
+	for (int i = 0; i < 16; ++i)
+	{
+		affines[i] = test_affine(first + i);
+		perspectives[i] = test_perspective(first + i);
+		glmAffines[i] = to_glm(affines[i].toGeneral4());
+		glmPerspectives[i] = to_glm(perspectives[i].toGeneral4());
+	}
+	volatile float sink = 0.0f;
+
+	const unsigned long long structured_allocations = heap_allocations();
+	const auto structured_start = Clock::now();
+	float sum = 0.0f;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const std::size_t a = i & 15;
+		const std::size_t b = (i + 5) & 15;
+		switch (operation)
+		{
+		case MatrixOperation::AffineInverse:
+			sum += inverse(affines[a]).m[9];
+			break;
+		case MatrixOperation::PerspectiveInverse:
+			sum += inverse(perspectives[a]).m[15];
+			break;
+		default:
+			sum += (perspectives[a] * (affines[b] * affines[a])).m[14];
+			break;
+		}
+	}
+	sink = sink + sum;
+	const double structured_ns = std::chrono::duration<double, std::nano>(Clock::now() - structured_start).count();
+	const unsigned long long structured_allocated = heap_allocations() - structured_allocations;
+
+	const unsigned long long glm_allocations = heap_allocations();
+	const auto glm_start = Clock::now();
+	sum = 0.0f;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const std::size_t a = i & 15;
+		const std::size_t b = (i + 5) & 15;
+		switch (operation)
+		{
+		case MatrixOperation::AffineInverse:
+			sum += glm::inverse(glmAffines[a])[3][0];
+			break;
+		case MatrixOperation::PerspectiveInverse:
+			sum += glm::inverse(glmPerspectives[a])[3][3];
+			break;
+		default:
+			sum += (glmPerspectives[a] * glmAffines[b] * glmAffines[a])[3][2];
+			break;
+		}
+	}
+	sink = sink + sum;
+	const double glm_ns = std::chrono::duration<double, std::nano>(Clock::now() - glm_start).count();
+	const unsigned long long glm_allocated = heap_allocations() - glm_allocations;
+
+	const double operations = static_cast<double>(std::max<std::size_t>(count, 1));
+	return MatrixTiming{ structured_ns / operations, glm_ns / operations, structured_allocated, glm_allocated, sink };
+}
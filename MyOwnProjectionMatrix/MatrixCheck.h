@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+
+// Checks the structured matrices of MatrixTypes.h and times them against glm::mat4.
+
+// largest entry of |inverse(x) * x - I| over a set of matrices of each shape: general
+// matrices (projection * modelview products), rotation/scale/translation chains and every
+// projection of the my_perspective/my_frustum family through the closed-form inverse
+struct MatrixInverseErrors
+{
+	float general;
+	float affine;
+	float perspective;
+};
+
+MatrixInverseErrors check_matrix_inverses();
+
+enum class MatrixOperation
+{
+	ModelViewProjection,	// Perspective * (Affine3 * Affine3) against three mat4 products
+	AffineInverse,			// MatrixInverse<Affine3> against glm::inverse
+	PerspectiveInverse		// MatrixInverse<Perspective> against glm::inverse
+};
+
+constexpr MatrixOperation matrix_operations[] = { MatrixOperation::ModelViewProjection, MatrixOperation::AffineInverse, MatrixOperation::PerspectiveInverse };
+
+const char* matrix_operation_name(MatrixOperation operation);
+
+// ns per operation over count operations on inputs only known at run time, and the heap
+// allocations made while timing them (none expected on either side)
+struct MatrixTiming
+{
+	double structured;
+	double glm;
+	unsigned long long structuredAllocations;
+	unsigned long long glmAllocations;
+	float checksum; // sum of entries of every result, what keeps the loops from being optimized away
+};
+
+MatrixTiming measure_matrix_operation(MatrixOperation operation, std::size_t count);
@@ -0,0 +1,363 @@
+#pragma once
+#include "Projection.h"
+#include <cmath>
+#include <type_traits>
+
+// Structured 4x4 matrices for the model-view-projection chain.
+// A full mat4 product costs 64 multiplies, but most of the matrices we build
+// have a known shape, so each shape stores only the entries that can be non-zero
+// and the products/inverses below are specialized per pair of shapes:
+//		General4	any 4x4 matrix (16 entries)
+//		Affine3		rotation/scale/translation, last row is implicitly (0, 0, 0, 1) (12 entries)
+//		Perspective	the my_perspective/my_frustum family (6 entries + the constant -1)
+// All matrices are column major, same as OpenGL and ProjectionMatrix.
+
+struct General4
+{
+	float m[16];
+
+	static constexpr General4 identity()
+	{
+		return General4{ {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f } };
+	}
+
+	static constexpr General4 fromProjection(const ProjectionMatrix& p)
+	{
+		return General4{ {
+			p[0], p[1], p[2], p[3],
+			p[4], p[5], p[6], p[7],
+			p[8], p[9], p[10], p[11],
+			p[12], p[13], p[14], p[15] } };
+	}
+
+	// element at (row, col)
+	constexpr float at(int row, int col) const { return m[col * 4 + row]; }
+	constexpr General4 toGeneral4() const { return *this; }
+	constexpr const float* data() const { return m; }
+};
+
+struct Affine3
+{
+	// columns of the upper 3x4 block: x axis, y axis, z axis, translation
+	float m[12];
+
+	static constexpr Affine3 identity()
+	{
+		return Affine3{ {
+			1.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 1.0f,
+			0.0f, 0.0f, 0.0f } };
+	}
+
+	static constexpr Affine3 translation(const float x, const float y, const float z)
+	{
+		return Affine3{ {
+			1.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 1.0f,
+			x, y, z } };
+	}
+
+	static constexpr Affine3 scale(const float x, const float y, const float z)
+	{
+		return Affine3{ {
+			x, 0.0f, 0.0f,
+			0.0f, y, 0.0f,
+			0.0f, 0.0f, z,
+			0.0f, 0.0f, 0.0f } };
+	}
+
+	// rotation of "angle" radians around the (x, y, z) axis, same convention as glm::rotate
+	static Affine3 rotation(const float angle, float x, float y, float z)
+	{
+		const float invLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+		x *= invLength;
+		y *= invLength;
+		z *= invLength;
+
+		const float c = std::cos(angle);
+		const float s = std::sin(angle);
+		const float t = 1.0f - c;
+
+		return Affine3{ {
+			c + t * x * x, t * x * y + s * z, t * x * z - s * y,
+			t * y * x - s * z, c + t * y * y, t * y * z + s * x,
+			t * z * x + s * y, t * z * y - s * x, c + t * z * z,
+			0.0f, 0.0f, 0.0f } };
+	}
+
+	// element at (row, col) for row < 3
+	constexpr float at(int row, int col) const { return m[col * 3 + row]; }
+
+	constexpr General4 toGeneral4() const
+	{
+		return General4{ {
+			m[0], m[1], m[2], 0.0f,
+			m[3], m[4], m[5], 0.0f,
+			m[6], m[7], m[8], 0.0f,
+			m[9], m[10], m[11], 1.0f } };
+	}
+};
+
+struct Perspective
+{
+	// non-zero entries of my_frustum:
+	//	| sx  0   ox  0 |
+	//	| 0   sy  oy  0 |
+	//	| 0   0   a   b |
+	//	| 0   0  -1   0 |
+	float sx, sy, ox, oy, a, b;
+
+	// takes the entries of any projection of the my_perspective/my_frustum family
+	// (my_orthographic is affine, use Affine3 for it)
+	static constexpr Perspective fromProjection(const ProjectionMatrix& p)
+	{
+		return Perspective{ p[0], p[5], p[8], p[9], p[10], p[14] };
+	}
+
+	constexpr General4 toGeneral4() const
+	{
+		return General4{ {
+			sx, 0.0f, 0.0f, 0.0f,
+			0.0f, sy, 0.0f, 0.0f,
+			ox, oy, a, -1.0f,
+			0.0f, 0.0f, b, 0.0f } };
+	}
+};
+
+// only the types above take part in the operators below
+template <typename T> struct IsStructuredMatrix : std::false_type {};
+template <> struct IsStructuredMatrix<General4> : std::true_type {};
+template <> struct IsStructuredMatrix<Affine3> : std::true_type {};
+template <> struct IsStructuredMatrix<Perspective> : std::true_type {};
+
+// ==========================================================================
+// products: lhs * rhs
+// the generic kernel expands both sides, the specializations skip the known zeros
+
+template <typename Lhs, typename Rhs>
+struct MatrixProduct
+{
+	using Result = General4;
+
+	static General4 multiply(const Lhs& lhs, const Rhs& rhs)
+	{
+		const General4 l = lhs.toGeneral4();
+		const General4 r = rhs.toGeneral4();
+
+		General4 result;
+		for (int col = 0; col < 4; ++col)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				result.m[col * 4 + row] =
+					l.m[row] * r.m[col * 4] +
+					l.m[4 + row] * r.m[col * 4 + 1] +
+					l.m[8 + row] * r.m[col * 4 + 2] +
+					l.m[12 + row] * r.m[col * 4 + 3];
+			}
+		}
+		return result;
+	}
+};
+
+// affine * affine stays affine: 36 multiplies instead of 64
+template <>
+struct MatrixProduct<Affine3, Affine3>
+{
+	using Result = Affine3;
+
+	static Affine3 multiply(const Affine3& l, const Affine3& r)
+	{
+		Affine3 result;
+		for (int col = 0; col < 4; ++col)
+		{
+			for (int row = 0; row < 3; ++row)
+			{
+				result.m[col * 3 + row] =
+					l.m[row] * r.m[col * 3] +
+					l.m[3 + row] * r.m[col * 3 + 1] +
+					l.m[6 + row] * r.m[col * 3 + 2];
+			}
+		}
+
+		// the implicit w = 1 of the rhs translation picks up the lhs translation
+		result.m[9] += l.m[9];
+		result.m[10] += l.m[10];
+		result.m[11] += l.m[11];
+		return result;
+	}
+};
+
+// perspective * affine (the projection-view or projection-modelview product): 20 multiplies
+template <>
+struct MatrixProduct<Perspective, Affine3>
+{
+	using Result = General4;
+
+	static General4 multiply(const Perspective& p, const Affine3& r)
+	{
+		// rows of the result: sx * r0 + ox * r2, sy * r1 + oy * r2, a * r2 + b * (0, 0, 0, 1), -r2
+		General4 result;
+		for (int col = 0; col < 4; ++col)
+		{
+			const float r0 = r.m[col * 3];
+			const float r1 = r.m[col * 3 + 1];
+			const float r2 = r.m[col * 3 + 2];
+
+			result.m[col * 4] = p.sx * r0 + p.ox * r2;
+			result.m[col * 4 + 1] = p.sy * r1 + p.oy * r2;
+			result.m[col * 4 + 2] = p.a * r2;
+			result.m[col * 4 + 3] = -r2;
+		}
+		result.m[14] += p.b;
+		return result;
+	}
+};
+
+// general * affine: 48 multiplies
+template <>
+struct MatrixProduct<General4, Affine3>
+{
+	using Result = General4;
+
+	static General4 multiply(const General4& l, const Affine3& r)
+	{
+		General4 result;
+		for (int col = 0; col < 4; ++col)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				result.m[col * 4 + row] =
+					l.m[row] * r.m[col * 3] +
+					l.m[4 + row] * r.m[col * 3 + 1] +
+					l.m[8 + row] * r.m[col * 3 + 2];
+			}
+		}
+
+		result.m[12] += l.m[12];
+		result.m[13] += l.m[13];
+		result.m[14] += l.m[14];
+		result.m[15] += l.m[15];
+		return result;
+	}
+};
+
+template <typename Lhs, typename Rhs, typename = typename std::enable_if<IsStructuredMatrix<Lhs>::value && IsStructuredMatrix<Rhs>::value>::type>
+typename MatrixProduct<Lhs, Rhs>::Result operator*(const Lhs& lhs, const Rhs& rhs)
+{
+	return MatrixProduct<Lhs, Rhs>::multiply(lhs, rhs);
+}
+
+// ==========================================================================
+// inverses
+
+template <typename Matrix>
+struct MatrixInverse;
+
+// cofactor expansion of the full 4x4
+template <>
+struct MatrixInverse<General4>
+{
+	using Result = General4;
+
+	static General4 invert(const General4& g)
+	{
+		const float* a = g.m;
+		General4 inv;
+
+		inv.m[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+		inv.m[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+		inv.m[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+		inv.m[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+		inv.m[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+		inv.m[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+		inv.m[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+		inv.m[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+		inv.m[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+		inv.m[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+		inv.m[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+		inv.m[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+		inv.m[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+		inv.m[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+		inv.m[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+		inv.m[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+		const float invDet = 1.0f / (a[0] * inv.m[0] + a[1] * inv.m[4] + a[2] * inv.m[8] + a[3] * inv.m[12]);
+		for (float& value : inv.m)
+		{
+			value *= invDet;
+		}
+		return inv;
+	}
+};
+
+// inverse of the 3x3 block, translation becomes -inverse(L) * t
+template <>
+struct MatrixInverse<Affine3>
+{
+	using Result = Affine3;
+
+	static Affine3 invert(const Affine3& r)
+	{
+		const float* a = r.m;
+
+		// cofactors of the 3x3 block, already transposed
+		Affine3 inv;
+		inv.m[0] = a[4] * a[8] - a[7] * a[5];
+		inv.m[1] = a[7] * a[2] - a[1] * a[8];
+		inv.m[2] = a[1] * a[5] - a[4] * a[2];
+		inv.m[3] = a[6] * a[5] - a[3] * a[8];
+		inv.m[4] = a[0] * a[8] - a[6] * a[2];
+		inv.m[5] = a[3] * a[2] - a[0] * a[5];
+		inv.m[6] = a[3] * a[7] - a[6] * a[4];
+		inv.m[7] = a[6] * a[1] - a[0] * a[7];
+		inv.m[8] = a[0] * a[4] - a[3] * a[1];
+
+		const float invDet = 1.0f / (a[0] * inv.m[0] + a[3] * inv.m[1] + a[6] * inv.m[2]);
+		for (int i = 0; i < 9; ++i)
+		{
+			inv.m[i] *= invDet;
+		}
+
+		inv.m[9] = -(inv.m[0] * a[9] + inv.m[3] * a[10] + inv.m[6] * a[11]);
+		inv.m[10] = -(inv.m[1] * a[9] + inv.m[4] * a[10] + inv.m[7] * a[11]);
+		inv.m[11] = -(inv.m[2] * a[9] + inv.m[5] * a[10] + inv.m[8] * a[11]);
+		return inv;
+	}
+};
+
+// closed form, 5 divisions and no determinant:
+//	| 1/sx  0     0     ox/sx |
+//	| 0     1/sy  0     oy/sy |
+//	| 0     0     0    -1     |
+//	| 0     0     1/b   a/b   |
+template <>
+struct MatrixInverse<Perspective>
+{
+	using Result = General4;
+
+	static General4 invert(const Perspective& p)
+	{
+		const float invSx = 1.0f / p.sx;
+		const float invSy = 1.0f / p.sy;
+		const float invB = 1.0f / p.b;
+
+		return General4{ {
+			invSx, 0.0f, 0.0f, 0.0f,
+			0.0f, invSy, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, invB,
+			p.ox * invSx, p.oy * invSy, -1.0f, p.a * invB } };
+	}
+};
+
+template <typename Matrix, typename = typename std::enable_if<IsStructuredMatrix<Matrix>::value>::type>
+typename MatrixInverse<Matrix>::Result inverse(const Matrix& matrix)
+{
+	return MatrixInverse<Matrix>::invert(matrix);
+}
@@ -0,0 +1,995 @@
+#include "MeshConverter.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double elapsed_ms(const Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// ======================================================================
+	// OBJ
+
+	// one corner of a face: position, texture coordinate and normal indices (-1 when missing)
+	struct ObjCorner
+	{
+		int position;
+		int uv;
+		int normal;
+
+		bool operator==(const ObjCorner& other) const
+		{
+			return position == other.position && uv == other.uv && normal == other.normal;
+		}
+	};
+
+	struct ObjCornerHash
+	{
+		std::size_t operator()(const ObjCorner& corner) const
+		{
+			return static_cast<std::size_t>(corner.position) * 73856093u ^ static_cast<std::size_t>(corner.uv) * 19349663u ^ static_cast<std::size_t>(corner.normal) * 83492791u;
+		}
+	};
+
+	// OBJ indices start at 1, negative ones count back from the last element read
+	int resolve_obj_index(const long index, const std::size_t count)
+	{
+		if (index > 0)
+		{
+			return index <= static_cast<long>(count) ? static_cast<int>(index - 1) : -2;
+		}
+		if (index < 0)
+		{
+			return -index <= static_cast<long>(count) ? static_cast<int>(static_cast<long>(count) + index) : -2;
+		}
+		return -2;
+	}
+
+	// the name after the keyword of a line, without trailing spaces
+	std::string line_argument(const char* text)
+	{
+		while (*text == ' ' || *text == '\t')
+		{
+			++text;
+		}
+		std::string name(text);
+		while (!name.empty() && std::isspace(static_cast<unsigned char>(name.back())))
+		{
+			name.pop_back();
+		}
+		return name;
+	}
+
+	void close_submesh(ImportedMesh& mesh, std::string const& name)
+	{
+		const std::size_t first = mesh.submeshes.empty() ? 0 : mesh.submeshes.back().firstIndex + mesh.submeshes.back().indexCount;
+		if (mesh.indices.size() > first)
+		{
+			mesh.submeshes.push_back(ImportedSubmesh{ name, first, mesh.indices.size() - first });
+		}
+	}
+
+	// ======================================================================
+	// glTF
+
+	// just enough JSON for glTF: the whole document becomes a tree of values
+	struct JsonValue
+	{
+		enum class Type { Null, Bool, Number, String, Array, Object };
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> array;
+		std::vector<std::pair<std::string, JsonValue>> object;
+
+		const JsonValue* get(const char* key) const
+		{
+			for (const auto& member : object)
+			{
+				if (member.first == key)
+				{
+					return &member.second;
+				}
+			}
+			return nullptr;
+		}
+
+		// a member number, fallback when missing
+		double number_or(const char* key, const double fallback) const
+		{
+			const JsonValue* member = get(key);
+			return member != nullptr && member->type == Type::Number ? member->number : fallback;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* begin, const char* end) : cursor(begin), end(end), failed(false) {}
+
+		bool parse(JsonValue& value)
+		{
+			value = parseValue(0);
+			skipSpace();
+			return !failed && cursor == end;
+		}
+
+	private:
+		const char* cursor;
+		const char* end;
+		bool failed;
+
+		void skipSpace()
+		{
+			while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+			{
+				++cursor;
+			}
+		}
+
+		bool consume(const char c)
+		{
+			skipSpace();
+			if (cursor < end && *cursor == c)
+			{
+				++cursor;
+				return true;
+			}
+			return false;
+		}
+
+		bool consumeWord(const char* word)
+		{
+			const std::size_t length = std::strlen(word);
+			if (static_cast<std::size_t>(end - cursor) >= length && std::memcmp(cursor, word, length) == 0)
+			{
+				cursor += length;
+				return true;
+			}
+			failed = true;
+			return false;
+		}
+
+		JsonValue parseValue(const int depth)
+		{
+			JsonValue value;
+			skipSpace();
+			if (cursor >= end || depth > 64)
+			{
+				failed = true;
+				return value;
+			}
+
+			switch (*cursor)
+			{
+			case '{':
+				++cursor;
+				value.type = JsonValue::Type::Object;
+				if (consume('}'))
+				{
+					return value;
+				}
+				do
+				{
+					skipSpace();
+					std::string key = parseString();
+					if (failed || !consume(':'))
+					{
+						failed = true;
+						return value;
+					}
+					value.object.emplace_back(std::move(key), parseValue(depth + 1));
+				} while (!failed && consume(','));
+				if (!consume('}'))
+				{
+					failed = true;
+				}
+				return value;
+			case '[':
+				++cursor;
+				value.type = JsonValue::Type::Array;
+				if (consume(']'))
+				{
+					return value;
+				}
+				do
+				{
+					value.array.push_back(parseValue(depth + 1));
+				} while (!failed && consume(','));
+				if (!consume(']'))
+				{
+					failed = true;
+				}
+				return value;
+			case '"':
+				value.type = JsonValue::Type::String;
+				value.string = parseString();
+				return value;
+			case 't':
+				value.type = JsonValue::Type::Bool;
+				value.boolean = consumeWord("true");
+				return value;
+			case 'f':
+				value.type = JsonValue::Type::Bool;
+				consumeWord("false");
+				return value;
+			case 'n':
+				consumeWord("null");
+				return value;
+			default:
+			{
+				// strtod stops at the first character that isn't part of the number, the
+				// document always has one more (a bracket at least) before the end
+				const std::string text(cursor, std::min<std::size_t>(static_cast<std::size_t>(end - cursor), 64));
+				char* numberEnd = nullptr;
+				value.type = JsonValue::Type::Number;
+				value.number = std::strtod(text.c_str(), &numberEnd);
+				if (numberEnd == text.c_str())
+				{
+					failed = true;
+				}
+				cursor += numberEnd - text.c_str();
+				return value;
+			}
+			}
+		}
+
+		std::string parseString()
+		{
+			std::string text;
+			if (cursor >= end || *cursor != '"')
+			{
+				failed = true;
+				return text;
+			}
+			++cursor;
+			while (cursor < end && *cursor != '"')
+			{
+				char c = *cursor++;
+				if (c == '\\' && cursor < end)
+				{
+					c = *cursor++;
+					switch (c)
+					{
+					case 'b': text += '\b'; break;
+					case 'f': text += '\f'; break;
+					case 'n': text += '\n'; break;
+					case 'r': text += '\r'; break;
+					case 't': text += '\t'; break;
+					case 'u':
+					{
+						// basic multilingual plane only, written back as UTF-8
+						if (end - cursor < 4)
+						{
+							failed = true;
+							return text;
+						}
+						const unsigned long code = std::strtoul(std::string(cursor, 4).c_str(), nullptr, 16);
+						cursor += 4;
+						if (code < 0x80)
+						{
+							text += static_cast<char>(code);
+						}
+						else if (code < 0x800)
+						{
+							text += static_cast<char>(0xC0 | (code >> 6));
+							text += static_cast<char>(0x80 | (code & 0x3F));
+						}
+						else
+						{
+							text += static_cast<char>(0xE0 | (code >> 12));
+							text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+							text += static_cast<char>(0x80 | (code & 0x3F));
+						}
+						break;
+					}
+					default: text += c; break; // \" \\ \/
+					}
+					continue;
+				}
+				text += c;
+			}
+			if (cursor >= end)
+			{
+				failed = true;
+				return text;
+			}
+			++cursor;
+			return text;
+		}
+	};
+
+	bool decode_base64(std::string const& text, std::vector<unsigned char>& bytes)
+	{
+		unsigned int bits = 0;
+		int bitCount = 0;
+		for (const char c : text)
+		{
+			int value;
+			if (c >= 'A' && c <= 'Z') value = c - 'A';
+			else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9') value = c - '0' + 52;
+			else if (c == '+') value = 62;
+			else if (c == '/') value = 63;
+			else if (c == '=') break;
+			else return false;
+
+			bits = (bits << 6) | static_cast<unsigned int>(value);
+			bitCount += 6;
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				bytes.push_back(static_cast<unsigned char>((bits >> bitCount) & 0xFF));
+			}
+		}
+		return true;
+	}
+
+	struct GltfDocument
+	{
+		JsonValue json;
+		std::vector<std::vector<unsigned char>> buffers;
+	};
+
+	bool load_gltf_buffers(GltfDocument& gltf, std::filesystem::path const& directory, const unsigned char* glbBinary, const std::size_t glbBinarySize)
+	{
+		const JsonValue* buffers = gltf.json.get("buffers");
+		if (buffers == nullptr)
+		{
+			return true;
+		}
+		for (const JsonValue& buffer : buffers->array)
+		{
+			std::vector<unsigned char> bytes;
+			const JsonValue* uri = buffer.get("uri");
+			if (uri == nullptr)
+			{
+				// the BIN chunk of a .glb
+				bytes.assign(glbBinary, glbBinary + glbBinarySize);
+			}
+			else if (uri->string.compare(0, 5, "data:") == 0)
+			{
+				const std::size_t comma = uri->string.find(',');
+				if (comma == std::string::npos || uri->string.rfind(";base64", comma) == std::string::npos || !decode_base64(uri->string.substr(comma + 1), bytes))
+				{
+					std::cout << "glTF buffer data URI is not base64" << std::endl;
+					return false;
+				}
+			}
+			else
+			{
+				const std::filesystem::path bufferPath = directory / uri->string;
+				const MappedFile file(bufferPath.string());
+				if (!file.isOpen())
+				{
+					std::cout << "ERROR TRYING TO READ GLTF BUFFER: " << bufferPath.string() << std::endl;
+					return false;
+				}
+				bytes.assign(file.data(), file.data() + file.size());
+			}
+
+			if (bytes.size() < static_cast<std::size_t>(buffer.number_or("byteLength", 0.0)))
+			{
+				std::cout << "glTF buffer is shorter than its byteLength" << std::endl;
+				return false;
+			}
+			gltf.buffers.push_back(std::move(bytes));
+		}
+		return true;
+	}
+
+	int gltf_component_size(const int componentType)
+	{
+		switch (componentType)
+		{
+		case 5120: case 5121: return 1;	// BYTE, UNSIGNED_BYTE
+		case 5122: case 5123: return 2;	// SHORT, UNSIGNED_SHORT
+		case 5125: case 5126: return 4;	// UNSIGNED_INT, FLOAT
+		default: return 0;
+		}
+	}
+
+	int gltf_type_components(std::string const& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	double read_gltf_component(const unsigned char* source, const int componentType, const bool normalized)
+	{
+		switch (componentType)
+		{
+		case 5120: { std::int8_t v; std::memcpy(&v, source, 1); return normalized ? std::max(v / 127.0, -1.0) : v; }
+		case 5121: return normalized ? source[0] / 255.0 : source[0];
+		case 5122: { std::int16_t v; std::memcpy(&v, source, 2); return normalized ? std::max(v / 32767.0, -1.0) : v; }
+		case 5123: { std::uint16_t v; std::memcpy(&v, source, 2); return normalized ? v / 65535.0 : v; }
+		case 5125: { std::uint32_t v; std::memcpy(&v, source, 4); return v; }
+		default: { float v; std::memcpy(&v, source, 4); return v; }
+		}
+	}
+
+	// every element of an accessor as doubles (exact for 32 bit indices), components values each
+	bool read_gltf_accessor(const GltfDocument& gltf, const double accessorIndex, const int components, std::vector<double>& values)
+	{
+		const JsonValue* accessors = gltf.json.get("accessors");
+		const auto index = static_cast<std::size_t>(accessorIndex);
+		if (accessors == nullptr || accessorIndex < 0.0 || index >= accessors->array.size())
+		{
+			std::cout << "glTF accessor " << accessorIndex << " doesn't exist" << std::endl;
+			return false;
+		}
+		const JsonValue& accessor = accessors->array[index];
+		const JsonValue* type = accessor.get("type");
+		const int componentType = static_cast<int>(accessor.number_or("componentType", 0.0));
+		const int componentSize = gltf_component_size(componentType);
+		const auto count = static_cast<std::size_t>(accessor.number_or("count", 0.0));
+		const JsonValue* normalized = accessor.get("normalized");
+		if (type == nullptr || gltf_type_components(type->string) != components || componentSize == 0)
+		{
+			std::cout << "glTF accessor " << index << " has an unexpected type" << std::endl;
+			return false;
+		}
+		if (accessor.get("sparse") != nullptr)
+		{
+			std::cout << "glTF sparse accessors aren't supported" << std::endl;
+			return false;
+		}
+
+		values.assign(count * components, 0.0);
+		const JsonValue* viewIndex = accessor.get("bufferView");
+		const JsonValue* views = gltf.json.get("bufferViews");
+		if (viewIndex == nullptr)
+		{
+			// no data means zeros
+			return true;
+		}
+		if (views == nullptr || viewIndex->number < 0.0 || static_cast<std::size_t>(viewIndex->number) >= views->array.size())
+		{
+			std::cout << "glTF buffer view " << viewIndex->number << " doesn't exist" << std::endl;
+			return false;
+		}
+		const JsonValue& view = views->array[static_cast<std::size_t>(viewIndex->number)];
+		const auto bufferIndex = static_cast<std::size_t>(view.number_or("buffer", 0.0));
+		if (bufferIndex >= gltf.buffers.size())
+		{
+			std::cout << "glTF buffer " << bufferIndex << " doesn't exist" << std::endl;
+			return false;
+		}
+
+		const std::vector<unsigned char>& buffer = gltf.buffers[bufferIndex];
+		const std::size_t elementSize = static_cast<std::size_t>(componentSize) * components;
+		const auto viewOffset = static_cast<std::size_t>(view.number_or("byteOffset", 0.0));
+		const auto viewLength = static_cast<std::size_t>(view.number_or("byteLength", 0.0));
+		const auto stride = static_cast<std::size_t>(view.number_or("byteStride", static_cast<double>(elementSize)));
+		const auto offset = static_cast<std::size_t>(accessor.number_or("byteOffset", 0.0));
+		if (count > 0 && (viewOffset + viewLength > buffer.size() || offset + (count - 1) * stride + elementSize > viewLength))
+		{
+			std::cout << "glTF accessor " << index << " reads past its buffer view" << std::endl;
+			return false;
+		}
+
+		const unsigned char* source = buffer.data() + viewOffset + offset;
+		const bool isNormalized = normalized != nullptr && normalized->boolean;
+		for (std::size_t e = 0; e < count; ++e)
+		{
+			for (int c = 0; c < components; ++c)
+			{
+				values[e * components + c] = read_gltf_component(source + e * stride + c * componentSize, componentType, isNormalized);
+			}
+		}
+		return true;
+	}
+
+	// area weighted normals of the vertices from firstVertex, from the triangles from firstIndex
+	// (which only use those vertices), for sources without them
+	void compute_normals(ImportedMesh& mesh, const std::size_t firstVertex, const std::size_t firstIndex)
+	{
+		const std::size_t vertexCount = mesh.vertices.size() / MESH_IMPORT_STRIDE;
+		for (std::size_t v = firstVertex; v < vertexCount; ++v)
+		{
+			std::fill_n(mesh.vertices.data() + v * MESH_IMPORT_STRIDE + 3, 3, 0.0f);
+		}
+		for (std::size_t i = firstIndex; i + 2 < mesh.indices.size(); i += 3)
+		{
+			const float* p0 = mesh.vertices.data() + mesh.indices[i] * MESH_IMPORT_STRIDE;
+			const float* p1 = mesh.vertices.data() + mesh.indices[i + 1] * MESH_IMPORT_STRIDE;
+			const float* p2 = mesh.vertices.data() + mesh.indices[i + 2] * MESH_IMPORT_STRIDE;
+			const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			for (std::size_t k = 0; k < 3; ++k)
+			{
+				float* normal = mesh.vertices.data() + mesh.indices[i + k] * MESH_IMPORT_STRIDE + 3;
+				normal[0] += n[0];
+				normal[1] += n[1];
+				normal[2] += n[2];
+			}
+		}
+		for (std::size_t v = firstVertex; v < vertexCount; ++v)
+		{
+			float* normal = mesh.vertices.data() + v * MESH_IMPORT_STRIDE + 3;
+			const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length > 0.0f)
+			{
+				normal[0] /= length;
+				normal[1] /= length;
+				normal[2] /= length;
+			}
+			else
+			{
+				normal[2] = 1.0f;
+			}
+		}
+	}
+
+	bool import_gltf_primitive(const GltfDocument& gltf, const JsonValue& primitive, ImportedMesh& mesh)
+	{
+		const JsonValue* attributes = primitive.get("attributes");
+		const JsonValue* position = attributes != nullptr ? attributes->get("POSITION") : nullptr;
+		if (position == nullptr)
+		{
+			return true;
+		}
+
+		std::vector<double> positions, normals, uvs, indices;
+		if (!read_gltf_accessor(gltf, position->number, 3, positions))
+		{
+			return false;
+		}
+		const std::size_t vertexCount = positions.size() / 3;
+
+		const JsonValue* normal = attributes->get("NORMAL");
+		if (normal != nullptr && !read_gltf_accessor(gltf, normal->number, 3, normals))
+		{
+			return false;
+		}
+		const JsonValue* uv = attributes->get("TEXCOORD_0");
+		if (uv != nullptr && !read_gltf_accessor(gltf, uv->number, 2, uvs))
+		{
+			return false;
+		}
+		if (normals.size() != (normal != nullptr ? positions.size() : 0) || uvs.size() != (uv != nullptr ? vertexCount * 2 : 0))
+		{
+			std::cout << "glTF primitive attributes have different counts" << std::endl;
+			return false;
+		}
+
+		const JsonValue* indicesAccessor = primitive.get("indices");
+		if (indicesAccessor != nullptr && !read_gltf_accessor(gltf, indicesAccessor->number, 1, indices))
+		{
+			return false;
+		}
+
+		const std::size_t base = mesh.vertices.size() / MESH_IMPORT_STRIDE;
+		const std::size_t firstIndex = mesh.indices.size();
+		mesh.vertices.reserve(mesh.vertices.size() + vertexCount * MESH_IMPORT_STRIDE);
+		for (std::size_t v = 0; v < vertexCount; ++v)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				mesh.vertices.push_back(static_cast<float>(positions[v * 3 + c]));
+			}
+			for (int c = 0; c < 3; ++c)
+			{
+				mesh.vertices.push_back(normals.empty() ? 0.0f : static_cast<float>(normals[v * 3 + c]));
+			}
+			// glTF puts the texture origin at the top left, OpenGL at the bottom left
+			mesh.vertices.push_back(uvs.empty() ? 0.0f : static_cast<float>(uvs[v * 2]));
+			mesh.vertices.push_back(uvs.empty() ? 0.0f : 1.0f - static_cast<float>(uvs[v * 2 + 1]));
+		}
+
+		const std::size_t indexCount = indicesAccessor != nullptr ? indices.size() : vertexCount;
+		for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			for (std::size_t k = 0; k < 3; ++k)
+			{
+				const std::size_t index = indicesAccessor != nullptr ? static_cast<std::size_t>(indices[i + k]) : i + k;
+				if (index >= vertexCount)
+				{
+					std::cout << "glTF index " << index << " is out of range" << std::endl;
+					return false;
+				}
+				mesh.indices.push_back(static_cast<unsigned int>(base + index));
+			}
+		}
+
+		// only this primitive's normals, the others keep the ones they came with
+		if (normal == nullptr)
+		{
+			compute_normals(mesh, base, firstIndex);
+		}
+		return true;
+	}
+
+	void compute_bounds(const std::vector<float>& vertices, const unsigned int* indices, const std::size_t indexCount, float boundsMin[3], float boundsMax[3])
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			boundsMin[c] = indexCount > 0 ? INFINITY : 0.0f;
+			boundsMax[c] = indexCount > 0 ? -INFINITY : 0.0f;
+		}
+		for (std::size_t i = 0; i < indexCount; ++i)
+		{
+			const float* position = vertices.data() + static_cast<std::size_t>(indices[i]) * MESH_IMPORT_STRIDE;
+			for (int c = 0; c < 3; ++c)
+			{
+				boundsMin[c] = std::min(boundsMin[c], position[c]);
+				boundsMax[c] = std::max(boundsMax[c], position[c]);
+			}
+		}
+	}
+}
+
+bool import_obj(std::string const& path, ImportedMesh& mesh)
+{
+	const MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cout << "ERROR TRYING TO READ OBJ FILE: " << path << std::endl;
+		return false;
+	}
+
+	std::vector<float> positions, uvs, normals;
+	std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> corners;
+	std::vector<unsigned int> polygon;
+	std::string submeshName = "default";
+	bool everyCornerHasNormal = true;
+	std::size_t lineNumber = 0;
+
+	// the mapping isn't NUL terminated, lines are copied out before strtof reads them
+	std::string line;
+	const char* cursor = file.data();
+	const char* const end = file.data() + file.size();
+	while (cursor < end)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)));
+		if (lineEnd == nullptr)
+		{
+			lineEnd = end;
+		}
+		line.assign(cursor, lineEnd);
+		cursor = lineEnd + 1;
+		++lineNumber;
+
+		const char* text = line.c_str();
+		while (*text == ' ' || *text == '\t')
+		{
+			++text;
+		}
+
+		if (text[0] == 'v' && (text[1] == ' ' || text[1] == '\t'))
+		{
+			char* next = const_cast<char*>(text + 1);
+			for (int c = 0; c < 3; ++c)
+			{
+				positions.push_back(std::strtof(next, &next));
+			}
+		}
+		else if (text[0] == 'v' && text[1] == 't' && (text[2] == ' ' || text[2] == '\t'))
+		{
+			char* next = const_cast<char*>(text + 2);
+			uvs.push_back(std::strtof(next, &next));
+			uvs.push_back(std::strtof(next, &next));
+		}
+		else if (text[0] == 'v' && text[1] == 'n' && (text[2] == ' ' || text[2] == '\t'))
+		{
+			char* next = const_cast<char*>(text + 2);
+			for (int c = 0; c < 3; ++c)
+			{
+				normals.push_back(std::strtof(next, &next));
+			}
+		}
+		else if (text[0] == 'f' && (text[1] == ' ' || text[1] == '\t'))
+		{
+			// v, v/vt, v//vn or v/vt/vn per corner
+			polygon.clear();
+			char* next = const_cast<char*>(text + 1);
+			for (;;)
+			{
+				while (*next == ' ' || *next == '\t' || *next == '\r')
+				{
+					++next;
+				}
+				if (*next == '\0')
+				{
+					break;
+				}
+
+				ObjCorner corner = { resolve_obj_index(std::strtol(next, &next, 10), positions.size() / 3), -1, -1 };
+				if (*next == '/')
+				{
+					++next;
+					if (*next != '/')
+					{
+						corner.uv = resolve_obj_index(std::strtol(next, &next, 10), uvs.size() / 2);
+					}
+					if (*next == '/')
+					{
+						++next;
+						corner.normal = resolve_obj_index(std::strtol(next, &next, 10), normals.size() / 3);
+					}
+				}
+				if (corner.position < 0 || corner.uv == -2 || corner.normal == -2 || (*next != '\0' && *next != ' ' && *next != '\t' && *next != '\r'))
+				{
+					std::cout << "OBJ face with a bad index at " << path << ":" << lineNumber << std::endl;
+					return false;
+				}
+				everyCornerHasNormal = everyCornerHasNormal && corner.normal >= 0;
+
+				const auto inserted = corners.emplace(corner, static_cast<unsigned int>(mesh.vertices.size() / MESH_IMPORT_STRIDE));
+				if (inserted.second)
+				{
+					const float* p = &positions[corner.position * 3];
+					mesh.vertices.insert(mesh.vertices.end(), p, p + 3);
+					for (int c = 0; c < 3; ++c)
+					{
+						mesh.vertices.push_back(corner.normal >= 0 ? normals[corner.normal * 3 + c] : 0.0f);
+					}
+					mesh.vertices.push_back(corner.uv >= 0 ? uvs[corner.uv * 2] : 0.0f);
+					mesh.vertices.push_back(corner.uv >= 0 ? uvs[corner.uv * 2 + 1] : 0.0f);
+				}
+				polygon.push_back(inserted.first->second);
+			}
+
+			// convex polygons as triangle fans
+			for (std::size_t k = 2; k < polygon.size(); ++k)
+			{
+				mesh.indices.push_back(polygon[0]);
+				mesh.indices.push_back(polygon[k - 1]);
+				mesh.indices.push_back(polygon[k]);
+			}
+		}
+		else if ((text[0] == 'o' || text[0] == 'g') && (text[1] == ' ' || text[1] == '\t'))
+		{
+			close_submesh(mesh, submeshName);
+			submeshName = line_argument(text + 1);
+		}
+		else if (std::strncmp(text, "usemtl", 6) == 0 && (text[6] == ' ' || text[6] == '\t'))
+		{
+			close_submesh(mesh, submeshName);
+			submeshName = line_argument(text + 6);
+		}
+	}
+	close_submesh(mesh, submeshName);
+
+	mesh.hasNormals = everyCornerHasNormal;
+	if (mesh.indices.empty())
+	{
+		std::cout << "OBJ file has no faces: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool import_gltf(std::string const& path, ImportedMesh& mesh)
+{
+	const MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cout << "ERROR TRYING TO READ GLTF FILE: " << path << std::endl;
+		return false;
+	}
+
+	// a .glb is a 12 byte header, the JSON chunk and an optional BIN chunk
+	const char* json = file.data();
+	std::size_t jsonSize = file.size();
+	const unsigned char* binary = nullptr;
+	std::size_t binarySize = 0;
+	std::uint32_t glbHeader[3] = { 0, 0, 0 };
+	if (file.size() >= sizeof(glbHeader))
+	{
+		std::memcpy(glbHeader, file.data(), sizeof(glbHeader));
+	}
+	if (glbHeader[0] == 0x46546C67) // "glTF"
+	{
+		jsonSize = 0;
+		std::size_t offset = sizeof(glbHeader);
+		const std::size_t length = std::min<std::size_t>(glbHeader[2], file.size());
+		while (offset + 8 <= length)
+		{
+			std::uint32_t chunk[2];
+			std::memcpy(chunk, file.data() + offset, sizeof(chunk));
+			offset += sizeof(chunk);
+			if (chunk[0] > length - offset)
+			{
+				break;
+			}
+			if (chunk[1] == 0x4E4F534A) // "JSON"
+			{
+				json = file.data() + offset;
+				jsonSize = chunk[0];
+			}
+			else if (chunk[1] == 0x004E4942) // "BIN"
+			{
+				binary = reinterpret_cast<const unsigned char*>(file.data() + offset);
+				binarySize = chunk[0];
+			}
+			offset += chunk[0];
+		}
+		if (glbHeader[1] != 2 || jsonSize == 0)
+		{
+			std::cout << "GLB file is malformed: " << path << std::endl;
+			return false;
+		}
+	}
+
+	// the JSON chunk may be padded with spaces
+	GltfDocument gltf;
+	JsonParser parser(json, json + jsonSize);
+	if (!parser.parse(gltf.json) || gltf.json.type != JsonValue::Type::Object)
+	{
+		std::cout << "glTF JSON is malformed: " << path << std::endl;
+		return false;
+	}
+	if (!load_gltf_buffers(gltf, std::filesystem::path(path).parent_path(), binary, binarySize))
+	{
+		return false;
+	}
+
+	const JsonValue* meshes = gltf.json.get("meshes");
+	if (meshes != nullptr)
+	{
+		for (std::size_t m = 0; m < meshes->array.size(); ++m)
+		{
+			const JsonValue& gltfMesh = meshes->array[m];
+			const JsonValue* name = gltfMesh.get("name");
+			const JsonValue* primitives = gltfMesh.get("primitives");
+			if (primitives == nullptr)
+			{
+				continue;
+			}
+			for (std::size_t p = 0; p < primitives->array.size(); ++p)
+			{
+				const JsonValue& primitive = primitives->array[p];
+				if (primitive.number_or("mode", 4.0) != 4.0)
+				{
+					std::cout << "Skipping a glTF primitive that isn't a triangle list" << std::endl;
+					continue;
+				}
+				if (!import_gltf_primitive(gltf, primitive, mesh))
+				{
+					return false;
+				}
+				close_submesh(mesh, (name != nullptr ? name->string : "mesh" + std::to_string(m)) + (primitives->array.size() > 1 ? "." + std::to_string(p) : ""));
+			}
+		}
+	}
+
+	// a primitive without normals got computed ones
+	mesh.hasNormals = true;
+	if (mesh.indices.empty())
+	{
+		std::cout << "glTF file has no triangles: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool convert_mesh(std::string const& inputPath, std::string const& outputPath, MeshConversionReport& report)
+{
+	report = MeshConversionReport();
+	const Clock::time_point importStart = Clock::now();
+
+	std::string extension = std::filesystem::path(inputPath).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	ImportedMesh mesh;
+	bool imported = false;
+	if (extension == ".obj")
+	{
+		imported = import_obj(inputPath, mesh);
+	}
+	else if (extension == ".gltf" || extension == ".glb")
+	{
+		imported = import_gltf(inputPath, mesh);
+	}
+	else
+	{
+		std::cout << "Unknown mesh format (expected .obj, .gltf or .glb): " << inputPath << std::endl;
+	}
+	if (!imported)
+	{
+		return false;
+	}
+	if (!mesh.hasNormals)
+	{
+		compute_normals(mesh, 0, 0);
+	}
+
+	report.verticesImported = mesh.vertices.size() / MESH_IMPORT_STRIDE;
+	report.triangles = mesh.indices.size() / 3;
+	report.submeshes = mesh.submeshes.size();
+	report.acmrBefore = compute_acmr(mesh.indices);
+	report.importMs = elapsed_ms(importStart);
+
+	const Clock::time_point optimizeStart = Clock::now();
+
+	// clockwise, the winding the renderer treats as the front face
+	for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+	}
+
+	// the same stages as optimize_mesh, but the triangles are only reordered inside their submesh
+	const std::size_t welded = weld_vertices(mesh.vertices, MESH_IMPORT_STRIDE, mesh.indices);
+	std::vector<unsigned int> submeshIndices;
+	for (const ImportedSubmesh& submesh : mesh.submeshes)
+	{
+		const auto first = mesh.indices.begin() + static_cast<std::ptrdiff_t>(submesh.firstIndex);
+		const auto last = first + static_cast<std::ptrdiff_t>(submesh.indexCount);
+		submeshIndices.assign(first, last);
+		const std::vector<std::size_t> clusters = optimize_vertex_cache(submeshIndices, welded);
+		optimize_overdraw(submeshIndices, clusters, mesh.vertices, MESH_IMPORT_STRIDE, GL_CW);
+		std::copy(submeshIndices.begin(), submeshIndices.end(), first);
+	}
+	const std::size_t vertexCount = optimize_vertex_fetch(mesh.vertices, MESH_IMPORT_STRIDE, mesh.indices);
+	report.verticesWritten = vertexCount;
+	report.acmrAfter = compute_acmr(mesh.indices);
+
+	// the normal goes in the color attribute ([-1, 1] to [0, 1]), the shaders have no lighting
+	bool uvsInUnitRange = true;
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		float* vertex = mesh.vertices.data() + v * MESH_IMPORT_STRIDE;
+		for (int c = 3; c < 6; ++c)
+		{
+			vertex[c] = vertex[c] * 0.5f + 0.5f;
+		}
+		uvsInUnitRange = uvsInUnitRange && vertex[6] >= 0.0f && vertex[6] <= 1.0f && vertex[7] >= 0.0f && vertex[7] <= 1.0f;
+	}
+
+	MeshFileContents contents;
+	compute_bounds(mesh.vertices, mesh.indices.data(), mesh.indices.size(), contents.boundsMin, contents.boundsMax);
+	for (const ImportedSubmesh& submesh : mesh.submeshes)
+	{
+		MeshFileSubmesh stored = {};
+		std::strncpy(stored.name, submesh.name.c_str(), sizeof(stored.name) - 1);
+		stored.firstIndex = static_cast<std::uint32_t>(submesh.firstIndex);
+		stored.indexCount = static_cast<std::uint32_t>(submesh.indexCount);
+		compute_bounds(mesh.vertices, mesh.indices.data() + submesh.firstIndex, submesh.indexCount, stored.boundsMin, stored.boundsMax);
+		contents.submeshes.push_back(stored);
+	}
+
+	// one range for the three position components, uPositionDequant is a scalar scale and bias
+	const float positionMin = std::min({ contents.boundsMin[0], contents.boundsMin[1], contents.boundsMin[2] });
+	const float positionMax = std::max({ contents.boundsMax[0], contents.boundsMax[1], contents.boundsMax[2] });
+	contents.layout
+		.add(0, 3, AttributeFormat::Snorm16, positionMin, positionMax)
+		.add(1, 3, AttributeFormat::Unorm8)
+		.add(2, 2, uvsInUnitRange ? AttributeFormat::Unorm16 : AttributeFormat::Half);
+	contents.vertices = contents.layout.pack(mesh.vertices.data(), vertexCount, MESH_IMPORT_STRIDE);
+	contents.vertexCount = vertexCount;
+	contents.indices = narrow_indices(mesh.indices, vertexCount);
+	report.optimizeMs = elapsed_ms(optimizeStart);
+
+	const Clock::time_point writeStart = Clock::now();
+	if (!write_mesh_file(outputPath, contents))
+	{
+		return false;
+	}
+	report.writeMs = elapsed_ms(writeStart);
+
+	std::error_code error;
+	report.fileBytes = static_cast<std::size_t>(std::filesystem::file_size(outputPath, error));
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Offline conversion of OBJ and glTF 2.0 files into the binary mesh format (see MeshFile.h),
+// run with: MyOwnProjectionMatrix --convert-mesh model.obj model.mesh
+// Supported input:
+//		.obj		v/vt/vn, polygons (triangulated as fans), negative indices, o/g/usemtl start a submesh
+//		.gltf/.glb	triangle primitives with POSITION, NORMAL, TEXCOORD_0 and indices, buffers in the
+//					.glb, in external files or in base64 data URIs; one submesh per primitive.
+//					Node transforms, materials, skins and morph targets are ignored
+// Everything the runtime would do to the mesh happens here: welding, vertex cache and overdraw
+// order per submesh, fetch order, quantization and index narrowing.
+
+// vertices read from the source file: position, normal and texture coordinates
+constexpr std::size_t MESH_IMPORT_STRIDE = 8;
+
+struct ImportedSubmesh
+{
+	std::string name;
+	std::size_t firstIndex;
+	std::size_t indexCount;
+};
+
+struct ImportedMesh
+{
+	std::vector<float> vertices;		// MESH_IMPORT_STRIDE floats per vertex
+	std::vector<unsigned int> indices;	// counter clockwise triangles
+	std::vector<ImportedSubmesh> submeshes;
+	bool hasNormals = false;			// else convert_mesh computes smooth ones
+};
+
+struct MeshConversionReport
+{
+	std::size_t verticesImported;
+	std::size_t verticesWritten;
+	std::size_t triangles;
+	std::size_t submeshes;
+	double acmrBefore;
+	double acmrAfter;
+	std::size_t fileBytes;
+	double importMs;
+	double optimizeMs;
+	double writeMs;
+};
+
+// false (with a message) when the file can't be read or has nothing to draw
+bool import_obj(std::string const& path, ImportedMesh& mesh);
+bool import_gltf(std::string const& path, ImportedMesh& mesh);
+
+// import by extension, optimize, quantize and write outputPath
+bool convert_mesh(std::string const& inputPath, std::string const& outputPath, MeshConversionReport& report);
@@ -0,0 +1,208 @@
+#include "MeshFile.h"
+#include "Profiler.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	std::uint64_t align_up(const std::uint64_t offset)
+	{
+		return (offset + MESH_FILE_ALIGNMENT - 1) & ~static_cast<std::uint64_t>(MESH_FILE_ALIGNMENT - 1);
+	}
+
+	void write_padding(std::ofstream& file, const std::uint64_t from, const std::uint64_t to)
+	{
+		static const char zeros[MESH_FILE_ALIGNMENT] = {};
+		file.write(zeros, static_cast<std::streamsize>(to - from));
+	}
+}
+
+bool write_mesh_file(std::string const& path, const MeshFileContents& contents)
+{
+	const std::vector<VertexAttribute>& attributes = contents.layout.getAttributes();
+
+	MeshFileHeader header = {};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = static_cast<std::uint32_t>(contents.vertexCount);
+	header.vertexStride = static_cast<std::uint32_t>(contents.layout.getStride());
+	header.attributeCount = static_cast<std::uint32_t>(attributes.size());
+	header.indexCount = static_cast<std::uint32_t>(contents.indices.count);
+	header.indexType = contents.indices.type;
+	header.submeshCount = static_cast<std::uint32_t>(contents.submeshes.size());
+	std::memcpy(header.boundsMin, contents.boundsMin, sizeof(header.boundsMin));
+	std::memcpy(header.boundsMax, contents.boundsMax, sizeof(header.boundsMax));
+
+	const std::uint64_t tablesEnd = sizeof(MeshFileHeader) + attributes.size() * sizeof(MeshFileAttribute) + contents.submeshes.size() * sizeof(MeshFileSubmesh);
+	header.vertexOffset = align_up(tablesEnd);
+	header.vertexBytes = contents.vertices.size();
+	header.indexOffset = align_up(header.vertexOffset + header.vertexBytes);
+	header.indexBytes = contents.indices.data.size();
+
+	// written next to the file then renamed, so a reader never maps a partial file
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const VertexAttribute& attribute : attributes)
+		{
+			const MeshFileAttribute stored = {
+				attribute.location, static_cast<std::uint32_t>(attribute.components), static_cast<std::uint32_t>(attribute.format),
+				static_cast<std::uint32_t>(attribute.offset), attribute.minimum, attribute.maximum };
+			file.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+		}
+		file.write(reinterpret_cast<const char*>(contents.submeshes.data()), static_cast<std::streamsize>(contents.submeshes.size() * sizeof(MeshFileSubmesh)));
+
+		write_padding(file, tablesEnd, header.vertexOffset);
+		file.write(reinterpret_cast<const char*>(contents.vertices.data()), static_cast<std::streamsize>(header.vertexBytes));
+		write_padding(file, header.vertexOffset + header.vertexBytes, header.indexOffset);
+		file.write(reinterpret_cast<const char*>(contents.indices.data.data()), static_cast<std::streamsize>(header.indexBytes));
+		if (!file)
+		{
+			std::cout << "ERROR WRITING MESH FILE: " << temporaryPath << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cout << "ERROR WRITING MESH FILE: " << path << " (" << error.message() << ")" << std::endl;
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+MeshFile::MeshFile(std::string const& path) : file(std::make_shared<const MappedFile>(path)), header(nullptr), valid(false)
+{
+	if (!file->isOpen())
+	{
+		std::cout << "ERROR TRYING TO READ MESH FILE: " << path << std::endl;
+		return;
+	}
+
+	// every offset and size is checked against the mapping before anything is read through it
+	const std::uint64_t size = file->size();
+	if (size < sizeof(MeshFileHeader))
+	{
+		std::cout << "Mesh file is malformed: " << path << std::endl;
+		return;
+	}
+	header = reinterpret_cast<const MeshFileHeader*>(file->data());
+
+	const std::uint64_t tablesEnd = sizeof(MeshFileHeader)
+		+ static_cast<std::uint64_t>(header->attributeCount) * sizeof(MeshFileAttribute)
+		+ static_cast<std::uint64_t>(header->submeshCount) * sizeof(MeshFileSubmesh);
+	const bool streamsFit = tablesEnd <= size
+		&& header->vertexOffset <= size && header->vertexBytes <= size - header->vertexOffset
+		&& header->indexOffset <= size && header->indexBytes <= size - header->indexOffset;
+	const bool knownIndexType = header->indexType == GL_UNSIGNED_BYTE || header->indexType == GL_UNSIGNED_SHORT || header->indexType == GL_UNSIGNED_INT;
+	if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION || !streamsFit || !knownIndexType
+		|| header->vertexBytes != static_cast<std::uint64_t>(header->vertexCount) * header->vertexStride
+		|| header->indexBytes != static_cast<std::uint64_t>(header->indexCount) * index_type_size(header->indexType))
+	{
+		std::cout << "Mesh file is malformed: " << path << std::endl;
+		return;
+	}
+
+	const auto* attributes = reinterpret_cast<const MeshFileAttribute*>(file->data() + sizeof(MeshFileHeader));
+	for (std::uint32_t i = 0; i < header->attributeCount; ++i)
+	{
+		if (attributes[i].format > static_cast<std::uint32_t>(AttributeFormat::Unorm8) || attributes[i].components < 1 || attributes[i].components > 4)
+		{
+			std::cout << "Mesh file is malformed (vertex layout): " << path << std::endl;
+			return;
+		}
+		layout.add(attributes[i].location, static_cast<int>(attributes[i].components), static_cast<AttributeFormat>(attributes[i].format),
+			attributes[i].minimum, attributes[i].maximum);
+	}
+	if (layout.getStride() != header->vertexStride)
+	{
+		std::cout << "Mesh file is malformed (vertex layout): " << path << std::endl;
+		return;
+	}
+
+	// every submesh draws inside the index stream and has a printable name
+	const MeshFileSubmesh* submeshes = getSubmeshes();
+	for (std::uint32_t i = 0; i < header->submeshCount; ++i)
+	{
+		if (static_cast<std::uint64_t>(submeshes[i].firstIndex) + submeshes[i].indexCount > header->indexCount
+			|| std::memchr(submeshes[i].name, '\0', sizeof(submeshes[i].name)) == nullptr)
+		{
+			std::cout << "Mesh file is malformed (submesh " << i << "): " << path << std::endl;
+			return;
+		}
+	}
+
+	valid = true;
+}
+
+bool MeshFile::isOpen() const
+{
+	return valid;
+}
+
+const MeshFileHeader& MeshFile::getHeader() const
+{
+	return *header;
+}
+
+const VertexLayout& MeshFile::getLayout() const
+{
+	return layout;
+}
+
+const MeshFileSubmesh* MeshFile::getSubmeshes() const
+{
+	return reinterpret_cast<const MeshFileSubmesh*>(file->data() + sizeof(MeshFileHeader) + header->attributeCount * sizeof(MeshFileAttribute));
+}
+
+const unsigned char* MeshFile::getVertexData() const
+{
+	return reinterpret_cast<const unsigned char*>(file->data() + header->vertexOffset);
+}
+
+const unsigned char* MeshFile::getIndexData() const
+{
+	return reinterpret_cast<const unsigned char*>(file->data() + header->indexOffset);
+}
+
+MeshBuffers MeshFile::upload() const
+{
+	MeshBuffers buffers;
+	if (!valid)
+	{
+		return buffers;
+	}
+	PROFILE_SCOPE("MeshFile::upload");
+
+	glGenVertexArrays(1, &buffers.vertexArray);
+	glBindVertexArray(buffers.vertexArray);
+
+	// the driver copies from the mapped pages, they are read from disk on first touch
+	glGenBuffers(1, &buffers.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(header->vertexBytes), getVertexData(), GL_STATIC_DRAW);
+	layout.apply();
+
+	glGenBuffers(1, &buffers.indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(header->indexBytes), getIndexData(), GL_STATIC_DRAW);
+
+	buffers.indexCount = static_cast<GLsizei>(header->indexCount);
+	buffers.indexType = header->indexType;
+	return buffers;
+}
+
+void delete_mesh_buffers(MeshBuffers& buffers)
+{
+	glDeleteBuffers(1, &buffers.vertexBuffer);
+	glDeleteBuffers(1, &buffers.indexBuffer);
+	glDeleteVertexArrays(1, &buffers.vertexArray);
+	buffers = MeshBuffers();
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "VertexLayout.h"
+
+// Binary mesh container (.mesh), laid out so the GPU streams are used in place:
+//		MeshFileHeader
+//		MeshFileAttribute[attributeCount]	the VertexLayout of the vertex stream
+//		MeshFileSubmesh[submeshCount]		index ranges with their bounds
+//		vertex stream						already packed, MESH_FILE_ALIGNMENT aligned
+//		index stream						8/16/32 bit, MESH_FILE_ALIGNMENT aligned
+// Every field is little endian. Written by the converter (see MeshConverter.h), read by
+// MeshFile through a memory mapping: loading is validating the header and handing the
+// mapped streams to glBufferData, nothing is parsed.
+constexpr std::uint32_t MESH_FILE_MAGIC = 0x4D504F4D; // "MOPM"
+constexpr std::uint32_t MESH_FILE_VERSION = 1;
+constexpr std::size_t MESH_FILE_ALIGNMENT = 64;
+
+struct MeshFileHeader
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t vertexCount;
+	std::uint32_t vertexStride;
+	std::uint32_t attributeCount;
+	std::uint32_t indexCount;
+	std::uint32_t indexType;		// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	std::uint32_t submeshCount;
+	float boundsMin[3];
+	float boundsMax[3];
+	std::uint64_t vertexOffset;		// from the start of the file
+	std::uint64_t vertexBytes;
+	std::uint64_t indexOffset;
+	std::uint64_t indexBytes;
+};
+
+struct MeshFileAttribute
+{
+	std::uint32_t location;
+	std::uint32_t components;
+	std::uint32_t format;			// AttributeFormat
+	std::uint32_t offset;
+	float minimum;
+	float maximum;
+};
+
+struct MeshFileSubmesh
+{
+	char name[32];					// NUL terminated, truncated
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+static_assert(sizeof(MeshFileHeader) == 88, "MeshFileHeader is written as is");
+static_assert(sizeof(MeshFileAttribute) == 24, "MeshFileAttribute is written as is");
+static_assert(sizeof(MeshFileSubmesh) == 64, "MeshFileSubmesh is written as is");
+
+// what write_mesh_file stores
+struct MeshFileContents
+{
+	VertexLayout layout;
+	std::vector<unsigned char> vertices;	// packed with layout
+	std::size_t vertexCount = 0;
+	IndexBuffer indices;
+	std::vector<MeshFileSubmesh> submeshes;
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// written next to the destination then renamed, false (with a message) on failure
+bool write_mesh_file(std::string const& path, const MeshFileContents& contents);
+
+// the vertex array of an uploaded mesh, ready for glDrawElements(GL_TRIANGLES, indexCount, indexType, 0)
+struct MeshBuffers
+{
+	GLuint vertexArray = 0;
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+};
+
+class MeshFile
+{
+public:
+	// map and validate, see isOpen
+	explicit MeshFile(std::string const& path);
+
+	// false when the file is missing, truncated or not a mesh file of this version
+	bool isOpen() const;
+
+	const MeshFileHeader& getHeader() const;
+	const VertexLayout& getLayout() const;
+	const MeshFileSubmesh* getSubmeshes() const;
+
+	// the streams inside the mapping
+	const unsigned char* getVertexData() const;
+	const unsigned char* getIndexData() const;
+
+	// GL thread: a VAO with the vertex and index buffers filled straight from the mapping
+	MeshBuffers upload() const;
+
+private:
+	std::shared_ptr<const MappedFile> file;
+	const MeshFileHeader* header;
+	VertexLayout layout;
+	bool valid;
+};
+
+void delete_mesh_buffers(MeshBuffers& buffers);
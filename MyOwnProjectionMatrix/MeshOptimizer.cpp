@@ -0,0 +1,413 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// FNV-1a over the bytes of a vertex
+	std::uint32_t hash_vertex(const float* vertex, const std::size_t stride)
+	{
+		const auto* bytes = reinterpret_cast<const unsigned char*>(vertex);
+		std::uint32_t hash = 2166136261u;
+		for (std::size_t i = 0; i < stride * sizeof(float); ++i)
+		{
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	// triangles using each vertex, as offsets into one array (compressed adjacency)
+	struct VertexTriangles
+	{
+		std::vector<std::size_t> first;		// vertexCount + 1 entries
+		std::vector<std::size_t> triangles;
+	};
+
+	VertexTriangles build_adjacency(const std::vector<unsigned int>& indices, const std::size_t vertexCount)
+	{
+		VertexTriangles adjacency;
+		adjacency.first.assign(vertexCount + 1, 0);
+		for (const unsigned int index : indices)
+		{
+			++adjacency.first[index + 1];
+		}
+		for (std::size_t v = 0; v < vertexCount; ++v)
+		{
+			adjacency.first[v + 1] += adjacency.first[v];
+		}
+
+		adjacency.triangles.resize(indices.size());
+		std::vector<std::size_t> fill(adjacency.first.begin(), adjacency.first.end() - 1);
+		for (std::size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency.triangles[fill[indices[i]]++] = i / 3;
+		}
+		return adjacency;
+	}
+}
+
+MeshOptimizationReport optimize_mesh(std::vector<float>& vertices, const std::size_t stride, std::vector<unsigned int>& indices, const GLenum frontFace)
+{
+	MeshOptimizationReport report = {};
+	report.verticesBefore = vertices.size() / stride;
+	report.triangles = indices.size() / 3;
+	report.acmrBefore = compute_acmr(indices);
+	report.indexBytesBefore = indices.size() * sizeof(unsigned int);
+
+	const std::size_t welded = weld_vertices(vertices, stride, indices);
+	const std::vector<std::size_t> clusters = optimize_vertex_cache(indices, welded);
+	optimize_overdraw(indices, clusters, vertices, stride, frontFace);
+	report.verticesAfter = optimize_vertex_fetch(vertices, stride, indices);
+
+	report.clusters = clusters.size();
+	report.acmrAfter = compute_acmr(indices);
+	report.atvrAfter = report.verticesAfter > 0 ? report.acmrAfter * static_cast<double>(report.triangles) / static_cast<double>(report.verticesAfter) : 0.0;
+	report.indexType = smallest_index_type(report.verticesAfter);
+	report.indexBytesAfter = indices.size() * index_type_size(report.indexType);
+	return report;
+}
+
+std::size_t weld_vertices(std::vector<float>& vertices, const std::size_t stride, std::vector<unsigned int>& indices)
+{
+	const std::size_t vertexCount = vertices.size() / stride;
+
+	// open addressing hash table (linear probing) of the kept vertices, at most half full
+	std::size_t capacity = 16;
+	while (capacity < 2 * vertexCount)
+	{
+		capacity *= 2;
+	}
+	constexpr unsigned int EMPTY = ~0u;
+	std::vector<unsigned int> table(capacity, EMPTY);
+	const std::size_t mask = capacity - 1;
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::size_t kept = 0;
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		const float* vertex = vertices.data() + v * stride;
+		for (std::size_t slot = hash_vertex(vertex, stride) & mask;; slot = (slot + 1) & mask)
+		{
+			if (table[slot] == EMPTY)
+			{
+				// first of its kind, moved down to the next kept position
+				if (kept != v)
+				{
+					std::memmove(vertices.data() + kept * stride, vertex, stride * sizeof(float));
+				}
+				table[slot] = static_cast<unsigned int>(kept);
+				remap[v] = static_cast<unsigned int>(kept++);
+				break;
+			}
+			if (std::memcmp(vertices.data() + table[slot] * stride, vertex, stride * sizeof(float)) == 0)
+			{
+				remap[v] = table[slot];
+				break;
+			}
+		}
+	}
+
+	for (unsigned int& index : indices)
+	{
+		index = remap[index];
+	}
+	vertices.resize(kept * stride);
+	return kept;
+}
+
+std::vector<std::size_t> optimize_vertex_cache(std::vector<unsigned int>& indices, const std::size_t vertexCount, const unsigned int cacheSize)
+{
+	std::vector<std::size_t> clusters;
+	const std::size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return clusters;
+	}
+
+	const VertexTriangles adjacency = build_adjacency(indices, vertexCount);
+
+	std::vector<unsigned int> liveTriangles(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		liveTriangles[v] = static_cast<unsigned int>(adjacency.first[v + 1] - adjacency.first[v]);
+	}
+
+	// the time a vertex last entered the cache, "in cache" means time - cacheTime < cacheSize
+	std::vector<std::size_t> cacheTime(vertexCount, 0);
+	std::size_t time = cacheSize + 1;
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;			// recently used vertices, to restart from
+	std::vector<unsigned int> candidates;		// 1-ring of the fanning vertex
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	std::size_t cursor = 0;						// next vertex to try when everything else is dead
+	long long fanning = 0;
+	bool jumped = true;
+	while (fanning >= 0)
+	{
+		if (jumped && (clusters.empty() || clusters.back() != output.size() / 3))
+		{
+			clusters.push_back(output.size() / 3);
+		}
+
+		// emit every live triangle around the fanning vertex
+		candidates.clear();
+		const auto f = static_cast<std::size_t>(fanning);
+		for (std::size_t a = adjacency.first[f]; a < adjacency.first[f + 1]; ++a)
+		{
+			const std::size_t triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = true;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const unsigned int v = indices[triangle * 3 + corner];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--liveTriangles[v];
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time++;
+				}
+			}
+		}
+
+		// the candidate still in cache after emitting its remaining triangles, oldest first
+		long long next = -1;
+		long long best = -1;
+		for (const unsigned int v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+			{
+				continue;
+			}
+			long long priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+			{
+				priority = static_cast<long long>(time - cacheTime[v]);
+			}
+			if (priority > best)
+			{
+				best = priority;
+				next = v;
+			}
+		}
+
+		jumped = next < 0;
+		if (jumped)
+		{
+			// dead end: a recent vertex with triangles left, else the next one in input order
+			while (!deadEnd.empty() && next < 0)
+			{
+				const unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveTriangles[v] > 0)
+				{
+					next = v;
+				}
+			}
+			while (next < 0 && cursor < vertexCount)
+			{
+				if (liveTriangles[cursor] > 0)
+				{
+					next = static_cast<long long>(cursor);
+				}
+				++cursor;
+			}
+		}
+		fanning = next;
+	}
+
+	indices.swap(output);
+	return clusters;
+}
+
+void optimize_overdraw(std::vector<unsigned int>& indices, const std::vector<std::size_t>& clusters, const std::vector<float>& vertices, const std::size_t stride, const GLenum frontFace)
+{
+	const std::size_t triangleCount = indices.size() / 3;
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	const auto position = [&](const unsigned int v)
+	{
+		return vertices.data() + static_cast<std::size_t>(v) * stride;
+	};
+
+	// mesh center, the average of the triangle centers
+	double center[3] = { 0.0, 0.0, 0.0 };
+	for (const unsigned int index : indices)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			center[c] += position(index)[c];
+		}
+	}
+	for (double& c : center)
+	{
+		c /= static_cast<double>(indices.size());
+	}
+
+	struct Cluster
+	{
+		std::size_t first;
+		std::size_t end;
+		double score;
+	};
+	std::vector<Cluster> sorted;
+	for (std::size_t i = 0; i < clusters.size(); ++i)
+	{
+		const std::size_t first = clusters[i];
+		const std::size_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+		// area weighted normal and center of the cluster
+		double normal[3] = { 0.0, 0.0, 0.0 };
+		double centroid[3] = { 0.0, 0.0, 0.0 };
+		for (std::size_t t = first; t < end; ++t)
+		{
+			const float* a = position(indices[t * 3]);
+			const float* b = position(indices[t * 3 + 1]);
+			const float* c = position(indices[t * 3 + 2]);
+			const double e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const double e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			normal[0] += e0[1] * e1[2] - e0[2] * e1[1];
+			normal[1] += e0[2] * e1[0] - e0[0] * e1[2];
+			normal[2] += e0[0] * e1[1] - e0[1] * e1[0];
+			for (int k = 0; k < 3; ++k)
+			{
+				centroid[k] += (a[k] + b[k] + c[k]) / 3.0;
+			}
+		}
+
+		// the cross product points out of counter-clockwise front faces
+		double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (frontFace == GL_CW)
+		{
+			length = -length;
+		}
+		double score = 0.0;
+		if (length != 0.0 && end > first)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				score += (centroid[k] / static_cast<double>(end - first) - center[k]) * normal[k] / length;
+			}
+		}
+		sorted.push_back(Cluster{ first, end, score });
+	}
+
+	// the most outward facing clusters occlude the others, draw them first
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& l, const Cluster& r) { return l.score > r.score; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (const Cluster& cluster : sorted)
+	{
+		output.insert(output.end(), indices.begin() + static_cast<std::ptrdiff_t>(cluster.first * 3), indices.begin() + static_cast<std::ptrdiff_t>(cluster.end * 3));
+	}
+	indices.swap(output);
+}
+
+std::size_t optimize_vertex_fetch(std::vector<float>& vertices, const std::size_t stride, std::vector<unsigned int>& indices)
+{
+	const std::size_t vertexCount = vertices.size() / stride;
+	constexpr unsigned int UNUSED = ~0u;
+	std::vector<unsigned int> remap(vertexCount, UNUSED);
+	std::vector<float> output;
+	output.reserve(vertices.size());
+
+	unsigned int next = 0;
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == UNUSED)
+		{
+			remap[index] = next++;
+			output.insert(output.end(), vertices.begin() + static_cast<std::ptrdiff_t>(index * stride), vertices.begin() + static_cast<std::ptrdiff_t>((index + 1) * stride));
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(output);
+	return next;
+}
+
+double compute_acmr(const std::vector<unsigned int>& indices, const unsigned int cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0;
+	}
+
+	// FIFO: a hit doesn't refresh the entry
+	std::vector<unsigned int> cache(cacheSize, ~0u);
+	std::size_t head = 0;
+	std::size_t misses = 0;
+	for (const unsigned int index : indices)
+	{
+		if (std::find(cache.begin(), cache.end(), index) == cache.end())
+		{
+			cache[head] = index;
+			head = (head + 1) % cacheSize;
+			++misses;
+		}
+	}
+	return static_cast<double>(misses) / static_cast<double>(indices.size() / 3);
+}
+
+GLenum smallest_index_type(const std::size_t vertexCount)
+{
+	if (vertexCount <= 0x100)
+	{
+		return GL_UNSIGNED_BYTE;
+	}
+	if (vertexCount <= 0x10000)
+	{
+		return GL_UNSIGNED_SHORT;
+	}
+	return GL_UNSIGNED_INT;
+}
+
+IndexBuffer narrow_indices(const std::vector<unsigned int>& indices, const std::size_t vertexCount)
+{
+	IndexBuffer buffer;
+	buffer.type = smallest_index_type(vertexCount);
+	buffer.count = indices.size();
+	const std::size_t size = index_type_size(buffer.type);
+	buffer.data.resize(indices.size() * size);
+	for (std::size_t i = 0; i < indices.size(); ++i)
+	{
+		// little endian like every GPU, the low bytes of the index
+		if (size == 1)
+		{
+			buffer.data[i] = static_cast<unsigned char>(indices[i]);
+		}
+		else if (size == 2)
+		{
+			const auto index = static_cast<std::uint16_t>(indices[i]);
+			std::memcpy(buffer.data.data() + 2 * i, &index, 2);
+		}
+		else
+		{
+			std::memcpy(buffer.data.data() + 4 * i, &indices[i], 4);
+		}
+	}
+	return buffer;
+}
+
+std::size_t index_type_size(const GLenum type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE: return 1;
+	case GL_UNSIGNED_SHORT: return 2;
+	default: return 4;
+	}
+}
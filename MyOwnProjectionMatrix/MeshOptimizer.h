@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// Post-transform vertex cache size assumed by the optimizer and by compute_acmr (a FIFO,
+// what most GPUs behave closest to; exact sizes vary between 16 and 32+ entries)
+constexpr unsigned int MESH_CACHE_SIZE = 16;
+
+// Triangle list optimizations, for meshes stored as interleaved float vertices
+// (stride floats per vertex, the position in the first three) and 32 bit indices.
+// optimize_mesh runs every stage:
+//		1. weld_vertices			merge bitwise identical vertices
+//		2. optimize_vertex_cache	Tipsify: reorder triangles so vertices are reused while still cached
+//		3. optimize_overdraw		order Tipsify's clusters outside-in, so front faces tend to draw first
+//		4. optimize_vertex_fetch	renumber vertices by first use, the fetch walks memory forward
+//		5. narrow_indices			8, 16 or 32 bit indices, the smallest that fits
+struct MeshOptimizationReport
+{
+	std::size_t verticesBefore;
+	std::size_t verticesAfter;
+	std::size_t triangles;
+	std::size_t clusters;		// runs Tipsify found, what overdraw ordering sorts
+	double acmrBefore;			// cache misses per triangle, 0.5 is the limit of big regular meshes
+	double acmrAfter;
+	double atvrAfter;			// cache misses per vertex, 1 is optimal
+	GLenum indexType;
+	std::size_t indexBytesBefore;	// as 32 bit indices
+	std::size_t indexBytesAfter;
+};
+
+// index data ready for glBufferData(GL_ELEMENT_ARRAY_BUFFER, ...) and glDrawElements(..., type, ...)
+struct IndexBuffer
+{
+	GLenum type;	// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	std::size_t count;
+	std::vector<unsigned char> data;
+};
+
+// every stage above, vertices and indices are rewritten in place.
+// frontFace is the glFrontFace winding, it tells the outside of the mesh from the inside
+MeshOptimizationReport optimize_mesh(std::vector<float>& vertices, std::size_t stride, std::vector<unsigned int>& indices, GLenum frontFace = GL_CCW);
+
+// drop duplicate vertices (every float equal), returns the vertex count left
+std::size_t weld_vertices(std::vector<float>& vertices, std::size_t stride, std::vector<unsigned int>& indices);
+
+// Tipsify (Sander, Nehab and Barczak 2007), linear time. Returns the first triangle of
+// every cluster: where the walk had to jump to a vertex outside the last 1-ring
+std::vector<std::size_t> optimize_vertex_cache(std::vector<unsigned int>& indices, std::size_t vertexCount, unsigned int cacheSize = MESH_CACHE_SIZE);
+
+// sort the clusters by how much they face away from the mesh center (same paper),
+// keeps the vertex cache order inside each cluster
+void optimize_overdraw(std::vector<unsigned int>& indices, const std::vector<std::size_t>& clusters, const std::vector<float>& vertices, std::size_t stride, GLenum frontFace = GL_CCW);
+
+// renumber the vertices in the order the indices first use them, unused ones are dropped.
+// Returns the vertex count left
+std::size_t optimize_vertex_fetch(std::vector<float>& vertices, std::size_t stride, std::vector<unsigned int>& indices);
+
+// average cache misses per triangle with a FIFO of cacheSize vertices
+double compute_acmr(const std::vector<unsigned int>& indices, unsigned int cacheSize = MESH_CACHE_SIZE);
+
+// the smallest index type that addresses vertexCount vertices
+GLenum smallest_index_type(std::size_t vertexCount);
+IndexBuffer narrow_indices(const std::vector<unsigned int>& indices, std::size_t vertexCount);
+std::size_t index_type_size(GLenum type);
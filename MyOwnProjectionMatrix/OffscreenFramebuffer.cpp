@@ -0,0 +1,68 @@
+#include "OffscreenFramebuffer.h"
+#include <iostream>
+
+OffscreenFramebuffer::OffscreenFramebuffer(const GLsizei width, const GLsizei height, const GLenum colorFormat, const GLenum depthFormat)
+	: fbo(0), colorRenderbuffer(0), depthRenderbuffer(0), width(width), height(height), complete(false)
+{
+	glGenRenderbuffers(1, &colorRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, colorFormat, width, height);
+
+	glGenRenderbuffers(1, &depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+	complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	if (!complete)
+	{
+		std::cout << "ERROR OFFSCREEN FRAMEBUFFER IS NOT COMPLETE\n";
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+OffscreenFramebuffer::~OffscreenFramebuffer()
+{
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &colorRenderbuffer);
+	glDeleteRenderbuffers(1, &depthRenderbuffer);
+}
+
+void OffscreenFramebuffer::bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, width, height);
+}
+
+void OffscreenFramebuffer::present(const GLsizei targetWidth, const GLsizei targetHeight) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, targetWidth == width && targetHeight == height ? GL_NEAREST : GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+bool OffscreenFramebuffer::isComplete() const
+{
+	return complete;
+}
+
+GLuint OffscreenFramebuffer::getId() const
+{
+	return fbo;
+}
+
+GLsizei OffscreenFramebuffer::getWidth() const
+{
+	return width;
+}
+
+GLsizei OffscreenFramebuffer::getHeight() const
+{
+	return height;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <glad/glad.h>
+
+// Framebuffer object with a color and a depth renderbuffer, the render target
+// of the headless mode (a headless context has no default framebuffer) and of
+// depth formats the default framebuffer doesn't offer (32F for reversed-Z)
+class OffscreenFramebuffer
+{
+public:
+	OffscreenFramebuffer(GLsizei width, GLsizei height, GLenum colorFormat = GL_RGBA8, GLenum depthFormat = GL_DEPTH_COMPONENT24);
+	~OffscreenFramebuffer();
+
+	OffscreenFramebuffer(const OffscreenFramebuffer&) = delete;
+	OffscreenFramebuffer& operator=(const OffscreenFramebuffer&) = delete;
+
+	// bind for drawing and set the viewport to the whole target
+	void bind() const;
+
+	// copy the color to the default framebuffer (stretched to its size), for windows that render through the target
+	void present(GLsizei targetWidth, GLsizei targetHeight) const;
+
+	bool isComplete() const;
+	GLuint getId() const;
+	GLsizei getWidth() const;
+	GLsizei getHeight() const;
+
+private:
+	GLuint fbo;
+	GLuint colorRenderbuffer;
+	GLuint depthRenderbuffer;
+	GLsizei width;
+	GLsizei height;
+	bool complete;
+};
@@ -0,0 +1,221 @@
+#include "Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// trace thread id of the GPU timeline, CPU threads are numbered from 1
+	constexpr int GPU_TRACK = 0;
+
+	struct TraceEvent
+	{
+		char const* name;
+		long long startUs;
+		double durationUs;
+		int track;
+	};
+
+	struct PendingQuery
+	{
+		GLuint query;
+		char const* name;
+		long long startUs;
+	};
+
+	struct ThreadName
+	{
+		int track;
+		char const* name;
+	};
+
+	std::atomic<bool> enabled(false);
+	std::atomic<int> nextTrack(1);
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	// shared by every thread
+	std::mutex eventsMutex;
+	std::vector<TraceEvent> events;
+	std::vector<ThreadName> threadNames;
+	unsigned long long cpuEventCount = 0;
+	unsigned long long gpuEventCount = 0;
+
+	// GL thread only
+	std::deque<PendingQuery> pendingQueries; // oldest first, results arrive in submission order
+	std::vector<GLuint> freeQueries;
+	bool gpuScopeActive = false;
+	unsigned long long gpuScopesSkipped = 0;
+	unsigned long long gpuResultsDiscarded = 0;
+
+	long long now_us()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	int current_track()
+	{
+		thread_local const int track = nextTrack++;
+		return track;
+	}
+
+	void add_event(char const* name, long long startUs, double durationUs, int track)
+	{
+		std::lock_guard<std::mutex> lock(eventsMutex);
+		events.push_back(TraceEvent{ name, startUs, durationUs, track });
+		if (track == GPU_TRACK)
+		{
+			++gpuEventCount;
+		}
+		else
+		{
+			++cpuEventCount;
+		}
+	}
+
+	// read one finished query and give it back to the pool
+	void resolve_query(const PendingQuery& pending)
+	{
+		GLuint64 elapsedNs = 0;
+		glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsedNs);
+		freeQueries.push_back(pending.query);
+
+		// the work can't have taken longer than the time since it was submitted,
+		// some drivers (llvmpipe) report garbage for scopes without draw calls
+		const double elapsedUs = static_cast<double>(elapsedNs) / 1000.0;
+		if (elapsedUs > static_cast<double>(now_us() - pending.startUs))
+		{
+			++gpuResultsDiscarded;
+			return;
+		}
+
+		// the GPU clock isn't synchronized with the CPU one, GPU events are
+		// placed at the time their commands were submitted
+		add_event(pending.name, pending.startUs, elapsedUs, GPU_TRACK);
+	}
+}
+
+void profiler_enable(bool enable)
+{
+	enabled = enable;
+}
+
+bool profiler_enabled()
+{
+	return enabled;
+}
+
+void profiler_set_thread_name(char const* name)
+{
+	const int track = current_track();
+	std::lock_guard<std::mutex> lock(eventsMutex);
+	threadNames.push_back(ThreadName{ track, name });
+}
+
+void profiler_collect()
+{
+	while (!pendingQueries.empty())
+	{
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(pendingQueries.front().query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE)
+		{
+			break;
+		}
+		resolve_query(pendingQueries.front());
+		pendingQueries.pop_front();
+	}
+}
+
+bool profiler_write_trace(char const* path)
+{
+	// end of the run, waiting is fine now
+	while (!pendingQueries.empty())
+	{
+		resolve_query(pendingQueries.front());
+		pendingQueries.pop_front();
+	}
+	glDeleteQueries(static_cast<GLsizei>(freeQueries.size()), freeQueries.data());
+	freeQueries.clear();
+
+	std::ofstream out(path);
+	if (!out)
+	{
+		std::cout << "ERROR COULD NOT WRITE TRACE FILE: " << path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(eventsMutex);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TRACK << ",\"args\":{\"name\":\"GPU (GL_TIME_ELAPSED)\"}}";
+	for (const ThreadName& thread : threadNames)
+	{
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.track << ",\"args\":{\"name\":\"" << thread.name << "\"}}";
+	}
+	for (const TraceEvent& event : events)
+	{
+		out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.track == GPU_TRACK ? "gpu" : "cpu")
+			<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track
+			<< ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+	}
+	out << "\n]}\n";
+	return true;
+}
+
+ProfilerStats profiler_stats()
+{
+	std::lock_guard<std::mutex> lock(eventsMutex);
+	return ProfilerStats{ cpuEventCount, gpuEventCount, pendingQueries.size(), gpuScopesSkipped, gpuResultsDiscarded };
+}
+
+CpuProfileScope::CpuProfileScope(char const* name) : name(name), startUs(enabled ? now_us() : -1)
+{
+}
+
+CpuProfileScope::~CpuProfileScope()
+{
+	if (startUs >= 0)
+	{
+		add_event(name, startUs, static_cast<double>(now_us() - startUs), current_track());
+	}
+}
+
+GpuProfileScope::GpuProfileScope(char const* name) : name(name), startUs(0), query(0)
+{
+	if (!enabled)
+	{
+		return;
+	}
+	if (gpuScopeActive)
+	{
+		++gpuScopesSkipped;
+		return;
+	}
+
+	if (freeQueries.empty())
+	{
+		glGenQueries(1, &query);
+	}
+	else
+	{
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	gpuScopeActive = true;
+	startUs = now_us();
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+GpuProfileScope::~GpuProfileScope()
+{
+	if (query == 0)
+	{
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuScopeActive = false;
+	pendingQueries.push_back(PendingQuery{ query, name, startUs });
+}
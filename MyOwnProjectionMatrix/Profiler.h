@@ -0,0 +1,71 @@
+#pragma once
+#include <glad/glad.h>
+
+// Scoped CPU timers and GPU timers (GL_TIME_ELAPSED queries) exported as a
+// Chrome trace, open the file in chrome://tracing or https://ui.perfetto.dev
+//
+//		PROFILE_SCOPE("stbi_load");			// CPU time of the enclosing scope, any thread
+//		PROFILE_GPU_SCOPE("draw");			// GPU time of the commands issued in the scope, GL thread only
+//
+// Nothing is recorded until profiler_enable(true), a disabled scope costs a branch.
+// GPU results are never waited for during the run: profiler_collect() (once per frame)
+// only reads the queries the driver reports as available and recycles them.
+// Scope names must be string literals (they are stored by pointer and written unescaped).
+
+// start or stop recording, the profiler starts disabled
+void profiler_enable(bool enabled);
+bool profiler_enabled();
+
+// name the calling thread in the trace
+void profiler_set_thread_name(char const* name);
+
+// GL thread, once per frame: gather the finished GPU queries without stalling
+void profiler_collect();
+
+// wait for the GPU queries still in flight, then write every event to a JSON trace file
+bool profiler_write_trace(char const* path);
+
+struct ProfilerStats
+{
+	unsigned long long cpuEvents;
+	unsigned long long gpuEvents;
+	unsigned long long gpuQueriesInFlight;
+	unsigned long long gpuScopesSkipped; // GL_TIME_ELAPSED queries can't nest, inner GPU scopes are dropped
+	unsigned long long gpuResultsDiscarded; // impossible durations reported by the driver
+};
+
+ProfilerStats profiler_stats();
+
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(char const* name);
+	~CpuProfileScope();
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	char const* name;
+	long long startUs; // -1 when the profiler was disabled at construction
+};
+
+class GpuProfileScope
+{
+public:
+	explicit GpuProfileScope(char const* name);
+	~GpuProfileScope();
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	char const* name;
+	long long startUs;
+	GLuint query; // 0 when nothing is measured
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
@@ -0,0 +1,197 @@
+#include "ProgramBinaryCache.h"
+#include "GLExtensions.h"
+#include "Profiler.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	constexpr std::uint32_t CACHE_MAGIC = 0x42504F4D; // "MOPB"
+	constexpr std::uint32_t CACHE_VERSION = 1;
+
+	struct CacheEntryHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t key;
+		std::uint32_t binaryFormat;
+		std::uint32_t binaryLength;
+	};
+
+	// 64 bit FNV-1a, strings are hashed with their terminator so "ab"+"c" != "a"+"bc"
+	std::uint64_t hash_string(std::uint64_t hash, char const* text)
+	{
+		if (text == nullptr)
+		{
+			text = "";
+		}
+		do
+		{
+			hash = (hash ^ static_cast<unsigned char>(*text)) * 1099511628211ull;
+		} while (*text++ != '\0');
+		return hash;
+	}
+
+	// mapped sources aren't NUL terminated (see MappedFile), the length is hashed as a separator
+	std::uint64_t hash_bytes(std::uint64_t hash, char const* bytes, std::size_t length)
+	{
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 1099511628211ull;
+		}
+		for (std::size_t i = 0; i < sizeof(length); ++i)
+		{
+			hash = (hash ^ ((length >> (8 * i)) & 0xFF)) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	char const* gl_string(GLenum name)
+	{
+		return reinterpret_cast<char const*>(glGetString(name));
+	}
+}
+
+ProgramBinaryCache::ProgramBinaryCache(std::string directory) : directory(std::move(directory)), stats()
+{
+}
+
+bool ProgramBinaryCache::isAvailable() const
+{
+	return gl_extensions().programBinary;
+}
+
+std::uint64_t ProgramBinaryCache::makeKey(char const* vertexSource, std::size_t vertexLength, char const* fragmentSource, std::size_t fragmentLength) const
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	hash = hash_string(hash, gl_string(GL_VENDOR));
+	hash = hash_string(hash, gl_string(GL_RENDERER));
+	hash = hash_string(hash, gl_string(GL_VERSION));
+	hash = hash_bytes(hash, vertexSource, vertexLength);
+	hash = hash_bytes(hash, fragmentSource, fragmentLength);
+	return hash;
+}
+
+GLuint ProgramBinaryCache::load(std::uint64_t key)
+{
+	if (!isAvailable())
+	{
+		return 0;
+	}
+	PROFILE_SCOPE("ProgramBinaryCache::load");
+
+	std::ifstream file(entryPath(key), std::ios::binary);
+	if (!file)
+	{
+		++stats.misses;
+		return 0;
+	}
+
+	// the binary fills the rest of the entry, a length claiming more is never allocated
+	std::error_code error;
+	const std::uintmax_t fileSize = std::filesystem::file_size(entryPath(key), error);
+
+	CacheEntryHeader header = {};
+	std::vector<char> binary;
+	if (file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		&& header.magic == CACHE_MAGIC && header.version == CACHE_VERSION && header.key == key
+		&& !error && header.binaryLength == fileSize - sizeof(header))
+	{
+		binary.resize(header.binaryLength);
+		file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+	}
+	if (binary.empty() || !file)
+	{
+		std::cout << "Program binary cache entry is malformed: " << entryPath(key) << std::endl;
+		++stats.rejected;
+		return 0;
+	}
+
+	const GLuint program = glCreateProgram();
+	glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		// stale binary, the caller compiles from source and stores a fresh one over it
+		glDeleteProgram(program);
+		++stats.rejected;
+		return 0;
+	}
+
+	++stats.hits;
+	return program;
+}
+
+void ProgramBinaryCache::store(std::uint64_t key, GLuint program)
+{
+	if (!isAvailable())
+	{
+		return;
+	}
+
+	GLint linked = GL_FALSE;
+	GLint length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (linked != GL_TRUE || length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(static_cast<std::size_t>(length));
+	GLenum binaryFormat = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+	if (written <= 0)
+	{
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	// written next to the entry then renamed, so a reader never sees a partial file
+	const std::string path = entryPath(key);
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		const CacheEntryHeader header = { CACHE_MAGIC, CACHE_VERSION, key, binaryFormat, static_cast<std::uint32_t>(written) };
+		file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		file.write(binary.data(), written);
+		if (!file)
+		{
+			std::cout << "ERROR WRITING PROGRAM BINARY CACHE ENTRY: " << temporaryPath << std::endl;
+			return;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+		return;
+	}
+	++stats.stored;
+}
+
+ProgramBinaryCacheStats ProgramBinaryCache::getStats() const
+{
+	return stats;
+}
+
+std::string ProgramBinaryCache::entryPath(std::uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(directory) / name).string();
+}
+
+ProgramBinaryCache& program_binary_cache()
+{
+	static ProgramBinaryCache cache("ShaderCache");
+	return cache;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked shader programs (glGetProgramBinary / glProgramBinary).
+// A program is keyed by a hash of its GLSL sources (defines included, they are part
+// of the source text) and of the driver's vendor, renderer and version strings, so
+// a driver update or a different GPU never reuses a stale binary.
+// Every entry is one file: <directory>/<key in hex>.bin
+// The driver may still reject a binary (e.g. after an update keeping the same
+// version string), load() then returns 0 and the caller compiles from source.
+struct ProgramBinaryCacheStats
+{
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long rejected; // found on disk but refused by the driver or malformed
+	unsigned long long stored;
+};
+
+class ProgramBinaryCache
+{
+public:
+	explicit ProgramBinaryCache(std::string directory);
+
+	// false when the context can't retrieve program binaries, load/store then do nothing
+	bool isAvailable() const;
+
+	// key of a program built from these sources on the current context
+	std::uint64_t makeKey(char const* vertexSource, std::size_t vertexLength, char const* fragmentSource, std::size_t fragmentLength) const;
+
+	// a linked program from the cache, 0 when missing or rejected
+	GLuint load(std::uint64_t key);
+
+	// save a successfully linked program (compiled with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+	void store(std::uint64_t key, GLuint program);
+
+	ProgramBinaryCacheStats getStats() const;
+
+private:
+	std::string entryPath(std::uint64_t key) const;
+
+	std::string directory;
+	ProgramBinaryCacheStats stats;
+};
+
+// the cache used by Shader, stored in ./ShaderCache
+ProgramBinaryCache& program_binary_cache();
@@ -0,0 +1,159 @@
+#pragma once
+
+// Projection matrices written from scratch.
+// Every function here returns its matrix by value (no heap memory involved) and
+// can be evaluated at compile time, e.g:
+//		constexpr ProjectionMatrix proj = my_perspective(0.785398f, 1.0f, 0.1f, 50.0f);
+// Formula and theory from here: https://www.scratchapixel.com/lessons/3d-basic-rendering/perspective-and-orthographic-projection-matrix/opengl-perspective-projection-matrix
+
+// OpenGL is column major... so m[] is laid out like { col0, col1, col2, col3 }
+// and can be passed directly to glUniformMatrix4fv(loc, 1, GL_FALSE, proj.data())
+struct ProjectionMatrix
+{
+	float m[16];
+
+	constexpr const float* data() const { return m; }
+	constexpr float operator[](int i) const { return m[i]; }
+	constexpr float& operator[](int i) { return m[i]; }
+};
+
+namespace projection_detail
+{
+	// std::tan is not constexpr, so evaluate the sine and cosine series in double
+	// precision (far more than what a float needs) and round the quotient once.
+	// Valid for the half field of view angles a projection uses: [0, pi/2)
+	constexpr double sin_series(const double x)
+	{
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 16; ++n)
+		{
+			term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr double cos_series(const double x)
+	{
+		double term = 1.0;
+		double sum = 1.0;
+		for (int n = 1; n < 16; ++n)
+		{
+			term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr float tan(const float x)
+	{
+		return static_cast<float>(sin_series(x) / cos_series(x));
+	}
+
+	constexpr ProjectionMatrix zero()
+	{
+		return ProjectionMatrix{ {
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 0.0f } };
+	}
+}
+
+// Off-center perspective frustum, maps [-near, -far] in view space to [-1, 1] in NDC
+constexpr ProjectionMatrix my_frustum(const float left, const float right, const float bottom, const float top, const float zNear, const float zFar)
+{
+	ProjectionMatrix p = projection_detail::zero();
+
+	// First column
+	p[0] = (2.0f * zNear) / (right - left);
+
+	// Second column
+	p[5] = (2.0f * zNear) / (top - bottom);
+
+	// Third column
+	p[8] = (right + left) / (right - left);
+	p[9] = (top + bottom) / (top - bottom);
+	p[10] = -(zFar + zNear) / (zFar - zNear);
+	p[11] = -1.0f;
+
+	// Fourth column
+	p[14] = -(2.0f * zFar * zNear) / (zFar - zNear);
+
+	return p;
+}
+
+// Symmetric perspective frustum
+constexpr ProjectionMatrix my_perspective(const float fovY, const float aspect, const float zNear, const float zFar)
+{
+	// top = tan(fovY / 2) * near and right = top * aspect, so the frustum terms
+	// 2n / (r - l) and 2n / (t - b) reduce to 1 / (aspect * tan) and 1 / tan
+	// (same rounding as glm::perspective) and the off-center terms vanish
+	const float tanHalfFovY = projection_detail::tan(fovY / 2.0f);
+
+	ProjectionMatrix p = projection_detail::zero();
+	p[0] = 1.0f / (aspect * tanHalfFovY);
+	p[5] = 1.0f / tanHalfFovY;
+	p[10] = -(zFar + zNear) / (zFar - zNear);
+	p[11] = -1.0f;
+	p[14] = -(2.0f * zFar * zNear) / (zFar - zNear);
+	return p;
+}
+
+// Symmetric perspective frustum with the far plane at infinity (limit of my_perspective when far -> inf)
+constexpr ProjectionMatrix my_perspective_infinite(const float fovY, const float aspect, const float zNear)
+{
+	const float tanHalfFovY = projection_detail::tan(fovY / 2.0f);
+
+	ProjectionMatrix p = projection_detail::zero();
+	p[0] = 1.0f / (aspect * tanHalfFovY);
+	p[5] = 1.0f / tanHalfFovY;
+	p[10] = -1.0f;
+	p[11] = -1.0f;
+	p[14] = -2.0f * zNear;
+	return p;
+}
+
+// Reversed-Z perspective frustum, maps near to depth 1 and far to depth 0.
+// Expects a [0, 1] clip depth range: glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE)
+constexpr ProjectionMatrix my_perspective_reversed_z(const float fovY, const float aspect, const float zNear, const float zFar)
+{
+	const float tanHalfFovY = projection_detail::tan(fovY / 2.0f);
+
+	ProjectionMatrix p = projection_detail::zero();
+	p[0] = 1.0f / (aspect * tanHalfFovY);
+	p[5] = 1.0f / tanHalfFovY;
+	p[10] = zNear / (zFar - zNear);
+	p[11] = -1.0f;
+	p[14] = (zFar * zNear) / (zFar - zNear);
+	return p;
+}
+
+// Reversed-Z perspective frustum with the far plane at infinity, maps near to depth 1 and infinity to depth 0.
+// Expects a [0, 1] clip depth range: glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE)
+constexpr ProjectionMatrix my_perspective_infinite_reversed_z(const float fovY, const float aspect, const float zNear)
+{
+	const float tanHalfFovY = projection_detail::tan(fovY / 2.0f);
+
+	ProjectionMatrix p = projection_detail::zero();
+	p[0] = 1.0f / (aspect * tanHalfFovY);
+	p[5] = 1.0f / tanHalfFovY;
+	p[11] = -1.0f;
+	p[14] = zNear;
+	return p;
+}
+
+// Orthographic box, maps [left, right] x [bottom, top] x [-near, -far] to the [-1, 1] NDC cube
+constexpr ProjectionMatrix my_orthographic(const float left, const float right, const float bottom, const float top, const float zNear, const float zFar)
+{
+	ProjectionMatrix p = projection_detail::zero();
+	p[0] = 2.0f / (right - left);
+	p[5] = 2.0f / (top - bottom);
+	p[10] = -2.0f / (zFar - zNear);
+	p[12] = -(right + left) / (right - left);
+	p[13] = -(top + bottom) / (top - bottom);
+	p[14] = -(zFar + zNear) / (zFar - zNear);
+	p[15] = 1.0f;
+	return p;
+}
@@ -0,0 +1,133 @@
+#include "ProjectionCheck.h"
+#include "Projection.h"
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// what doesn't need glm is checked while compiling
+static_assert(my_perspective(1.57079633f, 1.0f, 0.1f, 50.0f)[5] == 1.0f, "constexpr tan(pi / 4) should round to 1");
+static_assert(my_perspective_reversed_z(0.785398163f, 1.0f, 1.0f, 3.0f)[10] == 0.5f && my_perspective_reversed_z(0.785398163f, 1.0f, 1.0f, 3.0f)[14] == 1.5f, "reversed-Z should map near to depth 1 and far to 0");
+static_assert(my_perspective_infinite_reversed_z(0.785398163f, 1.0f, 0.1f)[10] == 0.0f && my_perspective_infinite_reversed_z(0.785398163f, 1.0f, 0.1f)[14] == 0.1f, "infinite reversed-Z should have no far term");
+
+namespace
+{
+	constexpr float infiniteFar = 1e30f;
+
+	ProjectionMatrix my_projection(const ProjectionVariant variant, const float fovY, const float aspect, const float zNear, const float zFar)
+	{
+		switch (variant)
+		{
+		case ProjectionVariant::Infinite:
+			return my_perspective_infinite(fovY, aspect, zNear);
+		case ProjectionVariant::ReversedZ:
+			return my_perspective_reversed_z(fovY, aspect, zNear, zFar);
+		case ProjectionVariant::ReversedZInfinite:
+			return my_perspective_infinite_reversed_z(fovY, aspect, zNear);
+		default:
+			return my_perspective(fovY, aspect, zNear, zFar);
+		}
+	}
+
+	glm::mat4 glm_projection(const ProjectionVariant variant, const float fovY, const float aspect, const float zNear, const float zFar)
+	{
+		// glm has no reversed-Z, a [0, 1] depth range with the planes swapped is the same matrix
+		switch (variant)
+		{
+		case ProjectionVariant::Infinite:
+			return glm::infinitePerspective(fovY, aspect, zNear);
+		case ProjectionVariant::ReversedZ:
+			return glm::perspectiveRH_ZO(fovY, aspect, zFar, zNear);
+		case ProjectionVariant::ReversedZInfinite:
+			return glm::perspectiveRH_ZO(fovY, aspect, infiniteFar, zNear);
+		default:
+			return glm::perspective(fovY, aspect, zNear, zFar);
+		}
+	}
+}
+
+const char* projection_variant_name(const ProjectionVariant variant)
+{
+	switch (variant)
+	{
+	case ProjectionVariant::Infinite:
+		return "infinite";
+	case ProjectionVariant::ReversedZ:
+		return "reversed-Z";
+	case ProjectionVariant::ReversedZInfinite:
+		return "reversed-Z infinite";
+	default:
+		return "standard";
+	}
+}
+
+float check_projection(const ProjectionVariant variant)
+{
+	float maxError = 0.0f;
+	for (int degrees = 10; degrees <= 120; degrees += 10)
+	{
+		const float fovY = glm::radians(static_cast<float>(degrees));
+		for (const float aspect : { 0.5f, 1.0f, 16.0f / 9.0f, 2.35f })
+		{
+			for (const float zNear : { 0.01f, 0.1f, 1.0f })
+			{
+				for (const float zFar : { 10.0f, 50.0f, 1000.0f })
+				{
+					const ProjectionMatrix mine = my_projection(variant, fovY, aspect, zNear, zFar);
+					const glm::mat4 reference = glm_projection(variant, fovY, aspect, zNear, zFar);
+					for (int i = 0; i < 16; ++i)
+					{
+						const float expected = reference[i / 4][i % 4];
+						maxError = std::max(maxError, std::abs(mine[i] - expected) / std::max(std::abs(expected), 1.0f));
+					}
+				}
+			}
+		}
+	}
+	return maxError;
+}
+
+ProjectionTiming measure_projection(const ProjectionVariant variant, const std::size_t count)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// the inputs go through volatile loads, so the compiler can't fold a call into a constant
+	volatile float firstDegrees = 30.0f;
+	volatile float aspectInput = 16.0f / 9.0f;
+	const float aspect = aspectInput;
+	float fovY[64];
+	for (int i = 0; i < 64; ++i)
+	{
+		fovY[i] = glm::radians(firstDegrees + static_cast<float>(i));
+	}
+	volatile float sink = 0.0f;
+
+	const unsigned long long mine_allocations = heap_allocations();
+	const auto mine_start = Clock::now();
+	float sum = 0.0f;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const ProjectionMatrix p = my_projection(variant, fovY[i & 63], aspect, 0.1f, 50.0f);
+		sum += p[0] + p[10] + p[14];
+	}
+	sink = sink + sum;
+	const double mine_ns = std::chrono::duration<double, std::nano>(Clock::now() - mine_start).count();
+	const unsigned long long mine_allocated = heap_allocations() - mine_allocations;
+
+	const unsigned long long glm_allocations = heap_allocations();
+	const auto glm_start = Clock::now();
+	sum = 0.0f;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const glm::mat4 p = glm_projection(variant, fovY[i & 63], aspect, 0.1f, 50.0f);
+		sum += p[0][0] + p[2][2] + p[3][2];
+	}
+	sink = sink + sum;
+	const double glm_ns = std::chrono::duration<double, std::nano>(Clock::now() - glm_start).count();
+	const unsigned long long glm_allocated = heap_allocations() - glm_allocations;
+
+	const double matrices = static_cast<double>(std::max<std::size_t>(count, 1));
+	return ProjectionTiming{ mine_ns / matrices, glm_ns / matrices, mine_allocated, glm_allocated, sink };
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+// Checks and times the projections of Projection.h against glm.
+// glm isn't constexpr, so the comparison runs at startup; what can be checked while
+// compiling is static_assert-ed in ProjectionCheck.cpp.
+enum class ProjectionVariant
+{
+	Standard,			// my_perspective against glm::perspective
+	Infinite,			// my_perspective_infinite against glm::infinitePerspective
+	ReversedZ,			// my_perspective_reversed_z against glm::perspectiveRH_ZO with near and far swapped
+	ReversedZInfinite	// my_perspective_infinite_reversed_z against the same with the far plane at 1e30
+};
+
+constexpr ProjectionVariant projection_variants[] = { ProjectionVariant::Standard, ProjectionVariant::Infinite, ProjectionVariant::ReversedZ, ProjectionVariant::ReversedZInfinite };
+
+const char* projection_variant_name(ProjectionVariant variant);
+
+// largest difference of an entry to glm over a sweep of fields of view, aspects and planes,
+// relative to the entry (absolute below 1)
+float check_projection(ProjectionVariant variant);
+
+// ns per matrix building count matrices of a variant from inputs only known at run time, and
+// the heap allocations made while timing them (none expected on either side)
+struct ProjectionTiming
+{
+	double mine;
+	double glm;
+	unsigned long long mineAllocations;
+	unsigned long long glmAllocations;
+	float checksum; // sum of entries of every matrix built, what keeps the loops from being optimized away
+};
+
+ProjectionTiming measure_projection(ProjectionVariant variant, std::size_t count);
@@ -1,18 +1,34 @@
 
 #include "Shader.h"
-#include <fstream>
+#include "CameraUniformBuffer.h"
+#include "Profiler.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderSourceCache.h"
+#include "GLExtensions.h"
 #include <sstream>
+#include <utility>
 
 // for transformations
-#include <glm\gtc\type_ptr.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
-Shader::Shader(GLchar const *vertexPath, GLchar const *fragmentPath) : vertexSrcFilePath(vertexPath), fragmentSrcFilePath(fragmentPath)
+namespace
+{
+	UniformCacheStats uniformCacheStats = { 0, 0 };
+
+	// 0 marks empty slots, so a name hashing to 0 is stored as 1
+	std::uint64_t slot_hash(const std::uint64_t hash)
+	{
+		return hash != 0 ? hash : 1;
+	}
+}
+
+Shader::Shader(GLchar const *vertexPath, GLchar const *fragmentPath)
 {
 	// 1. retrieve the vertex/fragment source code from filePath
 	std::cout << "Shader instanced will find source files at:\n\t";
 	std::cout << vertexPath << " and " << fragmentPath << "\n";
 
-	id = initShader(vertexPath, fragmentPath);
+	program = shader_registry().acquire(vertexPath, fragmentPath);
 }
 
 Shader::Shader(GLchar const *shaderName)
@@ -25,44 +41,28 @@ Shader::Shader(GLchar const *shaderName)
 	const std::string fragmentPath = ssFragmentPath.str();
 
 	std::cout << "Shader instanced will find source files at:\n\t";
-	char const *vertexPath_cstr = vertexPath.c_str();
-	char const *fragmentPath_cstr = fragmentPath.c_str();	
-	std::cout << vertexPath_cstr << " and " << fragmentPath_cstr << "\n";
+	std::cout << vertexPath << " and " << fragmentPath << "\n";
 
-	id = initShader(vertexPath_cstr, fragmentPath_cstr);
-	vertexSrcFilePath = vertexPath_cstr;
-	fragmentSrcFilePath = fragmentPath_cstr;
+	program = shader_registry().acquire(vertexPath, fragmentPath);
 }
 
-Shader::Shader(const Shader& other)
+Shader::Shader(std::shared_ptr<ShaderProgram> program) : program(std::move(program))
 {
-	id = initShader(other.vertexSrcFilePath, other.fragmentSrcFilePath);
-	vertexSrcFilePath = other.vertexSrcFilePath;
-	fragmentSrcFilePath = other.fragmentSrcFilePath;
 }
 
-Shader& Shader::operator=(const Shader& other)
+Shader::Shader(const Shader& other) : program(other.program)
 {
-	if (&other == this)
-	{
-		return *this;
-	}
+}
 
-	id = initShader(other.vertexSrcFilePath, other.fragmentSrcFilePath);
-	vertexSrcFilePath = other.vertexSrcFilePath;
-	fragmentSrcFilePath = other.fragmentSrcFilePath;
+Shader& Shader::operator=(const Shader& other)
+{
+	// the previous program is deleted here if this was its last Shader
+	program = other.program;
 	return *this;
 }
 
-Shader::Shader(Shader&& other) noexcept
+Shader::Shader(Shader&& other) noexcept : program(std::move(other.program))
 {
-	id = other.id;
-	vertexSrcFilePath = other.vertexSrcFilePath;
-	fragmentSrcFilePath = other.fragmentSrcFilePath;
-
-	other.id = 0;
-	other.vertexSrcFilePath = nullptr;
-	other.fragmentSrcFilePath = nullptr;
 }
 
 Shader& Shader::operator=(Shader&& other) noexcept
@@ -72,47 +72,46 @@ Shader& Shader::operator=(Shader&& other) noexcept
 		return *this;
 	}
 
-	id = other.id;
-	vertexSrcFilePath = other.vertexSrcFilePath;
-	fragmentSrcFilePath = other.fragmentSrcFilePath;
-
-	other.id = 0;
-	other.vertexSrcFilePath = nullptr;
-	other.fragmentSrcFilePath = nullptr;
-
+	program = std::move(other.program);
 	return *this;
 }
 
 unsigned Shader::initShader(char const* vertexPath_cstr, char const* fragmentPath_cstr)
 {
-	// convert from string to c-like string
-	char const* vertexCode_cstr = readShaderFile(vertexPath_cstr);
-	char const* fragmentCode_cstr = readShaderFile(fragmentPath_cstr);
-
-	// =====================================================
-	// 2. compile shader
-	const unsigned int shaderId = compileShader(vertexCode_cstr, fragmentCode_cstr);
+	// read the files (or reuse the sources of a previous Shader)
+	const std::shared_ptr<const ShaderFile> vertexFile = readShaderFile(vertexPath_cstr);
+	const std::shared_ptr<const ShaderFile> fragmentFile = readShaderFile(fragmentPath_cstr);
+	const ShaderSource vertexCode = shader_source(vertexFile.get());
+	const ShaderSource fragmentCode = shader_source(fragmentFile.get());
 
 	// =====================================================
-	// 3. Clear memory
-	delete vertexCode_cstr;
-	delete fragmentCode_cstr;
+	// 2. reuse the program linked by a previous run, else compile shader
+	ProgramBinaryCache& binaryCache = program_binary_cache();
+	const std::uint64_t cacheKey = binaryCache.makeKey(vertexCode.text, vertexCode.length, fragmentCode.text, fragmentCode.length);
+	unsigned int shaderId = binaryCache.load(cacheKey);
+	if (shaderId == 0)
+	{
+		shaderId = compileShader(vertexCode, fragmentCode);
+		binaryCache.store(cacheKey, shaderId);
+	}
 
 	return shaderId;
 }
 
 
-unsigned int Shader::compileShader(char const *vertex_src, char const *fragment_src)
+unsigned int Shader::compileShader(ShaderSource vertex_src, ShaderSource fragment_src)
 {
+	PROFILE_SCOPE("Shader::compileShader");
+
 	// compile vertex shader
 	const unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertex_src, NULL);
+	glShaderSource(vertexShader, 1, &vertex_src.text, &vertex_src.length);
 	glCompileShader(vertexShader);
 	checkCompileError(vertexShader, GL_VERTEX_SHADER, GL_COMPILE_STATUS);
 
 	// compile fragment shader
 	const unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragment_src, NULL);
+	glShaderSource(fragmentShader, 1, &fragment_src.text, &fragment_src.length);
 	glCompileShader(fragmentShader);
 	checkCompileError(fragmentShader, GL_FRAGMENT_SHADER, GL_COMPILE_STATUS);
 
@@ -120,6 +119,11 @@ unsigned int Shader::compileShader(char const *vertex_src, char const *fragment_
 	const unsigned int shaderId = glCreateProgram();
 	glAttachShader(shaderId, vertexShader);
 	glAttachShader(shaderId, fragmentShader);
+	if (gl_extensions().programBinary)
+	{
+		// some drivers only keep a retrievable binary when asked before linking
+		glProgramParameteri(shaderId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(shaderId);
 	checkCompileError(shaderId, NULL, GL_LINK_STATUS);
 
@@ -158,104 +162,340 @@ void Shader::checkCompileError(unsigned int shader, unsigned int stage, unsigned
 
 	if (status == GL_LINK_STATUS)
 	{
-		glGetShaderiv(shader, GL_LINK_STATUS, &success);
+		glGetProgramiv(shader, GL_LINK_STATUS, &success);
 		if (!success)
 		{
-			glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+			glGetProgramInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
 			std::cout << "ERROR WHILE LINKING SHADER PROGRAM\n";
 			std::cout << infoLog << std::endl;
 		}
 	}
 }
 
-char* Shader::readShaderFile(char const* shader_file_src)
+std::shared_ptr<const ShaderFile> Shader::readShaderFile(char const* shader_file_src)
+{
+	return shader_source_cache().get(shader_file_src);
+}
+
+void Shader::cacheUniformLocations(ShaderProgram& program)
+{
+	const unsigned int id = program.id;
+	std::vector<ShaderProgram::UniformSlot>& uniformSlots = program.uniformSlots;
+
+	GLint activeUniforms = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &activeUniforms);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	// arrays are stored under "name[0]" as reported, plain "name" and "name[i]" for every other element
+	std::vector<std::pair<std::string, GLint>> names;
+	std::vector<GLchar> nameBuffer(static_cast<std::size_t>(maxNameLength) + 1);
+	for (GLint index = 0; index < activeUniforms; ++index)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(id, static_cast<GLuint>(index), static_cast<GLsizei>(nameBuffer.size()), &length, &size, &type, nameBuffer.data());
+
+		const std::string name(nameBuffer.data(), static_cast<std::size_t>(length));
+		const GLint location = glGetUniformLocation(id, name.c_str());
+		++uniformCacheStats.driverLookups;
+
+		// members of uniform blocks have no location
+		if (location < 0)
+		{
+			continue;
+		}
+		names.emplace_back(name, location);
+
+		const std::size_t arraySuffix = name.rfind("[0]");
+		if (arraySuffix != std::string::npos && arraySuffix + 3 == name.size())
+		{
+			const std::string baseName = name.substr(0, arraySuffix);
+			names.emplace_back(baseName, location);
+			for (GLint element = 1; element < size; ++element)
+			{
+				const std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				const GLint elementLocation = glGetUniformLocation(id, elementName.c_str());
+				++uniformCacheStats.driverLookups;
+				if (elementLocation >= 0)
+				{
+					names.emplace_back(elementName, elementLocation);
+				}
+			}
+		}
+	}
+
+	// at most half full, so probe sequences stay short
+	std::size_t capacity = 8;
+	while (capacity < 2 * names.size())
+	{
+		capacity *= 2;
+	}
+	uniformSlots.assign(capacity, ShaderProgram::UniformSlot{ 0, -1 });
+
+	const std::size_t mask = uniformSlots.size() - 1;
+	for (const std::pair<std::string, GLint>& entry : names)
+	{
+		std::string const& name = entry.first;
+		const std::uint64_t hash = slot_hash(uniform_hash(name.c_str(), name.size()));
+		for (std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask)
+		{
+			if (uniformSlots[i].hash == 0)
+			{
+				uniformSlots[i] = ShaderProgram::UniformSlot{ hash, entry.second };
+				break;
+			}
+			if (uniformSlots[i].hash == hash)
+			{
+				// neither name may land on the other's location: the slot keeps the hash but
+				// no location, so string setters ask the driver and UniformName setters find nothing
+				uniformSlots[i].location = -1;
+				std::cout << "UNIFORM NAME HASH COLLISION: " << name << "\n";
+				break;
+			}
+		}
+	}
+}
+
+void Shader::bindUniformBlocks(unsigned int id)
+{
+	struct SharedBlock
+	{
+		char const* name;
+		GLuint binding;
+	};
+	static constexpr SharedBlock sharedBlocks[] = {
+		{ "Camera", CAMERA_BLOCK_BINDING },
+		{ "Materials", MATERIAL_BLOCK_BINDING }
+	};
+
+	for (const SharedBlock& block : sharedBlocks)
+	{
+		const GLuint blockIndex = glGetUniformBlockIndex(id, block.name);
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(id, blockIndex, block.binding);
+		}
+	}
+}
+
+void Shader::copyUniformValues(unsigned int source, unsigned int destination)
+{
+	GLint previous = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+	glUseProgram(destination);
+
+	GLint activeUniforms = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(destination, GL_ACTIVE_UNIFORMS, &activeUniforms);
+	glGetProgramiv(destination, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<GLchar> nameBuffer(static_cast<std::size_t>(maxNameLength) + 1);
+	for (GLint index = 0; index < activeUniforms; ++index)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(destination, static_cast<GLuint>(index), static_cast<GLsizei>(nameBuffer.size()), &length, &size, &type, nameBuffer.data());
+
+		// the source must have a uniform of the same name and type
+		char const* name = nameBuffer.data();
+		GLuint sourceIndex = GL_INVALID_INDEX;
+		glGetUniformIndices(source, 1, &name, &sourceIndex);
+		if (sourceIndex == GL_INVALID_INDEX)
+		{
+			continue;
+		}
+		GLint sourceType = 0;
+		glGetActiveUniformsiv(source, 1, &sourceIndex, GL_UNIFORM_TYPE, &sourceType);
+		if (static_cast<GLenum>(sourceType) != type)
+		{
+			continue;
+		}
+
+		// arrays are reported as "name[0]", every element has its own location
+		std::string baseName(name, static_cast<std::size_t>(length));
+		const std::size_t arraySuffix = baseName.rfind("[0]");
+		const bool isArray = arraySuffix != std::string::npos && arraySuffix + 3 == baseName.size();
+		if (isArray)
+		{
+			baseName.erase(arraySuffix);
+		}
+
+		for (GLint element = 0; element < size; ++element)
+		{
+			const std::string elementName = isArray ? baseName + "[" + std::to_string(element) + "]" : baseName;
+			const GLint from = glGetUniformLocation(source, elementName.c_str());
+			const GLint to = glGetUniformLocation(destination, elementName.c_str());
+			if (from < 0 || to < 0)
+			{
+				continue;
+			}
+
+			GLfloat f[16];
+			GLint i[4];
+			GLuint u[4];
+			switch (type)
+			{
+			case GL_FLOAT: glGetUniformfv(source, from, f); glUniform1fv(to, 1, f); break;
+			case GL_FLOAT_VEC2: glGetUniformfv(source, from, f); glUniform2fv(to, 1, f); break;
+			case GL_FLOAT_VEC3: glGetUniformfv(source, from, f); glUniform3fv(to, 1, f); break;
+			case GL_FLOAT_VEC4: glGetUniformfv(source, from, f); glUniform4fv(to, 1, f); break;
+			case GL_FLOAT_MAT2: glGetUniformfv(source, from, f); glUniformMatrix2fv(to, 1, GL_FALSE, f); break;
+			case GL_FLOAT_MAT3: glGetUniformfv(source, from, f); glUniformMatrix3fv(to, 1, GL_FALSE, f); break;
+			case GL_FLOAT_MAT4: glGetUniformfv(source, from, f); glUniformMatrix4fv(to, 1, GL_FALSE, f); break;
+			case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(source, from, i); glUniform2iv(to, 1, i); break;
+			case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(source, from, i); glUniform3iv(to, 1, i); break;
+			case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(source, from, i); glUniform4iv(to, 1, i); break;
+			case GL_UNSIGNED_INT: glGetUniformuiv(source, from, u); glUniform1uiv(to, 1, u); break;
+			case GL_INT: case GL_BOOL:
+			case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+			case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_MULTISAMPLE:
+			case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+				// samplers hold their texture unit
+				glGetUniformiv(source, from, i); glUniform1iv(to, 1, i); break;
+			default:
+				break;
+			}
+		}
+	}
+
+	glUseProgram(static_cast<GLuint>(previous));
+}
+
+GLint Shader::getUniformLocation(UniformName name) const
 {
-	std::ifstream file;
-	std::string shaderFileData;
-	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try
+	++uniformCacheStats.lookupsAvoided;
+	if (program == nullptr || program->uniformSlots.empty())
 	{
-		std::stringstream ssFile;
-		file.open(shader_file_src);
-		ssFile << file.rdbuf();
-		file.close();
-		shaderFileData = ssFile.str();
+		return -1;
 	}
-	catch (const std::ifstream::failure& e)
+
+	std::vector<ShaderProgram::UniformSlot> const& uniformSlots = program->uniformSlots;
+	const std::size_t mask = uniformSlots.size() - 1;
+	const std::uint64_t hash = slot_hash(name.hash);
+	for (std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask)
 	{
-		std::cout << "ERROR TRYING TO READ SHADER FILES\n";
+		if (uniformSlots[i].hash == hash)
+		{
+			return uniformSlots[i].location;
+		}
+		if (uniformSlots[i].hash == 0)
+		{
+			return -1;
+		}
 	}
+}
 
-	// Convert to c-string and store on heap
-	char* source = new char[shaderFileData.size() + 1];
-	for (auto current = shaderFileData.cbegin(); current < shaderFileData.cend(); ++current)
+GLint Shader::getUniformLocation(std::string const& name) const
+{
+	const GLint location = getUniformLocation(UniformName{ uniform_hash(name.c_str(), name.size()) });
+	if (location >= 0 || program == nullptr)
 	{
-		source[current - shaderFileData.cbegin()] = *current;
+		return location;
 	}
-	source[shaderFileData.size()] = NULL;
-	return source;
+
+	// not an active uniform nor an array element the cache holds: the driver knows
+	--uniformCacheStats.lookupsAvoided;
+	++uniformCacheStats.driverLookups;
+	return glGetUniformLocation(program->id, name.c_str());
+}
+
+UniformCacheStats Shader::getUniformCacheStats()
+{
+	return uniformCacheStats;
 }
 
 void Shader::use() const
 {
-	glUseProgram(id);
+	glUseProgram(getId());
 }
 
 void Shader::setMatrix(std::string const& name, glm::mat4x4& value) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(value));
 }
 
 void Shader::setBool(std::string const &name, bool value) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniform1i(uniformLoc, value);
 }
 
 void Shader::setInt(std::string const &name, int value) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniform1i(uniformLoc, value);
 }
 
 void Shader::setFloat(std::string const &name, float value) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniform1f(uniformLoc, value);
 }
 
 void Shader::setFloatArray(std::string const& name, GLsizei arraySize, const float* firstItem) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniform3fv(uniformLoc, arraySize, firstItem);
 }
 
 void Shader::setVec3(std::string const& name, glm::vec3& value) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniform3fv(uniformLoc, 1, &(value.x));
 }
 
 void Shader::setVec3(std::string const& name, float x, float y, float z) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniform3f(uniformLoc, x, y, z);
 }
 
 void Shader::setVec3Array(std::string const& name, GLsizei arraySize, glm::vec3 firstItem) const
 {
-	const GLint uniformLoc = glGetUniformLocation(id, name.c_str());
+	const GLint uniformLoc = getUniformLocation(name);
 	glUniform3fv(uniformLoc, arraySize, &(firstItem.x));
 }
 
+void Shader::setMatrix(UniformName name, const float* columnMajor) const
+{
+	glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, columnMajor);
+}
+
+void Shader::setBool(UniformName name, bool value) const
+{
+	glUniform1i(getUniformLocation(name), value);
+}
+
+void Shader::setInt(UniformName name, int value) const
+{
+	glUniform1i(getUniformLocation(name), value);
+}
+
+void Shader::setFloat(UniformName name, float value) const
+{
+	glUniform1f(getUniformLocation(name), value);
+}
+
+void Shader::setVec2(UniformName name, float x, float y) const
+{
+	glUniform2f(getUniformLocation(name), x, y);
+}
+
+void Shader::setVec3(UniformName name, float x, float y, float z) const
+{
+	glUniform3f(getUniformLocation(name), x, y, z);
+}
+
 unsigned Shader::getId() const
 {
-	return id;
+	return program != nullptr ? program->id : 0;
 }
 
 Shader::~Shader()
 {
-	glDeleteProgram(id);
-	id = 0;
+	// the ShaderProgram deletes the GL program with its last reference
 }
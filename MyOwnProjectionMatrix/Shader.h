@@ -2,7 +2,60 @@
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 #include <glm/gtc/type_ptr.hpp> // for transformations
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include "ShaderSourceCache.h"
+#include "ShaderRegistry.h"
+
+// 64-bit FNV-1a hash of a uniform name, usable at compile time. Wide enough that two
+// names of a program (or a name the program doesn't have) practically never collide
+constexpr std::uint64_t uniform_hash(char const* name, std::size_t length)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	for (std::size_t i = 0; i < length; ++i)
+	{
+		hash = (hash ^ static_cast<unsigned char>(name[i])) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// A uniform name hashed ahead of time, e.g:
+//		constexpr UniformName uModel = "uModel"_uniform;
+//		shader.setMatrix(uModel, model);
+// so setting a uniform never touches a string nor the driver
+struct UniformName
+{
+	std::uint64_t hash;
+};
+
+constexpr UniformName operator"" _uniform(char const* name, std::size_t length)
+{
+	return UniformName{ uniform_hash(name, length) };
+}
+
+// How many uniform locations were asked to the driver (once per active uniform
+// after linking) and how many setter calls were answered from the cache instead
+struct UniformCacheStats
+{
+	unsigned long long driverLookups;
+	unsigned long long lookupsAvoided;
+};
+
+// GLSL text as given to glShaderSource: not NUL terminated, always passed with its length
+struct ShaderSource
+{
+	char const* text;
+	GLint length;
+};
+
+// source of a mapped file, an unreadable file (nullptr) gives an empty source the compiler reports
+inline ShaderSource shader_source(const ShaderFile* file)
+{
+	return file != nullptr ? ShaderSource{ file->mapping.data(), static_cast<GLint>(file->mapping.size()) } : ShaderSource{ "", 0 };
+}
 
 class Shader
 {
@@ -17,7 +70,7 @@ public:
 	// two files; MyShader.frag, MyShader.vert
 	Shader(GLchar const *shaderName);
 
-	// Copy-Constructor
+	// Copy-Constructor: shares the program, no recompilation
 	Shader(const Shader& other);
 
 	// Move constructor
@@ -36,6 +89,8 @@ public:
 	void use() const;
 
 	// Utility uniform functions
+	// every name is resolved through the uniform location cache built after linking,
+	// a name it doesn't hold (e.g. "lights[3].color") is asked to the driver
 	void setMatrix(std::string const& name, glm::mat4x4& value) const;
 	void setBool(std::string const &name, bool value) const;
 	void setInt(std::string const &name, int value) const;
@@ -44,16 +99,52 @@ public:
 	void setVec3(std::string const& name, glm::vec3& value) const;
 	void setVec3(std::string const& name, float x, float y, float z) const;
 	void setVec3Array(std::string const& name, GLsizei arraySize, glm::vec3 firstItem) const;
+
+	// Same setters taking pre-hashed names (see UniformName)
+	void setMatrix(UniformName name, const float* columnMajor) const;
+	void setBool(UniformName name, bool value) const;
+	void setInt(UniformName name, int value) const;
+	void setFloat(UniformName name, float value) const;
+	void setVec2(UniformName name, float x, float y) const;
+	void setVec3(UniformName name, float x, float y, float z) const;
+
+	// Location of an active uniform (or an element of an active array) from the cache,
+	// -1 if the program has no such uniform
+	GLint getUniformLocation(UniformName name) const;
+	// same, falling back to glGetUniformLocation for the names the cache doesn't hold
+	GLint getUniformLocation(std::string const& name) const;
+
 	unsigned int getId() const;
 
+	static UniformCacheStats getUniformCacheStats();
+
 private:
+	// ShaderBatch and ShaderRegistry build programs themselves and wrap them in a Shader,
+	// ShaderHotReload rebuilds them
+	friend class ShaderBatch;
+	friend class ShaderRegistry;
+	friend class ShaderHotReload;
+
+	// Share a program owned by the ShaderRegistry
+	explicit Shader(std::shared_ptr<ShaderProgram> program);
+
 	static unsigned int initShader(char const* vertex_src, char const* fragment_src);
-	static unsigned int compileShader(char const *vertex_src, char const *fragment_src);
+	static unsigned int compileShader(ShaderSource vertex_src, ShaderSource fragment_src);
 	static void checkCompileError(unsigned int shader, unsigned int stage, unsigned int const status);
-	static char* readShaderFile(char const* shader_file_src);
+	// mapped through the process-wide ShaderSourceCache, keep it only until glShaderSource
+	static std::shared_ptr<const ShaderFile> readShaderFile(char const* shader_file_src);
+
+	// enumerate the active uniforms with glGetActiveUniform and fill program.uniformSlots
+	static void cacheUniformLocations(ShaderProgram& program);
+
+	// attach the shared uniform blocks (Camera, ...) the program declares to their binding points
+	static void bindUniformBlocks(unsigned int program);
+
+	// set the uniforms of destination to their values in source (same name and type only),
+	// so a rebuilt program keeps e.g. its sampler units
+	static void copyUniformValues(unsigned int source, unsigned int destination);
 
-	unsigned int id;
-	const char* vertexSrcFilePath;
-	const char* fragmentSrcFilePath;
+	// null after a move
+	std::shared_ptr<ShaderProgram> program;
 };
 
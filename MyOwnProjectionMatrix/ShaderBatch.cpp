@@ -0,0 +1,202 @@
+#include "ShaderBatch.h"
+#include "GLExtensions.h"
+#include "ProgramBinaryCache.h"
+#include "Profiler.h"
+#include <iostream>
+
+ShaderBatch::ShaderBatch() : stats()
+{
+}
+
+ShaderBatch::~ShaderBatch()
+{
+	for (Entry& entry : entries)
+	{
+		if (entry.state == State::Compiling)
+		{
+			glDeleteShader(entry.vertexShader);
+			glDeleteShader(entry.fragmentShader);
+		}
+		if (entry.state != State::Taken)
+		{
+			glDeleteProgram(entry.program);
+		}
+	}
+}
+
+std::size_t ShaderBatch::add(std::string const& vertexPath, std::string const& fragmentPath)
+{
+	Entry entry;
+	entry.vertexPath = vertexPath;
+	entry.fragmentPath = fragmentPath;
+	entries.push_back(entry);
+	++stats.programs;
+	return entries.size() - 1;
+}
+
+void ShaderBatch::submit()
+{
+	PROFILE_SCOPE("ShaderBatch::submit");
+
+	const bool parallel = gl_extensions().parallelShaderCompile;
+	if (parallel)
+	{
+		// let the driver use as many compiler threads as it wants
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+
+	ProgramBinaryCache& binaryCache = program_binary_cache();
+
+	// 1. start every compile
+	for (Entry& entry : entries)
+	{
+		if (entry.state != State::Queued)
+		{
+			continue;
+		}
+
+		const std::shared_ptr<const ShaderFile> vertexFile = Shader::readShaderFile(entry.vertexPath.c_str());
+		const std::shared_ptr<const ShaderFile> fragmentFile = Shader::readShaderFile(entry.fragmentPath.c_str());
+		const ShaderSource vertexSource = shader_source(vertexFile.get());
+		const ShaderSource fragmentSource = shader_source(fragmentFile.get());
+
+		entry.cacheKey = binaryCache.makeKey(vertexSource.text, vertexSource.length, fragmentSource.text, fragmentSource.length);
+		entry.program = binaryCache.load(entry.cacheKey);
+		if (entry.program != 0)
+		{
+			entry.state = State::Linked;
+			++stats.fromBinaryCache;
+		}
+		else
+		{
+			entry.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+			glShaderSource(entry.vertexShader, 1, &vertexSource.text, &vertexSource.length);
+			glCompileShader(entry.vertexShader);
+
+			entry.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+			glShaderSource(entry.fragmentShader, 1, &fragmentSource.text, &fragmentSource.length);
+			glCompileShader(entry.fragmentShader);
+			entry.state = State::Compiling;
+		}
+	}
+
+	// 2. start every link, a link of shaders still compiling just queues behind them
+	for (Entry& entry : entries)
+	{
+		if (entry.state != State::Compiling || entry.program != 0)
+		{
+			continue;
+		}
+
+		entry.program = glCreateProgram();
+		glAttachShader(entry.program, entry.vertexShader);
+		glAttachShader(entry.program, entry.fragmentShader);
+		if (gl_extensions().programBinary)
+		{
+			glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glLinkProgram(entry.program);
+	}
+}
+
+bool ShaderBatch::poll()
+{
+	const bool parallel = gl_extensions().parallelShaderCompile;
+	bool done = true;
+	for (Entry& entry : entries)
+	{
+		if (entry.state != State::Compiling)
+		{
+			continue;
+		}
+
+		if (parallel)
+		{
+			GLint complete = GL_FALSE;
+			glGetProgramiv(entry.program, GL_COMPLETION_STATUS_KHR, &complete);
+			if (complete == GL_FALSE)
+			{
+				++stats.pollsNotReady;
+				done = false;
+				continue;
+			}
+		}
+		resolve(entry);
+	}
+	return done;
+}
+
+void ShaderBatch::wait()
+{
+	PROFILE_SCOPE("ShaderBatch::wait");
+	for (Entry& entry : entries)
+	{
+		if (entry.state == State::Compiling)
+		{
+			resolve(entry);
+		}
+	}
+}
+
+Shader ShaderBatch::take(std::size_t index)
+{
+	Entry& entry = entries[index];
+	if (entry.state == State::Queued)
+	{
+		submit();
+	}
+	if (entry.state == State::Compiling)
+	{
+		resolve(entry);
+	}
+	if (entry.state == State::Taken)
+	{
+		std::cout << "ERROR SHADER BATCH PROGRAM ALREADY TAKEN: " << entry.vertexPath << " and " << entry.fragmentPath << "\n";
+		return Shader(std::shared_ptr<ShaderProgram>());
+	}
+	if (entry.state == State::Failed)
+	{
+		// an unlinked program isn't shared, the next Shader of these files compiles them again
+		glDeleteProgram(entry.program);
+		entry.program = 0;
+		entry.state = State::Taken;
+		return Shader(std::shared_ptr<ShaderProgram>());
+	}
+
+	// from now on the registry hands this program to every Shader of the same files
+	entry.state = State::Taken;
+	return Shader(shader_registry().adopt(entry.program, entry.vertexPath, entry.fragmentPath));
+}
+
+ShaderBatchStats ShaderBatch::getStats() const
+{
+	return stats;
+}
+
+void ShaderBatch::resolve(Entry& entry)
+{
+	GLint linked = GL_FALSE;
+	glGetProgramiv(entry.program, GL_LINK_STATUS, &linked);
+	if (linked == GL_TRUE)
+	{
+		entry.state = State::Linked;
+		program_binary_cache().store(entry.cacheKey, entry.program);
+	}
+	else
+	{
+		// only now is it worth asking which stage failed
+		std::cout << "ERROR IN SHADER BATCH PROGRAM: " << entry.vertexPath << " and " << entry.fragmentPath << "\n";
+		Shader::checkCompileError(entry.vertexShader, GL_VERTEX_SHADER, GL_COMPILE_STATUS);
+		Shader::checkCompileError(entry.fragmentShader, GL_FRAGMENT_SHADER, GL_COMPILE_STATUS);
+		Shader::checkCompileError(entry.program, 0, GL_LINK_STATUS);
+		entry.state = State::Failed;
+		++stats.failed;
+	}
+
+	glDetachShader(entry.program, entry.vertexShader);
+	glDetachShader(entry.program, entry.fragmentShader);
+	glDeleteShader(entry.vertexShader);
+	glDeleteShader(entry.fragmentShader);
+	entry.vertexShader = 0;
+	entry.fragmentShader = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Shader.h"
+
+// Builds many shader programs at once. submit() issues every glCompileShader and then
+// every glLinkProgram without asking for a single status in between, so the driver can
+// work on all of them concurrently; statuses are only read once a program is complete.
+// With KHR_parallel_shader_compile poll() asks GL_COMPLETION_STATUS_KHR and never blocks,
+// without it the driver compiles serially anyway and poll() resolves everything at once.
+//
+//		ShaderBatch batch;
+//		const std::size_t cube = batch.add("Shaders/myShader.vert", "Shaders/myShader.frag");
+//		batch.submit();
+//		... other startup work, or batch.poll() once per frame ...
+//		const Shader shader = batch.take(cube);	// waits if the program isn't complete yet
+//
+// Programs found in the program binary cache skip compilation, freshly linked ones are stored in it.
+struct ShaderBatchStats
+{
+	unsigned long long programs;
+	unsigned long long fromBinaryCache;
+	unsigned long long failed;
+	unsigned long long pollsNotReady; // GL_COMPLETION_STATUS_KHR queries answered "still compiling"
+};
+
+class ShaderBatch
+{
+public:
+	ShaderBatch();
+	~ShaderBatch();
+
+	ShaderBatch(const ShaderBatch&) = delete;
+	ShaderBatch& operator=(const ShaderBatch&) = delete;
+
+	// queue a program, returns its index for take()
+	std::size_t add(std::string const& vertexPath, std::string const& fragmentPath);
+
+	// read the sources and start compiling and linking every queued program
+	void submit();
+
+	// resolve the programs the driver has finished, true when none is left compiling
+	bool poll();
+
+	// resolve every program, blocking on the ones still compiling
+	void wait();
+
+	// hand the program over to a Shader, a program can be taken once. A program that failed to
+	// link gives a Shader without a program
+	Shader take(std::size_t index);
+
+	ShaderBatchStats getStats() const;
+
+private:
+	enum class State
+	{
+		Queued,
+		Compiling,
+		Linked,
+		Failed,
+		Taken
+	};
+
+	struct Entry
+	{
+		std::string vertexPath;
+		std::string fragmentPath;
+		State state = State::Queued;
+		GLuint program = 0;
+		GLuint vertexShader = 0;
+		GLuint fragmentShader = 0;
+		std::uint64_t cacheKey = 0;
+	};
+
+	void resolve(Entry& entry);
+
+	std::vector<Entry> entries;
+	ShaderBatchStats stats;
+};
@@ -0,0 +1,317 @@
+#include "ShaderHotReload.h"
+#include "Shader.h"
+#include "ShaderSourceCache.h"
+#include "Profiler.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#if defined(__linux__)
+#define HOT_RELOAD_USE_INOTIFY 1
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#define HOT_RELOAD_USE_INOTIFY 0
+#endif
+
+namespace
+{
+	// how long the worker waits for more events before rebuilding, editors
+	// often write a file in several steps (truncate, write, rename...)
+	constexpr int SETTLE_MS = 50;
+
+	// wakes up the worker this often to notice stop()
+	constexpr int WAIT_MS = 100;
+
+	std::string normalized(std::string const& path)
+	{
+		return std::filesystem::path(path).lexically_normal().generic_string();
+	}
+}
+
+ShaderHotReload::ShaderHotReload(std::string directory)
+	: directory(std::move(directory)), running(false), notifyDescriptor(-1), stats(), knownPrograms(0)
+{
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+	stop();
+}
+
+bool ShaderHotReload::start(GLFWwindow* renderWindow)
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	return workerContext.createShared(renderWindow, major, minor) && startWorker();
+}
+
+bool ShaderHotReload::start(HeadlessContext& renderContext)
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	return workerContext.createShared(renderContext, major, minor) && startWorker();
+}
+
+bool ShaderHotReload::startWorker()
+{
+#if HOT_RELOAD_USE_INOTIFY
+	notifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// editors either rewrite the file or write a new one and rename it over
+	if (notifyDescriptor < 0 || inotify_add_watch(notifyDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		std::cout << "ERROR WATCHING SHADER DIRECTORY: " << directory << std::endl;
+		if (notifyDescriptor >= 0)
+		{
+			close(notifyDescriptor);
+			notifyDescriptor = -1;
+		}
+		return false;
+	}
+#else
+	// the current times are the baseline
+	std::vector<std::string> unused;
+	waitForChanges(unused);
+#endif
+
+	refreshSources();
+	running = true;
+	worker = std::thread(&ShaderHotReload::workerLoop, this);
+	return true;
+}
+
+void ShaderHotReload::stop()
+{
+	if (worker.joinable())
+	{
+		running = false;
+		worker.join();
+	}
+
+#if HOT_RELOAD_USE_INOTIFY
+	if (notifyDescriptor >= 0)
+	{
+		close(notifyDescriptor);
+		notifyDescriptor = -1;
+	}
+#endif
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const ReloadedProgram& reloaded : ready)
+	{
+		glDeleteSync(reloaded.fence);
+		glDeleteProgram(reloaded.program);
+	}
+	ready.clear();
+}
+
+void ShaderHotReload::applyReloads()
+{
+	if (!running)
+	{
+		return;
+	}
+
+	if (shader_registry().getStats().programsCreated != knownPrograms)
+	{
+		refreshSources();
+	}
+
+	// take the programs the GPU is done with, the rest wait for a later frame
+	std::vector<ReloadedProgram> signaled;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (ready.empty())
+		{
+			return;
+		}
+		for (std::size_t i = 0; i < ready.size();)
+		{
+			const GLenum status = glClientWaitSync(ready[i].fence, 0, 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			{
+				signaled.push_back(std::move(ready[i]));
+				ready.erase(ready.begin() + static_cast<std::ptrdiff_t>(i));
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	PROFILE_SCOPE("ShaderHotReload::applyReloads");
+	for (ReloadedProgram& reloaded : signaled)
+	{
+		glDeleteSync(reloaded.fence);
+		const bool replaced = shader_registry().replace(reloaded.sources, reloaded.program,
+			reloaded.vertexVersion, reloaded.fragmentVersion);
+		if (!replaced)
+		{
+			glDeleteProgram(reloaded.program);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (replaced)
+		{
+			std::cout << "Shader reloaded: " << reloaded.sources.vertexPath << " and " << reloaded.sources.fragmentPath << std::endl;
+			++stats.reloadsApplied;
+		}
+		else
+		{
+			++stats.reloadsDropped;
+		}
+	}
+}
+
+bool ShaderHotReload::isWatching() const
+{
+	return running;
+}
+
+const char* ShaderHotReload::getWatchBackend() const
+{
+	return HOT_RELOAD_USE_INOTIFY ? "inotify" : "polling";
+}
+
+ShaderHotReloadStats ShaderHotReload::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void ShaderHotReload::workerLoop()
+{
+	profiler_set_thread_name("shader hot reload");
+	if (!workerContext.makeCurrent())
+	{
+		std::cout << "ERROR MAKING THE SHADER HOT RELOAD CONTEXT CURRENT" << std::endl;
+		return;
+	}
+
+	std::vector<std::string> changedFiles;
+	while (running)
+	{
+		changedFiles.clear();
+		if (waitForChanges(changedFiles))
+		{
+			rebuild(changedFiles);
+		}
+	}
+
+	workerContext.doneCurrent();
+}
+
+bool ShaderHotReload::waitForChanges(std::vector<std::string>& changedFiles)
+{
+#if HOT_RELOAD_USE_INOTIFY
+	pollfd descriptor = { notifyDescriptor, POLLIN, 0 };
+	int timeout = WAIT_MS;
+	while (poll(&descriptor, 1, timeout) > 0)
+	{
+		alignas(inotify_event) char buffer[4096];
+		const ssize_t length = read(notifyDescriptor, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len > 0)
+			{
+				changedFiles.push_back(normalized(directory + "/" + event->name));
+			}
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+		}
+		// keep collecting until the directory is quiet
+		timeout = SETTLE_MS;
+	}
+#else
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		const long long writeTime = static_cast<long long>(entry.last_write_time(error).time_since_epoch().count());
+		const std::string path = normalized(entry.path().generic_string());
+		auto found = writeTimes.find(path);
+		if (found == writeTimes.end())
+		{
+			writeTimes.emplace(path, writeTime);
+		}
+		else if (found->second != writeTime)
+		{
+			found->second = writeTime;
+			changedFiles.push_back(path);
+		}
+	}
+	if (changedFiles.empty() && running)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+	}
+#endif
+	return !changedFiles.empty();
+}
+
+void ShaderHotReload::rebuild(std::vector<std::string> const& changedFiles)
+{
+	std::vector<ShaderProgramSources> programs;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		programs = sources;
+	}
+
+	for (const ShaderProgramSources& program : programs)
+	{
+		const std::string vertexPath = normalized(program.vertexPath);
+		const std::string fragmentPath = normalized(program.fragmentPath);
+		bool changed = false;
+		for (const std::string& file : changedFiles)
+		{
+			changed = changed || file == vertexPath || file == fragmentPath;
+		}
+		if (!changed)
+		{
+			continue;
+		}
+
+		PROFILE_SCOPE("ShaderHotReload::rebuild");
+		const auto buildStart = std::chrono::steady_clock::now();
+
+		// the changed file is mapped again, and unmapped once compiled
+		const std::shared_ptr<const ShaderFile> vertexFile = shader_source_cache().get(program.vertexPath);
+		const std::shared_ptr<const ShaderFile> fragmentFile = shader_source_cache().get(program.fragmentPath);
+		ReloadedProgram reloaded;
+		reloaded.sources = program;
+		reloaded.vertexVersion = vertexFile != nullptr ? vertexFile->version : ShaderFileVersion{ -1, 0 };
+		reloaded.fragmentVersion = fragmentFile != nullptr ? fragmentFile->version : ShaderFileVersion{ -1, 0 };
+		reloaded.program = Shader::compileShader(shader_source(vertexFile.get()), shader_source(fragmentFile.get()));
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(reloaded.program, GL_LINK_STATUS, &linked);
+		const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+		if (linked != GL_TRUE)
+		{
+			glDeleteProgram(reloaded.program);
+			std::cout << "Shader reload failed, keeping the previous program: " << program.vertexPath << " and " << program.fragmentPath << std::endl;
+			std::lock_guard<std::mutex> lock(mutex);
+			++stats.buildsFailed;
+			continue;
+		}
+
+		// the GL thread uses the program once this context's commands completed
+		reloaded.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.push_back(std::move(reloaded));
+		stats.lastBuildMs = buildMs;
+	}
+}
+
+void ShaderHotReload::refreshSources()
+{
+	std::vector<ShaderProgramSources> live = shader_registry().getLiveSources();
+	knownPrograms = shader_registry().getStats().programsCreated;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	sources = std::move(live);
+}
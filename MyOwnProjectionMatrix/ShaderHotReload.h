@@ -0,0 +1,95 @@
+#pragma once
+#include <glad/glad.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "HeadlessContext.h"
+#include "ShaderSourceCache.h"
+#include "ShaderRegistry.h"
+
+// Rebuilds the live shader programs (see ShaderRegistry) when one of their files changes:
+//		worker thread	waits for changes in the directory, compiles and links on its own
+//						context sharing objects with the render context, fences the result
+//		GL thread		applyReloads() at the start of a frame swaps in the programs whose
+//						fence signaled, never waits for a compile
+// A program that fails to build is reported and the previous one stays in use.
+// Linux is notified by inotify, other platforms poll the modification times.
+//
+//		ShaderHotReload hotReload("Shaders");
+//		hotReload.start(window);
+//		while (...)
+//		{
+//			hotReload.applyReloads();
+//			...draw
+//		}
+struct ShaderHotReloadStats
+{
+	unsigned long long reloadsApplied;
+	unsigned long long buildsFailed;	// compile or link errors, the previous program was kept
+	unsigned long long reloadsDropped;	// built for a program no Shader references anymore
+	double lastBuildMs;					// compile + link on the worker
+};
+
+class ShaderHotReload
+{
+public:
+	explicit ShaderHotReload(std::string directory);
+	~ShaderHotReload();
+
+	ShaderHotReload(const ShaderHotReload&) = delete;
+	ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+	// GL thread, with the render context current: create the worker context sharing
+	// objects with it and start watching. false if watching isn't possible
+	bool start(GLFWwindow* renderWindow);
+	bool start(HeadlessContext& renderContext);
+
+	// GL thread: stop the worker, programs built but not applied are deleted
+	void stop();
+
+	// GL thread, between frames
+	void applyReloads();
+
+	bool isWatching() const;
+
+	// "inotify" or "polling"
+	const char* getWatchBackend() const;
+
+	ShaderHotReloadStats getStats() const;
+
+private:
+	// a linked program waiting for its fence on the GL thread
+	struct ReloadedProgram
+	{
+		ShaderProgramSources sources;
+		GLuint program;
+		GLsync fence;
+		ShaderFileVersion vertexVersion;
+		ShaderFileVersion fragmentVersion;
+	};
+
+	bool startWorker();
+	void workerLoop();
+	bool waitForChanges(std::vector<std::string>& changedFiles);
+	void rebuild(std::vector<std::string> const& changedFiles);
+	void refreshSources();
+
+	std::string directory;
+	HeadlessContext workerContext;
+	std::thread worker;
+	std::atomic<bool> running;
+	int notifyDescriptor; // inotify instance, -1 when polling
+	std::unordered_map<std::string, long long> writeTimes; // worker only, when polling
+
+	mutable std::mutex mutex;
+	std::vector<ShaderProgramSources> sources;	// what the worker rebuilds, refreshed by the GL thread
+	std::vector<ReloadedProgram> ready;
+	ShaderHotReloadStats stats;
+
+	// GL thread only, registry programsCreated when sources was last refreshed
+	unsigned long long knownPrograms;
+};
@@ -0,0 +1,124 @@
+#include "ShaderRegistry.h"
+#include "Shader.h"
+#include "ShaderSourceCache.h"
+#include <filesystem>
+#include <utility>
+
+ShaderProgram::~ShaderProgram()
+{
+	glDeleteProgram(id);
+}
+
+std::shared_ptr<ShaderProgram> ShaderRegistry::acquire(std::string const& vertexPath, std::string const& fragmentPath)
+{
+	const std::string key = makeKey(vertexPath, fragmentPath);
+	const auto found = entries.find(key);
+	if (found != entries.end())
+	{
+		// the same versions mean the program was built from the current sources
+		std::shared_ptr<ShaderProgram> live = found->second.program.lock();
+		if (live != nullptr
+			&& found->second.vertexVersion == shader_file_version(vertexPath)
+			&& found->second.fragmentVersion == shader_file_version(fragmentPath))
+		{
+			++stats.programsShared;
+			return live;
+		}
+	}
+
+	return adopt(Shader::initShader(vertexPath.c_str(), fragmentPath.c_str()), vertexPath, fragmentPath);
+}
+
+std::shared_ptr<ShaderProgram> ShaderRegistry::adopt(unsigned int program, std::string const& vertexPath, std::string const& fragmentPath)
+{
+	std::shared_ptr<ShaderProgram> shared = std::make_shared<ShaderProgram>();
+	shared->id = program;
+	shared->vertexPath = vertexPath;
+	shared->fragmentPath = fragmentPath;
+	Shader::cacheUniformLocations(*shared);
+	Shader::bindUniformBlocks(program);
+	++stats.programsCreated;
+
+	Entry& entry = entries[makeKey(vertexPath, fragmentPath)];
+	entry.program = shared;
+	entry.vertexVersion = shader_file_version(vertexPath);
+	entry.fragmentVersion = shader_file_version(fragmentPath);
+	return shared;
+}
+
+bool ShaderRegistry::replace(ShaderProgramSources const& sources, unsigned int program, const ShaderFileVersion vertexVersion, const ShaderFileVersion fragmentVersion)
+{
+	const auto found = entries.find(makeKey(sources.vertexPath, sources.fragmentPath));
+	const std::shared_ptr<ShaderProgram> live = found != entries.end() ? found->second.program.lock() : nullptr;
+	if (live == nullptr)
+	{
+		return false;
+	}
+
+	ShaderProgram rebuilt;
+	rebuilt.id = program;
+	Shader::cacheUniformLocations(rebuilt);
+	Shader::bindUniformBlocks(program);
+	Shader::copyUniformValues(live->id, program);
+
+	// a deleted program stays in use until unbound, so rebind it if it was current
+	GLint current = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+	if (static_cast<unsigned int>(current) == live->id)
+	{
+		glUseProgram(program);
+	}
+
+	// the previous program leaves with rebuilt
+	std::swap(live->id, rebuilt.id);
+	std::swap(live->uniformSlots, rebuilt.uniformSlots);
+	found->second.vertexVersion = vertexVersion;
+	found->second.fragmentVersion = fragmentVersion;
+	++stats.programsReplaced;
+	return true;
+}
+
+std::size_t ShaderRegistry::getLiveCount() const
+{
+	std::size_t live = 0;
+	for (const auto& entry : entries)
+	{
+		if (!entry.second.program.expired())
+		{
+			++live;
+		}
+	}
+	return live;
+}
+
+std::vector<ShaderProgramSources> ShaderRegistry::getLiveSources() const
+{
+	std::vector<ShaderProgramSources> sources;
+	for (const auto& entry : entries)
+	{
+		const std::shared_ptr<ShaderProgram> live = entry.second.program.lock();
+		if (live != nullptr)
+		{
+			sources.push_back(ShaderProgramSources{ live->vertexPath, live->fragmentPath });
+		}
+	}
+	return sources;
+}
+
+ShaderRegistryStats ShaderRegistry::getStats() const
+{
+	return stats;
+}
+
+std::string ShaderRegistry::makeKey(std::string const& vertexPath, std::string const& fragmentPath)
+{
+	// "Shaders/../Shaders/a.vert" and "Shaders/a.vert" are the same file
+	return std::filesystem::path(vertexPath).lexically_normal().generic_string() + '\n'
+		+ std::filesystem::path(fragmentPath).lexically_normal().generic_string();
+}
+
+ShaderRegistry& shader_registry()
+{
+	static ShaderRegistry registry;
+	return registry;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ShaderSourceCache.h"
+
+// A linked GL program with its uniform location table, shared by every Shader built from
+// the same source files. The GL program is deleted with the last Shader referencing it.
+struct ShaderProgram
+{
+	// open addressing hash table (linear probing), the size is a power of two
+	// and a hash of 0 marks an empty slot
+	struct UniformSlot
+	{
+		std::uint64_t hash;
+		GLint location;
+	};
+
+	unsigned int id = 0;
+	std::vector<UniformSlot> uniformSlots;
+	std::string vertexPath;
+	std::string fragmentPath;
+
+	ShaderProgram() = default;
+	~ShaderProgram();
+
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+};
+
+// the files a program is built from
+struct ShaderProgramSources
+{
+	std::string vertexPath;
+	std::string fragmentPath;
+};
+
+struct ShaderRegistryStats
+{
+	unsigned long long programsCreated; // compiled, loaded from the binary cache or adopted
+	unsigned long long programsShared;	// Shader constructions answered with a live program
+	unsigned long long programsReplaced; // rebuilt in place (hot reload)
+};
+
+// Deduplicates shader programs by source identity: the pair of files (normalized paths)
+// and their write times and sizes (see shader_file_version), so an edited file gives a new program.
+// Entries only hold weak references, the registry never keeps a program alive.
+// GL thread only.
+class ShaderRegistry
+{
+public:
+	// the live program built from these files, or a new one
+	std::shared_ptr<ShaderProgram> acquire(std::string const& vertexPath, std::string const& fragmentPath);
+
+	// register a program linked elsewhere (ShaderBatch), replaces the entry of the same files
+	std::shared_ptr<ShaderProgram> adopt(unsigned int program, std::string const& vertexPath, std::string const& fragmentPath);
+
+	// swap a rebuilt program into the live one of these files: every Shader sharing it uses the
+	// new program from the next draw on, with the uniform values of the previous one.
+	// false (and nothing changed) if no Shader references these files anymore
+	bool replace(ShaderProgramSources const& sources, unsigned int program, ShaderFileVersion vertexVersion, ShaderFileVersion fragmentVersion);
+
+	// programs currently referenced by at least one Shader
+	std::size_t getLiveCount() const;
+
+	// the files of every live program
+	std::vector<ShaderProgramSources> getLiveSources() const;
+
+	ShaderRegistryStats getStats() const;
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<ShaderProgram> program;
+		ShaderFileVersion vertexVersion;	// of the files the program was built from
+		ShaderFileVersion fragmentVersion;
+	};
+
+	static std::string makeKey(std::string const& vertexPath, std::string const& fragmentPath);
+
+	std::unordered_map<std::string, Entry> entries;
+	ShaderRegistryStats stats = {};
+};
+
+// the registry used by Shader
+ShaderRegistry& shader_registry();
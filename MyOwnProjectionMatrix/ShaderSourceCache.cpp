@@ -0,0 +1,84 @@
+#include "ShaderSourceCache.h"
+#include "Profiler.h"
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	bool read_file_version(std::string const& path, ShaderFileVersion& version)
+	{
+		std::error_code error;
+		const auto writeTime = std::filesystem::last_write_time(path, error);
+		const std::uintmax_t size = error ? 0 : std::filesystem::file_size(path, error);
+		if (error)
+		{
+			return false;
+		}
+		version = ShaderFileVersion{ static_cast<long long>(writeTime.time_since_epoch().count()), size };
+		return true;
+	}
+}
+
+std::shared_ptr<const ShaderFile> ShaderSourceCache::get(std::string const& path)
+{
+	ShaderFileVersion version;
+	if (!read_file_version(path, version))
+	{
+		std::cout << "ERROR TRYING TO READ SHADER FILE: " << path << std::endl;
+		std::lock_guard<std::mutex> lock(mutex);
+		++stats.failures;
+		return nullptr;
+	}
+
+	// "Shaders/./a.vert" and "Shaders/a.vert" share one mapping
+	const std::string key = std::filesystem::path(path).lexically_normal().generic_string();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto found = entries.find(key);
+	if (found != entries.end())
+	{
+		std::shared_ptr<const ShaderFile> live = found->second.lock();
+		if (live != nullptr && live->version == version)
+		{
+			++stats.hits;
+			return live;
+		}
+	}
+
+	PROFILE_SCOPE("map shader source");
+	std::shared_ptr<const ShaderFile> file = std::make_shared<const ShaderFile>(path, version);
+	if (!file->mapping.isOpen())
+	{
+		std::cout << "ERROR TRYING TO READ SHADER FILE: " << path << std::endl;
+		++stats.failures;
+		return nullptr;
+	}
+
+	entries[key] = file;
+	++stats.misses;
+	return file;
+}
+
+void ShaderSourceCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+}
+
+ShaderSourceCacheStats ShaderSourceCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+ShaderSourceCache& shader_source_cache()
+{
+	static ShaderSourceCache cache;
+	return cache;
+}
+
+ShaderFileVersion shader_file_version(std::string const& path)
+{
+	ShaderFileVersion version;
+	return read_file_version(path, version) ? version : ShaderFileVersion{ -1, 0 };
+}
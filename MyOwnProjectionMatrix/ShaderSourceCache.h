@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "MappedFile.h"
+
+// Process-wide cache of memory mapped shader sources, keyed by normalized path, last write
+// time and size. The sources go to glShaderSource with explicit lengths, nothing is copied.
+// A mapping only lives while a compile holds it (glShaderSource keeps its own copy), the
+// cache just lets concurrent compiles of the same file share it: a file kept mapped can't be
+// saved in place on Windows and faults elsewhere when truncated, which hot reload relies on.
+// Building the same Shader again is answered by the ShaderRegistry with a stat of the files.
+struct ShaderSourceCacheStats
+{
+	unsigned long long hits; // still mapped for another compile
+	unsigned long long misses; // mapped from disk
+	unsigned long long failures;
+};
+
+// which contents of a file a source (or a program built from it) is
+struct ShaderFileVersion
+{
+	long long writeTime;
+	std::uintmax_t size;
+};
+
+inline bool operator==(const ShaderFileVersion& a, const ShaderFileVersion& b)
+{
+	return a.writeTime == b.writeTime && a.size == b.size;
+}
+
+struct ShaderFile
+{
+	ShaderFile(std::string const& path, ShaderFileVersion version) : version(version), mapping(path)
+	{
+	}
+
+	ShaderFileVersion version;
+	MappedFile mapping;
+};
+
+class ShaderSourceCache
+{
+public:
+	// the mapped file, nullptr if it can't be read. Hold the pointer only until the sources
+	// are handed to glShaderSource, the file is unmapped with its last reference
+	std::shared_ptr<const ShaderFile> get(std::string const& path);
+
+	// forget every mapping (the ones still referenced stay valid)
+	void clear();
+
+	ShaderSourceCacheStats getStats() const;
+
+private:
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, std::weak_ptr<const ShaderFile>> entries;
+	ShaderSourceCacheStats stats = {};
+};
+
+// the cache used by Shader and ShaderBatch
+ShaderSourceCache& shader_source_cache();
+
+// write time and size of the file, { -1, 0 } if it can't be read. Only a stat, nothing is mapped
+ShaderFileVersion shader_file_version(std::string const& path);
@@ -0,0 +1,47 @@
+#version 330 core
+
+// FRAGMENT SHADER INPUT
+// from vertex shader
+in vec3 vColor;
+in vec2 vTexCoord;
+flat in uint vMaterial;
+
+// from CPU as uniform
+uniform float uTime;
+uniform sampler2DArray uTextures; // every image of the atlas (see TextureAtlas.h)
+
+// a material blends two images of the atlas, each in its layer at uv * scale + offset
+struct Material
+{
+	vec4 uvA; // scale (xy) and offset (zw) of image A
+	vec4 uvB;
+	vec4 layers; // layer of image A (x) and B (y)
+};
+
+layout (std140) uniform Materials
+{
+	Material uMaterials[64]; // MAX_MATERIALS
+};
+
+// FRAGMENT SHADER OUTPUT
+out vec4 FragColor;
+
+// LOCAL IDENTIFIERS
+#define PI 3.141516
+vec4 color;
+
+void main()
+{
+	// same look as myShader.frag, the two samplers become two lookups in the array
+	Material material = uMaterials[vMaterial];
+	vec2 uv = clamp(vTexCoord, 0.0, 1.0); // images packed together can't repeat
+
+	vec4 anim = vec4(0.5 + 0.5 * sin(uTime), 0.5 + 0.5 * sin(uTime + PI), 0.5 + 0.5 * sin(uTime + 0.5 * PI), 1.0);
+	vec4 texelA = texture(uTextures, vec3(uv * material.uvA.xy + material.uvA.zw, material.layers.x));
+	vec4 texelB = texture(uTextures, vec3(uv * material.uvB.xy + material.uvB.zw, material.layers.y));
+	vec4 tint = vec4(vec3(vColor), 1.0) * anim;
+	tint = 0.8 + 0.9 * tint;
+	color = mix(texelA, texelB, 0.5 + 0.5 * sin(uTime));
+	color = color * 0.8;
+	FragColor =  color * tint;
+}
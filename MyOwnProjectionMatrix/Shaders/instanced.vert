@@ -0,0 +1,47 @@
+#version 330 core
+
+// VERTEX SHADER INPUT:
+
+// vertex attributes
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+
+// instance attributes (glVertexAttribDivisor = 1, see Instancing.h)
+layout (location = 3) in vec4 aInstanceRotation;	// unit quaternion (snorm16)
+layout (location = 4) in vec4 aInstanceOffsetScale;	// translation and uniform scale
+layout (location = 5) in uint aInstanceMaterial;	// row of the material table (see atlas.frag)
+
+// uniforms
+uniform vec2 uPositionDequant; // scale and bias of the stored positions (see VertexLayout.h)
+uniform mat4 uModel; // animation shared by every instance
+
+// camera data shared by every program (see CameraUniformBuffer)
+layout (std140) uniform Camera
+{
+	mat4 uView;
+	mat4 uProj;
+	mat4 uViewProj;
+	vec4 uCameraPosition;
+};
+
+// VERTEX SHADER OUTPUT: pass info from 'vs' to 'fs'
+out vec3 vColor;
+out vec2 vTexCoord;
+flat out uint vMaterial;
+
+// rotate v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v)
+{
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+	vec3 local = (uModel * vec4(aPos * uPositionDequant.x + uPositionDequant.y, 1.0)).xyz * aInstanceOffsetScale.w;
+	vec3 world = rotate(normalize(aInstanceRotation), local) + aInstanceOffsetScale.xyz;
+	gl_Position = uViewProj * vec4(world, 1.0);
+	vColor = aColor;
+	vTexCoord = aTexCoord;
+	vMaterial = aInstanceMaterial;
+}
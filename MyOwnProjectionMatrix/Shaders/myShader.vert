@@ -8,9 +8,17 @@ layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
 
 // uniforms
+uniform vec2 uPositionDequant; // scale and bias of the stored positions (see VertexLayout.h)
 uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
+
+// camera data shared by every program (see CameraUniformBuffer)
+layout (std140) uniform Camera
+{
+	mat4 uView;
+	mat4 uProj;
+	mat4 uViewProj;
+	vec4 uCameraPosition;
+};
 
 // VERTEX SHADER OUTPUT: pass info from 'vs' to 'fs'
 out vec3 vColor;
@@ -21,7 +29,8 @@ vec4 pos;
 
 void main()
 {
-	gl_Position = uProj * uView * uModel * vec4(aPos, 1.0);
+	// multiply right to left: three matrix-vector products instead of two matrix-matrix products per vertex
+	gl_Position = uProj * (uView * (uModel * vec4(aPos * uPositionDequant.x + uPositionDequant.y, 1.0)));
 	vColor = aColor;
 	vTexCoord = aTexCoord;
 }
\ No newline at end of file
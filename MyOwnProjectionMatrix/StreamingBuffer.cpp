@@ -0,0 +1,145 @@
+#include "StreamingBuffer.h"
+#include "GLExtensions.h"
+#include <iostream>
+
+StreamingBuffer::StreamingBuffer(const GLenum target, const GLsizeiptr regionCapacity, const GLsizeiptr alignment)
+	: target(target), buffer(0), regionSize(0), regionCapacity(regionCapacity), mapped(nullptr), writing(false), fences(), current(0), bytesStreamed(0), fenceWaits(0)
+{
+	const GLsizeiptr align = alignment > 0 ? alignment : 1;
+	regionSize = (regionCapacity + align - 1) / align * align;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+
+	if (gl_extensions().bufferStorage)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, regionSize * FRAMES, nullptr, flags);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, regionSize * FRAMES, flags));
+		if (mapped == nullptr)
+		{
+			std::cout << "ERROR MAPPING STREAMING BUFFER\n";
+		}
+	}
+	else
+	{
+		glBufferData(target, regionSize * FRAMES, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	glBindBuffer(target, 0);
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	for (GLsync& fence : fences)
+	{
+		if (fence != nullptr)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	if (mapped != nullptr || writing)
+	{
+		glBindBuffer(target, buffer);
+		glUnmapBuffer(target);
+		glBindBuffer(target, 0);
+	}
+	glDeleteBuffers(1, &buffer);
+}
+
+void* StreamingBuffer::beginWrite()
+{
+	waitForRegion(current);
+
+	const GLintptr offset = regionSize * current;
+	if (mapped != nullptr)
+	{
+		return mapped + offset;
+	}
+
+	// the fence already guarantees the GPU is done with this region
+	glBindBuffer(target, buffer);
+	const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	void* region = glMapBufferRange(target, offset, regionCapacity, access);
+	glBindBuffer(target, 0);
+	writing = region != nullptr;
+	return region;
+}
+
+void StreamingBuffer::endWrite(const GLsizeiptr bytesWritten)
+{
+	if (writing)
+	{
+		glBindBuffer(target, buffer);
+		glUnmapBuffer(target);
+		glBindBuffer(target, 0);
+		writing = false;
+	}
+	bytesStreamed += static_cast<unsigned long long>(bytesWritten);
+}
+
+void StreamingBuffer::endFrame()
+{
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	current = (current + 1) % FRAMES;
+}
+
+void StreamingBuffer::waitForRegion(const int region)
+{
+	GLsync& fence = fences[region];
+	if (fence == nullptr)
+	{
+		return;
+	}
+
+	// poll first, only count a wait when the GPU is really behind
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+	{
+		++fenceWaits;
+		do
+		{
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+GLuint StreamingBuffer::getBuffer() const
+{
+	return buffer;
+}
+
+GLenum StreamingBuffer::getTarget() const
+{
+	return target;
+}
+
+GLintptr StreamingBuffer::getRegionOffset() const
+{
+	return regionSize * current;
+}
+
+GLsizeiptr StreamingBuffer::getRegionCapacity() const
+{
+	return regionCapacity;
+}
+
+bool StreamingBuffer::isPersistentlyMapped() const
+{
+	return mapped != nullptr;
+}
+
+unsigned long long StreamingBuffer::getBytesStreamed() const
+{
+	return bytesStreamed;
+}
+
+unsigned long long StreamingBuffer::getFenceWaits() const
+{
+	return fenceWaits;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <glad/glad.h>
+
+// Buffer for data the CPU rewrites every frame (the camera block, animated or culled instances).
+// The buffer is split in FRAMES regions used round-robin, each region is fenced after the
+// frame that reads it, so the CPU fills the next region while the GPU may still be reading
+// the previous ones: the driver never has to copy or orphan the storage, and the CPU only
+// waits when the GPU is more than FRAMES - 1 frames behind (counted in getFenceWaits).
+// With GL 4.4 / ARB_buffer_storage the whole buffer stays persistently and coherently
+// mapped, otherwise each region is mapped unsynchronized while it is written.
+//
+//		void* region = stream.beginWrite();		// this frame's region, any thread may fill it
+//		... write at most getRegionCapacity() bytes ...
+//		stream.endWrite(bytesWritten);
+//		... draws reading getBuffer() at getRegionOffset() ...
+//		stream.endFrame();
+class StreamingBuffer
+{
+public:
+	static constexpr int FRAMES = 3;
+
+	// regions of regionCapacity bytes, each starting at a multiple of alignment
+	StreamingBuffer(GLenum target, GLsizeiptr regionCapacity, GLsizeiptr alignment = 256);
+	~StreamingBuffer();
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	// GL thread: wait for the GPU to release this frame's region and return where it is mapped
+	// (nullptr when it couldn't be mapped). The pointer stays valid until endWrite()
+	void* beginWrite();
+
+	// GL thread: the bytes written since beginWrite() are ready for the draws
+	void endWrite(GLsizeiptr bytesWritten);
+
+	// fence the region used this frame and move to the next one, call after the frame draws
+	void endFrame();
+
+	GLuint getBuffer() const;
+	GLenum getTarget() const;
+	GLintptr getRegionOffset() const;
+	GLsizeiptr getRegionCapacity() const;
+
+	bool isPersistentlyMapped() const;
+
+	unsigned long long getBytesStreamed() const;
+
+	// how many times the CPU had to wait for the GPU to release a region
+	unsigned long long getFenceWaits() const;
+
+private:
+	void waitForRegion(int region);
+
+	GLenum target;
+	GLuint buffer;
+	GLsizeiptr regionSize;		// regionCapacity rounded up to the alignment
+	GLsizeiptr regionCapacity;
+	unsigned char* mapped;		// the whole buffer when persistent
+	bool writing;				// the region is mapped by beginWrite() without persistence
+	GLsync fences[FRAMES];
+	int current;
+	unsigned long long bytesStreamed;
+	unsigned long long fenceWaits;
+};
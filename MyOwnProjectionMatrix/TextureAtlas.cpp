@@ -0,0 +1,440 @@
+#include "TextureAtlas.h"
+#include "CameraUniformBuffer.h"
+#include "MappedFile.h"
+#include "TextureLoader.h"
+#include <stb/stb_image.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <utility>
+
+namespace
+{
+	constexpr std::uint32_t ATLAS_FILE_MAGIC = 0x54415050; // "PPAT"
+	constexpr std::uint32_t ATLAS_FILE_VERSION = 1;
+
+	struct AtlasFileHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::int32_t width;
+		std::int32_t height;
+		std::uint32_t layers;
+		std::uint32_t imageLayers;
+		std::uint32_t regionCount;
+		std::uint32_t reserved;
+	};
+
+	struct AtlasFileRegion
+	{
+		char name[44]; // NUL terminated, longer names are cut
+		AtlasRegion region;
+	};
+
+	static_assert(sizeof(AtlasFileHeader) == 32 && sizeof(AtlasFileRegion) == 64, "the atlas file tables must not get padded");
+
+	int align_up(const int value)
+	{
+		return (value + ATLAS_PADDING - 1) / ATLAS_PADDING * ATLAS_PADDING;
+	}
+
+	// copy image into its layer at (x, y) and extrude its edges over the padding around it
+	void blit_padded(const AtlasImage& image, unsigned char* layer, const int layerWidth, const int x, const int y)
+	{
+		for (int dy = -ATLAS_PADDING; dy < image.height + ATLAS_PADDING; ++dy)
+		{
+			const int sy = std::min(std::max(dy, 0), image.height - 1);
+			unsigned char* row = layer + (static_cast<std::size_t>(y + dy) * layerWidth + x) * 4;
+			for (int dx = -ATLAS_PADDING; dx < image.width + ATLAS_PADDING; ++dx)
+			{
+				const int sx = std::min(std::max(dx, 0), image.width - 1);
+				std::memcpy(row + dx * 4, &image.pixels[(static_cast<std::size_t>(sy) * image.width + sx) * 4], 4);
+			}
+		}
+	}
+}
+
+SkylinePacker::SkylinePacker(const int width, const int height) : skyline{ { 0, 0, width } }, width(width), height(height), usedArea(0)
+{
+}
+
+bool SkylinePacker::insert(const int rectWidth, const int rectHeight, int& x, int& y)
+{
+	std::size_t best = skyline.size();
+	int bestTop = INT_MAX, bestWidth = INT_MAX, bestY = 0;
+	for (std::size_t i = 0; i < skyline.size(); ++i)
+	{
+		if (skyline[i].x + rectWidth > width)
+		{
+			break;
+		}
+
+		// the rectangle rests on the highest segment under [x, x + rectWidth)
+		int top = 0;
+		for (std::size_t j = i; j < skyline.size() && skyline[j].x < skyline[i].x + rectWidth; ++j)
+		{
+			top = std::max(top, skyline[j].y);
+		}
+		if (top + rectHeight > height)
+		{
+			continue;
+		}
+
+		// lowest top first, then the narrowest segment (the tightest fit)
+		if (top + rectHeight < bestTop || (top + rectHeight == bestTop && skyline[i].width < bestWidth))
+		{
+			best = i;
+			bestTop = top + rectHeight;
+			bestWidth = skyline[i].width;
+			bestY = top;
+		}
+	}
+	if (best == skyline.size())
+	{
+		return false;
+	}
+
+	x = skyline[best].x;
+	y = bestY;
+
+	// the top of the rectangle becomes a segment, the ones under it shrink or go
+	skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(best), Segment{ x, y + rectHeight, rectWidth });
+	for (std::size_t i = best + 1; i < skyline.size();)
+	{
+		const int covered = x + rectWidth - skyline[i].x;
+		if (covered <= 0)
+		{
+			break;
+		}
+		if (covered < skyline[i].width)
+		{
+			skyline[i].x += covered;
+			skyline[i].width -= covered;
+			break;
+		}
+		skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i));
+	}
+
+	// neighbours at the same height are one segment
+	for (std::size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	usedArea += static_cast<long long>(rectWidth) * rectHeight;
+	return true;
+}
+
+float SkylinePacker::getOccupancy() const
+{
+	return static_cast<float>(static_cast<double>(usedArea) / (static_cast<double>(width) * height));
+}
+
+bool load_atlas_image(const std::string& path, AtlasImage& image)
+{
+	int channels = 0;
+	unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+	if (data == nullptr)
+	{
+		std::cout << "ERROR LOADING TEXTURE DATA: " << path << std::endl;
+		return false;
+	}
+
+	image.name = std::filesystem::path(path).filename().string();
+	const std::size_t rowBytes = static_cast<std::size_t>(image.width) * 4;
+	image.pixels.resize(rowBytes * image.height);
+	for (int y = 0; y < image.height; ++y)
+	{
+		std::memcpy(&image.pixels[y * rowBytes], data + (image.height - 1 - y) * rowBytes, rowBytes);
+	}
+	stbi_image_free(data);
+	return true;
+}
+
+bool pack_texture_atlas(const std::vector<AtlasImage>& images, TextureAtlas& atlas)
+{
+	atlas = TextureAtlas();
+	if (images.empty())
+	{
+		return false;
+	}
+
+	// the most common size, then the largest
+	std::map<std::pair<int, int>, std::size_t> sizes;
+	for (const AtlasImage& image : images)
+	{
+		++sizes[{ image.width, image.height }];
+	}
+	std::pair<int, int> layerSize = sizes.begin()->first;
+	for (const auto& size : sizes)
+	{
+		const std::size_t count = size.second, bestCount = sizes[layerSize];
+		if (count > bestCount || (count == bestCount && size.first.first * size.first.second > layerSize.first * layerSize.second))
+		{
+			layerSize = size.first;
+		}
+	}
+	atlas.width = layerSize.first;
+	atlas.height = layerSize.second;
+	const std::size_t layerBytes = static_cast<std::size_t>(atlas.width) * atlas.height * 4;
+
+	atlas.names.resize(images.size());
+	atlas.regions.resize(images.size());
+	std::vector<std::size_t> packed;
+	for (std::size_t i = 0; i < images.size(); ++i)
+	{
+		const AtlasImage& image = images[i];
+		atlas.names[i] = image.name;
+		if (image.width == atlas.width && image.height == atlas.height)
+		{
+			atlas.regions[i] = { atlas.layers++, 0, 0, static_cast<std::uint32_t>(atlas.width), static_cast<std::uint32_t>(atlas.height) };
+			atlas.pixels.insert(atlas.pixels.end(), image.pixels.begin(), image.pixels.end());
+			continue;
+		}
+		if (align_up(image.width + 2 * ATLAS_PADDING) > atlas.width || align_up(image.height + 2 * ATLAS_PADDING) > atlas.height)
+		{
+			std::cout << "ERROR PACKING TEXTURE ATLAS: " << image.name << " (" << image.width << "x" << image.height
+				<< ") doesn't fit a " << atlas.width << "x" << atlas.height << " layer with its padding" << std::endl;
+			return false;
+		}
+		packed.push_back(i);
+	}
+	atlas.imageLayers = atlas.layers;
+
+	// tallest first keeps the skyline flat, every image tries the layers opened before its own
+	std::stable_sort(packed.begin(), packed.end(), [&](const std::size_t a, const std::size_t b)
+	{
+		return images[a].height != images[b].height ? images[a].height > images[b].height : images[a].width > images[b].width;
+	});
+	std::vector<SkylinePacker> bins;
+	for (const std::size_t i : packed)
+	{
+		const AtlasImage& image = images[i];
+		const int paddedWidth = align_up(image.width + 2 * ATLAS_PADDING);
+		const int paddedHeight = align_up(image.height + 2 * ATLAS_PADDING);
+		int x = 0, y = 0;
+		std::size_t bin = 0;
+		while (bin < bins.size() && !bins[bin].insert(paddedWidth, paddedHeight, x, y))
+		{
+			++bin;
+		}
+		if (bin == bins.size())
+		{
+			bins.emplace_back(atlas.width, atlas.height);
+			bins.back().insert(paddedWidth, paddedHeight, x, y);
+			atlas.pixels.resize(atlas.pixels.size() + layerBytes, 0);
+			++atlas.layers;
+		}
+
+		const std::uint32_t layer = atlas.imageLayers + static_cast<std::uint32_t>(bin);
+		blit_padded(image, &atlas.pixels[layer * layerBytes], atlas.width, x + ATLAS_PADDING, y + ATLAS_PADDING);
+		atlas.regions[i] = { layer, static_cast<std::uint32_t>(x + ATLAS_PADDING), static_cast<std::uint32_t>(y + ATLAS_PADDING),
+			static_cast<std::uint32_t>(image.width), static_cast<std::uint32_t>(image.height) };
+	}
+	return true;
+}
+
+float atlas_occupancy(const TextureAtlas& atlas)
+{
+	const std::uint32_t sharedLayers = atlas.layers - atlas.imageLayers;
+	if (sharedLayers == 0)
+	{
+		return 1.0f;
+	}
+
+	double covered = 0.0;
+	for (const AtlasRegion& region : atlas.regions)
+	{
+		if (region.layer >= atlas.imageLayers)
+		{
+			covered += static_cast<double>(region.width) * region.height;
+		}
+	}
+	return static_cast<float>(covered / (static_cast<double>(atlas.width) * atlas.height * sharedLayers));
+}
+
+void atlas_uv_transform(const TextureAtlas& atlas, const std::size_t region, float transform[4])
+{
+	const AtlasRegion& r = atlas.regions[region];
+	transform[0] = static_cast<float>(r.width) / static_cast<float>(atlas.width);
+	transform[1] = static_cast<float>(r.height) / static_cast<float>(atlas.height);
+	transform[2] = static_cast<float>(r.x) / static_cast<float>(atlas.width);
+	transform[3] = static_cast<float>(r.y) / static_cast<float>(atlas.height);
+}
+
+bool write_texture_atlas(const std::string& path, const TextureAtlas& atlas)
+{
+	AtlasFileHeader header = {};
+	header.magic = ATLAS_FILE_MAGIC;
+	header.version = ATLAS_FILE_VERSION;
+	header.width = atlas.width;
+	header.height = atlas.height;
+	header.layers = atlas.layers;
+	header.imageLayers = atlas.imageLayers;
+	header.regionCount = static_cast<std::uint32_t>(atlas.regions.size());
+
+	// written next to the file then renamed, so a reader never maps a partial file
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (std::size_t i = 0; i < atlas.regions.size(); ++i)
+		{
+			AtlasFileRegion stored = {};
+			std::strncpy(stored.name, atlas.names[i].c_str(), sizeof(stored.name) - 1);
+			stored.region = atlas.regions[i];
+			file.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+		}
+		file.write(reinterpret_cast<const char*>(atlas.pixels.data()), static_cast<std::streamsize>(atlas.pixels.size()));
+		if (!file)
+		{
+			std::cout << "ERROR WRITING TEXTURE ATLAS: " << temporaryPath << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cout << "ERROR WRITING TEXTURE ATLAS: " << path << " (" << error.message() << ")" << std::endl;
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool read_texture_atlas(const std::string& path, TextureAtlas& atlas)
+{
+	const MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cout << "ERROR TRYING TO READ TEXTURE ATLAS: " << path << std::endl;
+		return false;
+	}
+
+	const std::uint64_t size = file.size();
+	if (size < sizeof(AtlasFileHeader))
+	{
+		std::cout << "Texture atlas is malformed: " << path << std::endl;
+		return false;
+	}
+	const auto* header = reinterpret_cast<const AtlasFileHeader*>(file.data());
+	const std::uint64_t tableBytes = static_cast<std::uint64_t>(header->regionCount) * sizeof(AtlasFileRegion);
+	const std::uint64_t pixelBytes = static_cast<std::uint64_t>(header->width > 0 ? header->width : 0) * (header->height > 0 ? header->height : 0) * 4 * header->layers;
+	if (header->magic != ATLAS_FILE_MAGIC || header->version != ATLAS_FILE_VERSION || header->imageLayers > header->layers
+		|| size != sizeof(AtlasFileHeader) + tableBytes + pixelBytes)
+	{
+		std::cout << "Texture atlas is malformed: " << path << std::endl;
+		return false;
+	}
+
+	atlas = TextureAtlas();
+	atlas.width = header->width;
+	atlas.height = header->height;
+	atlas.layers = header->layers;
+	atlas.imageLayers = header->imageLayers;
+	const auto* regions = reinterpret_cast<const AtlasFileRegion*>(file.data() + sizeof(AtlasFileHeader));
+	for (std::uint32_t i = 0; i < header->regionCount; ++i)
+	{
+		const AtlasRegion& region = regions[i].region;
+		if (region.layer >= atlas.layers || region.x + region.width > static_cast<std::uint32_t>(atlas.width) || region.y + region.height > static_cast<std::uint32_t>(atlas.height))
+		{
+			std::cout << "Texture atlas is malformed (regions): " << path << std::endl;
+			return false;
+		}
+		atlas.names.emplace_back(regions[i].name, strnlen(regions[i].name, sizeof(regions[i].name)));
+		atlas.regions.push_back(region);
+	}
+	const auto* pixels = reinterpret_cast<const unsigned char*>(file.data() + sizeof(AtlasFileHeader) + tableBytes);
+	atlas.pixels.assign(pixels, pixels + pixelBytes);
+	return true;
+}
+
+GLuint create_texture_array(const TextureAtlas& atlas)
+{
+	if (atlas.layers == 0)
+	{
+		return 0;
+	}
+
+	// shared layers keep the levels their padding protects, image layers alone get the whole chain
+	int levels = 1;
+	while ((atlas.width >> levels) > 0 || (atlas.height >> levels) > 0)
+	{
+		++levels;
+	}
+	if (atlas.imageLayers < atlas.layers)
+	{
+		levels = std::min(levels, ATLAS_MIP_LEVELS);
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// every layer of a level in one upload, each layer halved on its own
+	std::vector<unsigned char> level(atlas.pixels), next;
+	int w = atlas.width;
+	int h = atlas.height;
+	for (int l = 0; l < levels; ++l)
+	{
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, l, GL_RGBA8, w, h, static_cast<GLsizei>(atlas.layers), 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data());
+		if (l + 1 == levels)
+		{
+			break;
+		}
+
+		const int nw = std::max(w / 2, 1);
+		const int nh = std::max(h / 2, 1);
+		next.resize(static_cast<std::size_t>(nw) * nh * 4 * atlas.layers);
+		for (std::uint32_t layer = 0; layer < atlas.layers; ++layer)
+		{
+			downsample_image(&level[static_cast<std::size_t>(w) * h * 4 * layer], w, h, 4, &next[static_cast<std::size_t>(nw) * nh * 4 * layer]);
+		}
+		level.swap(next);
+		w = nw;
+		h = nh;
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return texture;
+}
+
+MaterialEntry make_material(const TextureAtlas& atlas, const std::size_t a, const std::size_t b)
+{
+	MaterialEntry material = {};
+	atlas_uv_transform(atlas, a, material.uvA);
+	atlas_uv_transform(atlas, b, material.uvB);
+	material.layers[0] = static_cast<float>(atlas.regions[a].layer);
+	material.layers[1] = static_cast<float>(atlas.regions[b].layer);
+	return material;
+}
+
+GLuint create_material_buffer(const MaterialBlock& block)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialBlock), &block, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, buffer);
+	return buffer;
+}
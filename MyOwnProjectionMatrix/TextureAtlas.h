@@ -0,0 +1,121 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Every image a batch samples in one GL_TEXTURE_2D_ARRAY, so switching image is an index
+// (the material of the instance, see Instancing.h) instead of a texture bind between draws.
+// Images of the layer size get a layer of their own. The other sizes share the remaining
+// layers, packed bottom-left along a skyline, each surrounded by ATLAS_PADDING texels copied
+// from its edges so the filtering and the first mip levels never read a neighbour.
+// A region is sampled at uv * scale + offset in its layer, uv clamped to [0, 1]: images in a
+// shared layer can't repeat.
+//
+//		offline:	pack_texture_atlas(images, atlas); write_texture_atlas("textures.atlas", atlas);
+//		runtime:	read_texture_atlas("textures.atlas", atlas); GLuint array = create_texture_array(atlas);
+constexpr int ATLAS_PADDING = 8;		// texels around a packed image, also the alignment of the packed regions
+constexpr int ATLAS_MIP_LEVELS = 4;		// mip levels kept when layers are shared: level 3 still has a 1 texel border
+
+// RGBA8 image, rows bottom up like GL expects them
+struct AtlasImage
+{
+	std::string name;
+	int width;
+	int height;
+	std::vector<unsigned char> pixels;
+};
+
+// where an image landed, in texels of its layer (the padding is around it)
+struct AtlasRegion
+{
+	std::uint32_t layer;
+	std::uint32_t x, y;
+	std::uint32_t width, height;
+};
+
+struct TextureAtlas
+{
+	int width;						// of every layer
+	int height;
+	std::uint32_t layers;
+	std::uint32_t imageLayers;		// the first layers, one image of the layer size each
+	std::vector<std::string> names;
+	std::vector<AtlasRegion> regions; // one per image, in the order they were packed in
+	std::vector<unsigned char> pixels; // RGBA8 level 0, layer after layer
+};
+
+// Skyline bin packer: the bin is filled bottom up, the top edge of what was placed is kept as
+// horizontal segments and a new rectangle rests on the segments where its top ends lowest.
+// Cheaper than a maximal rectangles packer and close to it for images of similar heights.
+class SkylinePacker
+{
+public:
+	SkylinePacker(int width, int height);
+
+	// place a width x height rectangle, false when it doesn't fit anymore
+	bool insert(int width, int height, int& x, int& y);
+
+	// area placed / area of the bin
+	float getOccupancy() const;
+
+private:
+	struct Segment
+	{
+		int x, y, width;
+	};
+
+	std::vector<Segment> skyline; // sorted by x, covering [0, width)
+	int width;
+	int height;
+	long long usedArea;
+};
+
+// decode an image file into RGBA8, flipped bottom up
+bool load_atlas_image(const std::string& path, AtlasImage& image);
+
+// The layer size is the most common image size (the largest one on ties), the images of
+// that size get a layer each, the others are packed into the following layers.
+// false when an image is larger than a layer
+bool pack_texture_atlas(const std::vector<AtlasImage>& images, TextureAtlas& atlas);
+
+// texels covered by the packed images / texels of the shared layers (1 without shared layers)
+float atlas_occupancy(const TextureAtlas& atlas);
+
+// uv transform of a region: scale (x, y) and offset (z, w)
+void atlas_uv_transform(const TextureAtlas& atlas, std::size_t region, float transform[4]);
+
+// binary .atlas file: header, region table, level 0 pixels. Read through a memory mapping
+bool write_texture_atlas(const std::string& path, const TextureAtlas& atlas);
+bool read_texture_atlas(const std::string& path, TextureAtlas& atlas);
+
+// GL thread: upload the layers with their mip chain (ATLAS_MIP_LEVELS levels when layers
+// are shared, all of them otherwise), returns the texture (0 for an empty atlas)
+GLuint create_texture_array(const TextureAtlas& atlas);
+
+// std140 layout of the Materials uniform block of Shaders/atlas.frag: a material blends two
+// images of the texture array, the instances pick one by index
+//		struct Material { vec4 uvA; vec4 uvB; vec4 layers; };
+//		layout (std140) uniform Materials { Material uMaterials[MAX_MATERIALS]; };
+constexpr std::size_t MAX_MATERIALS = 64;
+
+struct MaterialEntry
+{
+	float uvA[4];		// atlas_uv_transform of image A
+	float uvB[4];
+	float layers[4];	// layer of image A (x) and B (y)
+};
+
+struct MaterialBlock
+{
+	MaterialEntry materials[MAX_MATERIALS];
+};
+
+static_assert(sizeof(MaterialBlock) == MAX_MATERIALS * 48, "MaterialBlock must match the std140 layout of the Materials block");
+
+// the material blending regions a and b of the atlas
+MaterialEntry make_material(const TextureAtlas& atlas, std::size_t a, std::size_t b);
+
+// upload the table to a new uniform buffer bound to MATERIAL_BLOCK_BINDING, returns the buffer
+GLuint create_material_buffer(const MaterialBlock& block);
@@ -0,0 +1,936 @@
+#include "TextureCompression.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// up to 16 texels of a block as floats, one array per channel (count is 8 or 16)
+	struct Texels
+	{
+		float r[16], g[16], b[16], a[16];
+		int count;
+	};
+
+	using Palette = float[16][4];
+
+	// the 4x4 block at (bx, by), texels past the image edges repeat the last row and column
+	void load_block(const unsigned char* rgba, const int width, const int height, const int bx, const int by, Texels& texels)
+	{
+		for (int y = 0; y < 4; ++y)
+		{
+			const int sy = std::min(by * 4 + y, height - 1);
+			for (int x = 0; x < 4; ++x)
+			{
+				const int sx = std::min(bx * 4 + x, width - 1);
+				const unsigned char* texel = rgba + (static_cast<std::size_t>(sy) * width + sx) * 4;
+				const int i = y * 4 + x;
+				texels.r[i] = texel[0];
+				texels.g[i] = texel[1];
+				texels.b[i] = texel[2];
+				texels.a[i] = texel[3];
+			}
+		}
+		texels.count = 16;
+	}
+
+	void store_block(const unsigned char decoded[16][4], unsigned char* rgba, const int width, const int height, const int bx, const int by)
+	{
+		for (int y = 0; y < 4 && by * 4 + y < height; ++y)
+		{
+			for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+			{
+				std::memcpy(rgba + ((static_cast<std::size_t>(by) * 4 + y) * width + bx * 4 + x) * 4, decoded[y * 4 + x], 4);
+			}
+		}
+	}
+
+	float fit_indices_scalar(const Texels& texels, const Palette& palette, const int paletteSize, const bool withAlpha, unsigned char* indices)
+	{
+		const float alphaWeight = withAlpha ? 1.0f : 0.0f;
+		float total = 0.0f;
+		for (int i = 0; i < texels.count; ++i)
+		{
+			float best = 1e30f;
+			int bestIndex = 0;
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				const float dr = texels.r[i] - palette[p][0];
+				const float dg = texels.g[i] - palette[p][1];
+				const float db = texels.b[i] - palette[p][2];
+				const float da = (texels.a[i] - palette[p][3]) * alphaWeight;
+				const float d = dr * dr + dg * dg + db * db + da * da;
+				if (d < best)
+				{
+					best = d;
+					bestIndex = p;
+				}
+			}
+			indices[i] = static_cast<unsigned char>(bestIndex);
+			total += best;
+		}
+		return total;
+	}
+
+#if CPU_X86
+	// 4 texels against one palette entry at a time
+	float fit_indices_sse2(const Texels& texels, const Palette& palette, const int paletteSize, const bool withAlpha, unsigned char* indices)
+	{
+		const __m128 alphaWeight = _mm_set1_ps(withAlpha ? 1.0f : 0.0f);
+		float total = 0.0f;
+		for (int i = 0; i < texels.count; i += 4)
+		{
+			const __m128 r = _mm_loadu_ps(texels.r + i);
+			const __m128 g = _mm_loadu_ps(texels.g + i);
+			const __m128 b = _mm_loadu_ps(texels.b + i);
+			const __m128 a = _mm_loadu_ps(texels.a + i);
+			__m128 best = _mm_set1_ps(1e30f);
+			__m128 bestIndex = _mm_setzero_ps();
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+				const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+				const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+				const __m128 da = _mm_mul_ps(_mm_sub_ps(a, _mm_set1_ps(palette[p][3])), alphaWeight);
+				const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+				const __m128 closer = _mm_cmplt_ps(d, best);
+				best = _mm_min_ps(d, best);
+				bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(p))), _mm_andnot_ps(closer, bestIndex));
+			}
+
+			alignas(16) float bests[4], chosen[4];
+			_mm_store_ps(bests, best);
+			_mm_store_ps(chosen, bestIndex);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				indices[i + lane] = static_cast<unsigned char>(chosen[lane]);
+				total += bests[lane];
+			}
+		}
+		return total;
+	}
+#endif
+
+	// the closest palette entry of every texel, returns the summed squared error
+	float fit_indices(const Texels& texels, const Palette& palette, const int paletteSize, const bool withAlpha, unsigned char* indices)
+	{
+#if CPU_X86
+		if (cpu_features().sse2)
+		{
+			return fit_indices_sse2(texels, palette, paletteSize, withAlpha, indices);
+		}
+#endif
+		return fit_indices_scalar(texels, palette, paletteSize, withAlpha, indices);
+	}
+
+	// mean and principal axis of the texel colors (power iteration on the covariance), over
+	// the first channels only (3 or 4). The axis is zero for a flat block
+	void principal_axis(const Texels& texels, const int channels, float mean[4], float axis[4])
+	{
+		const float* values[4] = { texels.r, texels.g, texels.b, texels.a };
+		for (int c = 0; c < 4; ++c)
+		{
+			mean[c] = 0.0f;
+			axis[c] = 0.0f;
+			if (c < channels)
+			{
+				for (int i = 0; i < texels.count; ++i)
+				{
+					mean[c] += values[c][i];
+				}
+				mean[c] /= static_cast<float>(texels.count);
+			}
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < texels.count; ++i)
+		{
+			for (int c = 0; c < channels; ++c)
+			{
+				for (int d = c; d < channels; ++d)
+				{
+					covariance[c][d] += (values[c][i] - mean[c]) * (values[d][i] - mean[d]);
+				}
+			}
+		}
+		for (int c = 0; c < channels; ++c)
+		{
+			for (int d = 0; d < c; ++d)
+			{
+				covariance[c][d] = covariance[d][c];
+			}
+		}
+
+		float v[4] = { 1.0f, 0.9f, 0.8f, 0.7f };
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int c = 0; c < channels; ++c)
+			{
+				for (int d = 0; d < channels; ++d)
+				{
+					next[c] += covariance[c][d] * v[d];
+				}
+				length += next[c] * next[c];
+			}
+			if (length < 1e-12f)
+			{
+				return;
+			}
+			length = 1.0f / std::sqrt(length);
+			for (int c = 0; c < channels; ++c)
+			{
+				v[c] = next[c] * length;
+			}
+		}
+		for (int c = 0; c < channels; ++c)
+		{
+			axis[c] = v[c];
+		}
+	}
+
+	// the texels projected on the axis: the two extreme colors of the block
+	void axis_endpoints(const Texels& texels, const int channels, float e0[4], float e1[4])
+	{
+		float mean[4], axis[4];
+		principal_axis(texels, channels, mean, axis);
+		float lowest = 0.0f, highest = 0.0f;
+		for (int i = 0; i < texels.count; ++i)
+		{
+			const float t = (texels.r[i] - mean[0]) * axis[0] + (texels.g[i] - mean[1]) * axis[1] + (texels.b[i] - mean[2]) * axis[2] + (texels.a[i] - mean[3]) * axis[3];
+			lowest = std::min(lowest, t);
+			highest = std::max(highest, t);
+		}
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = std::min(std::max(mean[c] + lowest * axis[c], 0.0f), 255.0f);
+			e1[c] = std::min(std::max(mean[c] + highest * axis[c], 0.0f), 255.0f);
+		}
+	}
+
+	// the endpoints that best reproduce the texels with the chosen palette weights (least squares),
+	// false when the weights can't tell the endpoints apart
+	bool refine_endpoints(const Texels& texels, const unsigned char* indices, const float* weights, float e0[4], float e1[4])
+	{
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		const float* values[4] = { texels.r, texels.g, texels.b, texels.a };
+		for (int i = 0; i < texels.count; ++i)
+		{
+			const float w = weights[indices[i]];
+			aa += (1.0f - w) * (1.0f - w);
+			bb += w * w;
+			ab += (1.0f - w) * w;
+			for (int c = 0; c < 4; ++c)
+			{
+				ax[c] += (1.0f - w) * values[c][i];
+				bx[c] += w * values[c][i];
+			}
+		}
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			e1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	int quantize(const float value, const int maximum)
+	{
+		return std::min(std::max(static_cast<int>(value * static_cast<float>(maximum) / 255.0f + 0.5f), 0), maximum);
+	}
+
+	std::uint16_t pack_565(const float color[4])
+	{
+		return static_cast<std::uint16_t>(quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5 | quantize(color[2], 31));
+	}
+
+	void unpack_565(const std::uint16_t packed, int color[3])
+	{
+		const int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// the four colors of a BC1 block, the 3 color mode when c0 <= c1 and allowed
+	void bc1_palette(const std::uint16_t c0, const std::uint16_t c1, const bool threeColorMode, int palette[4][3])
+	{
+		unpack_565(c0, palette[0]);
+		unpack_565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			if (c0 > c1 || !threeColorMode)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	void encode_bc1_color(const Texels& texels, unsigned char* out)
+	{
+		static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		float e0[4], e1[4];
+		axis_endpoints(texels, 3, e1, e0); // the brighter end first, so c0 > c1 usually holds
+
+		std::uint16_t best0 = 0, best1 = 0;
+		unsigned char bestIndices[16] = {}, indices[16];
+		float bestError = 1e30f;
+		for (int iteration = 0; iteration < 3; ++iteration)
+		{
+			const std::uint16_t c0 = pack_565(e0), c1 = pack_565(e1);
+			int colors[4][3];
+			bc1_palette(c0, c1, false, colors);
+			Palette palette = {};
+			for (int p = 0; p < 4; ++p)
+			{
+				palette[p][0] = static_cast<float>(colors[p][0]);
+				palette[p][1] = static_cast<float>(colors[p][1]);
+				palette[p][2] = static_cast<float>(colors[p][2]);
+			}
+			const float error = fit_indices(texels, palette, 4, false, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				best0 = c0;
+				best1 = c1;
+				std::memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f || !refine_endpoints(texels, indices, weights, e0, e1))
+			{
+				break;
+			}
+		}
+
+		// 4 color mode needs c0 > c1: swapping the endpoints swaps 0 with 1 and 2 with 3
+		if (best0 < best1)
+		{
+			std::swap(best0, best1);
+			for (unsigned char& index : bestIndices)
+			{
+				index ^= 1;
+			}
+		}
+		else if (best0 == best1)
+		{
+			std::memset(bestIndices, 0, sizeof(bestIndices));
+		}
+
+		std::uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= static_cast<std::uint32_t>(bestIndices[i]) << (2 * i);
+		}
+		out[0] = static_cast<unsigned char>(best0);
+		out[1] = static_cast<unsigned char>(best0 >> 8);
+		out[2] = static_cast<unsigned char>(best1);
+		out[3] = static_cast<unsigned char>(best1 >> 8);
+		for (int i = 0; i < 4; ++i)
+		{
+			out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+		}
+	}
+
+	void decode_bc1_color(const unsigned char* in, const bool threeColorMode, unsigned char decoded[16][4])
+	{
+		const auto c0 = static_cast<std::uint16_t>(in[0] | in[1] << 8);
+		const auto c1 = static_cast<std::uint16_t>(in[2] | in[3] << 8);
+		const std::uint32_t bits = in[4] | in[5] << 8 | in[6] << 16 | static_cast<std::uint32_t>(in[7]) << 24;
+		int palette[4][3];
+		bc1_palette(c0, c1, threeColorMode, palette);
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* color = palette[(bits >> (2 * i)) & 3];
+			decoded[i][0] = static_cast<unsigned char>(color[0]);
+			decoded[i][1] = static_cast<unsigned char>(color[1]);
+			decoded[i][2] = static_cast<unsigned char>(color[2]);
+		}
+	}
+
+	// the eight alphas of a BC3 alpha block, the 6 value mode (with 0 and 255) when a0 <= a1
+	void bc3_alpha_palette(const int a0, const int a1, int palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	void encode_bc3_alpha(const Texels& texels, unsigned char* out)
+	{
+		float lowest = 255.0f, highest = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			lowest = std::min(lowest, texels.a[i]);
+			highest = std::max(highest, texels.a[i]);
+		}
+		const int a0 = static_cast<int>(highest + 0.5f);
+		const int a1 = static_cast<int>(lowest + 0.5f);
+		int palette[8];
+		bc3_alpha_palette(a0, a1, palette);
+
+		std::uint64_t bits = 0;
+		for (int i = 0; i < 16 && a0 != a1; ++i)
+		{
+			int bestIndex = 0;
+			float best = 1e30f;
+			for (int p = 0; p < 8; ++p)
+			{
+				const float d = std::fabs(texels.a[i] - static_cast<float>(palette[p]));
+				if (d < best)
+				{
+					best = d;
+					bestIndex = p;
+				}
+			}
+			bits |= static_cast<std::uint64_t>(bestIndex) << (3 * i);
+		}
+		out[0] = static_cast<unsigned char>(a0);
+		out[1] = static_cast<unsigned char>(a1);
+		for (int i = 0; i < 6; ++i)
+		{
+			out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+		}
+	}
+
+	void decode_bc3_alpha(const unsigned char* in, unsigned char decoded[16][4])
+	{
+		int palette[8];
+		bc3_alpha_palette(in[0], in[1], palette);
+		std::uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			bits |= static_cast<std::uint64_t>(in[2 + i]) << (8 * i);
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			decoded[i][3] = static_cast<unsigned char>(palette[(bits >> (3 * i)) & 7]);
+		}
+	}
+
+	// BC7 mode 6: 7 bit endpoints plus a low bit shared by the four channels of each endpoint
+	const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	int bc7_interpolate(const int e0, const int e1, const int weight)
+	{
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	// least significant bit first, like the BC7 block layout
+	struct BitWriter
+	{
+		unsigned char* bytes;
+		int position;
+
+		void write(const std::uint32_t value, const int bits)
+		{
+			for (int i = 0; i < bits; ++i, ++position)
+			{
+				bytes[position >> 3] |= static_cast<unsigned char>(((value >> i) & 1) << (position & 7));
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const unsigned char* bytes;
+		int position;
+
+		std::uint32_t read(const int bits)
+		{
+			std::uint32_t value = 0;
+			for (int i = 0; i < bits; ++i, ++position)
+			{
+				value |= static_cast<std::uint32_t>((bytes[position >> 3] >> (position & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	void encode_bc7_mode6(const Texels& texels, unsigned char* out)
+	{
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			weights[i] = static_cast<float>(bc7Weights[i]) / 64.0f;
+		}
+
+		float e0[4], e1[4];
+		axis_endpoints(texels, 4, e0, e1);
+
+		int best[2][4] = {}, bestParity[2] = {};
+		unsigned char bestIndices[16] = {}, indices[16];
+		float bestError = 1e30f;
+		for (int iteration = 0; iteration < 3; ++iteration)
+		{
+			// every choice of the two low bits, the endpoints rounded around them
+			float iterationError = 1e30f;
+			unsigned char iterationIndices[16] = {};
+			for (int parity = 0; parity < 4; ++parity)
+			{
+				const int p0 = parity & 1, p1 = parity >> 1;
+				int q[2][4];
+				Palette palette = {};
+				for (int c = 0; c < 4; ++c)
+				{
+					q[0][c] = std::min(std::max(static_cast<int>((e0[c] - static_cast<float>(p0)) / 2.0f + 0.5f), 0), 127);
+					q[1][c] = std::min(std::max(static_cast<int>((e1[c] - static_cast<float>(p1)) / 2.0f + 0.5f), 0), 127);
+					const int v0 = q[0][c] << 1 | p0, v1 = q[1][c] << 1 | p1;
+					for (int p = 0; p < 16; ++p)
+					{
+						palette[p][c] = static_cast<float>(bc7_interpolate(v0, v1, bc7Weights[p]));
+					}
+				}
+				const float error = fit_indices(texels, palette, 16, true, indices);
+				if (error < iterationError)
+				{
+					iterationError = error;
+					std::memcpy(iterationIndices, indices, sizeof(indices));
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					std::memcpy(best, q, sizeof(q));
+					bestParity[0] = p0;
+					bestParity[1] = p1;
+					std::memcpy(bestIndices, indices, sizeof(indices));
+				}
+			}
+			if (bestError == 0.0f || !refine_endpoints(texels, iterationIndices, weights, e0, e1))
+			{
+				break;
+			}
+		}
+
+		// the first index is stored without its top bit: it must be below 8
+		if (bestIndices[0] >= 8)
+		{
+			std::swap(best[0], best[1]);
+			std::swap(bestParity[0], bestParity[1]);
+			for (unsigned char& index : bestIndices)
+			{
+				index = static_cast<unsigned char>(15 - index);
+			}
+		}
+
+		std::memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.write(1u << 6, 7); // mode 6
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.write(static_cast<std::uint32_t>(best[0][c]), 7);
+			writer.write(static_cast<std::uint32_t>(best[1][c]), 7);
+		}
+		writer.write(static_cast<std::uint32_t>(bestParity[0]), 1);
+		writer.write(static_cast<std::uint32_t>(bestParity[1]), 1);
+		for (int i = 0; i < 16; ++i)
+		{
+			writer.write(bestIndices[i], i == 0 ? 3 : 4);
+		}
+	}
+
+	void decode_bc7(const unsigned char* in, unsigned char decoded[16][4])
+	{
+		if ((in[0] & 0x7F) != 1u << 6)
+		{
+			// not mode 6: magenta, so it shows
+			for (int i = 0; i < 16; ++i)
+			{
+				decoded[i][0] = 255;
+				decoded[i][1] = 0;
+				decoded[i][2] = 255;
+				decoded[i][3] = 255;
+			}
+			return;
+		}
+
+		BitReader reader = { in, 7 };
+		int endpoints[2][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] = static_cast<int>(reader.read(7));
+			endpoints[1][c] = static_cast<int>(reader.read(7));
+		}
+		const int p0 = static_cast<int>(reader.read(1));
+		const int p1 = static_cast<int>(reader.read(1));
+		for (int c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] = endpoints[0][c] << 1 | p0;
+			endpoints[1][c] = endpoints[1][c] << 1 | p1;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			const int weight = bc7Weights[reader.read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; ++c)
+			{
+				decoded[i][c] = static_cast<unsigned char>(bc7_interpolate(endpoints[0][c], endpoints[1][c], weight));
+			}
+		}
+	}
+
+	// ETC1 intensity modifiers: pixel index 0 adds the small one, 1 the large one, 2 and 3 subtract them
+	const int etcModifiers[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+
+	int etc_modifier(const int table, const int index)
+	{
+		const int modifier = etcModifiers[table][index & 1];
+		return (index & 2) != 0 ? -modifier : modifier;
+	}
+
+	// the texels of a half block: the left and right 2x4 halves, or the top and bottom 4x2 ones when flipped
+	bool in_half(const int texel, const bool flip, const int half)
+	{
+		const int x = texel & 3, y = texel >> 2;
+		return ((flip ? y : x) >= 2) == (half == 1);
+	}
+
+	// best intensity table of a half block around base, returns its error
+	float fit_etc_half(const Texels& half, const int base[3], int& table, unsigned char* indices)
+	{
+		float bestError = 1e30f;
+		unsigned char candidate[16];
+		for (int t = 0; t < 8; ++t)
+		{
+			Palette palette = {};
+			for (int p = 0; p < 4; ++p)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					palette[p][c] = static_cast<float>(std::min(std::max(base[c] + etc_modifier(t, p), 0), 255));
+				}
+			}
+			const float error = fit_indices(half, palette, 4, false, candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				table = t;
+				std::memcpy(indices, candidate, static_cast<std::size_t>(half.count));
+			}
+		}
+		return bestError;
+	}
+
+	void encode_etc2_rgb(const Texels& texels, unsigned char* out)
+	{
+		float bestError = 1e30f;
+		std::uint32_t bestHigh = 0, bestLow = 0;
+		for (int flip = 0; flip < 2; ++flip)
+		{
+			Texels halves[2];
+			int texelOf[2][8];
+			float average[2][3] = {};
+			for (int h = 0; h < 2; ++h)
+			{
+				halves[h].count = 0;
+				for (int i = 0; i < 16; ++i)
+				{
+					if (in_half(i, flip != 0, h))
+					{
+						const int n = halves[h].count++;
+						texelOf[h][n] = i;
+						halves[h].r[n] = texels.r[i];
+						halves[h].g[n] = texels.g[i];
+						halves[h].b[n] = texels.b[i];
+						halves[h].a[n] = 255.0f;
+						average[h][0] += texels.r[i] / 8.0f;
+						average[h][1] += texels.g[i] / 8.0f;
+						average[h][2] += texels.b[i] / 8.0f;
+					}
+				}
+			}
+
+			// differential mode when the 5 bit base colors are close enough, individual 4 bit ones always
+			for (int differential = 1; differential >= 0; --differential)
+			{
+				int stored[2][3], base[2][3];
+				bool fits = true;
+				for (int h = 0; h < 2; ++h)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						stored[h][c] = quantize(average[h][c], differential ? 31 : 15);
+						base[h][c] = differential ? (stored[h][c] << 3 | stored[h][c] >> 2) : (stored[h][c] << 4 | stored[h][c]);
+					}
+				}
+				for (int c = 0; c < 3 && differential; ++c)
+				{
+					const int delta = stored[1][c] - stored[0][c];
+					fits = fits && delta >= -4 && delta <= 3;
+				}
+				if (!fits)
+				{
+					continue;
+				}
+
+				int tables[2] = {};
+				unsigned char indices[2][8];
+				const float error = fit_etc_half(halves[0], base[0], tables[0], indices[0]) + fit_etc_half(halves[1], base[1], tables[1], indices[1]);
+				if (error >= bestError)
+				{
+					continue;
+				}
+				bestError = error;
+
+				if (differential)
+				{
+					bestHigh = static_cast<std::uint32_t>(stored[0][0] << 27 | ((stored[1][0] - stored[0][0]) & 7) << 24
+						| stored[0][1] << 19 | ((stored[1][1] - stored[0][1]) & 7) << 16
+						| stored[0][2] << 11 | ((stored[1][2] - stored[0][2]) & 7) << 8);
+				}
+				else
+				{
+					bestHigh = static_cast<std::uint32_t>(stored[0][0] << 28 | stored[1][0] << 24 | stored[0][1] << 20 | stored[1][1] << 16 | stored[0][2] << 12 | stored[1][2] << 8);
+				}
+				bestHigh |= static_cast<std::uint32_t>(tables[0] << 5 | tables[1] << 2 | differential << 1 | flip);
+
+				// pixel index bits column by column: the high bits in the upper half, the low ones below
+				bestLow = 0;
+				for (int h = 0; h < 2; ++h)
+				{
+					for (int n = 0; n < 8; ++n)
+					{
+						const int texel = texelOf[h][n];
+						const int bit = (texel & 3) * 4 + (texel >> 2);
+						bestLow |= static_cast<std::uint32_t>(indices[h][n] >> 1) << (16 + bit) | static_cast<std::uint32_t>(indices[h][n] & 1) << bit;
+					}
+				}
+			}
+		}
+
+		// big endian
+		for (int i = 0; i < 4; ++i)
+		{
+			out[i] = static_cast<unsigned char>(bestHigh >> (24 - 8 * i));
+			out[4 + i] = static_cast<unsigned char>(bestLow >> (24 - 8 * i));
+		}
+	}
+
+	int sign_extend_3(const int value)
+	{
+		return value >= 4 ? value - 8 : value;
+	}
+
+	void decode_etc2_rgb(const unsigned char* in, unsigned char decoded[16][4])
+	{
+		const std::uint32_t high = static_cast<std::uint32_t>(in[0]) << 24 | in[1] << 16 | in[2] << 8 | in[3];
+		const std::uint32_t low = static_cast<std::uint32_t>(in[4]) << 24 | in[5] << 16 | in[6] << 8 | in[7];
+		const bool differential = (high >> 1) & 1;
+		const bool flip = high & 1;
+
+		int base[2][3];
+		for (int c = 0; c < 3; ++c)
+		{
+			const int shift = 27 - 8 * c;
+			if (differential)
+			{
+				const int first = (high >> shift) & 31;
+				const int second = first + sign_extend_3((high >> (shift - 3)) & 7);
+				if (second < 0 || second > 31)
+				{
+					// the ETC2 T, H and planar modes, never written by the encoder: magenta
+					for (int i = 0; i < 16; ++i)
+					{
+						decoded[i][0] = 255;
+						decoded[i][1] = 0;
+						decoded[i][2] = 255;
+					}
+					return;
+				}
+				base[0][c] = first << 3 | first >> 2;
+				base[1][c] = second << 3 | second >> 2;
+			}
+			else
+			{
+				const int first = (high >> (shift + 1)) & 15;
+				const int second = (high >> (shift - 3)) & 15;
+				base[0][c] = first << 4 | first;
+				base[1][c] = second << 4 | second;
+			}
+		}
+		const int tables[2] = { static_cast<int>((high >> 5) & 7), static_cast<int>((high >> 2) & 7) };
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int half = in_half(i, flip, 1) ? 1 : 0;
+			const int bit = (i & 3) * 4 + (i >> 2);
+			const int index = static_cast<int>(((low >> (16 + bit)) & 1) << 1 | ((low >> bit) & 1));
+			for (int c = 0; c < 3; ++c)
+			{
+				decoded[i][c] = static_cast<unsigned char>(std::min(std::max(base[half][c] + etc_modifier(tables[half], index), 0), 255));
+			}
+		}
+	}
+
+	void encode_block(const BlockFormat format, const Texels& texels, unsigned char* out)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: encode_bc1_color(texels, out); break;
+		case BlockFormat::BC3: encode_bc3_alpha(texels, out); encode_bc1_color(texels, out + 8); break;
+		case BlockFormat::BC7: encode_bc7_mode6(texels, out); break;
+		case BlockFormat::ETC2: encode_etc2_rgb(texels, out); break;
+		}
+	}
+
+	void decode_block(const BlockFormat format, const unsigned char* in, unsigned char decoded[16][4])
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			decoded[i][3] = 255;
+		}
+		switch (format)
+		{
+		case BlockFormat::BC1: decode_bc1_color(in, true, decoded); break;
+		case BlockFormat::BC3: decode_bc3_alpha(in, decoded); decode_bc1_color(in + 8, false, decoded); break;
+		case BlockFormat::BC7: decode_bc7(in, decoded); break;
+		case BlockFormat::ETC2: decode_etc2_rgb(in, decoded); break;
+		}
+	}
+}
+
+char const* block_format_name(const BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC3: return "BC3";
+	case BlockFormat::BC7: return "BC7";
+	case BlockFormat::ETC2: return "ETC2";
+	}
+	return "unknown";
+}
+
+bool parse_block_format(char const* name, BlockFormat& format)
+{
+	for (const BlockFormat candidate : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7, BlockFormat::ETC2 })
+	{
+		const char* expected = block_format_name(candidate);
+		std::size_t i = 0;
+		while (expected[i] != '\0' && std::tolower(static_cast<unsigned char>(name[i])) == std::tolower(static_cast<unsigned char>(expected[i])))
+		{
+			++i;
+		}
+		if (expected[i] == '\0' && name[i] == '\0')
+		{
+			format = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::size_t block_bytes(const BlockFormat format)
+{
+	return format == BlockFormat::BC3 || format == BlockFormat::BC7 ? 16 : 8;
+}
+
+std::size_t compressed_size(const BlockFormat format, const int width, const int height)
+{
+	return static_cast<std::size_t>((width + 3) / 4) * static_cast<std::size_t>((height + 3) / 4) * block_bytes(format);
+}
+
+bool block_format_has_alpha(const BlockFormat format)
+{
+	return format == BlockFormat::BC3 || format == BlockFormat::BC7;
+}
+
+void compress_image(const BlockFormat format, const unsigned char* rgba, const int width, const int height, unsigned char* blocks, JobSystem* jobs)
+{
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+	const std::size_t rowBytes = static_cast<std::size_t>(blocksWide) * block_bytes(format);
+	const std::function<void(std::size_t, std::size_t)> encode_rows = [&](const std::size_t begin, const std::size_t end)
+	{
+		Texels texels;
+		for (std::size_t by = begin; by < end; ++by)
+		{
+			for (int bx = 0; bx < blocksWide; ++bx)
+			{
+				load_block(rgba, width, height, bx, static_cast<int>(by), texels);
+				encode_block(format, texels, blocks + by * rowBytes + bx * block_bytes(format));
+			}
+		}
+	};
+
+	if (jobs != nullptr)
+	{
+		JobCounter encoded;
+		jobs->parallelFor(static_cast<std::size_t>(blocksHigh), 1, encode_rows, encoded);
+		jobs->wait(encoded);
+	}
+	else
+	{
+		encode_rows(0, static_cast<std::size_t>(blocksHigh));
+	}
+}
+
+void decompress_image(const BlockFormat format, const unsigned char* blocks, const int width, const int height, unsigned char* rgba)
+{
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+	unsigned char decoded[16][4];
+	for (int by = 0; by < blocksHigh; ++by)
+	{
+		for (int bx = 0; bx < blocksWide; ++bx)
+		{
+			decode_block(format, blocks + (static_cast<std::size_t>(by) * blocksWide + bx) * block_bytes(format), decoded);
+			store_block(decoded, rgba, width, height, bx, by);
+		}
+	}
+}
+
+ImageQuality compare_images(const unsigned char* a, const unsigned char* b, const std::size_t count)
+{
+	double rgb = 0.0, alpha = 0.0;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			const double d = static_cast<double>(a[i * 4 + c]) - static_cast<double>(b[i * 4 + c]);
+			(c < 3 ? rgb : alpha) += d * d;
+		}
+	}
+
+	const auto psnr = [](const double squaredError, const double samples)
+	{
+		const double mse = squaredError / samples;
+		return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+	};
+	return { psnr(rgb, 3.0 * static_cast<double>(count)), psnr(alpha, static_cast<double>(count)) };
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+
+class JobSystem;
+
+// CPU encoders and decoders of the block compressed texture formats, every one a 4x4 texel
+// block at a fixed size:
+//		BC1		8 bytes, RGB: two RGB565 endpoints and 2 bit indices (4 bits per texel)
+//		BC3		16 bytes, RGBA: a BC1 color block after a block of two alpha endpoints and 3 bit indices
+//		BC7		16 bytes, RGBA: written in mode 6 only, two RGBA 7.7.7.7 endpoints with a shared
+//				low bit each and 4 bit indices; the decoder reads mode 6 only as well
+//		ETC2	8 bytes, RGB: written in the ETC1 individual and differential modes (which ETC2
+//				decodes the same way), two half blocks with a base color and an intensity table each
+// The encoders fit the endpoints along the principal axis of the block colors and refine them
+// by least squares, the texel to palette search runs 4 texels at a time with SSE2.
+enum class BlockFormat
+{
+	BC1,
+	BC3,
+	BC7,
+	ETC2
+};
+
+// "BC1", ... and back, false for an unknown name
+char const* block_format_name(BlockFormat format);
+bool parse_block_format(char const* name, BlockFormat& format);
+
+// bytes per 4x4 block
+std::size_t block_bytes(BlockFormat format);
+
+// bytes of a width x height image, partial blocks on the right and top edges count whole
+std::size_t compressed_size(BlockFormat format, int width, int height);
+
+// does the format keep alpha?
+bool block_format_has_alpha(BlockFormat format);
+
+// RGBA8 width x height (texels outside a partial block repeat the edge) to blocks, row of
+// blocks after row of blocks. Rows of blocks are spread over the jobs when given
+void compress_image(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* blocks, JobSystem* jobs = nullptr);
+
+// blocks back to RGBA8 (alpha 255 for the formats without it)
+void decompress_image(BlockFormat format, const unsigned char* blocks, int width, int height, unsigned char* rgba);
+
+// peak signal to noise ratio of b against a over count RGBA8 texels, in dB
+// (the RGB channels together, alpha on its own), 99 for identical images
+struct ImageQuality
+{
+	double psnrRgb;
+	double psnrAlpha;
+};
+
+ImageQuality compare_images(const unsigned char* a, const unsigned char* b, std::size_t count);
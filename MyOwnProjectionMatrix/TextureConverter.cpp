@@ -0,0 +1,94 @@
+#include "TextureConverter.h"
+#include "JobSystem.h"
+#include "Ktx2File.h"
+#include "TextureLoader.h"
+#include <stb/stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double elapsed_ms(const Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+bool convert_texture(std::string const& inputPath, std::string const& outputPath, const BlockFormat format, TextureConversionReport& report)
+{
+	report = TextureConversionReport();
+	const Clock::time_point decodeStart = Clock::now();
+
+	int width = 0, height = 0, channels = 0;
+	unsigned char* data = stbi_load(inputPath.c_str(), &width, &height, &channels, 4);
+	if (data == nullptr)
+	{
+		std::cout << "ERROR LOADING TEXTURE DATA: " << inputPath << std::endl;
+		return false;
+	}
+
+	// level 0 bottom up like the TextureLoader uploads it, then the chain down to 1x1
+	std::vector<std::vector<unsigned char>> levels(1);
+	const std::size_t rowBytes = static_cast<std::size_t>(width) * 4;
+	levels[0].resize(rowBytes * height);
+	for (int y = 0; y < height; ++y)
+	{
+		std::memcpy(&levels[0][y * rowBytes], data + (height - 1 - y) * rowBytes, rowBytes);
+	}
+	stbi_image_free(data);
+
+	int w = width, h = height;
+	while (w > 1 || h > 1)
+	{
+		std::vector<unsigned char> next(static_cast<std::size_t>(std::max(w / 2, 1)) * std::max(h / 2, 1) * 4);
+		downsample_image(levels.back().data(), w, h, 4, next.data());
+		levels.push_back(std::move(next));
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+	}
+	report.width = width;
+	report.height = height;
+	report.levels = levels.size();
+	report.decodeMs = elapsed_ms(decodeStart);
+
+	const Clock::time_point encodeStart = Clock::now();
+	JobSystem jobs;
+	report.workers = jobs.getWorkerCount();
+	CompressedTexture texture;
+	texture.format = format;
+	texture.width = width;
+	texture.height = height;
+	texture.levels.resize(levels.size());
+	w = width;
+	h = height;
+	for (std::size_t level = 0; level < levels.size(); ++level)
+	{
+		texture.levels[level].resize(compressed_size(format, w, h));
+		compress_image(format, levels[level].data(), w, h, texture.levels[level].data(), &jobs);
+		report.sourceBytes += levels[level].size();
+		report.compressedBytes += texture.levels[level].size();
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+	}
+	report.encodeMs = elapsed_ms(encodeStart);
+
+	std::vector<unsigned char> decoded(levels[0].size());
+	decompress_image(format, texture.levels[0].data(), width, height, decoded.data());
+	report.quality = compare_images(levels[0].data(), decoded.data(), static_cast<std::size_t>(width) * height);
+
+	const Clock::time_point writeStart = Clock::now();
+	if (!write_ktx2(outputPath, texture))
+	{
+		return false;
+	}
+	std::error_code error;
+	report.fileBytes = static_cast<std::size_t>(std::filesystem::file_size(outputPath, error));
+	report.writeMs = elapsed_ms(writeStart);
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "TextureCompression.h"
+#include <cstddef>
+#include <string>
+
+// Offline conversion of an image (anything stb_image decodes) into a block compressed KTX2
+// file with its whole mip chain (see Ktx2File.h), run with:
+//		MyOwnProjectionMatrix --compress-texture wall.jpg wall.ktx2 bc7
+// The image is flipped bottom up and the levels are built with the 2x2 box filter the
+// TextureLoader uses, then every level is encoded on a JobSystem. Level 0 is decoded back on
+// the CPU to measure what the encoding cost.
+struct TextureConversionReport
+{
+	int width;
+	int height;
+	std::size_t levels;
+	unsigned int workers;
+	std::size_t sourceBytes;		// RGBA8, every level
+	std::size_t compressedBytes;	// every level
+	std::size_t fileBytes;
+	ImageQuality quality;			// of level 0
+	double decodeMs;
+	double encodeMs;
+	double writeMs;
+};
+
+// false (with a message) when the image can't be read or the file can't be written
+bool convert_texture(std::string const& inputPath, std::string const& outputPath, BlockFormat format, TextureConversionReport& report);
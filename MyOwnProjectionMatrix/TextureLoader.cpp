@@ -0,0 +1,445 @@
+#include "TextureLoader.h"
+#include "Ktx2File.h"
+#include "Profiler.h"
+#include <stb/stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	double elapsed_ms(const std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+void downsample_image(const unsigned char* src, const int w, const int h, const int channels, unsigned char* dst)
+{
+	const int dw = std::max(w / 2, 1);
+	const int dh = std::max(h / 2, 1);
+	for (int y = 0; y < dh; ++y)
+	{
+		const unsigned char* row0 = src + static_cast<std::size_t>(std::min(2 * y, h - 1)) * w * channels;
+		const unsigned char* row1 = src + static_cast<std::size_t>(std::min(2 * y + 1, h - 1)) * w * channels;
+		for (int x = 0; x < dw; ++x)
+		{
+			const int x0 = std::min(2 * x, w - 1) * channels;
+			const int x1 = std::min(2 * x + 1, w - 1) * channels;
+			for (int c = 0; c < channels; ++c)
+			{
+				const int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+				*dst++ = static_cast<unsigned char>((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+GLenum texture_pixel_format(const int channels)
+{
+	switch (channels)
+	{
+	case 1: return GL_RED;
+	case 2: return GL_RG;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+GLenum texture_internal_format(const int channels)
+{
+	switch (channels)
+	{
+	case 1: return GL_R8;
+	case 2: return GL_RG8;
+	case 3: return GL_RGB8;
+	default: return GL_RGBA8;
+	}
+}
+
+TextureLoader::TextureLoader(unsigned int workerCount) : pending(0), stopping(false), stats(), pixelBuffer(0)
+{
+	if (workerCount == 0)
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		workers.emplace_back(&TextureLoader::workerLoop, this);
+	}
+}
+
+TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	// images never uploaded resolve to no texture
+	for (std::unique_ptr<DecodedImage>& image : requests)
+	{
+		if (image->mipChainOnly)
+		{
+			image->mipChain.set_value(TextureMipChain());
+		}
+		else
+		{
+			image->texture.set_value(0);
+		}
+	}
+	for (std::unique_ptr<DecodedImage>& image : decoded)
+	{
+		image->texture.set_value(0);
+	}
+
+	glDeleteBuffers(1, &pixelBuffer);
+}
+
+std::future<GLuint> TextureLoader::load(const std::string& path, const TextureLoadOptions& options)
+{
+	std::unique_ptr<DecodedImage> image(new DecodedImage);
+	image->path = path;
+	image->options = options;
+	std::future<GLuint> texture = image->texture.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back(std::move(image));
+		++pending;
+	}
+	workAvailable.notify_one();
+	return texture;
+}
+
+std::future<TextureMipChain> TextureLoader::loadMipChain(const std::string& path, const TextureLoadOptions& options)
+{
+	std::unique_ptr<DecodedImage> image(new DecodedImage);
+	image->path = path;
+	image->options = options;
+	image->mipChainOnly = true;
+	std::future<TextureMipChain> mipChain = image->mipChain.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back(std::move(image));
+		++pending;
+	}
+	workAvailable.notify_one();
+	return mipChain;
+}
+
+std::size_t TextureLoader::pumpUploads(const std::size_t maxBytes)
+{
+	std::size_t uploaded = 0;
+	std::size_t bytes = 0;
+	while (bytes < maxBytes)
+	{
+		std::unique_ptr<DecodedImage> image;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (decoded.empty())
+			{
+				break;
+			}
+			image = std::move(decoded.front());
+			decoded.pop_front();
+		}
+
+		bytes += image->pixels.size();
+		upload(*image);
+		++uploaded;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		--pending;
+	}
+	return uploaded;
+}
+
+void TextureLoader::finish()
+{
+	while (getPendingCount() > 0)
+	{
+		if (pumpUploads() == 0)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			imageDecoded.wait(lock, [this] { return !decoded.empty() || pending == 0; });
+		}
+	}
+}
+
+std::size_t TextureLoader::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending;
+}
+
+unsigned int TextureLoader::getWorkerCount() const
+{
+	return static_cast<unsigned int>(workers.size());
+}
+
+TextureLoaderStats TextureLoader::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void TextureLoader::workerLoop()
+{
+	profiler_set_thread_name("texture worker");
+	while (true)
+	{
+		std::unique_ptr<DecodedImage> image;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [this] { return stopping || !requests.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			image = std::move(requests.front());
+			requests.pop_front();
+		}
+
+		decode(*image);
+
+		if (image->mipChainOnly)
+		{
+			TextureMipChain mipChain;
+			mipChain.width = image->width;
+			mipChain.height = image->height;
+			mipChain.channels = image->channels;
+			mipChain.compressedFormat = image->compressedFormat;
+			mipChain.pixels = std::move(image->pixels);
+			mipChain.levelOffsets = std::move(image->levelOffsets);
+			const bool failed = mipChain.pixels.empty();
+			image->mipChain.set_value(std::move(mipChain));
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				++(failed ? stats.texturesFailed : stats.texturesLoaded);
+				--pending;
+			}
+			imageDecoded.notify_all();
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(std::move(image));
+		}
+		imageDecoded.notify_all();
+	}
+}
+
+void TextureLoader::decode(DecodedImage& image)
+{
+	if (std::filesystem::path(image.path).extension() == ".ktx2")
+	{
+		decodeCompressed(image);
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned char* data;
+	{
+		PROFILE_SCOPE("decode image");
+		data = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channels, 0);
+	}
+	if (data == nullptr)
+	{
+		std::cout << "ERROR LOADING TEXTURE DATA: " << image.path << std::endl;
+		return;
+	}
+
+	// count the levels of the chain, down to 1x1
+	std::size_t totalBytes = 0;
+	int w = image.width;
+	int h = image.height;
+	while (true)
+	{
+		image.levelOffsets.push_back(totalBytes);
+		totalBytes += static_cast<std::size_t>(w) * h * image.channels;
+		if (!image.options.generateMipmaps || (w == 1 && h == 1))
+		{
+			break;
+		}
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+	}
+	image.pixels.resize(totalBytes);
+
+	// level 0, flipped while copied out of the stb buffer
+	const std::size_t rowBytes = static_cast<std::size_t>(image.width) * image.channels;
+	for (int y = 0; y < image.height; ++y)
+	{
+		const int srcRow = image.options.flipVertically ? image.height - 1 - y : y;
+		std::memcpy(&image.pixels[y * rowBytes], data + srcRow * rowBytes, rowBytes);
+	}
+	stbi_image_free(data);
+	const double decodeMs = elapsed_ms(start);
+
+	start = std::chrono::steady_clock::now();
+	{
+		PROFILE_SCOPE("generate mipmaps");
+		w = image.width;
+		h = image.height;
+		for (std::size_t level = 1; level < image.levelOffsets.size(); ++level)
+		{
+			downsample_image(&image.pixels[image.levelOffsets[level - 1]], w, h, image.channels, &image.pixels[image.levelOffsets[level]]);
+			w = std::max(w / 2, 1);
+			h = std::max(h / 2, 1);
+		}
+	}
+	const double mipmapMs = elapsed_ms(start);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.decodeMs += decodeMs;
+	stats.mipmapMs += mipmapMs;
+}
+
+void TextureLoader::decodeCompressed(DecodedImage& image)
+{
+	// stored bottom up with the mip chain already, flipVertically doesn't apply
+	const auto start = std::chrono::steady_clock::now();
+	CompressedTexture texture;
+	{
+		PROFILE_SCOPE("read ktx2");
+		if (!read_ktx2(image.path, texture))
+		{
+			return;
+		}
+	}
+	if (!image.options.generateMipmaps)
+	{
+		texture.levels.resize(1);
+	}
+
+	// without the format in the driver the blocks are decoded here, the upload stays the same
+	const bool native = compressed_format_supported(texture.format);
+	image.width = texture.width;
+	image.height = texture.height;
+	image.channels = 4;
+	image.compressedFormat = native ? compressed_texture_format(texture.format) : 0;
+
+	std::size_t totalBytes = 0;
+	int w = image.width;
+	int h = image.height;
+	for (const std::vector<unsigned char>& level : texture.levels)
+	{
+		image.levelOffsets.push_back(totalBytes);
+		totalBytes += native ? level.size() : static_cast<std::size_t>(w) * h * 4;
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+	}
+	image.pixels.resize(totalBytes);
+
+	w = image.width;
+	h = image.height;
+	for (std::size_t level = 0; level < texture.levels.size(); ++level)
+	{
+		if (native)
+		{
+			std::memcpy(&image.pixels[image.levelOffsets[level]], texture.levels[level].data(), texture.levels[level].size());
+		}
+		else
+		{
+			PROFILE_SCOPE("decode blocks");
+			decompress_image(texture.format, texture.levels[level].data(), w, h, &image.pixels[image.levelOffsets[level]]);
+		}
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+	}
+
+	const double decodeMs = elapsed_ms(start);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.decodeMs += decodeMs;
+}
+
+void TextureLoader::upload(DecodedImage& image)
+{
+	if (image.pixels.empty())
+	{
+		image.texture.set_value(0);
+		std::lock_guard<std::mutex> lock(mutex);
+		++stats.texturesFailed;
+		return;
+	}
+
+	PROFILE_SCOPE("upload texture");
+	PROFILE_GPU_SCOPE("upload texture");
+	const auto start = std::chrono::steady_clock::now();
+
+	// orphan the staging buffer so the copy never waits on the previous upload
+	if (pixelBuffer == 0)
+	{
+		glGenBuffers(1, &pixelBuffer);
+	}
+	const auto size = static_cast<GLsizeiptr>(image.pixels.size());
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (staging != nullptr)
+	{
+		std::memcpy(staging, image.pixels.data(), image.pixels.size());
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	else
+	{
+		// read from client memory instead
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, image.options.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, image.options.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levelOffsets.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levelOffsets.size() - 1));
+
+	// rows of RGB images aren't 4 bytes aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	const GLenum format = texture_pixel_format(image.channels);
+	int w = image.width;
+	int h = image.height;
+	for (std::size_t level = 0; level < image.levelOffsets.size(); ++level)
+	{
+		// with a pixel unpack buffer bound the pointer is an offset into it
+		const std::size_t offset = image.levelOffsets[level];
+		const void* levelData = staging != nullptr ? reinterpret_cast<const void*>(offset) : image.pixels.data() + offset;
+		if (image.compressedFormat != 0)
+		{
+			const std::size_t end = level + 1 < image.levelOffsets.size() ? image.levelOffsets[level + 1] : image.pixels.size();
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), image.compressedFormat, w, h, 0, static_cast<GLsizei>(end - offset), levelData);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), texture_internal_format(image.channels), w, h, 0, format, GL_UNSIGNED_BYTE, levelData);
+		}
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	image.texture.set_value(texture);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	++stats.texturesLoaded;
+	stats.texturesCompressed += image.compressedFormat != 0 ? 1 : 0;
+	stats.bytesUploaded += image.pixels.size();
+	stats.uploadMs += elapsed_ms(start);
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous texture loading:
+//		worker threads	stbi_load, vertical flip, CPU mip chain (2x2 box filter)
+//		GL thread		pumpUploads(): copy into a pixel buffer object, glTexImage2D every level from it
+// .ktx2 files (see Ktx2File.h) come with their compressed mip chain: the workers only read them
+// and every level goes to glCompressedTexImage2D as it is, or decoded to RGBA8 on the worker
+// when the context can't sample the format.
+// load() returns right away with a future of the texture name (0 when the image
+// couldn't be decoded). The future is fulfilled by pumpUploads() or finish() on the
+// GL thread, so never wait on it from the GL thread without pumping first.
+//
+//		TextureLoader loader;
+//		std::future<GLuint> wall = loader.load("wall.jpg");
+//		const Shader shader("Shaders/myShader");	// compiles while the workers decode
+//		loader.finish();
+//		const GLuint texture = wall.get();
+//
+// The images are flipped by the loader, stbi_set_flip_vertically_on_load must stay off
+// (it is global state shared by every decoding thread).
+// loadMipChain() stops after the workers: the decoded chain is handed over for uploading the
+// levels some other way (see TextureResidency.h), its future is fulfilled by the worker.
+struct TextureLoadOptions
+{
+	bool flipVertically = true;
+	bool generateMipmaps = true;
+	GLenum wrap = GL_REPEAT;
+};
+
+// halve src (w x h, channels bytes per texel) into dst with a 2x2 box filter, odd edges repeat the last texel
+void downsample_image(const unsigned char* src, int w, int h, int channels, unsigned char* dst);
+
+// glTexImage2D format and sized internal format of 8 bit images with 1 to 4 channels
+GLenum texture_pixel_format(int channels);
+GLenum texture_internal_format(int channels);
+
+// a decoded image with its mip chain, levels stored back to back in pixels (no pixels when the
+// image couldn't be decoded)
+struct TextureMipChain
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	GLenum compressedFormat = 0; // the levels are blocks of this format
+	std::vector<unsigned char> pixels;
+	std::vector<std::size_t> levelOffsets;
+};
+
+struct TextureLoaderStats
+{
+	unsigned long long texturesLoaded;
+	unsigned long long texturesCompressed; // of the loaded ones, uploaded as blocks
+	unsigned long long texturesFailed;
+	unsigned long long bytesUploaded;
+	double decodeMs; // summed over every worker
+	double mipmapMs;
+	double uploadMs; // GL thread
+};
+
+class TextureLoader
+{
+public:
+	// 0 workers uses every hardware thread but the GL one
+	explicit TextureLoader(unsigned int workerCount = 0);
+	~TextureLoader();
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// queue an image file for decoding, any thread
+	std::future<GLuint> load(const std::string& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+	// queue an image file for decoding without creating a texture, any thread
+	std::future<TextureMipChain> loadMipChain(const std::string& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+	// GL thread: upload the decoded images, at most maxBytes of pixel data per call
+	// (at least one image is uploaded when any is ready), returns the number of textures created
+	std::size_t pumpUploads(std::size_t maxBytes = static_cast<std::size_t>(-1));
+
+	// GL thread: pump until every queued image is uploaded
+	void finish();
+
+	// images queued, decoding or waiting for upload (finish() waits for the mip chains too)
+	std::size_t getPendingCount() const;
+
+	unsigned int getWorkerCount() const;
+	TextureLoaderStats getStats() const;
+
+private:
+	// a decoded image with its mip chain, levels stored back to back in pixels
+	struct DecodedImage
+	{
+		std::string path;
+		TextureLoadOptions options;
+		std::promise<GLuint> texture;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		std::vector<unsigned char> pixels;
+		std::vector<std::size_t> levelOffsets;
+		GLenum compressedFormat = 0; // the levels are blocks of this format
+		bool mipChainOnly = false; // handed over through mipChain, never uploaded
+		std::promise<TextureMipChain> mipChain;
+	};
+
+	void workerLoop();
+	void decode(DecodedImage& image);
+	void decodeCompressed(DecodedImage& image);
+	void upload(DecodedImage& image);
+
+	std::vector<std::thread> workers;
+
+	mutable std::mutex mutex;
+	std::condition_variable workAvailable;	// workers wait for requests
+	std::condition_variable imageDecoded;	// finish() waits for decoded images
+	std::deque<std::unique_ptr<DecodedImage>> requests;
+	std::deque<std::unique_ptr<DecodedImage>> decoded;
+	std::size_t pending;
+	bool stopping;
+	TextureLoaderStats stats;
+
+	// GL thread only, staging buffer the texture levels are read from
+	GLuint pixelBuffer;
+};
@@ -0,0 +1,347 @@
+#include "TextureResidency.h"
+#include "GLExtensions.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	int level_size(const int size, const std::size_t level)
+	{
+		return std::max(size >> level, 1);
+	}
+
+	std::size_t level_bytes(const TextureMipChain& mipChain, const std::size_t level)
+	{
+		const std::size_t end = level + 1 < mipChain.levelOffsets.size() ? mipChain.levelOffsets[level + 1] : mipChain.pixels.size();
+		return end - mipChain.levelOffsets[level];
+	}
+
+	// bytes of the levels [first, coarsest]
+	std::size_t chain_bytes(const TextureMipChain& mipChain, const std::size_t first)
+	{
+		return first < mipChain.levelOffsets.size() ? mipChain.pixels.size() - mipChain.levelOffsets[first] : 0;
+	}
+}
+
+TextureResidency::TextureResidency(const std::size_t budgetBytes, const std::size_t uploadBytesPerFrame) : uploadBytesPerFrame(uploadBytesPerFrame), frame(1), stats()
+{
+	stats.budgetBytes = budgetBytes;
+}
+
+TextureResidency::~TextureResidency()
+{
+	for (const ResidentTexture& texture : textures)
+	{
+		glDeleteTextures(1, &texture.name);
+	}
+}
+
+std::size_t TextureResidency::add(TextureMipChain mipChain, const GLenum wrap)
+{
+	textures.emplace_back();
+	ResidentTexture& texture = textures.back();
+	texture.mipChain = std::move(mipChain);
+	texture.wrap = wrap;
+	texture.name = 0;
+	texture.requestedFrame = 0;
+	++stats.textures;
+
+	const std::size_t count = texture.mipChain.levelOffsets.size();
+	texture.tail = count > 0 ? count - 1 : 0;
+	while (texture.tail > 0 && std::max(level_size(texture.mipChain.width, texture.tail - 1), level_size(texture.mipChain.height, texture.tail - 1)) <= MIP_TAIL_SIZE)
+	{
+		--texture.tail;
+	}
+	texture.allocated = count;
+	texture.kept = count;
+	texture.uploaded = count;
+	texture.wanted = texture.tail;
+	texture.lastRequested.assign(count, 0);
+
+	// the tail is resident from the start and counts against the budget like the rest
+	if (count > 0)
+	{
+		resize(texture, texture.tail);
+		while (texture.uploaded > texture.allocated)
+		{
+			uploadLevel(texture, texture.uploaded - 1);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	return textures.size() - 1;
+}
+
+void TextureResidency::request(const std::size_t handle, std::size_t level)
+{
+	ResidentTexture& texture = textures[handle];
+	if (texture.lastRequested.empty())
+	{
+		return;
+	}
+
+	level = std::min(level, texture.tail);
+	texture.wanted = texture.requestedFrame == frame ? std::min(texture.wanted, level) : level;
+	texture.requestedFrame = frame;
+	for (std::size_t l = level; l < texture.lastRequested.size(); ++l)
+	{
+		texture.lastRequested[l] = frame;
+	}
+}
+
+void TextureResidency::update()
+{
+	PROFILE_SCOPE("texture residency");
+	stats.levelsUploaded = 0;
+	stats.bytesUploaded = 0;
+	stats.levelsEvicted = 0;
+
+	// grow the storage of the textures needing more, the ones wanting the coarsest levels first
+	std::vector<std::size_t> growing;
+	for (std::size_t i = 0; i < textures.size(); ++i)
+	{
+		if (textures[i].requestedFrame == frame && textures[i].wanted < textures[i].kept)
+		{
+			growing.push_back(i);
+		}
+	}
+	std::stable_sort(growing.begin(), growing.end(), [this](const std::size_t a, const std::size_t b) { return textures[a].wanted > textures[b].wanted; });
+	for (const std::size_t i : growing)
+	{
+		ResidentTexture& texture = textures[i];
+		std::size_t target = texture.wanted;
+
+		// make room, else settle for the coarser levels that fit
+		while (target < texture.kept)
+		{
+			const std::size_t growth = chain_bytes(texture.mipChain, target) - chain_bytes(texture.mipChain, texture.kept);
+			if (stats.residentBytes + growth <= stats.budgetBytes)
+			{
+				break;
+			}
+			if (!evictLeastRecentlyUsed())
+			{
+				++target;
+			}
+		}
+		if (target < texture.allocated)
+		{
+			resize(texture, target);
+		}
+		else if (target < texture.kept)
+		{
+			// evicted levels still in the storage are taken back, they only have to stream in again
+			stats.residentBytes += chain_bytes(texture.mipChain, target) - chain_bytes(texture.mipChain, texture.kept);
+			texture.kept = target;
+		}
+	}
+
+	// shrink the storage holding evicted levels, once per texture, when the levels it keeps can be
+	// uploaded again within this frame's budget (or nothing else was uploaded yet)
+	stats.shrinksPending = 0;
+	for (ResidentTexture& texture : textures)
+	{
+		if (texture.kept == texture.allocated)
+		{
+			continue;
+		}
+		const std::size_t bytes = chain_bytes(texture.mipChain, texture.uploaded);
+		if (stats.levelsUploaded > 0 && stats.bytesUploaded + bytes > uploadBytesPerFrame)
+		{
+			++stats.shrinksPending;
+			continue;
+		}
+		resize(texture, texture.kept);
+	}
+
+	// stream the missing levels in with what is left, the coarsest missing level of any texture first
+	while (true)
+	{
+		ResidentTexture* next = nullptr;
+		for (ResidentTexture& texture : textures)
+		{
+			if (texture.uploaded > texture.kept && (next == nullptr || texture.uploaded > next->uploaded))
+			{
+				next = &texture;
+			}
+		}
+		if (next == nullptr)
+		{
+			break;
+		}
+		const std::size_t bytes = level_bytes(next->mipChain, next->uploaded - 1);
+		if (stats.levelsUploaded > 0 && stats.bytesUploaded + bytes > uploadBytesPerFrame)
+		{
+			break;
+		}
+		uploadLevel(*next, next->uploaded - 1);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	stats.pendingLevels = 0;
+	stats.pendingBytes = 0;
+	for (const ResidentTexture& texture : textures)
+	{
+		if (texture.requestedFrame == frame && texture.wanted < texture.uploaded)
+		{
+			stats.pendingLevels += texture.uploaded - texture.wanted;
+			stats.pendingBytes += chain_bytes(texture.mipChain, texture.wanted) - chain_bytes(texture.mipChain, texture.uploaded);
+		}
+	}
+	++frame;
+}
+
+GLuint TextureResidency::getTexture(const std::size_t handle) const
+{
+	return textures[handle].name;
+}
+
+int TextureResidency::getSize(const std::size_t handle) const
+{
+	return std::max(textures[handle].mipChain.width, textures[handle].mipChain.height);
+}
+
+std::size_t TextureResidency::getResidentLevel(const std::size_t handle) const
+{
+	return textures[handle].uploaded;
+}
+
+TextureResidencyStats TextureResidency::getStats() const
+{
+	return stats;
+}
+
+void TextureResidency::resize(ResidentTexture& texture, const std::size_t allocated)
+{
+	PROFILE_SCOPE("resize texture storage");
+	const TextureMipChain& mipChain = texture.mipChain;
+	const std::size_t count = mipChain.levelOffsets.size();
+	const auto levels = static_cast<GLsizei>(count - allocated);
+	const GLenum internalFormat = mipChain.compressedFormat != 0 ? mipChain.compressedFormat : texture_internal_format(mipChain.channels);
+
+	GLuint name;
+	glGenTextures(1, &name);
+	glBindTexture(GL_TEXTURE_2D, name);
+	if (gl_extensions().textureStorage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, level_size(mipChain.width, allocated), level_size(mipChain.height, allocated));
+	}
+	else
+	{
+		// every level of the range without data, complete like immutable storage would be
+		for (std::size_t level = allocated; level < count; ++level)
+		{
+			const auto storageLevel = static_cast<GLint>(level - allocated);
+			const int w = level_size(mipChain.width, level);
+			const int h = level_size(mipChain.height, level);
+			if (mipChain.compressedFormat != 0)
+			{
+				glCompressedTexImage2D(GL_TEXTURE_2D, storageLevel, internalFormat, w, h, 0, static_cast<GLsizei>(level_bytes(mipChain, level)), nullptr);
+			}
+			else
+			{
+				glTexImage2D(GL_TEXTURE_2D, storageLevel, internalFormat, w, h, 0, texture_pixel_format(mipChain.channels), GL_UNSIGNED_BYTE, nullptr);
+			}
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	glDeleteTextures(1, &texture.name);
+	stats.residentBytes += chain_bytes(mipChain, allocated);
+	stats.residentBytes -= chain_bytes(mipChain, texture.kept);
+	++stats.reallocations;
+
+	// the levels kept go into the new storage again
+	const std::size_t firstKept = std::max(texture.uploaded, allocated);
+	texture.name = name;
+	texture.allocated = allocated;
+	texture.kept = allocated;
+	texture.uploaded = count;
+	while (texture.uploaded > firstKept)
+	{
+		uploadLevel(texture, texture.uploaded - 1);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(std::min(texture.uploaded, count - 1) - allocated));
+}
+
+void TextureResidency::uploadLevel(ResidentTexture& texture, const std::size_t level)
+{
+	PROFILE_SCOPE("upload texture level");
+	const TextureMipChain& mipChain = texture.mipChain;
+	const auto storageLevel = static_cast<GLint>(level - texture.allocated);
+	const int w = level_size(mipChain.width, level);
+	const int h = level_size(mipChain.height, level);
+	const std::size_t bytes = level_bytes(mipChain, level);
+	const unsigned char* data = mipChain.pixels.data() + mipChain.levelOffsets[level];
+
+	glBindTexture(GL_TEXTURE_2D, texture.name);
+
+	// rows of RGB images aren't 4 bytes aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (mipChain.compressedFormat != 0)
+	{
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, storageLevel, 0, 0, w, h, mipChain.compressedFormat, static_cast<GLsizei>(bytes), data);
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, storageLevel, 0, 0, w, h, texture_pixel_format(mipChain.channels), GL_UNSIGNED_BYTE, data);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, storageLevel);
+
+	texture.uploaded = level;
+	++stats.levelsUploaded;
+	stats.bytesUploaded += bytes;
+	stats.totalBytesUploaded += bytes;
+}
+
+bool TextureResidency::evictLeastRecentlyUsed()
+{
+	// the finest kept level of every texture is a candidate, but the tails and this frame's levels
+	ResidentTexture* victim = nullptr;
+	for (ResidentTexture& texture : textures)
+	{
+		if (texture.kept < texture.tail && texture.lastRequested[texture.kept] < frame
+			&& (victim == nullptr || texture.lastRequested[texture.kept] < victim->lastRequested[victim->kept]))
+		{
+			victim = &texture;
+		}
+	}
+	if (victim == nullptr)
+	{
+		return false;
+	}
+
+	// stop sampling the level now, the storage shrinks later in update() (see the header)
+	stats.residentBytes -= level_bytes(victim->mipChain, victim->kept);
+	++victim->kept;
+	if (victim->uploaded < victim->kept)
+	{
+		victim->uploaded = victim->kept;
+		glBindTexture(GL_TEXTURE_2D, victim->name);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(victim->kept - victim->allocated));
+	}
+	++stats.levelsEvicted;
+	++stats.totalLevelsEvicted;
+	return true;
+}
+
+float projected_size(const ProjectionMatrix& projection, const float worldSize, const float viewDepth, const int viewportHeight)
+{
+	if (viewDepth <= 0.0f)
+	{
+		return std::numeric_limits<float>::max();
+	}
+	return worldSize * projection[5] * 0.5f * static_cast<float>(viewportHeight) / viewDepth;
+}
+
+std::size_t needed_mip_level(const int textureSize, const float screenSize)
+{
+	const float texelsPerPixel = static_cast<float>(textureSize) / std::max(screenSize, 1.0f);
+	return texelsPerPixel > 1.0f ? static_cast<std::size_t>(std::floor(std::log2(texelsPerPixel))) : 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <glad/glad.h>
+#include "Projection.h"
+#include "TextureLoader.h"
+#include <cstddef>
+#include <vector>
+
+// Mip streaming under a budget of texture bytes, GL thread only:
+//		add()		take a decoded mip chain (TextureLoader::loadMipChain), allocate immutable storage
+//					for its mip tail (the levels of MIP_TAIL_SIZE texels or less) and upload the tail,
+//					the texture can be sampled right away
+//		request()	every frame the texture is drawn, with the finest level it needs on screen
+//					(needed_mip_level of its projected_size)
+//		update()	once per frame: grow the storage of the requested textures down to the level they
+//					need, evicting the finest levels least recently requested to stay under the budget,
+//					then upload the missing levels coarsest first, up to uploadBytesPerFrame (at least
+//					one level per frame)
+// The storage of a texture holds the levels [allocated, coarsest]. Resizing it allocates a new
+// texture and uploads the levels it keeps again, so getTexture() changes after update() and has to
+// be bound every frame. The levels allocated but not uploaded yet, or evicted, are hidden with
+// GL_TEXTURE_BASE_LEVEL. An eviction only raises the base level and the budget counts the level as
+// freed at once; the storage shrinks in one reallocation per texture, in the first frame whose
+// upload budget has room for the levels it uploads again. Those uploads, and the ones of a growing
+// texture, count against uploadBytesPerFrame like the streamed levels.
+// A level requested in the current frame is never evicted, the growth that doesn't fit settles
+// for coarser levels until there is room.
+// The chains stay in memory, standing in for the files the levels would be read from.
+constexpr int MIP_TAIL_SIZE = 64;
+
+struct TextureResidencyStats
+{
+	std::size_t textures;
+	std::size_t budgetBytes;
+	std::size_t residentBytes;	// storage kept, uploaded or not (evicted levels awaiting the shrink excluded)
+	std::size_t pendingLevels;	// needed by this frame's requests and not uploaded yet
+	std::size_t pendingBytes;
+
+	// last update()
+	std::size_t levelsUploaded;	// streamed in, or uploaded again into resized storage
+	std::size_t bytesUploaded;
+	std::size_t levelsEvicted;
+	std::size_t shrinksPending;	// textures with evicted levels still in their storage
+
+	// since construction
+	unsigned long long totalBytesUploaded;
+	unsigned long long totalLevelsEvicted;
+	unsigned long long reallocations;
+};
+
+class TextureResidency
+{
+public:
+	explicit TextureResidency(std::size_t budgetBytes, std::size_t uploadBytesPerFrame = 256 * 1024);
+	~TextureResidency();
+
+	TextureResidency(const TextureResidency&) = delete;
+	TextureResidency& operator=(const TextureResidency&) = delete;
+
+	// returns the handle of the texture, an empty chain (an image that couldn't be decoded) gets no texture
+	std::size_t add(TextureMipChain mipChain, GLenum wrap = GL_REPEAT);
+
+	// the texture is drawn this frame and needs level and the coarser ones
+	void request(std::size_t handle, std::size_t level);
+
+	// once per frame, after the requests and before drawing. Leaves no texture bound to the active unit
+	void update();
+
+	GLuint getTexture(std::size_t handle) const;
+	int getSize(std::size_t handle) const;			// larger side of level 0
+	std::size_t getResidentLevel(std::size_t handle) const; // finest level sampled
+	TextureResidencyStats getStats() const;
+
+private:
+	struct ResidentTexture
+	{
+		TextureMipChain mipChain;
+		GLenum wrap;
+		GLuint name;
+		std::size_t tail;		// first level of the mip tail, never evicted
+		std::size_t allocated;	// finest level of the storage
+		std::size_t kept;		// finest level not evicted, the storage shrinks to it
+		std::size_t uploaded;	// finest level uploaded, the base level
+		std::size_t wanted;		// finest level requested this frame
+		unsigned long long requestedFrame;
+		std::vector<unsigned long long> lastRequested; // frame of every level
+	};
+
+	void resize(ResidentTexture& texture, std::size_t allocated);
+	void uploadLevel(ResidentTexture& texture, std::size_t level);
+	bool evictLeastRecentlyUsed();
+
+	std::vector<ResidentTexture> textures;
+	std::size_t uploadBytesPerFrame;
+	unsigned long long frame;
+	TextureResidencyStats stats;
+};
+
+// pixels of the viewport height covered by worldSize units viewDepth in front of the camera, from
+// the vertical scale of the projection. Anything reaching behind the camera covers all of them
+float projected_size(const ProjectionMatrix& projection, float worldSize, float viewDepth, int viewportHeight);
+
+// the finest level a texture of textureSize texels needs when it spans screenSize pixels: about a
+// texel per pixel
+std::size_t needed_mip_level(int textureSize, float screenSize);
@@ -0,0 +1,332 @@
+#include "VertexLayout.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	struct FormatInfo
+	{
+		GLenum type;
+		GLboolean normalized;
+		std::size_t size;
+		const char* name;
+	};
+
+	FormatInfo format_info(const AttributeFormat format)
+	{
+		switch (format)
+		{
+		case AttributeFormat::Half: return FormatInfo{ GL_HALF_FLOAT, GL_FALSE, 2, "half" };
+		case AttributeFormat::Snorm16: return FormatInfo{ GL_SHORT, GL_TRUE, 2, "snorm16" };
+		case AttributeFormat::Unorm16: return FormatInfo{ GL_UNSIGNED_SHORT, GL_TRUE, 2, "unorm16" };
+		case AttributeFormat::Unorm8: return FormatInfo{ GL_UNSIGNED_BYTE, GL_TRUE, 1, "unorm8" };
+		default: return FormatInfo{ GL_FLOAT, GL_FALSE, 4, "float32" };
+		}
+	}
+
+	// value between the bounds as t in [0, 1]
+	float unit(const VertexAttribute& attribute, const float value)
+	{
+		const float range = attribute.maximum - attribute.minimum;
+		const float t = range != 0.0f ? (value - attribute.minimum) / range : 0.0f;
+		return std::min(std::max(t, 0.0f), 1.0f);
+	}
+}
+
+VertexLayout& VertexLayout::add(const GLuint location, const int components, const AttributeFormat format, const float minimum, const float maximum)
+{
+	const std::size_t size = static_cast<std::size_t>(components) * attribute_format_size(format);
+	attributes.push_back(VertexAttribute{ location, components, format, minimum, maximum, stride });
+
+	// next attribute on a 4 byte boundary (a unorm8x3 color takes 4 bytes)
+	stride += (size + 3) & ~static_cast<std::size_t>(3);
+	return *this;
+}
+
+std::size_t VertexLayout::getStride() const
+{
+	return stride;
+}
+
+const std::vector<VertexAttribute>& VertexLayout::getAttributes() const
+{
+	return attributes;
+}
+
+const VertexAttribute* VertexLayout::find(const GLuint location) const
+{
+	for (const VertexAttribute& attribute : attributes)
+	{
+		if (attribute.location == location)
+		{
+			return &attribute;
+		}
+	}
+	return nullptr;
+}
+
+AttributeDequantization VertexLayout::dequantization(const VertexAttribute& attribute)
+{
+	const float range = attribute.maximum - attribute.minimum;
+	switch (attribute.format)
+	{
+	case AttributeFormat::Snorm16:
+		// [-1, 1] to [minimum, maximum]
+		return AttributeDequantization{ 0.5f * range, attribute.minimum + 0.5f * range };
+	case AttributeFormat::Unorm16:
+	case AttributeFormat::Unorm8:
+		return AttributeDequantization{ range, attribute.minimum };
+	default:
+		return AttributeDequantization{ 1.0f, 0.0f };
+	}
+}
+
+std::vector<unsigned char> VertexLayout::pack(const float* vertices, const std::size_t vertexCount, const std::size_t sourceStride) const
+{
+	// padding bytes stay zero
+	std::vector<unsigned char> packed(vertexCount * stride, 0);
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		const float* source = vertices + v * sourceStride;
+		unsigned char* vertex = packed.data() + v * stride;
+		for (const VertexAttribute& attribute : attributes)
+		{
+			unsigned char* destination = vertex + attribute.offset;
+			for (int c = 0; c < attribute.components; ++c)
+			{
+				const float value = *source++;
+				switch (attribute.format)
+				{
+				case AttributeFormat::Float32:
+					std::memcpy(destination + 4 * c, &value, 4);
+					break;
+				case AttributeFormat::Half:
+				{
+					const std::uint16_t half = float_to_half(value);
+					std::memcpy(destination + 2 * c, &half, 2);
+					break;
+				}
+				case AttributeFormat::Snorm16:
+				{
+					// GL maps -32767 and 32767 to -1 and 1 (-32768 is never written)
+					const auto snorm = static_cast<std::int16_t>(std::lround((2.0f * unit(attribute, value) - 1.0f) * 32767.0f));
+					std::memcpy(destination + 2 * c, &snorm, 2);
+					break;
+				}
+				case AttributeFormat::Unorm16:
+				{
+					const auto unorm = static_cast<std::uint16_t>(std::lround(unit(attribute, value) * 65535.0f));
+					std::memcpy(destination + 2 * c, &unorm, 2);
+					break;
+				}
+				case AttributeFormat::Unorm8:
+					destination[c] = static_cast<unsigned char>(std::lround(unit(attribute, value) * 255.0f));
+					break;
+				}
+			}
+		}
+	}
+	return packed;
+}
+
+void VertexLayout::unpack(const unsigned char* packed, const std::size_t vertexCount, float* vertices, const std::size_t sourceStride) const
+{
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		float* destination = vertices + v * sourceStride;
+		const unsigned char* vertex = packed + v * stride;
+		for (const VertexAttribute& attribute : attributes)
+		{
+			const unsigned char* source = vertex + attribute.offset;
+			const AttributeDequantization dequantize = dequantization(attribute);
+			for (int c = 0; c < attribute.components; ++c)
+			{
+				// what the vertex fetch hands to the shader
+				float stored = 0.0f;
+				switch (attribute.format)
+				{
+				case AttributeFormat::Float32:
+					std::memcpy(&stored, source + 4 * c, 4);
+					break;
+				case AttributeFormat::Half:
+				{
+					std::uint16_t half;
+					std::memcpy(&half, source + 2 * c, 2);
+					stored = half_to_float(half);
+					break;
+				}
+				case AttributeFormat::Snorm16:
+				{
+					std::int16_t snorm;
+					std::memcpy(&snorm, source + 2 * c, 2);
+					stored = std::max(static_cast<float>(snorm) / 32767.0f, -1.0f);
+					break;
+				}
+				case AttributeFormat::Unorm16:
+				{
+					std::uint16_t unorm;
+					std::memcpy(&unorm, source + 2 * c, 2);
+					stored = static_cast<float>(unorm) / 65535.0f;
+					break;
+				}
+				case AttributeFormat::Unorm8:
+					stored = static_cast<float>(source[c]) / 255.0f;
+					break;
+				}
+				*destination++ = stored * dequantize.scale + dequantize.bias;
+			}
+		}
+	}
+}
+
+void VertexLayout::apply() const
+{
+	for (const VertexAttribute& attribute : attributes)
+	{
+		const FormatInfo info = format_info(attribute.format);
+		glVertexAttribPointer(attribute.location, attribute.components, info.type, info.normalized,
+			static_cast<GLsizei>(stride), reinterpret_cast<void*>(attribute.offset));
+		glEnableVertexAttribArray(attribute.location);
+	}
+}
+
+std::uint16_t float_to_half(const float value)
+{
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, 4);
+
+	const std::uint32_t sign = (bits >> 16) & 0x8000u;
+	const std::uint32_t exponent = (bits >> 23) & 0xFFu;
+	std::uint32_t mantissa = bits & 0x7FFFFFu;
+
+	if (exponent == 0xFFu)
+	{
+		// infinity stays infinity, NaN stays a (quiet) NaN
+		return static_cast<std::uint16_t>(sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0u));
+	}
+
+	const int halfExponent = static_cast<int>(exponent) - 127 + 15;
+	if (halfExponent >= 31)
+	{
+		return static_cast<std::uint16_t>(sign | 0x7C00u);
+	}
+	if (halfExponent <= 0)
+	{
+		// subnormal half (or zero): shift the mantissa with its implicit 1
+		if (halfExponent < -10)
+		{
+			return static_cast<std::uint16_t>(sign);
+		}
+		mantissa |= 0x800000u;
+		const int shift = 14 - halfExponent;
+		std::uint32_t half = mantissa >> shift;
+		const std::uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		const std::uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1u) != 0))
+		{
+			++half;
+		}
+		return static_cast<std::uint16_t>(sign | half);
+	}
+
+	std::uint32_t half = (static_cast<std::uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+	const std::uint32_t remainder = mantissa & 0x1FFFu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u) != 0))
+	{
+		// a carry into the exponent is still the right rounding (up to infinity)
+		++half;
+	}
+	return static_cast<std::uint16_t>(sign | half);
+}
+
+float half_to_float(const std::uint16_t value)
+{
+	const std::uint32_t sign = (value & 0x8000u) << 16;
+	std::uint32_t exponent = (value >> 10) & 0x1Fu;
+	std::uint32_t mantissa = value & 0x3FFu;
+
+	std::uint32_t bits;
+	if (exponent == 0x1Fu)
+	{
+		bits = sign | 0x7F800000u | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)
+	{
+		bits = sign;
+	}
+	else
+	{
+		// subnormal half, normalize it
+		exponent = 127 - 15 + 1;
+		while ((mantissa & 0x400u) == 0)
+		{
+			mantissa <<= 1;
+			--exponent;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+	}
+
+	float result;
+	std::memcpy(&result, &bits, 4);
+	return result;
+}
+
+std::size_t attribute_format_size(const AttributeFormat format)
+{
+	return format_info(format).size;
+}
+
+const char* attribute_format_name(const AttributeFormat format)
+{
+	return format_info(format).name;
+}
+
+double measure_vertex_fetch(const VertexLayout& layout, const float* vertices, const std::size_t vertexCount, const std::size_t sourceStride, const int draws)
+{
+	const std::vector<unsigned char> packed = layout.pack(vertices, vertexCount, sourceStride);
+
+	GLint previousVAO = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVAO);
+
+	GLuint vao, vbo;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(packed.size()), packed.data(), GL_STATIC_DRAW);
+	layout.apply();
+
+	// nothing reaches the rasterizer, the draw costs the fetch and the vertex shader
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	// the first draw pays for the upload
+	glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(vertexCount));
+	glFinish();
+
+	std::vector<double> times;
+	for (int i = 0; i < draws; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(vertexCount));
+		glFinish();
+		times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(static_cast<GLuint>(previousVAO));
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+
+	if (times.empty())
+	{
+		return 0.0;
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Storage format of a vertex attribute in the vertex buffer. The vertex shader always
+// receives floats: normalized formats are read in [0, 1] (unorm) or [-1, 1] (snorm)
+// and mapped back to the attribute bounds with its dequantization scale and bias.
+enum class AttributeFormat
+{
+	Float32,	// GL_FLOAT, 4 bytes per component
+	Half,		// GL_HALF_FLOAT, 2 bytes, about 3 decimal digits
+	Snorm16,	// GL_SHORT normalized, 2 bytes, 65535 steps between the bounds
+	Unorm16,	// GL_UNSIGNED_SHORT normalized, 2 bytes
+	Unorm8		// GL_UNSIGNED_BYTE normalized, 1 byte, 255 steps (colors)
+};
+
+struct VertexAttribute
+{
+	GLuint location;			// layout (location = n) in the vertex shader
+	int components;				// 1 to 4
+	AttributeFormat format;
+	float minimum;				// quantization bounds of the normalized formats, values
+	float maximum;				// outside are clamped (ignored by Float32 and Half)
+	std::size_t offset;			// in bytes, set by VertexLayout::add
+};
+
+// v = stored * scale + bias, stored as read by the vertex shader
+struct AttributeDequantization
+{
+	float scale;
+	float bias;
+};
+
+// Describes how the vertices are stored, e.g. the cube in 16 instead of 32 bytes:
+//		VertexLayout layout;
+//		layout.add(0, 3, AttributeFormat::Snorm16, -0.5f, 0.5f);	// position
+//		layout.add(1, 3, AttributeFormat::Unorm8);					// color
+//		layout.add(2, 2, AttributeFormat::Unorm16);					// texture coordinates
+//		const std::vector<unsigned char> packed = layout.pack(vertex_data, vertexCount, 8);
+//		glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+//		layout.apply();
+// Every attribute starts on a 4 byte boundary, as GPUs fetch unaligned attributes slower.
+class VertexLayout
+{
+public:
+	// append an attribute, the bounds only matter to the normalized formats
+	VertexLayout& add(GLuint location, int components, AttributeFormat format, float minimum = 0.0f, float maximum = 1.0f);
+
+	// bytes per vertex
+	std::size_t getStride() const;
+
+	const std::vector<VertexAttribute>& getAttributes() const;
+
+	// the attribute at this location, nullptr if the layout has none
+	const VertexAttribute* find(GLuint location) const;
+
+	// the float the vertex shader reads for a stored value, mapped back to the attribute bounds
+	static AttributeDequantization dequantization(const VertexAttribute& attribute);
+
+	// quantize interleaved float vertices, the attributes' components one after another
+	// in the order they were added, sourceStride floats per vertex
+	std::vector<unsigned char> pack(const float* vertices, std::size_t vertexCount, std::size_t sourceStride) const;
+
+	// back to interleaved floats (sourceStride floats per vertex), to measure the quantization error
+	void unpack(const unsigned char* packed, std::size_t vertexCount, float* vertices, std::size_t sourceStride) const;
+
+	// glVertexAttribPointer + glEnableVertexAttribArray for every attribute of the vertex
+	// buffer bound to GL_ARRAY_BUFFER, recorded in the bound VAO
+	void apply() const;
+
+private:
+	std::vector<VertexAttribute> attributes;
+	std::size_t stride = 0;
+};
+
+// IEEE 754 binary16 conversions (round to nearest even)
+std::uint16_t float_to_half(float value);
+float half_to_float(std::uint16_t value);
+
+// bytes of one component stored in this format
+std::size_t attribute_format_size(AttributeFormat format);
+const char* attribute_format_name(AttributeFormat format);
+
+// GPU time of drawing vertexCount vertices stored with layout as points with rasterization
+// disabled, so only vertex fetch and the vertex shader of the bound program run.
+// Uses a VAO and buffer of its own, returns the median milliseconds per draw
+double measure_vertex_fetch(const VertexLayout& layout, const float* vertices, std::size_t vertexCount, std::size_t sourceStride, int draws);
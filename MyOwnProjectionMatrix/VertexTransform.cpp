@@ -0,0 +1,296 @@
+#include "VertexTransform.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <vector>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	const float* vertex_at(const float* positions, std::size_t index, std::size_t strideBytes)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * strideBytes);
+	}
+
+	// ======================================================================
+	// scalar reference
+
+	void transform_one(const float* m, const float x, const float y, const float z, NdcPositions out, std::size_t i)
+	{
+		const float clipX = m[0] * x + m[4] * y + m[8] * z + m[12];
+		const float clipY = m[1] * x + m[5] * y + m[9] * z + m[13];
+		const float clipZ = m[2] * x + m[6] * y + m[10] * z + m[14];
+		const float clipW = m[3] * x + m[7] * y + m[11] * z + m[15];
+
+		const float invW = 1.0f / clipW;
+		out.x[i] = clipX * invW;
+		out.y[i] = clipY * invW;
+		out.z[i] = clipZ * invW;
+	}
+
+	void interleaved_scalar(const float* m, const float* positions, std::size_t begin, std::size_t count, std::size_t strideBytes, NdcPositions out)
+	{
+		for (std::size_t i = begin; i < count; ++i)
+		{
+			const float* p = vertex_at(positions, i, strideBytes);
+			transform_one(m, p[0], p[1], p[2], out, i);
+		}
+	}
+
+	void soa_scalar(const float* m, const float* x, const float* y, const float* z, std::size_t begin, std::size_t count, NdcPositions out)
+	{
+		for (std::size_t i = begin; i < count; ++i)
+		{
+			transform_one(m, x[i], y[i], z[i], out, i);
+		}
+	}
+
+	// the SIMD interleaved kernels load 4 floats per position (xyz plus whatever follows),
+	// so when the stride is tighter than that the very last position is left to the scalar tail
+	std::size_t simd_safe_count(std::size_t count, std::size_t strideBytes)
+	{
+		if (strideBytes >= 4 * sizeof(float) || count == 0)
+		{
+			return count;
+		}
+		return count - 1;
+	}
+
+#if CPU_X86
+	// ======================================================================
+	// SSE: 4 vertices per iteration
+
+	void project_sse(const float* m, __m128 x, __m128 y, __m128 z, NdcPositions out, std::size_t i)
+	{
+		__m128 clipX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), x), _mm_mul_ps(_mm_set1_ps(m[4]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8]), z), _mm_set1_ps(m[12])));
+		__m128 clipY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1]), x), _mm_mul_ps(_mm_set1_ps(m[5]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[9]), z), _mm_set1_ps(m[13])));
+		__m128 clipZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2]), x), _mm_mul_ps(_mm_set1_ps(m[6]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[10]), z), _mm_set1_ps(m[14])));
+		__m128 clipW = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[3]), x), _mm_mul_ps(_mm_set1_ps(m[7]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[11]), z), _mm_set1_ps(m[15])));
+
+		const __m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), clipW);
+		_mm_storeu_ps(out.x + i, _mm_mul_ps(clipX, invW));
+		_mm_storeu_ps(out.y + i, _mm_mul_ps(clipY, invW));
+		_mm_storeu_ps(out.z + i, _mm_mul_ps(clipZ, invW));
+	}
+
+	void interleaved_sse(const float* m, const float* positions, std::size_t count, std::size_t strideBytes, NdcPositions out)
+	{
+		const std::size_t safeCount = simd_safe_count(count, strideBytes);
+		std::size_t i = 0;
+		for (; i + 4 <= safeCount; i += 4)
+		{
+			// rows: x y z ? of 4 vertices, transposed into x x x x / y y y y / z z z z
+			const __m128 r0 = _mm_loadu_ps(vertex_at(positions, i, strideBytes));
+			const __m128 r1 = _mm_loadu_ps(vertex_at(positions, i + 1, strideBytes));
+			const __m128 r2 = _mm_loadu_ps(vertex_at(positions, i + 2, strideBytes));
+			const __m128 r3 = _mm_loadu_ps(vertex_at(positions, i + 3, strideBytes));
+
+			const __m128 t0 = _mm_unpacklo_ps(r0, r1);
+			const __m128 t1 = _mm_unpacklo_ps(r2, r3);
+			const __m128 t2 = _mm_unpackhi_ps(r0, r1);
+			const __m128 t3 = _mm_unpackhi_ps(r2, r3);
+
+			const __m128 x = _mm_movelh_ps(t0, t1);
+			const __m128 y = _mm_movehl_ps(t1, t0);
+			const __m128 z = _mm_movelh_ps(t2, t3);
+
+			project_sse(m, x, y, z, out, i);
+		}
+		interleaved_scalar(m, positions, i, count, strideBytes, out);
+	}
+
+	void soa_sse(const float* m, const float* x, const float* y, const float* z, std::size_t count, NdcPositions out)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			project_sse(m, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), _mm_loadu_ps(z + i), out, i);
+		}
+		soa_scalar(m, x, y, z, i, count, out);
+	}
+
+	// ======================================================================
+	// AVX2 + FMA: 8 vertices per iteration
+
+	CPU_TARGET_AVX2 void project_avx2(const float* m, __m256 x, __m256 y, __m256 z, NdcPositions out, std::size_t i)
+	{
+		__m256 clipX = _mm256_fmadd_ps(_mm256_set1_ps(m[0]), x, _mm256_fmadd_ps(_mm256_set1_ps(m[4]), y, _mm256_fmadd_ps(_mm256_set1_ps(m[8]), z, _mm256_set1_ps(m[12]))));
+		__m256 clipY = _mm256_fmadd_ps(_mm256_set1_ps(m[1]), x, _mm256_fmadd_ps(_mm256_set1_ps(m[5]), y, _mm256_fmadd_ps(_mm256_set1_ps(m[9]), z, _mm256_set1_ps(m[13]))));
+		__m256 clipZ = _mm256_fmadd_ps(_mm256_set1_ps(m[2]), x, _mm256_fmadd_ps(_mm256_set1_ps(m[6]), y, _mm256_fmadd_ps(_mm256_set1_ps(m[10]), z, _mm256_set1_ps(m[14]))));
+		__m256 clipW = _mm256_fmadd_ps(_mm256_set1_ps(m[3]), x, _mm256_fmadd_ps(_mm256_set1_ps(m[7]), y, _mm256_fmadd_ps(_mm256_set1_ps(m[11]), z, _mm256_set1_ps(m[15]))));
+
+		const __m256 invW = _mm256_div_ps(_mm256_set1_ps(1.0f), clipW);
+		_mm256_storeu_ps(out.x + i, _mm256_mul_ps(clipX, invW));
+		_mm256_storeu_ps(out.y + i, _mm256_mul_ps(clipY, invW));
+		_mm256_storeu_ps(out.z + i, _mm256_mul_ps(clipZ, invW));
+	}
+
+	CPU_TARGET_AVX2 __m256 load_pair(const float* positions, std::size_t low, std::size_t high, std::size_t strideBytes)
+	{
+		const __m128 lo = _mm_loadu_ps(vertex_at(positions, low, strideBytes));
+		const __m128 hi = _mm_loadu_ps(vertex_at(positions, high, strideBytes));
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+	}
+
+	CPU_TARGET_AVX2 void interleaved_avx2(const float* m, const float* positions, std::size_t count, std::size_t strideBytes, NdcPositions out)
+	{
+		const std::size_t safeCount = simd_safe_count(count, strideBytes);
+		std::size_t i = 0;
+		for (; i + 8 <= safeCount; i += 8)
+		{
+			// same 4x4 transpose as the SSE kernel, vertices i..i+3 in the low lanes and i+4..i+7 in the high lanes
+			const __m256 r0 = load_pair(positions, i, i + 4, strideBytes);
+			const __m256 r1 = load_pair(positions, i + 1, i + 5, strideBytes);
+			const __m256 r2 = load_pair(positions, i + 2, i + 6, strideBytes);
+			const __m256 r3 = load_pair(positions, i + 3, i + 7, strideBytes);
+
+			const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+			const __m256 t1 = _mm256_unpacklo_ps(r2, r3);
+			const __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+			const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+			const __m256 x = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 z = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+
+			project_avx2(m, x, y, z, out, i);
+		}
+		interleaved_scalar(m, positions, i, count, strideBytes, out);
+	}
+
+	CPU_TARGET_AVX2 void soa_avx2(const float* m, const float* x, const float* y, const float* z, std::size_t count, NdcPositions out)
+	{
+		std::size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			project_avx2(m, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i), out, i);
+		}
+		soa_scalar(m, x, y, z, i, count, out);
+	}
+#endif
+
+	TransformKernel detect_best_kernel()
+	{
+		const CpuFeatures& features = cpu_features();
+		if (features.avx2 && features.fma)
+		{
+			return TransformKernel::AVX2;
+		}
+		if (features.sse2)
+		{
+			return TransformKernel::SSE;
+		}
+		return TransformKernel::Scalar;
+	}
+}
+
+TransformKernel best_transform_kernel()
+{
+	static const TransformKernel kernel = detect_best_kernel();
+	return kernel;
+}
+
+const char* transform_kernel_name(const TransformKernel kernel)
+{
+	switch (kernel)
+	{
+	case TransformKernel::AVX2: return "AVX2";
+	case TransformKernel::SSE: return "SSE";
+	default: return "Scalar";
+	}
+}
+
+void transform_positions_to_ndc(const General4& mvp, const float* positions, std::size_t count, std::size_t strideBytes, NdcPositions out)
+{
+	transform_positions_to_ndc(best_transform_kernel(), mvp, positions, count, strideBytes, out);
+}
+
+void transform_positions_to_ndc(const TransformKernel kernel, const General4& mvp, const float* positions, std::size_t count, std::size_t strideBytes, NdcPositions out)
+{
+	switch (kernel)
+	{
+#if CPU_X86
+	case TransformKernel::AVX2:
+		interleaved_avx2(mvp.m, positions, count, strideBytes, out);
+		break;
+	case TransformKernel::SSE:
+		interleaved_sse(mvp.m, positions, count, strideBytes, out);
+		break;
+#endif
+	default:
+		interleaved_scalar(mvp.m, positions, 0, count, strideBytes, out);
+		break;
+	}
+}
+
+void transform_positions_to_ndc_soa(const General4& mvp, const float* x, const float* y, const float* z, std::size_t count, NdcPositions out)
+{
+	transform_positions_to_ndc_soa(best_transform_kernel(), mvp, x, y, z, count, out);
+}
+
+void transform_positions_to_ndc_soa(const TransformKernel kernel, const General4& mvp, const float* x, const float* y, const float* z, std::size_t count, NdcPositions out)
+{
+	switch (kernel)
+	{
+#if CPU_X86
+	case TransformKernel::AVX2:
+		soa_avx2(mvp.m, x, y, z, count, out);
+		break;
+	case TransformKernel::SSE:
+		soa_sse(mvp.m, x, y, z, count, out);
+		break;
+#endif
+	default:
+		soa_scalar(mvp.m, x, y, z, 0, count, out);
+		break;
+	}
+}
+
+float check_transform_kernels(const General4& mvp, const float* positions, std::size_t count, std::size_t strideBytes)
+{
+	// scalar reference
+	std::vector<float> reference(3 * count);
+	const NdcPositions expected = { reference.data(), reference.data() + count, reference.data() + 2 * count };
+	transform_positions_to_ndc(TransformKernel::Scalar, mvp, positions, count, strideBytes, expected);
+
+	// same positions split per component for the SoA kernels
+	std::vector<float> soa(3 * count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float* p = vertex_at(positions, i, strideBytes);
+		soa[i] = p[0];
+		soa[count + i] = p[1];
+		soa[2 * count + i] = p[2];
+	}
+
+	std::vector<float> result(3 * count);
+	const NdcPositions actual = { result.data(), result.data() + count, result.data() + 2 * count };
+
+	float maxError = 0.0f;
+	const auto compare = [&]()
+	{
+		for (std::size_t i = 0; i < reference.size(); ++i)
+		{
+			maxError = std::max(maxError, std::fabs(reference[i] - result[i]));
+		}
+	};
+
+	const TransformKernel best = best_transform_kernel();
+	for (const TransformKernel kernel : { TransformKernel::Scalar, TransformKernel::SSE, TransformKernel::AVX2 })
+	{
+		if (static_cast<int>(kernel) > static_cast<int>(best))
+		{
+			break;
+		}
+
+		transform_positions_to_ndc(kernel, mvp, positions, count, strideBytes, actual);
+		compare();
+		transform_positions_to_ndc_soa(kernel, mvp, soa.data(), soa.data() + count, soa.data() + 2 * count, count, actual);
+		compare();
+	}
+	return maxError;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "MatrixTypes.h"
+#include <cstddef>
+
+// CPU-side batch transform of vertex positions by a combined MVP, including
+// the perspective divide, e.g. for picking, culling or debug readback.
+// Input positions are either interleaved in a vertex buffer (like vertex_data
+// in main.cpp: 3 position floats at the start of every 8 * sizeof(float) vertex)
+// or split in one array per component (SoA). The output is always SoA.
+
+struct NdcPositions
+{
+	float* x;
+	float* y;
+	float* z;
+};
+
+enum class TransformKernel
+{
+	Scalar,
+	SSE,
+	AVX2
+};
+
+// the best kernel the running CPU supports, detected once
+TransformKernel best_transform_kernel();
+const char* transform_kernel_name(TransformKernel kernel);
+
+// positions: first float of the first vertex position
+// strideBytes: distance between two consecutive positions, a multiple of sizeof(float)
+void transform_positions_to_ndc(const General4& mvp, const float* positions, std::size_t count, std::size_t strideBytes, NdcPositions out);
+void transform_positions_to_ndc(TransformKernel kernel, const General4& mvp, const float* positions, std::size_t count, std::size_t strideBytes, NdcPositions out);
+
+void transform_positions_to_ndc_soa(const General4& mvp, const float* x, const float* y, const float* z, std::size_t count, NdcPositions out);
+void transform_positions_to_ndc_soa(TransformKernel kernel, const General4& mvp, const float* x, const float* y, const float* z, std::size_t count, NdcPositions out);
+
+// runs every kernel the CPU supports over both layouts and compares them against
+// the scalar reference, returns the largest absolute difference found
+float check_transform_kernels(const General4& mvp, const float* positions, std::size_t count, std::size_t strideBytes);
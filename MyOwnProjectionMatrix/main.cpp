@@ -4,10 +4,60 @@
 
 // Cpp libraries
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <iterator>
+#include <utility>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <functional>
 
 // for data loading and shader compiling
 #include "Shader.h"
-#include <stb/stb_image.h>
+#include "TextureLoader.h"
+#include "TextureAtlas.h"
+#include "TextureConverter.h"
+#include "TextureResidency.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderBatch.h"
+#include "ShaderSourceCache.h"
+#include "ShaderHotReload.h"
+
+// for projection and structured matrix math
+#include "Projection.h"
+#include "ProjectionCheck.h"
+#include "MatrixTypes.h"
+#include "MatrixCheck.h"
+#include "VertexTransform.h"
+#include "VertexLayout.h"
+#include "MeshOptimizer.h"
+#include "MeshFile.h"
+#include "MeshConverter.h"
+#include "GeometryPool.h"
+
+// for OpenGL features newer than 3.3 and shared uniform blocks
+#include "GLExtensions.h"
+#include "CameraUniformBuffer.h"
+#include "StreamingBuffer.h"
+
+// for drawing many cubes at once, only the ones the camera sees
+#include "Instancing.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+
+// for running without a display and measuring frame times
+#include "HeadlessContext.h"
+#include "OffscreenFramebuffer.h"
+#include "DepthMode.h"
+#include "FrameStats.h"
+
+// for seeing where startup and frame time goes
+#include "Profiler.h"
 
 // for transformations
 #include <glm/glm.hpp>
@@ -21,102 +71,361 @@
 // use winding order to draw correctly cube faces? else use dept testing method
 #define USE_CULL_FACE
 
+// command line switches, e.g: MyOwnProjectionMatrix.exe --instances 100000
+//						or: MyOwnProjectionMatrix --headless --frames 1000 --json bench.json
+struct AppOptions
+{
+	// 0 draws the single animated cube, otherwise draw this many cubes with one instanced draw call
+	std::size_t instances = 0;
+	float instanceExtent = 0.8f; // the instances fill [-extent, extent]^3
+
+	// test the instances against the view frustum every frame and draw the visible ones:
+	// flat SIMD batches, through a BVH (the instances never move), or not at all
+	enum class Culling { Off, Flat, Bvh };
+	Culling culling = Culling::Flat;
+
+	// spin every instance about an axis of its own, the per-frame update then rewrites them all
+	bool animateInstances = false;
+
+	// workers of the job system running the instance update, culling and draw list build
+	// (0 uses every hardware thread but the GL one)
+	unsigned int jobWorkers = 0;
+
+	// render into an offscreen framebuffer without opening a window, then report the frame times
+	bool headless = false;
+	unsigned long long frames = 500; // frames measured in headless mode
+	unsigned long long warmupFrames = 10; // rendered first and not measured (shader compiles, first uploads)
+	std::string jsonPath; // where the benchmark JSON goes, stdout when empty
+
+	// record CPU/GPU timings of startup and every frame into a Chrome trace file
+	std::string tracePath;
+
+	// depth range, buffer format and compare of the depth-test path (see DepthMode.h)
+	DepthMode depthMode = DepthMode::Standard;
+
+	// rebuild the shaders in the background when a file in Shaders/ is saved
+	bool hotReload = true;
+
+	// store the cube vertices quantized in 16 bytes (snorm16 position, unorm8 color, unorm16 uv)
+	// instead of 8 floats
+	bool compactVertices = true;
+
+	// time fetching this many vertices with every vertex layout before rendering, 0 skips it
+	std::size_t fetchBenchmarkVertices = 0;
+
+	// time frames drawing cameraBenchmarkDraws draws over this many programs, with the camera in
+	// the shared uniform block and as uniforms of every program, before rendering. 0 skips it
+	std::size_t cameraBenchmarkPrograms = 0;
+	std::size_t cameraBenchmarkDraws = 0;
+
+	// time building this many projections of every variant, against glm, 0 skips it
+	std::size_t projectionBenchmarkMatrices = 0;
+
+	// time this many products and inverses of the structured matrices, against glm::mat4, 0 skips it
+	std::size_t matrixBenchmarkOperations = 0;
+
+	// also optimize a shuffled 256x256 grid at startup and report what the reordering gains
+	bool meshOptimizerReport = false;
+
+	// draw this binary mesh (see MeshFile.h) instead of the cube
+	std::string meshPath;
+
+	// draw the instances as this many distinct shapes sharing one GeometryPool (instead of the
+	// cube or the mesh), with one multi-draw per material instead of one draw per shape
+	std::size_t poolMeshes = 0;
+
+	// sample every image through one texture array (see TextureAtlas.h), the instances pick their
+	// material by index so one bind serves every draw. Packed at startup from the two textures and
+	// generated images of other sizes, or read from atlasPath (written by --pack-textures)
+	bool textureAtlas = false;
+	std::string atlasPath;
+
+	// the two textures of the cube, a .ktx2 file (written by --compress-texture) is uploaded as
+	// compressed blocks. The atlas packs the original images
+	std::string texturePaths[2] = { "wall.jpg", "awesomeface.png" };
+
+	// upload only the mip tails of the two textures before the first frame and stream the finer
+	// levels as the cubes need them on screen, keeping at most textureBudget bytes resident
+	// (see TextureResidency.h)
+	bool streamTextures = false;
+	std::size_t textureBudget = 64 * 1024 * 1024;
+
+	// convert an OBJ/glTF file into a binary mesh and exit, no window is opened
+	std::string convertInput;
+	std::string convertOutput;
+
+	// pack images into an atlas file and exit, no window is opened
+	std::string packOutput;
+	std::vector<std::string> packInputs;
+
+	// compress an image into a KTX2 file and exit, no window is opened
+	std::string compressInput;
+	std::string compressOutput;
+	BlockFormat compressFormat = BlockFormat::BC7;
+};
+
 void resize_framebuffer_cb(GLFWwindow* window, int w, int h);
 void process_input(GLFWwindow* window);
-const float* my_perspective(float fovY, float aspect, float near, float far);
+AppOptions parse_options(int argc, char** argv);
+std::vector<float> make_fetch_benchmark_mesh(std::size_t vertexCount);
+void make_shuffled_grid(std::size_t side, std::vector<float>& vertices, std::vector<unsigned int>& indices);
+void make_pool_mesh(std::size_t variant, std::vector<float>& vertices, std::vector<unsigned int>& indices);
+AtlasImage make_atlas_tile(std::size_t variant, int width, int height);
 
-int main(void)
+int main(int argc, char** argv)
 {
-	// configure window and context
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// create window
-	GLFWwindow* window = glfwCreateWindow(W, H, WINDOW_TITLE, NULL, NULL);
-	if (window == NULL)
-	{
-		std::cout << "Window could not be created\n";
-		glfwTerminate();
-		return -1;
+	const AppOptions options = parse_options(argc, argv);
+	const bool instanced = options.instances > 0;
+
+	if (!options.convertInput.empty())
+	{
+		MeshConversionReport conversion;
+		if (!convert_mesh(options.convertInput, options.convertOutput, conversion))
+		{
+			return -1;
+		}
+		std::cout << "\n\nMESH CONVERTER:\n";
+		std::cout << options.convertInput << " -> " << options.convertOutput << " (" << conversion.fileBytes << " bytes)" << std::endl;
+		std::cout << "Triangles: " << conversion.triangles << ", submeshes: " << conversion.submeshes << std::endl;
+		std::cout << "Vertices: " << conversion.verticesImported << " imported, " << conversion.verticesWritten << " written" << std::endl;
+		std::cout << "ACMR: " << conversion.acmrBefore << " -> " << conversion.acmrAfter << std::endl;
+		std::cout << "Import / optimize / write time: " << conversion.importMs << " / " << conversion.optimizeMs << " / " << conversion.writeMs << " ms" << std::endl;
+		return 0;
+	}
+
+	if (!options.packOutput.empty())
+	{
+		std::vector<AtlasImage> images(options.packInputs.size());
+		for (std::size_t i = 0; i < images.size(); ++i)
+		{
+			if (!load_atlas_image(options.packInputs[i], images[i]))
+			{
+				return -1;
+			}
+		}
+		TextureAtlas atlas;
+		if (!pack_texture_atlas(images, atlas) || !write_texture_atlas(options.packOutput, atlas))
+		{
+			return -1;
+		}
+		std::cout << "\n\nTEXTURE ATLAS PACKER:\n";
+		std::cout << images.size() << " images -> " << options.packOutput << " (" << atlas.pixels.size() << " bytes of pixels)" << std::endl;
+		std::cout << "Layers: " << atlas.layers << " of " << atlas.width << "x" << atlas.height << ", " << atlas.imageLayers << " holding one image, occupancy of the others " << atlas_occupancy(atlas) << std::endl;
+		return 0;
+	}
+
+	if (!options.compressInput.empty())
+	{
+		TextureConversionReport conversion;
+		if (!convert_texture(options.compressInput, options.compressOutput, options.compressFormat, conversion))
+		{
+			return -1;
+		}
+		std::cout << "\n\nTEXTURE CONVERTER:\n";
+		std::cout << options.compressInput << " -> " << options.compressOutput << " (" << block_format_name(options.compressFormat) << ", " << conversion.fileBytes << " bytes)" << std::endl;
+		std::cout << "Size: " << conversion.width << "x" << conversion.height << ", " << conversion.levels << " levels, encoded by " << conversion.workers << " workers" << std::endl;
+		std::cout << "Bytes: " << conversion.compressedBytes << " compressed, " << conversion.sourceBytes << " as RGBA8 (" << static_cast<double>(conversion.sourceBytes) / conversion.compressedBytes << ":1)" << std::endl;
+		std::cout << "PSNR of level 0: " << conversion.quality.psnrRgb << " dB RGB";
+		if (block_format_has_alpha(options.compressFormat))
+		{
+			std::cout << ", " << conversion.quality.psnrAlpha << " dB alpha";
+		}
+		std::cout << std::endl;
+		std::cout << "Decode / encode / write time: " << conversion.decodeMs << " / " << conversion.encodeMs << " / " << conversion.writeMs << " ms" << std::endl;
+		return 0;
+	}
+
+	profiler_enable(!options.tracePath.empty());
+	profiler_set_thread_name("main");
+
+	// declared first so the context outlives every OpenGL object below
+	HeadlessContext headlessContext;
+	GLFWwindow* window = NULL;
+	GLADloadproc loadProc = reinterpret_cast<GLADloadproc>(glfwGetProcAddress);
+
+	if (options.headless)
+	{
+		if (!headlessContext.create(3, 3))
+		{
+			std::cout << "Headless context could not be created\n";
+			return -1;
+		}
+		loadProc = HeadlessContext::getProcAddress();
+	}
+	else
+	{
+		// configure window and context
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// create window
+		window = glfwCreateWindow(W, H, WINDOW_TITLE, NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout << "Window could not be created\n";
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
 	}
-	glfwMakeContextCurrent(window);
 
 	// init glad for call OpenGL functions
-	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+	if (!gladLoadGLLoader(loadProc))
 	{
 		std::cout << "Could not load GLAD\n";
 		return -1;
 	}
+	load_gl_extensions(loadProc);
 
 	// register GLFW events
-	glfwSetFramebufferSizeCallback(window, resize_framebuffer_cb);
-
-	// ======================================================================
-	// create new shader
-	const Shader myShader("Shaders/myShader");
-
-	// ======================================================================
-	// tell stb library to flip images in load
-	stbi_set_flip_vertically_on_load(true);
-
-	// load texture data using stb_image header library
-	int i_w, i_h, nrChannels;
-	unsigned char* image_data = stbi_load("wall.jpg", &i_w, &i_h, &nrChannels, 0);
+	if (window != NULL)
+	{
+		glfwSetFramebufferSizeCallback(window, resize_framebuffer_cb);
+	}
 
-	// load awesomeface image data
-	int i2_w, i2_h, nrChannels2;
-	unsigned char* image_data2 = stbi_load("awesomeface.png", &i2_w, &i2_h, &nrChannels2, 0);
+	// reversed-Z falls back to the standard range without glClipControl
+	const DepthMode depthMode = supported_depth_mode(options.depthMode);
 
+	// a headless context has no default framebuffer and the default one of a window has no
+	// float depth, both draw into an offscreen one of the window size (a window gets it blitted)
+	std::unique_ptr<OffscreenFramebuffer> offscreen;
+	if (options.headless || is_reversed_z(depthMode))
+	{
+		offscreen.reset(new OffscreenFramebuffer(W, H, GL_RGBA8, depth_mode_format(depthMode)));
+		if (!offscreen->isComplete())
+		{
+			return -1;
+		}
+		offscreen->bind();
+	}
+	apply_depth_mode(depthMode);
 
 	// ======================================================================
-	// generate first texture
-	unsigned int texture;
-	glGenTextures(1, &texture);
-	// bind for configuration
-	glActiveTexture(GL_TEXTURE0); // activate texture unit 0
-	glBindTexture(GL_TEXTURE_2D, texture);
-	// set the texture wrapping/filtering options (on the currently bound texture object)
-	// configure wrap mode in s and t dimensions
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// configure minification and magnification filters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// put imge_data to previously created opengl texture object
-	if (image_data)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, i_w, i_h, 0, GL_RGB, GL_UNSIGNED_BYTE, image_data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+	// decode the textures and build their mip chains on worker threads while the shader compiles
+	TextureLoader textureLoader;
+	std::future<GLuint> wallTexture, faceTexture;
+	std::future<TextureMipChain> wallMipChain, faceMipChain;
+	if (options.streamTextures)
+	{
+		// handed to the residency manager when decoded, the frames before draw untextured
+		wallMipChain = textureLoader.loadMipChain(options.texturePaths[0]);
+		faceMipChain = textureLoader.loadMipChain(options.texturePaths[1]);
 	}
 	else
 	{
-		std::cout << "Error loading texture data\n";
+		wallTexture = textureLoader.load(options.texturePaths[0]);
+		faceTexture = textureLoader.load(options.texturePaths[1]);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, 0);
-	stbi_image_free(image_data); // free memory
+	// ======================================================================
+	// start compiling the shader (the instanced one reads per-instance transforms and shares the fragment shader),
+	// the driver compiles while the textures are uploaded
+	ShaderBatch shaderBatch;
+	const std::size_t myShaderIndex = shaderBatch.add(instanced ? "Shaders/instanced.vert" : "Shaders/myShader.vert", options.textureAtlas ? "Shaders/atlas.frag" : "Shaders/myShader.frag");
+	shaderBatch.submit();
 
-	// generate second texture
-	unsigned int texture2;
-	glGenTextures(1, &texture2);
-	// activate texture unit 1
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	if (image_data2)
+	// ======================================================================
+	// upload the decoded images through a pixel buffer object, the futures are ready after this
+	// (the streamed ones come in with the frames)
+	GLuint texture = 0;
+	GLuint texture2 = 0;
+	if (!options.streamTextures)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, i2_w, i2_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data2);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		textureLoader.finish();
+		texture = wallTexture.get();
+		texture2 = faceTexture.get();
 	}
-	else
-	{
-		std::cout << "Error loading texture data\n";
 
+	// ======================================================================
+	// create new shader from the batch, waits only if the driver isn't done yet
+	shaderBatch.poll();
+	const Shader myShader = shaderBatch.take(myShaderIndex);
+
+	const ShaderBatchStats shaderBatchStats = shaderBatch.getStats();
+	std::cout << "\n\nSHADER BATCH:\n";
+	std::cout << "Programs: " << shaderBatchStats.programs << " (" << shaderBatchStats.fromBinaryCache << " from the binary cache, " << shaderBatchStats.failed << " failed)" << std::endl;
+	std::cout << "Parallel compile: " << (gl_extensions().parallelShaderCompile ? "yes" : "no") << ", polls still compiling: " << shaderBatchStats.pollsNotReady << std::endl;
+
+	// recompile the programs whose files get saved while the app runs, they are swapped in between frames
+	ShaderHotReload shaderHotReload("Shaders");
+	if (options.hotReload)
+	{
+		const bool watching = window != NULL ? shaderHotReload.start(window) : shaderHotReload.start(headlessContext);
+		if (!watching)
+		{
+			std::cout << "Shader hot reload is disabled\n";
+		}
 	}
 
-	stbi_image_free(image_data2);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	const TextureLoaderStats textureStats = textureLoader.getStats();
+	std::cout << "\n\nTEXTURE LOADER:\n";
+	std::cout << "Workers: " << textureLoader.getWorkerCount() << std::endl;
+	std::cout << "Textures loaded: " << textureStats.texturesLoaded << " (" << textureStats.texturesFailed << " failed, " << textureStats.texturesCompressed << " block compressed)" << std::endl;
+	std::cout << "Bytes uploaded (with mip chains): " << textureStats.bytesUploaded << std::endl;
+	std::cout << "Decode / mipmap / upload time: " << textureStats.decodeMs << " / " << textureStats.mipmapMs << " / " << textureStats.uploadMs << " ms" << std::endl;
+
+	// one texture array for every material: the instances carry the material index, the shader
+	// finds the layers and uv transforms of its two images in the Materials block
+	GLuint texture_array = 0;
+	GLuint material_buffer = 0;
+	std::size_t material_count = 1;
+	if (options.textureAtlas)
+	{
+		const auto atlas_start = std::chrono::steady_clock::now();
+		TextureAtlas atlas;
+		bool atlas_ready;
+		if (!options.atlasPath.empty())
+		{
+			atlas_ready = read_texture_atlas(options.atlasPath, atlas);
+		}
+		else
+		{
+			// the two textures take a layer each, the odd sizes get packed together
+			constexpr int tileSizes[][2] = { { 200, 120 }, { 96, 256 }, { 160, 160 }, { 300, 64 }, { 64, 64 }, { 128, 200 }, { 240, 100 }, { 48, 144 } };
+			std::vector<AtlasImage> images(2);
+			atlas_ready = load_atlas_image("wall.jpg", images[0]) && load_atlas_image("awesomeface.png", images[1]);
+			for (std::size_t i = 0; i < std::size(tileSizes); ++i)
+			{
+				images.push_back(make_atlas_tile(i, tileSizes[i][0], tileSizes[i][1]));
+			}
+			atlas_ready = atlas_ready && pack_texture_atlas(images, atlas);
+		}
+		const double pack_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - atlas_start).count();
+
+		// the program was built for the atlas, there's nothing to fall back to
+		if (!atlas_ready || atlas.regions.empty())
+		{
+			return -1;
+		}
+
+		const auto upload_start = std::chrono::steady_clock::now();
+		texture_array = create_texture_array(atlas);
+
+		// material m blends image m with the next one
+		material_count = std::min(atlas.regions.size(), MAX_MATERIALS);
+		MaterialBlock materials = {};
+		for (std::size_t m = 0; m < material_count; ++m)
+		{
+			materials.materials[m] = make_material(atlas, m, (m + 1) % atlas.regions.size());
+		}
+		material_buffer = create_material_buffer(materials);
+		glFinish();
+		const double upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start).count();
+
+		std::cout << "\n\nTEXTURE ATLAS:\n";
+		std::cout << "Images: " << atlas.regions.size() << (options.atlasPath.empty() ? " (packed at startup)" : " (from " + options.atlasPath + ")") << std::endl;
+		std::cout << "Layers: " << atlas.layers << " of " << atlas.width << "x" << atlas.height << ", " << atlas.imageLayers << " holding one image, "
+			<< atlas.layers - atlas.imageLayers << " shared (occupancy " << atlas_occupancy(atlas) << ")" << std::endl;
+		for (std::size_t i = 0; i < atlas.regions.size(); ++i)
+		{
+			const AtlasRegion& region = atlas.regions[i];
+			std::cout << "  " << atlas.names[i] << ": layer " << region.layer << ", " << region.width << "x" << region.height << " at (" << region.x << ", " << region.y << ")" << std::endl;
+		}
+		std::cout << "Materials: " << material_count << ", texture binds per frame: 1" << std::endl;
+		std::cout << "Pack / upload time: " << pack_ms << " / " << upload_ms << " ms" << std::endl;
+	}
 
 	// ======================================================================
 
@@ -226,6 +535,29 @@ int main(void)
 	};
 #endif // USE_CULL_FACE
 
+	// how the vertices are stored on the GPU, the vertex shaders read floats either way
+	// and map the positions back to [-0.5, 0.5] with uPositionDequant (colors and
+	// texture coordinates already are in the [0, 1] the unorm formats give back)
+	const VertexLayout floatLayout = VertexLayout()
+		.add(0, 3, AttributeFormat::Float32)	// position
+		.add(1, 3, AttributeFormat::Float32)	// color
+		.add(2, 2, AttributeFormat::Float32);	// texture coordinates
+	const VertexLayout compactLayout = VertexLayout()
+		.add(0, 3, AttributeFormat::Snorm16, -0.5f, 0.5f)	// the cube fills [-0.5, 0.5]^3
+		.add(1, 3, AttributeFormat::Unorm8)
+		.add(2, 2, AttributeFormat::Unorm16);
+	const VertexLayout& vertexLayout = options.compactVertices ? compactLayout : floatLayout;
+
+	// weld, reorder for the vertex cache and overdraw, remap for fetch and narrow the indices
+	// (the 24 vertices of the cube fit 8 bit indices)
+	std::vector<float> cube_vertices(std::begin(vertex_data), std::end(vertex_data));
+	std::vector<unsigned int> cube_indices(std::begin(index_drawing_data), std::end(index_drawing_data));
+	const MeshOptimizationReport cube_report = optimize_mesh(cube_vertices, 8, cube_indices, GL_CW);
+	const IndexBuffer cube_index_buffer = narrow_indices(cube_indices, cube_report.verticesAfter);
+
+	const size_t vertex_count = cube_report.verticesAfter;
+	const std::vector<unsigned char> packed_vertex_data = vertexLayout.pack(cube_vertices.data(), vertex_count, 8);
+
 	// generate VAO for store status of subsequent "vertex attribute" calls and element array buffer configs
 	unsigned int VAO;
 	glGenVertexArrays(1, &VAO);
@@ -238,7 +570,7 @@ int main(void)
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	// copy data from CPU to GPU
 	//		use the currently bounded buffer to GL_ARRAY_BUFFER as container
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_data), vertex_data, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, packed_vertex_data.size(), packed_vertex_data.data(), GL_STATIC_DRAW);
 
 	// tell OpenGL how it should interpret the vertex data(per
 	// vertex attribute) using glVertexAttribPointer:
@@ -249,22 +581,31 @@ int main(void)
 	//						stride = [distance in bytes between each "position" ternas in VBO],
 	//						start = [whare is the start index of "position"?];
 
-	// indicate which part of vertex data are vertex positions
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0); // enable the vertex attribute at location 0
-
-	// indicate which part of vertex data are vertex colors
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1); // enable the vertex attribute at location 1
-
-	// indicate which part of vertex data are texture coordinates
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2); // enable the vertex attribute at location 2
+	// one glVertexAttribPointer per attribute of the layout:
+	//		position			location 0
+	//		color				location 1
+	//		texture coordinates	location 2
+	vertexLayout.apply();
 
 	std::cout << "\n\nGL_ARRAY_BUFFER:\n";
-	std::cout << "sizeof(float): " << sizeof(float) << " bytes" << std::endl;
-	std::cout << "Num of indices at GL_ARRAY_BUFFER: " << sizeof(vertex_data) / sizeof(float) << std::endl;
-	std::cout << "Size reserved for GL_ARRAY_BUFFER: " << sizeof(vertex_data) << " bytes" << std::endl;
+	std::cout << "Vertex layout:";
+	for (const VertexAttribute& attribute : vertexLayout.getAttributes())
+	{
+		std::cout << " " << attribute_format_name(attribute.format) << "x" << attribute.components;
+	}
+	std::cout << " (" << vertexLayout.getStride() << " bytes per vertex)" << std::endl;
+	std::cout << "Num of vertices at GL_ARRAY_BUFFER: " << vertex_count << std::endl;
+	std::cout << "Size reserved for GL_ARRAY_BUFFER: " << packed_vertex_data.size() << " bytes (" << sizeof(vertex_data) << " as floats)" << std::endl;
+
+	// what the vertex shader gets back, against the float data
+	std::vector<float> unpacked_vertex_data(vertex_count * 8);
+	vertexLayout.unpack(packed_vertex_data.data(), vertex_count, unpacked_vertex_data.data(), 8);
+	float quantization_error = 0.0f;
+	for (size_t i = 0; i < unpacked_vertex_data.size(); ++i)
+	{
+		quantization_error = std::max(quantization_error, std::abs(unpacked_vertex_data[i] - cube_vertices[i]));
+	}
+	std::cout << "Max quantization error: " << quantization_error << std::endl;
 
 	// generate EBO
 	unsigned int EBO;
@@ -272,14 +613,239 @@ int main(void)
 	// bind EBO to GL_ELEMENT_ARRAY_BUFFER
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 	// pass EBO data from CPU to GPU
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_drawing_data), index_drawing_data, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, cube_index_buffer.data.size(), cube_index_buffer.data.data(), GL_STATIC_DRAW);
 
 	std::cout << "\n\nGL_ELEMENT_ARRAY_BUFFER:\n";
-	std::cout << "sizeof(unsigned int): " << sizeof(unsigned int) << " bytes" << std::endl;
-	std::cout << "Num of indices at GL_ELEMENT_ARRAY_BUFFER: " << sizeof(index_drawing_data) / sizeof(unsigned int) << std::endl;
-	std::cout << "Size reserved for GL_ELEMENT_ARRAY_BUFFER: " << sizeof(index_drawing_data) << " bytes" << std::endl;
+	std::cout << "Index size: " << index_type_size(cube_index_buffer.type) << " bytes" << std::endl;
+	std::cout << "Num of indices at GL_ELEMENT_ARRAY_BUFFER: " << cube_index_buffer.count << std::endl;
+	std::cout << "Size reserved for GL_ELEMENT_ARRAY_BUFFER: " << cube_index_buffer.data.size() << " bytes (" << sizeof(index_drawing_data) << " as 32 bit indices)" << std::endl;
+
+	// the cube is already optimal, a shuffled grid shows what the reordering does (on request,
+	// building and optimizing it takes tens of ms)
+	std::vector<std::pair<const char*, MeshOptimizationReport>> mesh_reports = { { "Cube", cube_report } };
+	double grid_ms = 0.0;
+	if (options.meshOptimizerReport)
+	{
+		std::vector<float> grid_vertices;
+		std::vector<unsigned int> grid_indices;
+		make_shuffled_grid(256, grid_vertices, grid_indices);
+		const auto grid_start = std::chrono::steady_clock::now();
+		mesh_reports.emplace_back("Shuffled 256x256 grid", optimize_mesh(grid_vertices, 8, grid_indices));
+		grid_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - grid_start).count();
+	}
+
+	std::cout << "\n\nMESH OPTIMIZER (FIFO cache of " << MESH_CACHE_SIZE << " vertices):\n";
+	for (const auto& mesh_report : mesh_reports)
+	{
+		const MeshOptimizationReport& r = mesh_report.second;
+		std::cout << mesh_report.first << ": " << r.triangles << " triangles, vertices " << r.verticesBefore << " -> " << r.verticesAfter
+			<< ", ACMR " << r.acmrBefore << " -> " << r.acmrAfter << " (ATVR " << r.atvrAfter << ", " << r.clusters << " clusters)"
+			<< ", indices " << r.indexBytesBefore << " -> " << r.indexBytesAfter << " bytes" << std::endl;
+	}
+	if (options.meshOptimizerReport)
+	{
+		std::cout << "Grid optimized in " << grid_ms << " ms" << std::endl;
+	}
+
+	// a converted mesh replaces the cube, uploaded straight from the file mapping
+	// (left bound so the instance attributes below go into its vertex array)
+	MeshBuffers mesh_buffers;
+	VertexLayout mesh_layout;
+	Affine3 mesh_fit = Affine3::identity();
+	if (!options.meshPath.empty() && options.poolMeshes == 0)
+	{
+		const auto mesh_start = std::chrono::steady_clock::now();
+		const MeshFile mesh_file(options.meshPath);
+		mesh_buffers = mesh_file.upload();
+		glFinish();
+		const double mesh_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mesh_start).count();
+
+		if (mesh_file.isOpen())
+		{
+			const MeshFileHeader& header = mesh_file.getHeader();
+			mesh_layout = mesh_file.getLayout();
+
+			// centered and scaled into the [-0.5, 0.5] the cube fills
+			float center[3], extent = 0.0f;
+			for (int c = 0; c < 3; ++c)
+			{
+				center[c] = 0.5f * (header.boundsMin[c] + header.boundsMax[c]);
+				extent = std::max(extent, header.boundsMax[c] - header.boundsMin[c]);
+			}
+			const float fit_scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+			mesh_fit = Affine3::scale(fit_scale, fit_scale, fit_scale) * Affine3::translation(-center[0], -center[1], -center[2]);
+
+			const double mesh_bytes = static_cast<double>(header.vertexBytes + header.indexBytes);
+			std::cout << "\n\nMESH FILE:\n";
+			std::cout << options.meshPath << ": " << header.indexCount / 3 << " triangles, " << header.vertexCount << " vertices, "
+				<< header.submeshCount << " submeshes" << std::endl;
+			std::cout << "Vertex layout:";
+			for (const VertexAttribute& attribute : mesh_layout.getAttributes())
+			{
+				std::cout << " " << attribute.location << ":" << attribute_format_name(attribute.format) << "x" << attribute.components;
+			}
+			std::cout << " (" << header.vertexStride << " bytes per vertex), " << index_type_size(header.indexType) << " byte indices" << std::endl;
+			for (std::uint32_t s = 0; s < header.submeshCount; ++s)
+			{
+				const MeshFileSubmesh& submesh = mesh_file.getSubmeshes()[s];
+				std::cout << "Submesh " << submesh.name << ": " << submesh.indexCount / 3 << " triangles" << std::endl;
+			}
+			std::cout << "Map and upload: " << mesh_ms << " ms (" << mesh_bytes / (mesh_ms * 1000.0) << " MB/s)" << std::endl;
+		}
+	}
 
-	std::cout << "\n\nTOTAL BYTES SENT TO GPU: " << sizeof(index_drawing_data) + sizeof(vertex_data) << " bytes" << std::endl;
+	// distinct shapes in one vertex buffer, index buffer and VAO (left bound for the instance
+	// attributes below). The instances are split in poolMeshes runs, one shape each
+	std::unique_ptr<GeometryPool> geometry_pool;
+	std::vector<GeometryHandle> pool_meshes;
+	if (instanced && options.poolMeshes > 0)
+	{
+		// a scratch shape after every second one, removed again to leave the pool fragmented
+		std::vector<std::vector<unsigned char>> shape_vertices;
+		std::vector<std::vector<unsigned int>> shape_indices;
+		std::uint32_t total_vertices = 0, total_indices = 0;
+		for (std::size_t shape = 0; shape < options.poolMeshes + (options.poolMeshes + 1) / 2; ++shape)
+		{
+			std::vector<float> vertices;
+			std::vector<unsigned int> indices;
+			make_pool_mesh(shape, vertices, indices);
+			const MeshOptimizationReport report = optimize_mesh(vertices, 8, indices, GL_CW);
+			shape_vertices.push_back(vertexLayout.pack(vertices.data(), report.verticesAfter, 8));
+			shape_indices.push_back(indices);
+			total_vertices += static_cast<std::uint32_t>(report.verticesAfter);
+			total_indices += static_cast<std::uint32_t>(indices.size());
+		}
+
+		geometry_pool.reset(new GeometryPool(vertexLayout, total_vertices, total_indices));
+		const std::uint32_t stride = static_cast<std::uint32_t>(vertexLayout.getStride());
+		const auto add_shape = [&](const std::size_t shape)
+		{
+			return geometry_pool->add(shape_vertices[shape].data(), static_cast<std::uint32_t>(shape_vertices[shape].size() / stride),
+				shape_indices[shape].data(), static_cast<std::uint32_t>(shape_indices[shape].size()));
+		};
+		std::vector<GeometryHandle> scratch;
+		for (std::size_t shape = 0; shape < options.poolMeshes; ++shape)
+		{
+			pool_meshes.push_back(add_shape(shape));
+			if (shape % 2 == 0)
+			{
+				scratch.push_back(add_shape(options.poolMeshes + shape / 2));
+			}
+		}
+		for (const GeometryHandle mesh : scratch)
+		{
+			geometry_pool->remove(mesh);
+		}
+		const GeometryPoolStats fragmented = geometry_pool->getStats();
+		const auto defragment_start = std::chrono::steady_clock::now();
+		geometry_pool->defragment();
+		glFinish();
+		const double defragment_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - defragment_start).count();
+		const GeometryPoolStats compacted = geometry_pool->getStats();
+		glBindVertexArray(geometry_pool->getVertexArray());
+
+		std::cout << "\n\nGEOMETRY POOL:\n";
+		std::cout << "Meshes: " << compacted.meshes << ", vertices " << compacted.verticesUsed << " / " << compacted.vertexCapacity
+			<< ", indices " << compacted.indicesUsed << " / " << compacted.indexCapacity << " (" << index_type_size(geometry_pool->getIndexType()) << " bytes each)" << std::endl;
+		std::cout << "Free vertex blocks after removing " << scratch.size() << " meshes: " << fragmented.freeVertexBlocks << " (largest " << fragmented.largestFreeVertexBlock
+			<< "), index blocks: " << fragmented.freeIndexBlocks << " (largest " << fragmented.largestFreeIndexBlock << ")" << std::endl;
+		std::cout << "After defragmenting: " << compacted.freeVertexBlocks << " (largest " << compacted.largestFreeVertexBlock << "), "
+			<< compacted.freeIndexBlocks << " (largest " << compacted.largestFreeIndexBlock << "), " << compacted.bytesMoved << " bytes moved in " << defragment_ms << " ms" << std::endl;
+	}
+
+	// per-instance transforms, stored in the VAO next to the vertex attributes. Rewritten every
+	// frame when culled or animated: then streamed through fenced regions instead of a static buffer
+	const bool stream_instances = instanced && (options.culling != AppOptions::Culling::Off || options.animateInstances);
+	GLuint instanceVBO = 0;
+	std::unique_ptr<StreamingBuffer> instance_stream;
+	std::vector<InstanceData> instance_data;
+	SphereBounds instance_bounds;
+	std::unique_ptr<BoundingVolumeHierarchy> instance_bvh;
+	if (instanced)
+	{
+		instance_data = make_instance_grid(options.instances, options.instanceExtent);
+		if (texture_array != 0)
+		{
+			// a pool shape keeps one material, the other instances go round the materials
+			for (std::size_t i = 0; i < instance_data.size(); ++i)
+			{
+				const std::size_t shape = geometry_pool ? i * pool_meshes.size() / instance_data.size() : i;
+				instance_data[i].material = static_cast<std::uint32_t>(shape % material_count);
+			}
+		}
+		if (stream_instances)
+		{
+			instance_stream.reset(new StreamingBuffer(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instance_data.size() * sizeof(InstanceData))));
+			point_instance_attributes(instance_stream->getBuffer(), instance_stream->getRegionOffset());
+		}
+		else
+		{
+			instanceVBO = create_instance_buffer(instance_data);
+		}
+
+		// the model (cube, fitted mesh or pool shape) fits [-0.5, 0.5]^3 in any rotation, scaled per instance
+		constexpr float model_radius = 0.8660254f; // sqrt(3) / 2
+		BoxBounds instance_boxes;
+		for (const InstanceData& instance : instance_data)
+		{
+			const float radius = model_radius * instance.offsetScale[3];
+			instance_bounds.add(instance.offsetScale[0], instance.offsetScale[1], instance.offsetScale[2], radius);
+			const float minimum[3] = { instance.offsetScale[0] - radius, instance.offsetScale[1] - radius, instance.offsetScale[2] - radius };
+			const float maximum[3] = { instance.offsetScale[0] + radius, instance.offsetScale[1] + radius, instance.offsetScale[2] + radius };
+			instance_boxes.add(minimum, maximum);
+		}
+		if (options.culling == AppOptions::Culling::Bvh)
+		{
+			instance_bvh.reset(new BoundingVolumeHierarchy(instance_boxes));
+		}
+
+		std::cout << "\n\nINSTANCES:\n";
+		std::cout << "Num of instances: " << options.instances << std::endl;
+		std::cout << "Size reserved for instance data: " << options.instances * sizeof(InstanceData) << " bytes" << std::endl;
+	}
+
+	std::cout << "\n\nTOTAL BYTES SENT TO GPU: " << cube_index_buffer.data.size() + packed_vertex_data.size() + options.instances * sizeof(InstanceData) << " bytes" << std::endl;
+
+	// check the CPU-side batch transform kernels (used for picking, culling, readback) against the scalar reference
+	const General4 check_mvp = Perspective::fromProjection(my_perspective(0.785398163f, static_cast<float>(W) / H, 0.1f, 50.0f)) * Affine3::translation(0.0f, 0.0f, -3.0f);
+	std::cout << "\n\nCPU VERTEX TRANSFORM KERNEL: " << transform_kernel_name(best_transform_kernel()) << std::endl;
+	std::cout << "Max error against scalar reference: " << check_transform_kernels(check_mvp, cube_vertices.data(), vertex_count, 8 * sizeof(float)) << std::endl;
+
+	// the constexpr projections against glm, every variant the depth modes use
+	std::cout << "\n\nPROJECTION:\n";
+	for (const ProjectionVariant variant : projection_variants)
+	{
+		const float error = check_projection(variant);
+		std::cout << (error > 1e-6f ? "ERROR " : "") << "Max relative error against glm (" << projection_variant_name(variant) << "): " << error << std::endl;
+	}
+	if (options.projectionBenchmarkMatrices > 0)
+	{
+		std::cout << "\n\nPROJECTION BENCHMARK:\n";
+		std::cout << "Matrices per variant: " << options.projectionBenchmarkMatrices << std::endl;
+		for (const ProjectionVariant variant : projection_variants)
+		{
+			const ProjectionTiming timing = measure_projection(variant, options.projectionBenchmarkMatrices);
+			std::cout << "Projection " << projection_variant_name(variant) << ": " << timing.mine << " ns per matrix, glm " << timing.glm << " ns"
+				<< ", heap allocations " << timing.mineAllocations << " / " << timing.glmAllocations << " (checksum " << timing.checksum << ")" << std::endl;
+		}
+	}
+
+	// inverse(x) * x of every shape, the perspective one is closed form
+	const MatrixInverseErrors inverse_errors = check_matrix_inverses();
+	std::cout << "\n\nMATRIX TYPES:\n";
+	std::cout << "Max error of inverse(x) * x against identity (general / affine / perspective): "
+		<< inverse_errors.general << " / " << inverse_errors.affine << " / " << inverse_errors.perspective << std::endl;
+	if (options.matrixBenchmarkOperations > 0)
+	{
+		std::cout << "\n\nMATRIX BENCHMARK:\n";
+		std::cout << "Operations per kernel: " << options.matrixBenchmarkOperations << std::endl;
+		for (const MatrixOperation operation : matrix_operations)
+		{
+			const MatrixTiming timing = measure_matrix_operation(operation, options.matrixBenchmarkOperations);
+			std::cout << "Structured " << matrix_operation_name(operation) << ": " << timing.structured << " ns, glm::mat4 " << timing.glm << " ns"
+				<< ", heap allocations " << timing.structuredAllocations << " / " << timing.glmAllocations << " (checksum " << timing.checksum << ")" << std::endl;
+		}
+	}
 	// ======================================================================
 	// update and draw commands
 
@@ -294,15 +860,30 @@ int main(void)
 #else
 	glEnable(GL_DEPTH_TEST);
 #endif // USE_CULL_FACE
-	/*bind opengl object "texture" to GL_TEXTURE_2D target
-	in texture unit 0 (GL_TEXTURE0)*/
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-
-	/*bind opengl object "texture2" to GL_TEXTURE_2D target
-	in texture unit 1 (GL_TEXTURE0)*/
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, texture2);
+	// culling alone can't sort overlapping cubes
+	const bool depthTest = instanced;
+	if (depthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	if (texture_array != 0)
+	{
+		// every image of every material, for the whole frame
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+	}
+	else
+	{
+		/*bind opengl object "texture" to GL_TEXTURE_2D target
+		in texture unit 0 (GL_TEXTURE0)*/
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		/*bind opengl object "texture2" to GL_TEXTURE_2D target
+		in texture unit 1 (GL_TEXTURE0)*/
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, texture2);
+	}
 
 	/*
 	Note that finding the uniform location does not require
@@ -315,78 +896,863 @@ int main(void)
 	// use shader program and pass uniforms
 	myShader.use();	//glUseProgram(shader_program); // use a shader program
 
-	// locate uTime uniform
-	const int uTimeLoc = glGetUniformLocation(myShader.getId(), "uTime");
+	// uniform names hashed at compile time, the shader resolves them through
+	// its uniform location cache so no glGetUniformLocation happens per frame
+	constexpr UniformName uTime = "uTime"_uniform;
+	constexpr UniformName uTextureA = "uTextureA"_uniform;
+	constexpr UniformName uTextureB = "uTextureB"_uniform;
+	constexpr UniformName uTextures = "uTextures"_uniform;
+	constexpr UniformName uModel = "uModel"_uniform;
 
 	// specify what texture unit should use the uniform GLSL sampler uTextureA
-	const int uTexALoc = glGetUniformLocation(myShader.getId(), "uTextureA");
-	glUniform1i(uTexALoc, 0); // use texture unit 0
+	myShader.setInt(uTextureA, 0); // use texture unit 0
 
 	// specify what texture unit should use the uniform GLSL sampler uTextureB
-	const int uTexBLoc = glGetUniformLocation(myShader.getId(), "uTextureB");
-	glUniform1i(uTexBLoc, 1); // use texture unit 1
+	myShader.setInt(uTextureB, 1); // use texture unit 1
+
+	// the texture array of the atlas program, unit 0 too
+	myShader.setInt(uTextures, 0);
 
-	// get uniform uModel, uView and uProj location at shader program
-	const int uModelLoc = glGetUniformLocation(myShader.getId(), "uModel");
-	const int uViewLoc = glGetUniformLocation(myShader.getId(), "uView");
-	const int uProjLoc = glGetUniformLocation(myShader.getId(), "uProj");
+	// positions stored normalized go back to model space with v * scale + bias
+	constexpr UniformName uPositionDequant = "uPositionDequant"_uniform;
+	const AttributeDequantization positionDequant = VertexLayout::dequantization(*(mesh_buffers.vertexArray != 0 ? mesh_layout : vertexLayout).find(0));
+	myShader.setVec2(uPositionDequant, positionDequant.scale, positionDequant.bias);
 
-	while (!glfwWindowShouldClose(window))
+	if (options.fetchBenchmarkVertices > 0)
 	{
+		// same attributes stored three ways, drawn as points without rasterization
+		const VertexLayout halfLayout = VertexLayout()
+			.add(0, 3, AttributeFormat::Half)
+			.add(1, 3, AttributeFormat::Unorm8)
+			.add(2, 2, AttributeFormat::Unorm16);
+		const VertexLayout* fetchLayouts[] = { &floatLayout, &halfLayout, &compactLayout };
+		const std::vector<float> fetchMesh = make_fetch_benchmark_mesh(options.fetchBenchmarkVertices);
+
+		std::cout << "\n\nVERTEX FETCH BENCHMARK:\n";
+		std::cout << "Vertices per draw: " << options.fetchBenchmarkVertices << std::endl;
+		for (const VertexLayout* layout : fetchLayouts)
+		{
+			const AttributeDequantization dequant = VertexLayout::dequantization(*layout->find(0));
+			myShader.setVec2(uPositionDequant, dequant.scale, dequant.bias);
+			const double ms = measure_vertex_fetch(*layout, fetchMesh.data(), options.fetchBenchmarkVertices, 8, 15);
+
+			std::cout << "Position " << attribute_format_name(layout->getAttributes()[0].format) << ", " << layout->getStride() << " bytes per vertex: "
+				<< ms << " ms per draw, " << static_cast<double>(options.fetchBenchmarkVertices) / (ms * 1000.0) << " M vertices/s" << std::endl;
+		}
+		myShader.setVec2(uPositionDequant, positionDequant.scale, positionDequant.bias);
+	}
+
+	if (options.cameraBenchmarkPrograms > 0)
+	{
+		std::cout << "\n\nCAMERA UNIFORM BENCHMARK:\n";
+		std::cout << "Programs: " << options.cameraBenchmarkPrograms << ", draws per frame: " << options.cameraBenchmarkDraws << std::endl;
+		const CameraUpdateTiming timing = measure_camera_updates(options.cameraBenchmarkPrograms, options.cameraBenchmarkDraws, 30);
+		std::cout << "Camera uniform block: " << timing.uniformBlock << " ms per frame" << std::endl;
+		std::cout << "Camera uniforms of every program: " << timing.perProgramUniforms << " ms per frame" << std::endl;
+		myShader.use();
+	}
+
+	// create projection matrix (evaluated at compile time, no heap memory involved)
+	constexpr float fovY = 0.785398163f; // 45 degrees
+	constexpr float aspect = static_cast<float>(W) / H;
+	constexpr float zNear = 0.1f;
+	constexpr float zFar = 50.0f;
+	constexpr ProjectionMatrix standardProjection = my_perspective(fovY, aspect, zNear, zFar);
+	constexpr ProjectionMatrix reversedProjection = my_perspective_reversed_z(fovY, aspect, zNear, zFar);
+	constexpr ProjectionMatrix reversedInfiniteProjection = my_perspective_infinite_reversed_z(fovY, aspect, zNear);
+	const ProjectionMatrix& myOwnProjectionMatrix = depthMode == DepthMode::ReversedZInfinite ? reversedInfiniteProjection
+		: depthMode == DepthMode::ReversedZ ? reversedProjection : standardProjection;
+
+	std::cout << "\n\nDEPTH BUFFER:\n";
+	std::cout << "Mode: " << depth_mode_name(depthMode) << std::endl;
+	std::cout << "Smallest resolvable depth step (standard / reversed-Z / reversed-Z infinite), near " << zNear << ", far " << zFar << ":" << std::endl;
+	for (const double distance : { 1.0, 10.0, 49.0, 1000.0, 100000.0 })
+	{
+		std::cout << "  at " << distance << ": " << depth_resolution(DepthMode::Standard, zNear, zFar, distance)
+			<< " / " << depth_resolution(DepthMode::ReversedZ, zNear, zFar, distance)
+			<< " / " << depth_resolution(DepthMode::ReversedZInfinite, zNear, zFar, distance) << std::endl;
+	}
+
+	// indices of the instances that passed culling this frame, gathered (and animated) straight into instance_stream
+	std::vector<std::uint32_t> visible_ids(instance_bounds.size());
+	std::size_t visible_count = instance_data.size();
+
+	// the ids of the draw list, in its order: a flat cull leaves the visible ids of every job at the
+	// job's first instance and compacts them here, the other paths write them compacted in visible_ids
+	std::vector<std::uint32_t> drawn_ids(instance_bounds.size());
+	const std::uint32_t* draw_ids = visible_ids.data();
+	unsigned long long culled_frames = 0, visible_total = 0;
+	BvhCullStats bvh_stats = {};
+
+	// the GL thread only submits the scene update, the workers run it and write the draw list into the mapped region
+	// in jobs of instanceJobGrain instances (a flat cull writes the visible ones of a job at its first instance)
+	constexpr std::size_t instanceJobGrain = 4096;
+	std::unique_ptr<JobSystem> scene_jobs;
+	std::vector<std::size_t> job_visible, job_offsets;
+	unsigned long long update_frames = 0;
+	double update_ms_total = 0.0;
+	if (stream_instances)
+	{
+		scene_jobs.reset(new JobSystem(options.jobWorkers));
+		const std::size_t job_count = (instance_data.size() + instanceJobGrain - 1) / instanceJobGrain;
+		job_visible.resize(job_count);
+		job_offsets.resize(job_count);
+	}
+	for (std::size_t i = 0; i < visible_ids.size(); ++i)
+	{
+		visible_ids[i] = static_cast<std::uint32_t>(i); // every instance when nothing is culled
+	}
+
+	// the pool draws: one command per shape with visible instances, the commands of a material
+	// next to each other and streamed to the GPU for glMultiDrawElementsIndirect.
+	// With the atlas the material is per instance data and every command goes in one bucket
+	constexpr std::size_t poolMaterials = 2;
+	const std::size_t pool_buckets = texture_array != 0 ? 1 : poolMaterials;
+	std::vector<DrawElementsIndirectCommand> pool_commands;
+	std::unique_ptr<StreamingBuffer> indirect_stream;
+	unsigned long long pool_frames = 0, pool_draw_calls = 0, pool_commands_total = 0;
+	if (geometry_pool && gl_extensions().multiDrawIndirect)
+	{
+		indirect_stream.reset(new StreamingBuffer(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(pool_meshes.size() * sizeof(DrawElementsIndirectCommand))));
+	}
+
+	// view and projection go to every program through the shared Camera uniform block
+	CameraUniformBuffer cameraBuffer;
+
+	// streamed textures: the mip tails are resident once decoded, the finer levels follow the size of
+	// the largest cube on screen. The frames changing the residency get a line each
+	std::unique_ptr<TextureResidency> texture_residency;
+	bool streamed_textures_added = false;
+	unsigned long long residency_frames = 0, settled_frame = 0;
+	double resident_bytes_total = 0.0, pending_levels_total = 0.0;
+	std::size_t resident_bytes_peak = 0;
+	if (options.streamTextures)
+	{
+		texture_residency.reset(new TextureResidency(options.textureBudget));
+		std::cout << "\n\nTEXTURE STREAMING (frames that changed the residency):\n";
+	}
+
+	// frame statistics for measuring draw throughput
+	using Clock = std::chrono::steady_clock;
+	FrameStats frameStats(options.headless ? static_cast<std::size_t>(options.frames) : 0);
+	unsigned long long frames = 0;
+
+	if (scene_jobs)
+	{
+		// utilization over the frames only
+		scene_jobs->resetStats();
+	}
+
+	while (options.headless ? frames < options.warmupFrames + options.frames : !glfwWindowShouldClose(window))
+	{
+		const Clock::time_point frameStart = Clock::now();
+		PROFILE_SCOPE("frame");
+
+		// frame boundary: programs rebuilt by the hot reload worker replace the old ones here
+		shaderHotReload.applyReloads();
+
+		// a window drawing through the offscreen target: the resize callback moved the viewport to the window size
+		if (offscreen && window != NULL)
+		{
+			offscreen->bind();
+		}
+
 		glClearColor(0.2f, 0.5f, 0.2f, 1.0f); // set the clear color
 #ifdef USE_CULL_FACE
-		glClear(GL_COLOR_BUFFER_BIT);
+		glClear(depthTest ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
 #else
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // clear color buffer bitfield
 #endif // USE_CULL_FACE
 
-		process_input(window);
+		if (window != NULL)
+		{
+			process_input(window);
+		}
 
-		const auto t = static_cast<float>(glfwGetTime());
-		float s = 0.5f + 0.5f * sin(static_cast<float>(glfwGetTime()));
+		// headless runs advance a fixed 60 Hz step so every run renders the same frames
+		const auto t = options.headless ? static_cast<float>(frames) / 60.0f : static_cast<float>(glfwGetTime());
 
-		glUniform1f(uTimeLoc, t);
+		myShader.setFloat(uTime, t);
 
-		// create model matrix
-		glm::mat4 model;
-		model = glm::rotate(model, t, glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::rotate(model, t, glm::vec3(1.0f, 0.0f, 0.0f));
-		glUniformMatrix4fv(uModelLoc, 1, GL_FALSE, glm::value_ptr(model)); // GLint location,	GLsizei count,	GLboolean transpose, const GLfloat* value
+		// create model matrix (two affine rotations, multiplied without the constant last row)
+		const Affine3 model = Affine3::rotation(t, 0.0f, 1.0f, 0.0f) * Affine3::rotation(t, 1.0f, 0.0f, 0.0f) * mesh_fit;
+		myShader.setMatrix(uModel, model.toGeneral4().data()); // glUniformMatrix4fv(location, count = 1, transpose = GL_FALSE, value)
 
 		// create view matrix
-		glm::mat4 view = glm::mat4(1.0f);
-		view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f)); // note that we're translating the scene in the reverse direction of where we want to move
-		glUniformMatrix4fv(uViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+		const Affine3 view = Affine3::translation(0.0f, 0.0f, -3.0f); // note that we're translating the scene in the reverse direction of where we want to move
 
 		// create projection matrix
 		/*glm::mat4 projection;
 		projection = glm::perspective(glm::radians(45.0f), static_cast<float>(W / H), 0.1f, 100.0f);
 		glUniformMatrix4fv(uProjLoc, 1, GL_FALSE, glm::value_ptr(projection));*/
 
-		const float* myOwnProjectionMatrix = my_perspective(glm::radians(45.0f), static_cast<float>(W / H), 0.1f, 50.0f);
-		glUniformMatrix4fv(uProjLoc, 1, false, myOwnProjectionMatrix);
-		delete myOwnProjectionMatrix; // Free heap memory
-
-		glBindVertexArray(VAO); // bind object VAO
+		// one memcpy updates the camera of every program
+		CameraBlock camera;
+		camera.view = view.toGeneral4();
+		camera.proj = General4::fromProjection(myOwnProjectionMatrix);
+		camera.viewProj = Perspective::fromProjection(myOwnProjectionMatrix) * view;
+		camera.position[0] = 0.0f;
+		camera.position[1] = 0.0f;
+		camera.position[2] = 3.0f;
+		camera.position[3] = 1.0f;
+		cameraBuffer.update(camera);
+
+		if (scene_jobs)
+		{
+			PROFILE_SCOPE("scene update");
+			const Clock::time_point updateStart = Clock::now();
+			// no far plane to build from the parameters with an infinite projection
+			const Frustum frustum = depthMode == DepthMode::ReversedZInfinite ? frustum_from_matrix(camera.viewProj, true) : frustum_from_perspective(fovY, aspect, zNear, zFar, view);
+
+			// instances of the draw list, animated to this frame when asked
+			const auto build_draw_list = [&](const std::uint32_t* ids, const std::size_t count, InstanceData* out)
+			{
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					out[i] = options.animateInstances ? animate_instance(instance_data[ids[i]], ids[i], t) : instance_data[ids[i]];
+				}
+			};
+			const std::function<void(std::size_t, std::size_t)> cull_job = [&](const std::size_t begin, const std::size_t end)
+			{
+				job_visible[begin / instanceJobGrain] = cull_spheres(frustum, instance_bounds, begin, end - begin, visible_ids.data() + begin);
+			};
+			InstanceData* draw_list = nullptr;
+			const std::function<void(std::size_t, std::size_t)> gather_culled_job = [&](const std::size_t begin, const std::size_t)
+			{
+				const std::size_t job = begin / instanceJobGrain;
+				build_draw_list(visible_ids.data() + begin, job_visible[job], draw_list + job_offsets[job]);
+				std::copy(visible_ids.data() + begin, visible_ids.data() + begin + job_visible[job], drawn_ids.data() + job_offsets[job]);
+			};
+			const std::function<void(std::size_t, std::size_t)> gather_job = [&](const std::size_t begin, const std::size_t end)
+			{
+				build_draw_list(visible_ids.data() + begin, end - begin, draw_list + begin);
+			};
+
+			JobCounter culled, gathered;
+			if (options.culling == AppOptions::Culling::Flat)
+			{
+				scene_jobs->parallelFor(instance_data.size(), instanceJobGrain, cull_job, culled);
+				scene_jobs->wait(culled);
+
+				// where every job's visible instances start in the draw list
+				visible_count = 0;
+				for (std::size_t job = 0; job < job_visible.size(); ++job)
+				{
+					job_offsets[job] = visible_count;
+					visible_count += job_visible[job];
+				}
+			}
+			else if (instance_bvh)
+			{
+				// the hierarchy is walked by a single job
+				// in hierarchy order, sorted back for the pool that expects every shape's instances together
+				scene_jobs->submit([&]
+				{
+					visible_count = instance_bvh->cull(frustum, visible_ids.data(), &bvh_stats);
+					if (geometry_pool)
+					{
+						std::sort(visible_ids.begin(), visible_ids.begin() + visible_count);
+					}
+				}, culled);
+				scene_jobs->wait(culled);
+			}
+
+			// mapped after culling, which gave the GPU the most time to release the region
+			draw_list = static_cast<InstanceData*>(instance_stream->beginWrite());
+			if (draw_list == nullptr)
+			{
+				visible_count = 0;
+			}
+			else if (options.culling == AppOptions::Culling::Flat)
+			{
+				// one gather per cull job
+				scene_jobs->parallelFor(instance_data.size(), instanceJobGrain, gather_culled_job, gathered);
+				scene_jobs->wait(gathered);
+				draw_ids = drawn_ids.data();
+			}
+			else
+			{
+				scene_jobs->parallelFor(visible_count, instanceJobGrain, gather_job, gathered);
+				scene_jobs->wait(gathered);
+			}
+			instance_stream->endWrite(static_cast<GLsizeiptr>(visible_count * sizeof(InstanceData)));
+			update_ms_total += std::chrono::duration<double, std::milli>(Clock::now() - updateStart).count();
+			++update_frames;
+			if (options.culling != AppOptions::Culling::Off)
+			{
+				visible_total += visible_count;
+				++culled_frames;
+			}
+		}
+
+		if (texture_residency)
+		{
+			// added together so the wall is handle 0 and the face 1
+			if (!streamed_textures_added && wallMipChain.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+				&& faceMipChain.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				texture_residency->add(wallMipChain.get());
+				texture_residency->add(faceMipChain.get());
+				streamed_textures_added = true;
+			}
+			if (streamed_textures_added)
+			{
+				// a cube side at the nearest point of the bounding sphere: the visible instances, else the cube fitted to [-0.5, 0.5]^3 at the origin
+				constexpr float cube_radius = 0.8660254f; // sqrt(3) / 2
+				float screen_size = 0.0f;
+				for (std::size_t i = 0; instanced && i < visible_count; ++i)
+				{
+					const std::uint32_t id = draw_ids[i];
+					const float view_z = view.m[2] * instance_bounds.x[id] + view.m[5] * instance_bounds.y[id] + view.m[8] * instance_bounds.z[id] + view.m[11];
+					screen_size = std::max(screen_size, projected_size(myOwnProjectionMatrix, instance_data[id].offsetScale[3], -view_z - instance_bounds.radius[id], H));
+				}
+				if (!instanced)
+				{
+					screen_size = projected_size(myOwnProjectionMatrix, 1.0f, -view.m[11] - cube_radius, H);
+				}
+				for (std::size_t handle = 0; handle < 2; ++handle)
+				{
+					texture_residency->request(handle, needed_mip_level(texture_residency->getSize(handle), screen_size));
+				}
+			}
+			texture_residency->update();
+
+			const TextureResidencyStats residency = texture_residency->getStats();
+			if (residency.levelsUploaded > 0 || residency.levelsEvicted > 0)
+			{
+				std::cout << "Frame " << frames << ": " << residency.residentBytes << " bytes resident, " << residency.pendingLevels << " levels pending (" << residency.pendingBytes
+					<< " bytes), " << residency.bytesUploaded << " bytes uploaded, " << residency.levelsEvicted << " levels evicted, " << residency.shrinksPending << " shrinks pending" << std::endl;
+			}
+			if (streamed_textures_added)
+			{
+				resident_bytes_total += static_cast<double>(residency.residentBytes);
+				pending_levels_total += static_cast<double>(residency.pendingLevels);
+				resident_bytes_peak = std::max(resident_bytes_peak, residency.residentBytes);
+				++residency_frames;
+				settled_frame = settled_frame == 0 && residency.pendingLevels == 0 ? frames + 1 : settled_frame;
+
+				// the storage is reallocated when it grows or shrinks, bound again every frame
+				texture = texture_residency->getTexture(0);
+				texture2 = texture_residency->getTexture(1);
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, texture);
+				glActiveTexture(GL_TEXTURE1);
+				glBindTexture(GL_TEXTURE_2D, texture2);
+			}
+		}
+
+		glBindVertexArray(geometry_pool ? geometry_pool->getVertexArray() : mesh_buffers.vertexArray != 0 ? mesh_buffers.vertexArray : VAO); // bind object VAO
+		if (instance_stream)
+		{
+			// this frame's instances sit in another region than the last frame's
+			point_instance_attributes(instance_stream->getBuffer(), instance_stream->getRegionOffset());
+		}
 
 		// read more at: https://people.eecs.ku.edu/~jrmiller/Courses/672/InClass/3DModeling/glDrawElements.html
 		// glDrawArrays(GL_TRIANGLES, 0, 3); // draw triangle
-		constexpr int vertices_per_triangle = 3;
-		constexpr int num_of_triangles = 12;
 		constexpr GLenum mode = GL_TRIANGLES; // Specifies what kind of primitives to render.
-		constexpr GLsizei count = vertices_per_triangle * num_of_triangles; // Specifies the number of elements to be rendered.
-		constexpr GLenum type = GL_UNSIGNED_INT; // Specifies the type of the values in indices.Must be one of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT.
+		const auto count = mesh_buffers.vertexArray != 0 ? mesh_buffers.indexCount : static_cast<GLsizei>(cube_index_buffer.count); // Specifies the number of elements to be rendered.
+		const GLenum type = mesh_buffers.vertexArray != 0 ? mesh_buffers.indexType : cube_index_buffer.type; // Specifies the type of the values in indices.Must be one of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT.
 		const GLvoid* indices = nullptr; // Specifies a pointer to the location where the indices are stored
 		// Passing nullptr as the final parameter to glDrawElements tells the vertex fetch processor to use the currently bound element buffer object when extracting per - vertex data for vertex shader executions.
-		glDrawElements(mode, count, type, indices); // draw a quad
+		{
+			PROFILE_SCOPE("draw");
+			PROFILE_GPU_SCOPE("draw");
+			if (geometry_pool)
+			{
+				// the visible instances of shape m are the ones of its run [m * N / M, (m + 1) * N / M),
+				// next to each other in the draw list (sorted by id)
+				pool_commands.clear();
+				std::size_t bucket_ends[poolMaterials];
+				for (std::size_t material = 0; material < pool_buckets; ++material)
+				{
+					for (std::size_t m = material; m < pool_meshes.size(); m += pool_buckets)
+					{
+						const auto run_start = [&](const std::size_t shape)
+						{
+							const std::uint32_t first = static_cast<std::uint32_t>(shape * instance_data.size() / pool_meshes.size());
+							return static_cast<GLuint>(std::lower_bound(draw_ids, draw_ids + visible_count, first) - draw_ids);
+						};
+						const GLuint begin = run_start(m);
+						const GLuint end = run_start(m + 1);
+						if (end > begin)
+						{
+							pool_commands.push_back(geometry_pool->command(pool_meshes[m], end - begin, begin));
+						}
+					}
+					bucket_ends[material] = pool_commands.size();
+				}
+
+				if (indirect_stream)
+				{
+					void* region = indirect_stream->beginWrite();
+					if (region != nullptr)
+					{
+						std::memcpy(region, pool_commands.data(), pool_commands.size() * sizeof(DrawElementsIndirectCommand));
+					}
+					indirect_stream->endWrite(static_cast<GLsizeiptr>(pool_commands.size() * sizeof(DrawElementsIndirectCommand)));
+					glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_stream->getBuffer());
+				}
+
+				for (std::size_t material = 0, bucket_begin = 0; material < pool_buckets; bucket_begin = bucket_ends[material++])
+				{
+					const std::size_t bucket_count = bucket_ends[material] - bucket_begin;
+					if (bucket_count == 0)
+					{
+						continue;
+					}
+
+					// the material: which image each sampler reads
+					if (texture_array == 0)
+					{
+						glActiveTexture(GL_TEXTURE0);
+						glBindTexture(GL_TEXTURE_2D, material == 0 ? texture : texture2);
+						glActiveTexture(GL_TEXTURE1);
+						glBindTexture(GL_TEXTURE_2D, material == 0 ? texture2 : texture);
+					}
+
+					if (indirect_stream)
+					{
+						geometry_pool->multiDraw(indirect_stream->getRegionOffset() + static_cast<GLintptr>(bucket_begin * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(bucket_count));
+						++pool_draw_calls;
+						continue;
+					}
+
+					// no baseInstance before GL 4.2: the instance attributes move to every command's first instance
+					for (std::size_t c = bucket_begin; c < bucket_ends[material]; ++c)
+					{
+						const GLintptr instance_offset = instance_stream ? instance_stream->getRegionOffset() : 0;
+						point_instance_attributes(instance_stream ? instance_stream->getBuffer() : instanceVBO, instance_offset + static_cast<GLintptr>(pool_commands[c].baseInstance * sizeof(InstanceData)));
+						geometry_pool->draw(pool_commands[c]);
+						++pool_draw_calls;
+					}
+				}
+				pool_commands_total += pool_commands.size();
+				++pool_frames;
+			}
+			else if (instanced)
+			{
+				// every visible instance in a single draw call
+				glDrawElementsInstanced(mode, count, type, indices, static_cast<GLsizei>(visible_count));
+			}
+			else
+			{
+				glDrawElements(mode, count, type, indices); // draw a quad
+			}
+		}
+
+		cameraBuffer.endFrame();
+		if (instance_stream)
+		{
+			instance_stream->endFrame();
+		}
+		if (indirect_stream)
+		{
+			indirect_stream->endFrame();
+		}
+
+		// read the GPU timings that are ready, never waits
+		profiler_collect();
+
+		if (window != NULL)
+		{
+			PROFILE_SCOPE("swap buffers");
+			if (offscreen)
+			{
+				int framebufferWidth, framebufferHeight;
+				glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+				offscreen->present(framebufferWidth, framebufferHeight);
+			}
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+		else
+		{
+			// nothing is presented, wait for the GPU so the frame time covers the rendering
+			PROFILE_SCOPE("glFinish");
+			glFinish();
+		}
+		if (!options.headless || frames >= options.warmupFrames)
+		{
+			frameStats.addFrame(std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+		}
+		++frames;
+	}
+	frames = frameStats.getFrameCount();
+
+	const FrameTimeSummary frameTimes = frameStats.summarize();
+	const double elapsed = frameTimes.totalMs / 1000.0;
+	const double instancesPerFrame = instanced ? static_cast<double>(options.instances) : 1.0;
+	std::cout << "\n\nDRAW THROUGHPUT:\n";
+	std::cout << "Frames: " << frames << " in " << elapsed << " s" << std::endl;
+	if (frames > 0 && elapsed > 0.0)
+	{
+		std::cout << "Average frame time: " << frameTimes.meanMs << " ms" << std::endl;
+		std::cout << "Median / p95 / p99 frame time: " << frameTimes.medianMs << " / " << frameTimes.p95Ms << " / " << frameTimes.p99Ms << " ms" << std::endl;
+		std::cout << "Cubes per second: " << instancesPerFrame * static_cast<double>(frames) / elapsed << std::endl;
+	}
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	if (culled_frames > 0)
+	{
+		const double visible_per_frame = static_cast<double>(visible_total) / static_cast<double>(culled_frames);
+		std::cout << "\n\nFRUSTUM CULLING (" << (instance_bvh ? "BVH" : "flat") << ", " << transform_kernel_name(best_transform_kernel()) << " kernel):\n";
+		std::cout << "Instances visible / culled per frame: " << visible_per_frame << " / " << static_cast<double>(options.instances) - visible_per_frame << std::endl;
+		std::cout << "Last frame visible / culled: " << visible_count << " / " << options.instances - visible_count << std::endl;
+		if (instance_bvh)
+		{
+			std::cout << "BVH: " << instance_bvh->getNodeCount() << " nodes, depth " << instance_bvh->getDepth() << ", last frame visited " << bvh_stats.nodesVisited
+				<< " (" << bvh_stats.nodesFullyInside << " fully inside), " << bvh_stats.objectsTested << " instances tested" << std::endl;
+		}
+	}
+
+	if (update_frames > 0)
+	{
+		std::cout << "\n\nSCENE UPDATE JOBS:\n";
+		std::cout << "Instances " << (options.animateInstances ? "animated" : "static") << ", " << scene_jobs->getWorkerCount() << " workers, " << instanceJobGrain << " instances per job" << std::endl;
+		std::cout << "Update (animate, cull, draw list) and upload time: " << update_ms_total / static_cast<double>(update_frames) << " ms per frame" << std::endl;
+		const std::vector<JobWorkerStats> workerStats = scene_jobs->getWorkerStats();
+		for (std::size_t i = 0; i < workerStats.size(); ++i)
+		{
+			std::cout << "Worker " << i << ": " << workerStats[i].jobsRun << " jobs (" << workerStats[i].jobsStolen << " stolen), busy "
+				<< workerStats[i].busyMs << " ms, utilization " << 100.0 * workerStats[i].utilization << "%" << std::endl;
+		}
+	}
+
+	if (residency_frames > 0)
+	{
+		const TextureResidencyStats residency = texture_residency->getStats();
+		std::cout << "\n\nTEXTURE RESIDENCY:\n";
+		std::cout << "Budget: " << residency.budgetBytes << " bytes, resident at the end: " << residency.residentBytes << " (peak " << resident_bytes_peak << ", "
+			<< resident_bytes_total / static_cast<double>(residency_frames) << " per frame)" << std::endl;
+		std::cout << "Finest levels resident (wall / face): " << texture_residency->getResidentLevel(0) << " / " << texture_residency->getResidentLevel(1)
+			<< ", pending levels per frame: " << pending_levels_total / static_cast<double>(residency_frames) << std::endl;
+		if (settled_frame > 0)
+		{
+			std::cout << "Every requested level resident from frame " << settled_frame - 1 << std::endl;
+		}
+		std::cout << "Bytes uploaded: " << residency.totalBytesUploaded << ", levels evicted: " << residency.totalLevelsEvicted << ", storage reallocations: " << residency.reallocations << std::endl;
+	}
+
+	if (pool_frames > 0)
+	{
+		std::cout << "\n\nGEOMETRY POOL DRAWS (" << (indirect_stream ? "glMultiDrawElementsIndirect" : "glDrawElementsInstancedBaseVertex") << "):\n";
+		std::cout << "Draw calls per frame: " << static_cast<double>(pool_draw_calls) / static_cast<double>(pool_frames) << " for " << pool_meshes.size()
+			<< " meshes in " << pool_buckets << " material buckets (" << static_cast<double>(pool_commands_total) / static_cast<double>(pool_frames) << " commands)" << std::endl;
+	}
+
+	const UniformCacheStats uniformStats = Shader::getUniformCacheStats();
+	std::cout << "\n\nUNIFORM LOCATION CACHE:\n";
+	std::cout << "Driver lookups (glGetUniformLocation): " << uniformStats.driverLookups << std::endl;
+	std::cout << "Driver lookups avoided: " << uniformStats.lookupsAvoided << std::endl;
+
+	const ShaderSourceCacheStats sourceCacheStats = shader_source_cache().getStats();
+	std::cout << "\n\nSHADER SOURCE CACHE:\n";
+	std::cout << "Files mapped: " << sourceCacheStats.misses << ", reused: " << sourceCacheStats.hits << ", unreadable: " << sourceCacheStats.failures << std::endl;
+
+	const ShaderRegistryStats registryStats = shader_registry().getStats();
+	std::cout << "\n\nSHADER REGISTRY:\n";
+	std::cout << "Live programs: " << shader_registry().getLiveCount() << std::endl;
+	std::cout << "Programs created: " << registryStats.programsCreated << ", shared: " << registryStats.programsShared << ", replaced: " << registryStats.programsReplaced << std::endl;
+
+	const ShaderHotReloadStats hotReloadStats = shaderHotReload.getStats();
+	std::cout << "\n\nSHADER HOT RELOAD:\n";
+	std::cout << "Watching: " << (shaderHotReload.isWatching() ? shaderHotReload.getWatchBackend() : "no") << std::endl;
+	std::cout << "Reloads applied: " << hotReloadStats.reloadsApplied << ", failed builds: " << hotReloadStats.buildsFailed << ", dropped: " << hotReloadStats.reloadsDropped << std::endl;
+	std::cout << "Last build (compile + link on the worker): " << hotReloadStats.lastBuildMs << " ms" << std::endl;
+	shaderHotReload.stop();
+
+	const ProgramBinaryCacheStats binaryCacheStats = program_binary_cache().getStats();
+	std::cout << "\n\nPROGRAM BINARY CACHE:\n";
+	std::cout << "Available: " << (program_binary_cache().isAvailable() ? "yes" : "no") << std::endl;
+	std::cout << "Hits: " << binaryCacheStats.hits << ", misses: " << binaryCacheStats.misses << ", rejected: " << binaryCacheStats.rejected << ", stored: " << binaryCacheStats.stored << std::endl;
+
+	std::cout << "\n\nCAMERA UNIFORM BUFFER:\n";
+	std::cout << "Persistently mapped: " << (cameraBuffer.isPersistentlyMapped() ? "yes" : "no") << std::endl;
+	std::cout << "Fence waits: " << cameraBuffer.getFenceWaits() << std::endl;
+
+	if (instance_stream)
+	{
+		std::cout << "\n\nINSTANCE STREAMING BUFFER:\n";
+		std::cout << "Persistently mapped: " << (instance_stream->isPersistentlyMapped() ? "yes" : "no") << ", " << StreamingBuffer::FRAMES << " regions of " << instance_stream->getRegionCapacity() << " bytes" << std::endl;
+		std::cout << "Bytes streamed: " << instance_stream->getBytesStreamed();
+		if (update_frames > 0)
+		{
+			std::cout << " (" << static_cast<double>(instance_stream->getBytesStreamed()) / static_cast<double>(update_frames) << " per frame)";
+		}
+		std::cout << std::endl;
+		std::cout << "Fence waits: " << instance_stream->getFenceWaits() << std::endl;
+	}
+
+	if (!options.tracePath.empty())
+	{
+		// queries still in flight at the end of the run are the only ones waited for
+		const unsigned long long queriesInFlight = profiler_stats().gpuQueriesInFlight;
+		if (profiler_write_trace(options.tracePath.c_str()))
+		{
+			const ProfilerStats profilerStats = profiler_stats();
+			std::cout << "\n\nPROFILER:\n";
+			std::cout << "Trace written to " << options.tracePath << std::endl;
+			std::cout << "CPU events: " << profilerStats.cpuEvents << std::endl;
+			std::cout << "GPU events: " << profilerStats.gpuEvents << " (" << queriesInFlight << " were still in flight at exit)" << std::endl;
+			std::cout << "Nested GPU scopes skipped: " << profilerStats.gpuScopesSkipped << std::endl;
+			std::cout << "Invalid GPU results discarded: " << profilerStats.gpuResultsDiscarded << std::endl;
+		}
+	}
+
+	if (options.headless)
+	{
+		BenchmarkReport report;
+		report.backend = headlessContext.getBackend();
+		report.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+		report.width = W;
+		report.height = H;
+		report.instances = options.instances;
+		report.visiblePerFrame = culled_frames > 0 ? static_cast<double>(visible_total) / static_cast<double>(culled_frames) : static_cast<double>(options.instances);
+		report.drawsPerFrame = pool_frames > 0 ? static_cast<std::size_t>(pool_draw_calls / pool_frames) : 1;
+		report.frameTimes = frameTimes;
+
+		if (options.jsonPath.empty())
+		{
+			std::cout << "\n\nBENCHMARK:\n";
+			write_benchmark_json(std::cout, report);
+		}
+		else
+		{
+			std::ofstream json(options.jsonPath);
+			write_benchmark_json(json, report);
+			std::cout << "\n\nBenchmark written to " << options.jsonPath << std::endl;
+		}
 	}
 
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteBuffers(1, &material_buffer);
+	glDeleteTextures(1, &texture_array);
+	delete_mesh_buffers(mesh_buffers);
+
 	return 0;
 }
 
+AppOptions parse_options(int argc, char** argv)
+{
+	AppOptions options;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+		{
+			options.instances = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--instance-extent") == 0 && i + 1 < argc)
+		{
+			options.instanceExtent = std::strtof(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--culling") == 0 && i + 1 < argc)
+		{
+			// flat (default), bvh or off
+			++i;
+			options.culling = std::strcmp(argv[i], "off") == 0 ? AppOptions::Culling::Off : std::strcmp(argv[i], "bvh") == 0 ? AppOptions::Culling::Bvh : AppOptions::Culling::Flat;
+		}
+		else if (std::strcmp(argv[i], "--animate") == 0)
+		{
+			options.animateInstances = true;
+		}
+		else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+		{
+			options.jobWorkers = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			options.headless = true;
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			options.frames = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+		{
+			options.warmupFrames = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			options.jsonPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			options.tracePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+		{
+			// standard (default), reversed or reversed-infinite
+			++i;
+			options.depthMode = std::strcmp(argv[i], "reversed") == 0 ? DepthMode::ReversedZ
+				: std::strcmp(argv[i], "reversed-infinite") == 0 ? DepthMode::ReversedZInfinite : DepthMode::Standard;
+		}
+		else if (std::strcmp(argv[i], "--no-hot-reload") == 0)
+		{
+			options.hotReload = false;
+		}
+		else if (std::strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc)
+		{
+			// compact (default) or float
+			options.compactVertices = std::strcmp(argv[++i], "float") != 0;
+		}
+		else if (std::strcmp(argv[i], "--fetch-benchmark") == 0 && i + 1 < argc)
+		{
+			options.fetchBenchmarkVertices = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--camera-benchmark") == 0 && i + 2 < argc)
+		{
+			options.cameraBenchmarkPrograms = std::strtoull(argv[++i], nullptr, 10);
+			options.cameraBenchmarkDraws = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--projection-benchmark") == 0 && i + 1 < argc)
+		{
+			options.projectionBenchmarkMatrices = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--matrix-benchmark") == 0 && i + 1 < argc)
+		{
+			options.matrixBenchmarkOperations = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--mesh-optimizer-report") == 0)
+		{
+			options.meshOptimizerReport = true;
+		}
+		else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+		{
+			options.meshPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--convert-mesh") == 0 && i + 2 < argc)
+		{
+			options.convertInput = argv[++i];
+			options.convertOutput = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--pool-meshes") == 0 && i + 1 < argc)
+		{
+			options.poolMeshes = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--atlas") == 0)
+		{
+			options.textureAtlas = true;
+		}
+		else if (std::strcmp(argv[i], "--atlas-file") == 0 && i + 1 < argc)
+		{
+			options.textureAtlas = true;
+			options.atlasPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--pack-textures") == 0 && i + 2 < argc)
+		{
+			// every following argument up to the next option is an image
+			options.packOutput = argv[++i];
+			while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0)
+			{
+				options.packInputs.push_back(argv[++i]);
+			}
+		}
+		else if (std::strcmp(argv[i], "--textures") == 0 && i + 2 < argc)
+		{
+			options.texturePaths[0] = argv[++i];
+			options.texturePaths[1] = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--stream-textures") == 0)
+		{
+			options.streamTextures = true;
+		}
+		else if (std::strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+		{
+			// in KiB
+			options.streamTextures = true;
+			options.textureBudget = std::strtoull(argv[++i], nullptr, 10) * 1024;
+		}
+		else if (std::strcmp(argv[i], "--compress-texture") == 0 && i + 3 < argc)
+		{
+			options.compressInput = argv[++i];
+			options.compressOutput = argv[++i];
+			if (!parse_block_format(argv[++i], options.compressFormat))
+			{
+				std::cout << "Unknown block format: " << argv[i] << ", compressing as " << block_format_name(options.compressFormat) << "\n";
+			}
+		}
+		else
+		{
+			std::cout << "Unknown option: " << argv[i] << "\n";
+			std::cout << "Usage: " << argv[0] << " [--instances N] [--instance-extent E] [--culling flat|bvh|off] [--animate] [--jobs N] [--headless] [--frames N] [--warmup N] [--json file] [--trace file] [--depth standard|reversed|reversed-infinite] [--no-hot-reload] [--vertex-format compact|float] [--fetch-benchmark N] [--camera-benchmark programs draws] [--projection-benchmark N] [--matrix-benchmark N] [--mesh-optimizer-report] [--mesh file.mesh] [--pool-meshes N] [--atlas] [--atlas-file file.atlas] [--convert-mesh in.obj|in.gltf|in.glb out.mesh] [--pack-textures out.atlas images...] [--textures wall face] [--stream-textures] [--texture-budget KiB] [--compress-texture in out.ktx2 bc1|bc3|bc7|etc2]\n";
+		}
+	}
+
+	// one instance per pool shape at least
+	if (options.poolMeshes > 0)
+	{
+		options.instances = std::max(options.instances, options.poolMeshes);
+	}
+
+	// the material index is instance data, and the atlas samples its own texture array
+	if (options.textureAtlas)
+	{
+		options.instances = std::max<std::size_t>(options.instances, 1);
+		options.streamTextures = false;
+	}
+	return options;
+}
+
+std::vector<float> make_fetch_benchmark_mesh(std::size_t vertexCount)
+{
+	// position in [-0.5, 0.5]^3, color and texture coordinates in [0, 1], from a cheap deterministic sequence
+	std::vector<float> vertices(vertexCount * 8);
+	unsigned int state = 12345u;
+	for (float& value : vertices)
+	{
+		state = state * 1664525u + 1013904223u;
+		value = static_cast<float>(state >> 8) / 16777216.0f;
+	}
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			vertices[v * 8 + c] -= 0.5f;
+		}
+	}
+	return vertices;
+}
+
+void make_shuffled_grid(std::size_t side, std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+	// side x side vertices in the z = 0 plane, 8 floats each like the cube (position, color, uv)
+	vertices.clear();
+	for (std::size_t y = 0; y < side; ++y)
+	{
+		for (std::size_t x = 0; x < side; ++x)
+		{
+			const float u = static_cast<float>(x) / static_cast<float>(side - 1);
+			const float v = static_cast<float>(y) / static_cast<float>(side - 1);
+			const float vertex[8] = { u - 0.5f, v - 0.5f, 0.0f, u, v, 1.0f, u, v };
+			vertices.insert(vertices.end(), vertex, vertex + 8);
+		}
+	}
+
+	indices.clear();
+	for (std::size_t y = 0; y + 1 < side; ++y)
+	{
+		for (std::size_t x = 0; x + 1 < side; ++x)
+		{
+			const auto i = static_cast<unsigned int>(y * side + x);
+			const auto s = static_cast<unsigned int>(side);
+			const unsigned int quad[6] = { i, i + 1, i + s, i + 1, i + s + 1, i + s };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	// triangles in random order (Fisher-Yates), the worst case for the vertex cache
+	unsigned int state = 12345u;
+	for (std::size_t t = indices.size() / 3; t > 1; --t)
+	{
+		state = state * 1664525u + 1013904223u;
+		const std::size_t other = (state >> 8) % t;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			std::swap(indices[(t - 1) * 3 + corner], indices[other * 3 + corner]);
+		}
+	}
+}
+
 void resize_framebuffer_cb(GLFWwindow* window, int w, int h)
 {
 	glViewport(0, 0, w, h);
@@ -400,44 +1766,126 @@ void process_input(GLFWwindow* window)
 	}
 }
 
-const float* my_perspective(const float fovY, const float aspect, const float near, const float far)
+void make_pool_mesh(std::size_t variant, std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+	// a solid of revolution around y filling [-0.5, 0.5]^3, 8 floats per vertex like the cube:
+	// 3 to 10 sides, 1 to 4 rings and one of four profiles (prism, cone, barrel, flared)
+	const std::size_t sides = 3 + variant % 8;
+	const std::size_t rings = 1 + (variant / 8) % 4;
+	const std::size_t profile = (variant / 32) % 4;
+	const auto radius = [profile](const float t)
+	{
+		switch (profile)
+		{
+		case 1: return 0.5f * (1.0f - t);
+		case 2: return 0.5f * std::sin(3.14159265f * (0.15f + 0.7f * t));
+		case 3: return 0.5f * (0.4f + 0.6f * t);
+		default: return 0.5f;
+		}
+	};
+
+	vertices.clear();
+	const auto add_vertex = [&vertices](const float x, const float y, const float z, const float u, const float v)
+	{
+		const float vertex[8] = { x, y, z, x + 0.5f, y + 0.5f, z + 0.5f, u, v };
+		vertices.insert(vertices.end(), vertex, vertex + 8);
+	};
+	for (std::size_t ring = 0; ring <= rings; ++ring)
+	{
+		const float t = static_cast<float>(ring) / static_cast<float>(rings);
+		for (std::size_t side = 0; side <= sides; ++side)
+		{
+			// the last column repeats the first with u = 1
+			const float u = static_cast<float>(side) / static_cast<float>(sides);
+			const float angle = 6.28318531f * u;
+			add_vertex(radius(t) * std::cos(angle), t - 0.5f, radius(t) * std::sin(angle), u, t);
+		}
+	}
+	const auto bottom = static_cast<unsigned int>(vertices.size() / 8);
+	add_vertex(0.0f, -0.5f, 0.0f, 0.5f, 0.0f);
+	add_vertex(0.0f, 0.5f, 0.0f, 0.5f, 1.0f);
+
+	indices.clear();
+	const auto columns = static_cast<unsigned int>(sides + 1);
+	const auto top_ring = static_cast<unsigned int>(rings) * columns;
+	for (unsigned int ring = 0; ring < rings; ++ring)
+	{
+		for (unsigned int side = 0; side < sides; ++side)
+		{
+			const unsigned int i = ring * columns + side;
+			const unsigned int quad[6] = { i, i + 1, i + columns, i + 1, i + columns + 1, i + columns };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	for (unsigned int side = 0; side < sides; ++side)
+	{
+		const unsigned int caps[6] = { bottom, side, side + 1, bottom + 1, top_ring + side, top_ring + side + 1 };
+		indices.insert(indices.end(), caps, caps + 6);
+	}
+
+	// the shape is convex around the origin: a triangle faces out when its counter clockwise
+	// normal points away from the origin, flip those so every front face winds clockwise.
+	// Triangles collapsed onto the apex of a cone are dropped
+	std::size_t kept = 0;
+	for (std::size_t t = 0; t < indices.size(); t += 3)
+	{
+		const float* a = &vertices[indices[t] * 8];
+		const float* b = &vertices[indices[t + 1] * 8];
+		const float* c = &vertices[indices[t + 2] * 8];
+		const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		const float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+		const float area = normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2];
+		if (area < 1e-12f)
+		{
+			continue;
+		}
+		const float outward = normal[0] * (a[0] + b[0] + c[0]) + normal[1] * (a[1] + b[1] + c[1]) + normal[2] * (a[2] + b[2] + c[2]);
+		indices[kept] = indices[t];
+		indices[kept + 1] = outward > 0.0f ? indices[t + 2] : indices[t + 1];
+		indices[kept + 2] = outward > 0.0f ? indices[t + 1] : indices[t + 2];
+		kept += 3;
+	}
+	indices.resize(kept);
+}
+
+AtlasImage make_atlas_tile(std::size_t variant, int width, int height)
 {
-	// OpenGL is column major... so it expects something like { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, transX, transY, transZ, 1 }
-	// Formula and theory from here: https://www.scratchapixel.com/lessons/3d-basic-rendering/perspective-and-orthographic-projection-matrix/opengl-perspective-projection-matrix
-	//std::unique_ptr<float> projectionMatrix = std::unique_ptr<float>{  };
-	const auto projectionMatrix = new float[16];
-
-	// Calculate top and bottom (at near plane)
-	const float top = tan(fovY / 2.0f) * near;
-	const float bottom = -top;
-
-	// Calculate left and right (at near plane)
-	const float left = -top * aspect;
-	const float right = top * aspect;
-	
-	// First column
-	projectionMatrix[0] = (2.0f * near) / (right - left);
-	projectionMatrix[1] = 0.0f;
-	projectionMatrix[2] = 0.0f;
-	projectionMatrix[3] = 0.0f;
-
-	// Second column
-	projectionMatrix[4] = 0.0f;
-	projectionMatrix[5] = (2.0f * near) / (top - bottom);
-	projectionMatrix[6] = 0.0f;
-	projectionMatrix[7] = 0.0f;
-	
-	// Second column
-	projectionMatrix[8] = (right + left) / (right - left);
-	projectionMatrix[9] = (top + bottom) / (top - bottom);
-	projectionMatrix[10] = -(far + near) / (far - near);
-	projectionMatrix[11] = -1.0f;
-	
-	// Second column
-	projectionMatrix[12] = 0.0f;
-	projectionMatrix[13] = 0.0f;
-	projectionMatrix[14] = -(2.0f * far * near) / (far - near);
-	projectionMatrix[15] = 0.f;
-
-	return projectionMatrix;
+	// an image of an odd size for the atlas: stripes, rings or checkers in a color of its own,
+	// framed by a dark border so bleeding from a neighbour would show
+	AtlasImage image;
+	image.name = "tile" + std::to_string(variant);
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(static_cast<std::size_t>(width) * height * 4);
+
+	const float hue = 6.28318531f * static_cast<float>(variant) / 8.0f;
+	const float color[3] = { 0.5f + 0.5f * std::cos(hue), 0.5f + 0.5f * std::cos(hue - 2.0943951f), 0.5f + 0.5f * std::cos(hue + 2.0943951f) };
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+			const float v = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+			float shade;
+			switch (variant % 3)
+			{
+			case 0: shade = std::fmod(8.0f * (u + v), 1.0f) < 0.5f ? 1.0f : 0.45f; break;
+			case 1: shade = std::fmod(10.0f * std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)), 1.0f) < 0.5f ? 1.0f : 0.45f; break;
+			default: shade = ((x / 16) + (y / 16)) % 2 == 0 ? 1.0f : 0.45f; break;
+			}
+			if (x < 4 || y < 4 || x >= width - 4 || y >= height - 4)
+			{
+				shade = 0.15f;
+			}
+
+			unsigned char* texel = &image.pixels[(static_cast<std::size_t>(y) * width + x) * 4];
+			for (int c = 0; c < 3; ++c)
+			{
+				texel[c] = static_cast<unsigned char>(255.0f * color[c] * shade);
+			}
+			texel[3] = 255;
+		}
+	}
+	return image;
 }
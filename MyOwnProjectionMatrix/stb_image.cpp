@@ -1,3 +1,3 @@
 #define STB_IMAGE_IMPLEMENTATION
-#include <stb\stb_image.h>
+#include <stb/stb_image.h>
 // here will be the implementation of the image loader stb
\ No newline at end of file